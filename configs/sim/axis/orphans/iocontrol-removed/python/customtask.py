@@ -111,9 +111,7 @@ class CustomTask(emctask.Task,UserFuncs):
             self.io.aux.estop = 1
             self._callback = None
             self._check = None
-            tt = self.io.tool.toolTable
-            for p in range(0,len(tt)):
-                tt[p].zero()
+            self.io.tool.toolTable.clear(0)
             UserFuncs.__init__(self)
             self.enqueue = EnqueueCall(self)
         except Exception,e:
@@ -138,7 +136,7 @@ class CustomTask(emctask.Task,UserFuncs):
             self.hal_init_pins()
             # on nonrandom machines, always start by assuming the spindle is empty
             if not self.random_toolchanger:
-                 self.io.tool.toolTable[0].zero()
+                 self.zero_pocket(0)
 
             if self.inifile.find("TOOL", "ODBC_CONNECT"):
                 import sqltoolaccess
@@ -214,14 +212,20 @@ class CustomTask(emctask.Task,UserFuncs):
             if toolno == t[p].toolno:
                 self.load_tool(p)
 
+    def zero_pocket(self,pocket):
+        # toolTable entries are copies, store the changed entry back
+        t = self.io.tool.toolTable[pocket]
+        t.zero()
+        self.io.tool.toolTable[pocket] = t
+
     def load_tool(self,pocket):
         if self.random_toolchanger:
-            self.io.tool.toolTable[0],self.io.tool.toolTable[pocket] = self.io.tool.toolTable[pocket],self.io.tool.toolTable[0]
+            self.io.tool.toolTable.swap(0,pocket)
             self.comments[0],self.comments[pocket] = self.comments[pocket],self.comments[0]
             self.tt.save_table(self.io.tool.toolTable,self.comments,self.fms)
         else:
             if pocket == 0:
-                self.io.tool.toolTable[0].zero()
+                self.zero_pocket(0)
             else:
                 self.io.tool.toolTable[0] = self.io.tool.toolTable[pocket]
 
@@ -289,12 +293,14 @@ class CustomTask(emctask.Task,UserFuncs):
     def emcToolSetOffset(self,pocket,toolno,offset,diameter,frontangle,backangle,orientation):
         if debug(): print "py:  emcToolSetOffset", pocket,toolno,str(offset),diameter,frontangle,backangle,orientation
 
-        self.io.tool.toolTable[pocket].toolno = toolno
-        self.io.tool.toolTable[pocket].orientation = orientation
-        self.io.tool.toolTable[pocket].diameter = diameter
-        self.io.tool.toolTable[pocket].frontangle = frontangle
-        self.io.tool.toolTable[pocket].backangle = backangle
-        self.io.tool.toolTable[pocket].offset = offset
+        t = self.io.tool.toolTable[pocket]
+        t.toolno = toolno
+        t.orientation = orientation
+        t.diameter = diameter
+        t.frontangle = frontangle
+        t.backangle = backangle
+        t.offset = offset
+        self.io.tool.toolTable[pocket] = t
 
         if debug(): print "new tool enttry: ",str(self.io.tool.toolTable[pocket])
 
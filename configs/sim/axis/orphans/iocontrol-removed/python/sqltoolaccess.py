@@ -68,6 +68,7 @@ class SqlToolAccess(object):
                 t.offset.z = row.z_offset
                 t.offset.a = row.a_offset
                 t.offset.b = row.b_offset
+                tooltable[pocket] = t # entries are copies
                 t.offset.c = row.c_offset
                 t.offset.u = row.u_offset
                 t.offset.v = row.v_offset
@@ -89,23 +89,25 @@ class EmcToolTable(object):
             print "max pocket number is %d. skipping tool %d" % (len(tooltable) - 1, toolno)
             return
 
-        tooltable[pocket].zero()
+        t = tooltable[pocket]
+        t.zero()
         for (key,value) in entry.items():
-            if key == 'T' : tooltable[pocket].toolno = value
-            if key == 'Q' : tooltable[pocket].orientation = value
-            if key == 'D' : tooltable[pocket].diameter = value
-            if key == 'I' : tooltable[pocket].frontangle = value
-            if key == 'J' : tooltable[pocket].backangle = value
-            if key == 'X' : tooltable[pocket].offset.x = value
-            if key == 'Y' : tooltable[pocket].offset.y = value
-            if key == 'Z' : tooltable[pocket].offset.z = value
-            if key == 'A' : tooltable[pocket].offset.a = value
-            if key == 'B' : tooltable[pocket].offset.b = value
-            if key == 'C' : tooltable[pocket].offset.c = value
-            if key == 'U' : tooltable[pocket].offset.u = value
-            if key == 'V' : tooltable[pocket].offset.v = value
-            if key == 'W' : tooltable[pocket].offset.w = value
+            if key == 'T' : t.toolno = value
+            if key == 'Q' : t.orientation = value
+            if key == 'D' : t.diameter = value
+            if key == 'I' : t.frontangle = value
+            if key == 'J' : t.backangle = value
+            if key == 'X' : t.offset.x = value
+            if key == 'Y' : t.offset.y = value
+            if key == 'Z' : t.offset.z = value
+            if key == 'A' : t.offset.a = value
+            if key == 'B' : t.offset.b = value
+            if key == 'C' : t.offset.c = value
+            if key == 'U' : t.offset.u = value
+            if key == 'V' : t.offset.v = value
+            if key == 'W' : t.offset.w = value
             if key == 'comment' : comments[pocket] = value # aaargh
+        tooltable[pocket] = t # entries are copies
 
     def parseline(self,lineno,line):
         """
@@ -83,6 +83,9 @@ class GLCanon(Translated, ArcsToSegmentsMixin):
         self.feed = []; self.feed_append = self.feed.append
         # arcfeed list - [line number, [start position], [end position], feedrate, [tlo x, tlo y, tlo z]]
         self.arcfeed = []; self.arcfeed_append = self.arcfeed.append
+        # arcs not yet turned into arcfeed items, see flush_arcs
+        self.arcs = []; self.arcs_append = self.arcs.append
+        self.arc_frame = None
         # dwell list - [line number, color, pos x, pos y, pos z, plane]
         self.dwells = []; self.dwells_append = self.dwells.append
         self.choice = None
@@ -187,7 +190,27 @@ class GLCanon(Translated, ArcsToSegmentsMixin):
     def draw_dwells(self, dwells, alpha, for_selection, j0=0):
         return linuxcnc.draw_dwells(self.geometry, dwells, alpha, for_selection, self.is_lathe())
 
+    def index_lines(self, index, lines):
+        if self.is_foam:
+            index.add_lines('XY', lines, self.foam_z)
+            index.add_lines('UV', lines, self.foam_w)
+        else:
+            index.add_lines(self.geometry, lines)
+
+    def pick_index(self, rapids):
+        # Same segments as draw(1, not rapids), for picking without GL_SELECT
+        index = linuxcnc.pickindex()
+        if rapids:
+            self.index_lines(index, self.traverse)
+        else:
+            self.index_lines(index, self.feed)
+            self.index_lines(index, self.arcfeed)
+            index.add_dwells(self.dwells)
+        index.build()
+        return index
+
     def calc_extents(self):
+        self.flush_arcs()
         self.min_extents, self.max_extents, self.min_extents_notool, self.max_extents_notool = gcode.calc_extents(self.arcfeed, self.feed, self.traverse)
         if self.is_foam:
             min_z = min(self.foam_z, self.foam_w)
@@ -237,14 +260,56 @@ class GLCanon(Translated, ArcsToSegmentsMixin):
 #        self.dwells_append((self.lineno, self.colors['dwell'], x + self.offset_x, y + self.offset_y, z + self.offset_z, 0))
         self.feed_append((self.lineno, l, self.lo, self.feedrate, [self.xo, self.yo, self.zo]))
 
-    def arc_feed(self, *args):
+    # Arcs are only recorded while the program is parsed, with the
+    # coordinate system they were programmed in; flush_arcs() turns all of
+    # them into segments at once, which gcode does on several threads.
+    def set_g5x_offset(self, *args):
+        Translated.set_g5x_offset(self, *args)
+        self.arc_frame = None
+
+    def set_g92_offset(self, *args):
+        Translated.set_g92_offset(self, *args)
+        self.arc_frame = None
+
+    def set_xy_rotation(self, theta):
+        Translated.set_xy_rotation(self, theta)
+        self.arc_frame = None
+
+    def set_plane(self, plane):
+        ArcsToSegmentsMixin.set_plane(self, plane)
+        self.arc_frame = None
+
+    def get_arc_frame(self):
+        if self.arc_frame is None:
+            self.arc_frame = (self.plane, self.rotation_cos, self.rotation_sin,
+                (self.g5x_offset_x, self.g5x_offset_y, self.g5x_offset_z,
+                 self.g5x_offset_a, self.g5x_offset_b, self.g5x_offset_c,
+                 self.g5x_offset_u, self.g5x_offset_v, self.g5x_offset_w),
+                (self.g92_offset_x, self.g92_offset_y, self.g92_offset_z,
+                 self.g92_offset_a, self.g92_offset_b, self.g92_offset_c,
+                 self.g92_offset_u, self.g92_offset_v, self.g92_offset_w))
+        return self.arc_frame
+
+    def arc_feed(self, x1, y1, cx, cy, rot, z1, a, b, c, u, v, w):
         if self.suppress > 0: return
         self.first_move = False
-        self.in_arc = True
-        try:
-            ArcsToSegmentsMixin.arc_feed(self, *args)
-        finally:
-            self.in_arc = False
+        lo = tuple(self.lo)
+        self.arcs_append((self.lineno, lo, self.feedrate,
+            [self.xo, self.yo, self.zo],
+            (x1, y1, cx, cy, rot, z1, a, b, c, u, v, w),
+            self.get_arc_frame()))
+        if self.plane == 1:
+            n = x1, y1, z1
+        elif self.plane == 3:
+            n = y1, z1, x1
+        else:
+            n = z1, x1, y1
+        self.lo = tuple(self.rotate_and_translate(*(n + (a, b, c, u, v, w))))
+
+    def flush_arcs(self):
+        if not self.arcs: return
+        self.arcfeed.extend(gcode.arcs_to_segments(self.arcs, self.arcdivision))
+        del self.arcs[:]
 
     def straight_arcsegments(self, segs):
         self.first_move = False
@@ -414,7 +479,7 @@ class GlCanonDraw:
         self.lp = lp
         self.canon = g
         self._dlists = {}
-        self.select_buffer_size = 100
+        self._pick_index = {}
         self.cached_tool = -1
         self.initialised = 0
         self.no_joint_display = False
@@ -453,41 +518,34 @@ class GlCanonDraw:
 
     def select(self, x, y):
         if self.canon is None: return
-        pmatrix = glGetDoublev(GL_PROJECTION_MATRIX)
-        glMatrixMode(GL_PROJECTION)
-        glPushMatrix()
-        glLoadIdentity()
         vport = glGetIntegerv(GL_VIEWPORT)
-        gluPickMatrix(x, vport[3]-y, 5, 5, vport)
-        glMultMatrixd(pmatrix)
-        glMatrixMode(GL_MODELVIEW)
-
-        while 1:
-            glSelectBuffer(self.select_buffer_size)
-            glRenderMode(GL_SELECT)
-            glInitNames()
-            glPushName(0)
-
-            if self.get_show_rapids():
-                glCallList(self.dlist('select_rapids', gen=self.make_selection_list))
-            glCallList(self.dlist('select_norapids', gen=self.make_selection_list))
-
-            try:
-                buffer = list(glRenderMode(GL_RENDER))
-            except OverflowError:
-                self.select_buffer_size *= 2
-                continue
-            break
-
-        if buffer:
-            min_depth, max_depth, names = min(buffer)
-            self.set_highlight_line(names[0])
+        hits = [self.get_pick_index(False).pick(x, vport[3]-y, 2.5)]
+        if self.get_show_rapids():
+            hits.append(self.get_pick_index(True).pick(x, vport[3]-y, 2.5))
+        hits = [h for h in hits if h is not None]
+
+        if hits:
+            min_depth, line = min(hits)
+            self.set_highlight_line(line)
         else:
             self.set_highlight_line(None)
 
-        glMatrixMode(GL_PROJECTION)
-        glPopMatrix()
-        glMatrixMode(GL_MODELVIEW)
+    def select_box(self, x0, y0, x1, y1):
+        if self.canon is None: return []
+        vport = glGetIntegerv(GL_VIEWPORT)
+        lines = set(self.get_pick_index(False).pick_box(
+                x0, vport[3]-y0, x1, vport[3]-y1))
+        if self.get_show_rapids():
+            lines.update(self.get_pick_index(True).pick_box(
+                x0, vport[3]-y0, x1, vport[3]-y1))
+        return sorted(lines)
+
+    def get_pick_index(self, rapids):
+        canon, index = self._pick_index.get(rapids, (None, None))
+        if canon is not self.canon:
+            index = self.canon.pick_index(rapids)
+            self._pick_index[rapids] = self.canon, index
+        return index
 
     def dlist(self, name, n=1, gen=lambda n: None):
         if name not in self._dlists:
@@ -1744,16 +1802,6 @@ class GlCanonDraw:
             size = [3, 3, 3]
         return mid, size
 
-    def make_selection_list(self, unused=None):
-        select_rapids = self.dlist('select_rapids')
-        select_program = self.dlist('select_norapids')
-        glNewList(select_rapids, GL_COMPILE)
-        if self.canon: self.canon.draw(1, False)
-        glEndList()
-        glNewList(select_program, GL_COMPILE)
-        if self.canon: self.canon.draw(1, True)
-        glEndList()
-
     def make_main_list(self, unused=None):
         program = self.dlist('program_norapids')
         rapids = self.dlist('program_rapids')
@@ -1768,14 +1816,14 @@ class GlCanonDraw:
     def load_preview(self, f, canon, unitcode, initcode, interpname=""):
         self.set_canon(canon)
         result, seq = gcode.parse(f, canon, unitcode, initcode, interpname)
+        canon.flush_arcs()
 
         if result <= gcode.MIN_ERROR:
             self.canon.progress.nextphase(1)
             canon.calc_extents()
             self.stale_dlist('program_rapids')
             self.stale_dlist('program_norapids')
-            self.stale_dlist('select_rapids')
-            self.stale_dlist('select_norapids')
+            self._pick_index.clear()
 
         return result, seq
 
@@ -150,6 +150,9 @@ class StatMixin:
             return tuple(self.tools[pocket])
         return -1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0
 
+    def get_pockets_max(self):
+        return len(self.tools)
+
     def get_external_angular_units(self):
         return self.s.angular_units or 1.0
 
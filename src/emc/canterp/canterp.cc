@@ -82,6 +82,11 @@ public:
     int open(const char *filename);
     int read();
     int read(const char *line);
+    int restore_checkpoint(int line);
+    int save_state(std::string &state);
+    int restore_state(const char *state, size_t length);
+    int runtime_reads();
+    unsigned long long parameter_digest();
     int close();
     int reset();
     int line();
@@ -245,6 +250,29 @@ int Canterp::read() {
     return canterp_parse(buf);
 }
 
+int Canterp::restore_checkpoint(int line) {
+    return 0;
+}
+
+// all of its state is in the canon it reads
+int Canterp::save_state(std::string &state) {
+    state.clear();
+    return INTERP_OK;
+}
+
+int Canterp::restore_state(const char *state, size_t length) {
+    return length == 0 ? INTERP_OK : INTERP_ERROR;
+}
+
+// the canon it reads is the program, nothing else
+int Canterp::runtime_reads() {
+    return 0;
+}
+
+unsigned long long Canterp::parameter_digest() {
+    return 0;
+}
+
 int Canterp::execute(const char *line) {
     int retval;
     double d1, d2, d3, d4, d5, d6, d7, d8, d9, d10, d11;
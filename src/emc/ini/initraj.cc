@@ -217,6 +217,17 @@ static int loadTraj(EmcIniFile *trajInifile)
         old_inihal_data.traj_arc_blend_tangent_kink_ratio = arcBlendTangentKinkRatio;
         //TODO update inihal
 
+        int jointLimitSamples = 0;
+        trajInifile->Find(&jointLimitSamples, "JOINT_LIMIT_SAMPLES", "TRAJ");
+
+        if (jointLimitSamples > 0 &&
+                0 != emcSetJointLimitSamples(jointLimitSamples)) {
+            if (emc_debug & EMC_DEBUG_CONFIG) {
+                rcs_print("bad return value from emcSetJointLimitSamples\n");
+            }
+            return -1;
+        }
+
         double maxFeedScale = 1.0;
         trajInifile->Find(&maxFeedScale, "MAX_FEED_OVERRIDE", "DISPLAY");
 
@@ -69,6 +69,7 @@
 #include "timer.hh"
 #include "rcs_print.hh"
 #include "tool_parse.h"
+#include "tooldata.hh"
 
 static RCS_CMD_CHANNEL *emcioCommandBuffer = 0;
 static RCS_CMD_MSG *emcioCommand = 0;
@@ -76,8 +77,7 @@ static RCS_STAT_CHANNEL *emcioStatusBuffer = 0;
 static EMC_IO_STAT emcioStatus;
 static NML *emcErrorBuffer = 0;
 
-static char *ttcomments[CANON_POCKETS_MAX];
-static int fms[CANON_POCKETS_MAX];
+static ToolData *tooldata = 0;
 static int random_toolchanger = 0;
 
 
@@ -253,67 +253,36 @@ static int iniLoad(const char *filename)
 
 /********************************************************************
 *
-* Description: saveToolTable(const char *filename, CANON_TOOL_TABLE toolTable[])
-*		Saves the tool table from toolTable[] array into file filename.
-*		  Array is CANON_TOOL_MAX + 1 entries, since 0 is included.
+* Description: saveToolTable(const char *filename)
+*		Saves the shared tool table into file filename, or into
+*		the ini file's TOOL_TABLE if filename is empty.
 *
 * Return Value: Zero on success or -1 if file not found.
 *
-* Side Effects: Default setting used if the parameter not found in
-*		the ini file.
-*
 * Called By: main()
 *
 ********************************************************************/
-static int saveToolTable(const char *filename,
-			 CANON_TOOL_TABLE toolTable[])
+static int saveToolTable(const char *filename)
 {
-    int pocket;
-    FILE *fp;
-    const char *name;
-    int start_pocket;
-
-    // check filename
     if (filename[0] == 0) {
-	name = tool_table_file;
-    } else {
-	// point to name provided
-	name = filename;
-    }
-
-    // open tool table file
-    if (NULL == (fp = fopen(name, "w"))) {
-	// can't open file
-	return -1;
-    }
-
-    if(random_toolchanger) {
-        start_pocket = 0;
-    } else {
-        start_pocket = 1;
-    }
-    for (pocket = start_pocket; pocket < CANON_POCKETS_MAX; pocket++) {
-        if (toolTable[pocket].toolno != -1) {
-            fprintf(fp, "T%d P%d", toolTable[pocket].toolno, random_toolchanger? pocket: fms[pocket]);
-            if (toolTable[pocket].diameter) fprintf(fp, " D%f", toolTable[pocket].diameter);
-            if (toolTable[pocket].offset.tran.x) fprintf(fp, " X%+f", toolTable[pocket].offset.tran.x);
-            if (toolTable[pocket].offset.tran.y) fprintf(fp, " Y%+f", toolTable[pocket].offset.tran.y);
-            if (toolTable[pocket].offset.tran.z) fprintf(fp, " Z%+f", toolTable[pocket].offset.tran.z);
-            if (toolTable[pocket].offset.a) fprintf(fp, " A%+f", toolTable[pocket].offset.a);
-            if (toolTable[pocket].offset.b) fprintf(fp, " B%+f", toolTable[pocket].offset.b);
-            if (toolTable[pocket].offset.c) fprintf(fp, " C%+f", toolTable[pocket].offset.c);
-            if (toolTable[pocket].offset.u) fprintf(fp, " U%+f", toolTable[pocket].offset.u);
-            if (toolTable[pocket].offset.v) fprintf(fp, " V%+f", toolTable[pocket].offset.v);
-            if (toolTable[pocket].offset.w) fprintf(fp, " W%+f", toolTable[pocket].offset.w);
-            if (toolTable[pocket].frontangle) fprintf(fp, " I%+f", toolTable[pocket].frontangle);
-            if (toolTable[pocket].backangle) fprintf(fp, " J%+f", toolTable[pocket].backangle);
-            if (toolTable[pocket].orientation) fprintf(fp, " Q%d", toolTable[pocket].orientation);
-            fprintf(fp, " ;%s\n", ttcomments[pocket]);
-        }
+	filename = tool_table_file;
     }
+    return saveToolData(filename, *tooldata, random_toolchanger);
+}
 
-    fclose(fp);
-    return 0;
+/********************************************************************
+*
+* Description: updateToolStatus()
+*		Copies the tool table generation and the spindle pocket
+*		into the status, which does not carry the table itself.
+*
+* Called By: main(), before writing the status
+*
+********************************************************************/
+static void updateToolStatus()
+{
+    emcioStatus.tool.toolTableGeneration = tooldata->generation();
+    tooldata->get(0, emcioStatus.tool.spindleTool);
 }
 
 static int done = 0;
@@ -591,44 +560,46 @@ int read_hal_inputs(void)
 void load_tool(int pocket) {
     if(random_toolchanger) {
         // swap the tools between the desired pocket and the spindle pocket
-        CANON_TOOL_TABLE temp;
-        char *comment_temp;
-
-        temp = emcioStatus.tool.toolTable[0];
-        emcioStatus.tool.toolTable[0] = emcioStatus.tool.toolTable[pocket];
-        emcioStatus.tool.toolTable[pocket] = temp;
+        tooldata->swap(0, pocket);
 
-        comment_temp = ttcomments[0];
-        ttcomments[0] = ttcomments[pocket];
-        ttcomments[pocket] = comment_temp;
-
-        if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable))
+        if (0 != saveToolTable(tool_table_file))
             emcioStatus.status = RCS_ERROR;
     } else if(pocket == 0) {
         // on non-random tool-changers, asking for pocket 0 is the secret
         // handshake for "unload the tool from the spindle"
-	emcioStatus.tool.toolTable[0].toolno = 0;
-        ZERO_EMC_POSE(emcioStatus.tool.toolTable[0].offset);
-        emcioStatus.tool.toolTable[0].diameter = 0.0;
-        emcioStatus.tool.toolTable[0].frontangle = 0.0;
-        emcioStatus.tool.toolTable[0].backangle = 0.0;
-        emcioStatus.tool.toolTable[0].orientation = 0;
+        CANON_TOOL_TABLE empty;
+
+	empty.toolno = 0;
+        ZERO_EMC_POSE(empty.offset);
+        empty.diameter = 0.0;
+        empty.frontangle = 0.0;
+        empty.backangle = 0.0;
+        empty.orientation = 0;
+        tooldata->put(0, empty);
     } else {
         // just copy the desired tool to the spindle
-        emcioStatus.tool.toolTable[0] = emcioStatus.tool.toolTable[pocket];
+        CANON_TOOL_TABLE tool;
+
+        tooldata->get(pocket, tool);
+        tooldata->put(0, tool);
     }
 }
 
 void reload_tool_number(int toolno) {
     if(random_toolchanger) return; // doesn't need special handling here
-    for(int i=1; i<CANON_POCKETS_MAX; i++) {
-        if(emcioStatus.tool.toolTable[i].toolno == toolno) {
-            load_tool(i);
-            break;
-        }
+    int pocket = tooldata->find(toolno);
+    if(pocket > 0) {
+        load_tool(pocket);
     }
 }
 
+static int pocket_toolno(int pocket) {
+    CANON_TOOL_TABLE tool;
+
+    if(tooldata->get(pocket, tool) != 0) return -1;
+    return tool.toolno;
+}
+
 
 /********************************************************************
 *
@@ -658,7 +629,7 @@ int read_tool_inputs(void)
             emcioStatus.tool.toolInSpindle = 0;
         } else {
             // the tool now in the spindle is the one that was prepared
-            emcioStatus.tool.toolInSpindle = emcioStatus.tool.toolTable[emcioStatus.tool.pocketPrepped].toolno; 
+            emcioStatus.tool.toolInSpindle = pocket_toolno(emcioStatus.tool.pocketPrepped);
         }
 	*(iocontrol_data->tool_number) = emcioStatus.tool.toolInSpindle; //likewise in HAL
 	load_tool(emcioStatus.tool.pocketPrepped);
@@ -746,25 +717,18 @@ int main(int argc, char *argv[])
 	return -1;
     }
 
-    for(int i=0; i<CANON_POCKETS_MAX; i++) {
-        ttcomments[i] = (char *)malloc(CANON_TOOL_ENTRY_LEN);
+    tooldata = new ToolData(1);
+    if (!tooldata->valid()) {
+	rcs_print_error("can't create tool table shared memory.\n");
+	return -1;
     }
 
-
     // on nonrandom machines, always start by assuming the spindle is empty
     if(!random_toolchanger) {
-	emcioStatus.tool.toolTable[0].toolno = -1;
-        ZERO_EMC_POSE(emcioStatus.tool.toolTable[0].offset);
-	emcioStatus.tool.toolTable[0].diameter = 0.0;
-        emcioStatus.tool.toolTable[0].frontangle = 0.0;
-        emcioStatus.tool.toolTable[0].backangle = 0.0;
-        emcioStatus.tool.toolTable[0].orientation = 0;
-        fms[0] = 0;
-        ttcomments[0][0] = '\0';
+	tooldata->clear(0);
     }
 
-    if (0 != loadToolTable(tool_table_file, emcioStatus.tool.toolTable,
-		fms, ttcomments, random_toolchanger)) {
+    if (0 != loadToolData(tool_table_file, *tooldata, random_toolchanger)) {
 	rcs_print_error("can't load tool table.\n");
     }
 
@@ -774,7 +738,7 @@ int main(int argc, char *argv[])
     emcioStatus.aux.estop = 1; //estop=1 means to emc that ESTOP condition is met
     emcioStatus.tool.pocketPrepped = -1;
     if (random_toolchanger) {
-        emcioStatus.tool.toolInSpindle = emcioStatus.tool.toolTable[0].toolno;
+        emcioStatus.tool.toolInSpindle = pocket_toolno(0);
     } else {
         emcioStatus.tool.toolInSpindle = 0;
     }
@@ -803,6 +767,7 @@ int main(int argc, char *argv[])
 	    emcioStatus.echo_serial_number =
 		emcioCommand->serial_number;
 	    emcioStatus.heartbeat++;
+	    updateToolStatus();
 	    emcioStatusBuffer->write(&emcioStatus);
 	}
 
@@ -837,8 +802,7 @@ int main(int argc, char *argv[])
 
 	case EMC_TOOL_INIT_TYPE:
 	    rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_INIT\n");
-	    loadToolTable(tool_table_file, emcioStatus.tool.toolTable,
-		    fms, ttcomments, random_toolchanger);
+	    loadToolData(tool_table_file, *tooldata, random_toolchanger);
 	    reload_tool_number(emcioStatus.tool.toolInSpindle);
 	    break;
 
@@ -869,13 +833,15 @@ int main(int argc, char *argv[])
 
                 /* set tool number first */
                 iocontrol_data->tool_prep_index = p;
-                *(iocontrol_data->tool_prep_pocket) = random_toolchanger? p: fms[p];
+                tooldata_entry e;
+                tooldata->get(p, e);
+                *(iocontrol_data->tool_prep_pocket) = random_toolchanger? p: e.fms;
                 if(!random_toolchanger && p == 0) {
                     *(iocontrol_data->tool_prep_number) = 0;
                 } else {
-                    *(iocontrol_data->tool_prep_number) = emcioStatus.tool.toolTable[p].toolno;
+                    *(iocontrol_data->tool_prep_number) = e.tool.toolno;
 		    rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_PREPARE: mismatch: tooltable[%d]=%d, got %d\n", 
-				    p, emcioStatus.tool.toolTable[p].toolno, t);
+				    p, e.tool.toolno, t);
                 }
                 /* then set the prepare pin to tell external logic to get started */
                 *(iocontrol_data->tool_prepare) = 1;
@@ -896,7 +862,7 @@ int main(int argc, char *argv[])
 
             // it's not necessary to load the tool already in the spindle
             if (!random_toolchanger && emcioStatus.tool.pocketPrepped > 0 &&
-                emcioStatus.tool.toolInSpindle == emcioStatus.tool.toolTable[emcioStatus.tool.pocketPrepped].toolno) {
+                emcioStatus.tool.toolInSpindle == pocket_toolno(emcioStatus.tool.pocketPrepped)) {
                 break;
             }
 
@@ -924,8 +890,7 @@ int main(int argc, char *argv[])
 		    ((EMC_TOOL_LOAD_TOOL_TABLE *) emcioCommand)->file;
 		if(!strlen(filename)) filename = tool_table_file;
 		rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_LOAD_TOOL_TABLE\n");
-		if (0 != loadToolTable(filename, emcioStatus.tool.toolTable,
-				  fms, ttcomments, random_toolchanger))
+		if (0 != loadToolData(filename, *tooldata, random_toolchanger))
 		    emcioStatus.status = RCS_ERROR;
 		else
 		    reload_tool_number(emcioStatus.tool.toolInSpindle);
@@ -951,18 +916,20 @@ int main(int argc, char *argv[])
                                 " frontangle=%lf, backangle=%lf, orientation=%d\n",
                                 p, t, offs.tran.z, offs.tran.x, d, f, b, o);
 
-                emcioStatus.tool.toolTable[p].toolno = t;
-                emcioStatus.tool.toolTable[p].offset = offs;
-                emcioStatus.tool.toolTable[p].diameter = d;
-                emcioStatus.tool.toolTable[p].frontangle = f;
-                emcioStatus.tool.toolTable[p].backangle = b;
-                emcioStatus.tool.toolTable[p].orientation = o;
+                CANON_TOOL_TABLE tool;
+                tool.toolno = t;
+                tool.offset = offs;
+                tool.diameter = d;
+                tool.frontangle = f;
+                tool.backangle = b;
+                tool.orientation = o;
+                tooldata->put(p, tool);
 
                 if (emcioStatus.tool.toolInSpindle == t) {
-                    emcioStatus.tool.toolTable[0] = emcioStatus.tool.toolTable[p];
+                    tooldata->put(0, tool);
                 }                    
             }
-	    if (0 != saveToolTable(tool_table_file, emcioStatus.tool.toolTable))
+	    if (0 != saveToolTable(tool_table_file))
 		emcioStatus.status = RCS_ERROR;
 	    break;
 
@@ -971,9 +938,9 @@ int main(int argc, char *argv[])
 		int pocket_number;
 		
 		pocket_number = ((EMC_TOOL_SET_NUMBER *) emcioCommand)->tool;
-		rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_SET_NUMBER old_loaded_tool=%d new_pocket_number=%d new_tool=%d\n", emcioStatus.tool.toolInSpindle, pocket_number, emcioStatus.tool.toolTable[pocket_number].toolno);
+		rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_SET_NUMBER old_loaded_tool=%d new_pocket_number=%d new_tool=%d\n", emcioStatus.tool.toolInSpindle, pocket_number, pocket_toolno(pocket_number));
                 load_tool(pocket_number);
-		emcioStatus.tool.toolInSpindle = emcioStatus.tool.toolTable[pocket_number].toolno;
+		emcioStatus.tool.toolInSpindle = pocket_toolno(pocket_number);
 		*(iocontrol_data->tool_number) = emcioStatus.tool.toolInSpindle; //likewise in HAL
 	    }
 	    break;
@@ -1056,6 +1023,7 @@ int main(int argc, char *argv[])
 	//set above, to allow some commands to fail this
 	//emcioStatus.status = RCS_DONE;
 	emcioStatus.heartbeat++;
+	updateToolStatus();
 	emcioStatusBuffer->write(&emcioStatus);
 
 	esleep(emc_io_cycle_time);
@@ -1079,9 +1047,7 @@ int main(int argc, char *argv[])
 	emcioCommandBuffer = 0;
     }
 
-    for(int i=0; i<CANON_POCKETS_MAX; i++) {
-        free(ttcomments[i]);
-    }
+    delete tooldata;
 
     return 0;
 }
@@ -71,7 +71,29 @@
                     last forward kinematics solution;
 
   genhexkins.max-iterations - maximum number of iterations spent for
-                    a converged solution during current session.
+                    a converged solution during current session;
+
+  genhexkins.iteration-budget - when nonzero, a fixed upper bound on the
+                    iterations spent per call.  If the budget runs out
+                    before convergence the best estimate is returned
+                    anyway (unless it exceeds max-error), and the next
+                    call continues from it.  This makes the worst case
+                    cost of one servo cycle deterministic;
+
+  genhexkins.extrapolate - when true, and the initial value passed in is
+                    the previous solution, start iterating from the
+                    previous solution plus the last change in pose (a
+                    constant velocity extrapolation), which typically
+                    saves one or two iterations per cycle;
+
+  genhexkins.last-error - sum of the strut length errors of the last
+                    solution returned;
+
+  genhexkins.converged - false if the last solution was returned
+                    because the iteration budget was exhausted.
+
+  The Newton-Raphson step solves the 6x6 inverse Jacobian system
+  directly (see solve6-common.h) instead of inverting the matrix.
 
  ----------------------------------------------------------------------------*/
 
@@ -80,6 +102,7 @@
 #include "genhexkins.h"
 #include "kinematics.h"             /* these decls, KINEMATICS_FORWARD_FLAGS */
 #include "hal.h"
+#include "solve6-common.h"          /* solve6() */
 
 struct haldata {
     hal_float_t basex[NUM_STRUTS];
@@ -91,11 +114,19 @@ struct haldata {
     hal_u32_t *last_iter;
     hal_u32_t *max_iter;
     hal_u32_t *iter_limit;
+    hal_u32_t *iter_budget;
+    hal_bit_t *extrapolate;
+    hal_bit_t *converged;
+    hal_float_t *last_error;
     hal_float_t *max_error;
     hal_float_t *conv_criterion;
     hal_float_t *tool_offset;
 } *haldata;
 
+/* the last two solutions of kinematicsForward, used for warm starts */
+static EmcPose fwd_last, fwd_prev;
+static int fwd_solutions;
+
 
 /******************************* MatInvert() ***************************/
 
@@ -332,18 +363,20 @@ int kinematicsForward(const double * joints,
   PmCartesian InvKinStrutVect,InvKinStrutVectUnit;
   PmCartesian q_trans, RMatrix_a, RMatrix_a_cross_Strut;
 
-  double Jacobian[NUM_STRUTS][NUM_STRUTS];
   double InverseJacobian[NUM_STRUTS][NUM_STRUTS];
   double InvKinStrutLength, StrutLengthDiff[NUM_STRUTS];
+  double rhs[NUM_STRUTS];
   double delta[NUM_STRUTS];
   double conv_err = 1.0;
 
   PmRotationMatrix RMatrix;
   PmRpy q_RPY;
+  EmcPose guess;
 
   int iterate = 1;
   int i;
   int iteration = 0;
+  unsigned int limit;
 
   genhexkins_read_hal_pins();
 
@@ -359,15 +392,40 @@ int kinematicsForward(const double * joints,
     return -1;
   }
 
-  /* assign a,b,c to roll, pitch, yaw angles */
-  q_RPY.r = pos->a * PM_PI / 180.0;
-  q_RPY.p = pos->b * PM_PI / 180.0;
-  q_RPY.y = pos->c * PM_PI / 180.0;
+  guess = *pos;
+
+  /* warm start: if we were handed our own previous answer, move the
+     starting point ahead by the last change in pose */
+  if (*haldata->extrapolate && fwd_solutions >= 2 &&
+      guess.tran.x == fwd_last.tran.x &&
+      guess.tran.y == fwd_last.tran.y &&
+      guess.tran.z == fwd_last.tran.z &&
+      guess.a == fwd_last.a &&
+      guess.b == fwd_last.b &&
+      guess.c == fwd_last.c) {
+    guess.tran.x += fwd_last.tran.x - fwd_prev.tran.x;
+    guess.tran.y += fwd_last.tran.y - fwd_prev.tran.y;
+    guess.tran.z += fwd_last.tran.z - fwd_prev.tran.z;
+    guess.a += fwd_last.a - fwd_prev.a;
+    guess.b += fwd_last.b - fwd_prev.b;
+    guess.c += fwd_last.c - fwd_prev.c;
+  }
 
-  /* Assign translation values in pos to q_trans */
-  q_trans.x = pos->tran.x;
-  q_trans.y = pos->tran.y;
-  q_trans.z = pos->tran.z;
+  /* assign a,b,c to roll, pitch, yaw angles */
+  q_RPY.r = guess.a * PM_PI / 180.0;
+  q_RPY.p = guess.b * PM_PI / 180.0;
+  q_RPY.y = guess.c * PM_PI / 180.0;
+
+  /* Assign translation values in guess to q_trans */
+  q_trans.x = guess.tran.x;
+  q_trans.y = guess.tran.y;
+  q_trans.z = guess.tran.z;
+
+  limit = *haldata->iter_limit;
+  if (*haldata->iter_budget && *haldata->iter_budget < limit) {
+    limit = *haldata->iter_budget;
+  }
+  *haldata->converged = 1;
 
   /* Enter Newton-Raphson iterative method   */
   while (iterate) {
@@ -378,15 +436,20 @@ int kinematicsForward(const double * joints,
       return -2;
     };
 
-    iteration++;
-
     /* check iteration to see if the kinematics can reach the
-       convergence criterion and return error flag if it can't */
-    if (iteration > *haldata->iter_limit) {
-      /* we can't converge */
-      return -5;
+       convergence criterion and return error flag if it can't.  With
+       an iteration budget, settle for the current estimate instead */
+    if (iteration >= limit) {
+      if (!*haldata->iter_budget) {
+        /* we can't converge */
+        return -5;
+      }
+      *haldata->converged = 0;
+      break;
     }
 
+    iteration++;
+
     /* Convert q_RPY to Rotation Matrix */
     pmRpyMatConvert(&q_RPY, &RMatrix);
 
@@ -415,11 +478,13 @@ int kinematicsForward(const double * joints,
       InverseJacobian[i][5] = RMatrix_a_cross_Strut.z;
     }
 
-    /* invert Inverse Jacobian */
-    MatInvert(InverseJacobian, Jacobian);
-
-    /* multiply Jacobian by LegLengthDiff */
-    MatMult(Jacobian, StrutLengthDiff, delta);
+    /* solve InverseJacobian * delta = StrutLengthDiff */
+    for (i = 0; i < NUM_STRUTS; i++) {
+      rhs[i] = StrutLengthDiff[i];
+    }
+    if (0 != solve6(InverseJacobian, rhs, delta)) {
+      return -1;
+    }
 
     /* subtract delta from last iterations pos values */
     q_trans.x -= delta[0];
@@ -455,10 +520,17 @@ int kinematicsForward(const double * joints,
   pos->tran.z = q_trans.z;
 
   *haldata->last_iter = iteration;
+  *haldata->last_error = conv_err;
 
-  if (iteration > *haldata->max_iter){
+  if (*haldata->converged && iteration > *haldata->max_iter){
     *haldata->max_iter = iteration;
   }
+
+  fwd_prev = fwd_last;
+  fwd_last = *pos;
+  if (fwd_solutions < 2) {
+    fwd_solutions++;
+  }
   return 0;
 }
 
@@ -585,7 +657,27 @@ int rtapi_app_main(void)
         "genhexkins.limit-iterations")) < 0)
     goto error;
     *haldata->iter_limit = 120;
-    
+
+    if ((res = hal_pin_u32_newf(HAL_IN, &haldata->iter_budget, comp_id,
+        "genhexkins.iteration-budget")) < 0)
+    goto error;
+    *haldata->iter_budget = 0;
+
+    if ((res = hal_pin_bit_newf(HAL_IN, &haldata->extrapolate, comp_id,
+        "genhexkins.extrapolate")) < 0)
+    goto error;
+    *haldata->extrapolate = 0;
+
+    if ((res = hal_pin_bit_newf(HAL_OUT, &haldata->converged, comp_id,
+        "genhexkins.converged")) < 0)
+    goto error;
+    *haldata->converged = 1;
+
+    if ((res = hal_pin_float_newf(HAL_OUT, &haldata->last_error, comp_id,
+        "genhexkins.last-error")) < 0)
+    goto error;
+    *haldata->last_error = 0.0;
+
     if ((res = hal_pin_float_newf(HAL_IN, &haldata->tool_offset, comp_id,
         "genhexkins.tool-offset")) < 0)
     goto error;
@@ -23,6 +23,31 @@
   The parameters for the manipulator are defined by hal pins.
   Currently the type of the joints is hardcoded to ANGULAR, although 
   the kins support both ANGULAR and LINEAR axes.
+
+  For the usual six link DH chain the inverse kinematics use a closed
+  form geometric Jacobian built from the accumulated link frames, and
+  solve the 6x6 Newton step directly (see solve6-common.h).  Other link
+  counts go through the general go_matrix code.
+
+  Parameters to control the inverse kinematics iterations:
+
+  genserkins.max-iterations - give up with an error after this many
+                    iterations;
+
+  genserkins.iteration-budget - when nonzero, a fixed upper bound on the
+                    iterations spent per call.  If the budget runs out
+                    before convergence the best estimate is returned
+                    anyway and the next call continues from it, so the
+                    worst case cost of one servo cycle is deterministic;
+
+  genserkins.extrapolate - when true, and the joint estimate passed in is
+                    the previous solution, start iterating from the
+                    previous solution plus the last change in joints;
+
+  genserkins.last-error - largest joint increment of the last iteration;
+
+  genserkins.converged - false if the last solution was returned because
+                    the iteration budget was exhausted.
   
   TODO:
     * make number of joints a loadtime parameter
@@ -36,6 +61,8 @@
 #include "gomath.h"		/* go_pose */
 #include "genserkins.h"		/* these decls */
 #include "kinematics.h"
+#include "kinematicsbatch.h"	/* kinsPoseArraysGet() */
+#include "solve6-common.h"	/* solve6() */
 
 #ifdef RTAPI
 #include "rtapi.h"
@@ -48,6 +75,10 @@ struct haldata {
     hal_float_t *alpha[GENSER_MAX_JOINTS];
     hal_float_t *d[GENSER_MAX_JOINTS];
     hal_s32_t   unrotate[GENSER_MAX_JOINTS];
+    hal_s32_t   iteration_budget;
+    hal_bit_t   extrapolate;
+    hal_bit_t   converged;
+    hal_float_t last_error;
     genser_struct *kins;
     go_pose *pos;		// used in various functions, we malloc it
 				// only once in rtapi_app_main
@@ -55,6 +86,19 @@ struct haldata {
 
 double j[GENSER_MAX_JOINTS];
 
+/* Warm start state of one caller of the inverse: the joints it was last
+   handed back, and the last two solutions in radians (before unrotate).
+   Only motion's own kinematicsInverse() calls keep one; the TP's joint
+   limit samples come through kinematicsInverseBatch(), which seeds each
+   sample from the one before and leaves this alone. */
+typedef struct {
+    double answer[GENSER_MAX_JOINTS];
+    go_real last[GENSER_MAX_JOINTS], prev[GENSER_MAX_JOINTS];
+    int solutions;
+} genser_warm;
+
+static genser_warm motion_warm;
+
 #define A(i) (*(haldata->a[i]))
 #define ALPHA(i) (*(haldata->alpha[i]))
 #define D(i) (*(haldata->d[i]))
@@ -225,6 +269,84 @@ static int compute_jinv(go_matrix * Jfwd, go_matrix * Jinv)
     return GO_RESULT_OK;
 }
 
+/* closed form Jacobian for a chain of exactly six DH links.
+   Accumulates the link frames in plain 3x3 arrays; the Jacobian column
+   for a revolute joint is z_i x (p_L - p_i) over z_i, for a prismatic
+   joint z_i over 0, all in the {0} frame.  Also returns the pose of the
+   last frame so the caller does not need a separate forward kins pass.
+   Produces the same J as compute_jfwd() followed by the rotation back
+   into {0}, without any go_matrix dimension checking. */
+static int compute_jfwd6(const go_link * links,
+			 const go_real * joints,
+			 double J[6][6],
+			 go_pose * T_L_0)
+{
+    double R[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    double p[3] = {0, 0, 0};
+    double z[6][3], o[6][3];
+    double Rl[3][3], pl[3], Rn[3][3];
+    double sth, cth, sal, cal, theta, d;
+    go_mat mat;
+    int link, row, col, k;
+
+    for (link = 0; link < 6; link++) {
+	if (GO_LINK_DH != links[link].type)
+	    return GO_RESULT_IMPL_ERROR;
+	theta = links[link].u.dh.theta;
+	d = links[link].u.dh.d;
+	if (GO_QUANTITY_LENGTH == links[link].quantity)
+	    d = joints[link];
+	else
+	    theta = joints[link];
+	sth = sin(theta), cth = cos(theta);
+	sal = sin(links[link].u.dh.alpha), cal = cos(links[link].u.dh.alpha);
+
+	/* same link transform as go_dh_pose_convert() */
+	Rl[0][0] = cth,     Rl[0][1] = -sth,     Rl[0][2] = 0.0;
+	Rl[1][0] = sth*cal, Rl[1][1] = cth*cal,  Rl[1][2] = -sal;
+	Rl[2][0] = sth*sal, Rl[2][1] = cth*sal,  Rl[2][2] = cal;
+	pl[0] = links[link].u.dh.a;
+	pl[1] = -sal*d;
+	pl[2] = cal*d;
+
+	for (row = 0; row < 3; row++) {
+	    p[row] += R[row][0]*pl[0] + R[row][1]*pl[1] + R[row][2]*pl[2];
+	    for (col = 0; col < 3; col++) {
+		Rn[row][col] = 0;
+		for (k = 0; k < 3; k++)
+		    Rn[row][col] += R[row][k] * Rl[k][col];
+	    }
+	}
+	for (row = 0; row < 3; row++) {
+	    for (col = 0; col < 3; col++)
+		R[row][col] = Rn[row][col];
+	    z[link][row] = R[row][2];
+	    o[link][row] = p[row];
+	}
+    }
+
+    for (col = 0; col < 6; col++) {
+	double r0 = p[0] - o[col][0];
+	double r1 = p[1] - o[col][1];
+	double r2 = p[2] - o[col][2];
+	if (GO_QUANTITY_LENGTH == links[col].quantity) {
+	    J[0][col] = z[col][0], J[1][col] = z[col][1], J[2][col] = z[col][2];
+	    J[3][col] = 0, J[4][col] = 0, J[5][col] = 0;
+	} else {
+	    J[0][col] = z[col][1]*r2 - z[col][2]*r1;
+	    J[1][col] = z[col][2]*r0 - z[col][0]*r2;
+	    J[2][col] = z[col][0]*r1 - z[col][1]*r0;
+	    J[3][col] = z[col][0], J[4][col] = z[col][1], J[5][col] = z[col][2];
+	}
+    }
+
+    mat.x.x = R[0][0], mat.y.x = R[0][1], mat.z.x = R[0][2];
+    mat.x.y = R[1][0], mat.y.y = R[1][1], mat.z.y = R[1][2];
+    mat.x.z = R[2][0], mat.y.z = R[2][1], mat.z.z = R[2][2];
+    T_L_0->tran.x = p[0], T_L_0->tran.y = p[1], T_L_0->tran.z = p[2];
+    return go_mat_quat_convert(&mat, &T_L_0->rot);
+}
+
 int genser_kin_jac_inv(void *kins,
     const go_pose * pos,
     const go_screw * vel, const go_real * joints, go_real * jointvels)
@@ -387,10 +509,9 @@ int genser_kin_fwd(void *kins, const go_real * joints, go_pose * pos)
     return GO_RESULT_OK;
 }
 
-int kinematicsInverse(const EmcPose * world,
-		      double *joints,
-		      const KINEMATICS_INVERSE_FLAGS * iflags,
-		      KINEMATICS_FORWARD_FLAGS * fflags)
+static int genser_inverse(const EmcPose * world,
+			  double *joints,
+			  genser_warm * warm)
 {
 
     genser_struct *genser = KINS_PTR;
@@ -405,6 +526,10 @@ int kinematicsInverse(const EmcPose * world,
     go_rvec rvec;
     go_cart cart;
     go_link linkout[GENSER_MAX_JOINTS];
+    double J6[6][6];
+    double err, maxerr = 0;
+    int fast;
+    int limit;
     int link;
     int smalls;
     int retval;
@@ -427,30 +552,68 @@ int kinematicsInverse(const EmcPose * world,
     go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
     go_matrix_init(Jinv, Jinv_stg, genser->link_num, 6);
 
-    /* jest[] is a copy of joints[], which is the joint estimate */
+    /* jest[] is a copy of joints[], which is the joint estimate, with
+       the unrotate added at the end taken out again */
     for (link = 0; link < genser->link_num; link++) {
 	// jest, and the rest of joint related calcs are in radians
 	jest[link] = joints[link] * (PM_PI / 180);
+	if ((link) && (haldata->unrotate[link]))
+	    jest[link] -= haldata->unrotate[link] * joints[link-1] * (PM_PI / 180);
     }
 
-    for (genser->iterations = 0; genser->iterations < genser->max_iterations; genser->iterations++) {
-	/* update the Jacobians */
+    /* warm start: if we were handed our own previous answer, move the
+       estimate ahead by the last change in joints */
+    if (warm && haldata->extrapolate && warm->solutions >= 2) {
 	for (link = 0; link < genser->link_num; link++) {
-	    go_link_joint_set(&genser->links[link], jest[link], &linkout[link]);
+	    if (!GO_ROT_CLOSE(joints[link], warm->answer[link]))
+		break;
 	}
-	retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &T_L_0);
-	if (GO_RESULT_OK != retval) {
-	    rtapi_print("ERR kI - compute_jfwd (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
-	    return retval;
-	}
-	retval = compute_jinv(&Jfwd, &Jinv);
-	if (GO_RESULT_OK != retval) {
-	    rtapi_print("ERR kI - compute_jinv (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
-	    return retval;
+	if (link == genser->link_num) {
+	    for (link = 0; link < genser->link_num; link++)
+		jest[link] += warm->last[link] - warm->prev[link];
 	}
+    }
+
+    fast = (6 == genser->link_num);
+    if (fast) {
+	/* the fast path doesn't call genser_kin_fwd(), so pick up the
+	   link parameters here */
+	genser_kin_init();
+    }
+
+    limit = genser->max_iterations;
+    if (warm && haldata->iteration_budget > 0
+	&& haldata->iteration_budget < limit)
+	limit = haldata->iteration_budget;
+
+    for (genser->iterations = 0; genser->iterations < limit; genser->iterations++) {
+	if (fast) {
+	    retval = compute_jfwd6(genser->links, jest, J6, &pest);
+	    if (GO_RESULT_OK != retval) {
+		rtapi_print("ERR kI - compute_jfwd6 (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+		return retval;
+	    }
+	    for (link = 0; link < 6; link++)
+		linkout[link].quantity = genser->links[link].quantity;
+	} else {
+	    /* update the Jacobians */
+	    for (link = 0; link < genser->link_num; link++) {
+		go_link_joint_set(&genser->links[link], jest[link], &linkout[link]);
+	    }
+	    retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &T_L_0);
+	    if (GO_RESULT_OK != retval) {
+		rtapi_print("ERR kI - compute_jfwd (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+		return retval;
+	    }
+	    retval = compute_jinv(&Jfwd, &Jinv);
+	    if (GO_RESULT_OK != retval) {
+		rtapi_print("ERR kI - compute_jinv (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+		return retval;
+	    }
 
-	/* pest is the resulting pose estimate given joint estimate */
-	genser_kin_fwd(KINS_PTR, jest, &pest);
+	    /* pest is the resulting pose estimate given joint estimate */
+	    genser_kin_fwd(KINS_PTR, jest, &pest);
+	}
 //	printf("jest: %f %f %f %f %f %f\n",jest[0],jest[1],jest[2],jest[3],jest[4],jest[5]);
 	/* pestinv is its inverse */
 	go_pose_inv(&pest, &pestinv);
@@ -491,10 +654,21 @@ int kinematicsInverse(const EmcPose * world,
         dvw[5] = cart.z;
 
 	/* push the Cartesian velocity vector through the inverse Jacobian */
-	go_matrix_vector_mult(&Jinv, dvw, dj);
+	if (fast) {
+	    if (0 != solve6(J6, dvw, dj)) {
+		rtapi_print("ERR kI - singular (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+		return GO_RESULT_SINGULAR;
+	    }
+	} else {
+	    go_matrix_vector_mult(&Jinv, dvw, dj);
+	}
 
 	/* check for small joint increments, if so we're done */
+	maxerr = 0;
 	for (link = 0, smalls = 0; link < genser->link_num; link++) {
+	    err = fabs(dj[link]);
+	    if (err > maxerr)
+		maxerr = err;
 	    if (GO_QUANTITY_LENGTH == linkout[link].quantity) {
 		if (GO_TRAN_SMALL(dj[link]))
 		    smalls++;
@@ -505,14 +679,7 @@ int kinematicsInverse(const EmcPose * world,
 	}
 	if (smalls == genser->link_num) {
 	    /* converged, copy jest[] out */
-	    for (link = 0; link < genser->link_num; link++) {
-		// convert from radians back to angles
-		joints[link] = jest[link] * 180 / PM_PI;
-                if ((link) && (haldata->unrotate[link]))
-                    joints[link] += (haldata->unrotate[link]) * joints[link-1];
-	    }
-//	    rtapi_print("DONEkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
-	    return GO_RESULT_OK;
+	    goto done;
 	}
 	/* else keep iterating */
 	for (link = 0; link < genser->link_num; link++) {
@@ -520,8 +687,70 @@ int kinematicsInverse(const EmcPose * world,
 	}
     }				/* for (iterations) */
 
+    if (limit < genser->max_iterations) {
+	/* out of budget: hand back the best estimate, the next call
+	   picks up from there */
+	goto done;
+    }
+
     rtapi_print("ERRkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
     return GO_RESULT_ERROR;
+
+  done:
+    for (link = 0; link < genser->link_num; link++) {
+	// convert from radians back to angles
+	joints[link] = jest[link] * 180 / PM_PI;
+	if ((link) && (haldata->unrotate[link]))
+	    joints[link] += (haldata->unrotate[link]) * joints[link-1];
+    }
+    if (warm) {
+	haldata->converged = genser->iterations < limit;
+	haldata->last_error = maxerr;
+	for (link = 0; link < genser->link_num; link++) {
+	    warm->answer[link] = joints[link];
+	    warm->prev[link] = warm->last[link];
+	    warm->last[link] = jest[link];
+	}
+	if (warm->solutions < 2)
+	    warm->solutions++;
+    }
+//  rtapi_print("DONEkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+    return GO_RESULT_OK;
+}
+
+int kinematicsInverse(const EmcPose * world,
+		      double *joints,
+		      const KINEMATICS_INVERSE_FLAGS * iflags,
+		      KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    return genser_inverse(world, joints, &motion_warm);
+}
+
+/* Without warm starts, iteration budget or HAL pins, so sampling a
+   segment doesn't disturb what motion sees; each pose is seeded from the
+   result of the one before. */
+int kinematicsInverseBatch(const EmcPoseArrays * world,
+			   double * const *joints,
+			   int n,
+			   const KINEMATICS_INVERSE_FLAGS * iflags,
+			   KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    double q[EMCMOT_MAX_JOINTS];
+    EmcPose pos;
+    int i, j;
+
+    if (n <= 0)
+	return 0;
+    for (j = 0; j < EMCMOT_MAX_JOINTS; j++)
+	q[j] = kinsBatchGet(joints[j], 0);
+    for (i = 0; i < n; i++) {
+	kinsPoseArraysGet(world, i, &pos);
+	if (genser_inverse(&pos, q, NULL) != GO_RESULT_OK)
+	    return i;
+	for (j = 0; j < EMCMOT_MAX_JOINTS; j++)
+	    kinsBatchSet(joints[j], i, q[j]);
+    }
+    return n;
 }
 
 /*
@@ -569,6 +798,7 @@ KINEMATICS_TYPE kinematicsType()
 EXPORT_SYMBOL(kinematicsType);
 EXPORT_SYMBOL(kinematicsForward);
 EXPORT_SYMBOL(kinematicsInverse);
+EXPORT_SYMBOL(kinematicsInverseBatch);
 MODULE_LICENSE("GPL");
 
 int comp_id;
@@ -623,6 +853,23 @@ int rtapi_app_main(void)
 
     KINS_PTR->max_iterations = GENSER_DEFAULT_MAX_ITERATIONS;
 
+    if ((res=
+        hal_param_s32_newf(HAL_RW, &(haldata->iteration_budget), comp_id, "genserkins.iteration-budget")) < 0)
+        goto error;
+    haldata->iteration_budget = 0;
+    if ((res=
+        hal_param_bit_newf(HAL_RW, &(haldata->extrapolate), comp_id, "genserkins.extrapolate")) < 0)
+        goto error;
+    haldata->extrapolate = 0;
+    if ((res=
+        hal_param_bit_newf(HAL_RO, &(haldata->converged), comp_id, "genserkins.converged")) < 0)
+        goto error;
+    haldata->converged = 1;
+    if ((res=
+        hal_param_float_newf(HAL_RO, &(haldata->last_error), comp_id, "genserkins.last-error")) < 0)
+        goto error;
+    haldata->last_error = 0;
+
 
     A(0) = DEFAULT_A1;
     A(1) = DEFAULT_A2;
@@ -697,6 +944,9 @@ int main(int argc, char *argv[])
 
     KINS_PTR = malloc(sizeof(genser_struct));
     haldata->pos = (go_pose *) malloc(sizeof(go_pose));
+    haldata->iteration_budget = 0;
+    haldata->extrapolate = 0;
+    KINS_PTR->max_iterations = GENSER_DEFAULT_MAX_ITERATIONS;
 
     for (i = 0; i < GENSER_MAX_JOINTS ; i++) {
 	haldata->a[i] = malloc(sizeof(double));
@@ -101,4 +101,47 @@ extern int kinematicsHome(struct EmcPose * world,
 
 extern KINEMATICS_TYPE kinematicsType(void);
 
+/* Poses stored as one array per coordinate ("structure of arrays"), for
+   the batch kinematics below.  Pose i is x[i], y[i], ... w[i].  Arrays for
+   coordinates the caller doesn't care about may be NULL: a NULL input
+   reads as zero and a NULL output is not written.  The coordinates the
+   kinematics actually compute from or produce must be present. */
+typedef struct EmcPoseArrays {
+    double *x, *y, *z;
+    double *a, *b, *c;
+    double *u, *v, *w;
+} EmcPoseArrays;
+
+/* The batch kinematics convert n poses in one call, so that consumers
+   that need many points (limit checking a program, joint space preview,
+   sampling a segment in the trajectory planner) pay the call and setup
+   cost once, and the module can run a tight loop the compiler can
+   vectorize.  joints[] holds one array of n values per joint, up to
+   EMCMOT_MAX_JOINTS of them; NULL entries are treated like NULL pose
+   arrays.  For iterative kinematics the inverse takes its initial
+   estimate, as for kinematicsInverse, from the first entry of the joint
+   arrays and starts each later pose from the result of the one before,
+   so callers should pass poses in path order.
+
+   Both return the number of poses converted.  A return value less than n
+   is the index of the first pose that failed; the outputs for that pose
+   and any after it are unspecified.
+
+   These are optional.  A kinematics module that implements them exports
+   them like the functions above; callers must be prepared for them to be
+   missing and fall back to kinematicsForwardBatchScalar() /
+   kinematicsInverseBatchScalar() from kinematicsbatch.h, which loop over
+   the single pose functions. */
+extern int kinematicsForwardBatch(double * const *joints,
+				  const EmcPoseArrays * world,
+				  int n,
+				  const KINEMATICS_FORWARD_FLAGS * fflags,
+				  KINEMATICS_INVERSE_FLAGS * iflags);
+
+extern int kinematicsInverseBatch(const EmcPoseArrays * world,
+				  double * const *joints,
+				  int n,
+				  const KINEMATICS_INVERSE_FLAGS * iflags,
+				  KINEMATICS_FORWARD_FLAGS * fflags);
+
 #endif
@@ -0,0 +1,130 @@
+/********************************************************************
+* Description: kinematicsbatch.h
+*   Helpers for the optional batch kinematics calls
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#ifndef KINEMATICSBATCH_H
+#define KINEMATICSBATCH_H
+
+#include "kinematics.h"		/* EmcPoseArrays, kinematicsForward() */
+#include "emcmotcfg.h"		/* EMCMOT_MAX_JOINTS */
+
+/* copy n values, honoring the NULL conventions of EmcPoseArrays */
+static inline void kinsBatchCopy(double *dst, const double *src, int n)
+{
+    int i;
+
+    if (!dst) {
+	return;
+    }
+    if (src) {
+	for (i = 0; i < n; i++) {
+	    dst[i] = src[i];
+	}
+    } else {
+	for (i = 0; i < n; i++) {
+	    dst[i] = 0.0;
+	}
+    }
+}
+
+static inline double kinsBatchGet(const double *a, int i)
+{
+    return a ? a[i] : 0.0;
+}
+
+static inline void kinsBatchSet(double *a, int i, double value)
+{
+    if (a) {
+	a[i] = value;
+    }
+}
+
+static inline void kinsPoseArraysGet(const EmcPoseArrays * p, int i,
+				     EmcPose * pos)
+{
+    pos->tran.x = kinsBatchGet(p->x, i);
+    pos->tran.y = kinsBatchGet(p->y, i);
+    pos->tran.z = kinsBatchGet(p->z, i);
+    pos->a = kinsBatchGet(p->a, i);
+    pos->b = kinsBatchGet(p->b, i);
+    pos->c = kinsBatchGet(p->c, i);
+    pos->u = kinsBatchGet(p->u, i);
+    pos->v = kinsBatchGet(p->v, i);
+    pos->w = kinsBatchGet(p->w, i);
+}
+
+static inline void kinsPoseArraysSet(const EmcPoseArrays * p, int i,
+				     const EmcPose * pos)
+{
+    kinsBatchSet(p->x, i, pos->tran.x);
+    kinsBatchSet(p->y, i, pos->tran.y);
+    kinsBatchSet(p->z, i, pos->tran.z);
+    kinsBatchSet(p->a, i, pos->a);
+    kinsBatchSet(p->b, i, pos->b);
+    kinsBatchSet(p->c, i, pos->c);
+    kinsBatchSet(p->u, i, pos->u);
+    kinsBatchSet(p->v, i, pos->v);
+    kinsBatchSet(p->w, i, pos->w);
+}
+
+/* the per-pose fallbacks for modules without batch kinematics */
+static inline int kinematicsForwardBatchScalar(double * const *joints,
+					       const EmcPoseArrays * world,
+					       int n,
+					       const KINEMATICS_FORWARD_FLAGS * fflags,
+					       KINEMATICS_INVERSE_FLAGS * iflags)
+{
+    double q[EMCMOT_MAX_JOINTS];
+    EmcPose pos;
+    int i, j;
+
+    for (i = 0; i < n; i++) {
+	for (j = 0; j < EMCMOT_MAX_JOINTS; j++) {
+	    q[j] = kinsBatchGet(joints[j], i);
+	}
+	/* the forward kinematics may use the pose as an estimate */
+	kinsPoseArraysGet(world, i, &pos);
+	if (kinematicsForward(q, &pos, fflags, iflags) != 0) {
+	    return i;
+	}
+	kinsPoseArraysSet(world, i, &pos);
+    }
+    return n;
+}
+
+static inline int kinematicsInverseBatchScalar(const EmcPoseArrays * world,
+					       double * const *joints,
+					       int n,
+					       const KINEMATICS_INVERSE_FLAGS * iflags,
+					       KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    double q[EMCMOT_MAX_JOINTS];
+    EmcPose pos;
+    int i, j;
+
+    if (n <= 0) {
+	return 0;
+    }
+    /* pose 0 starts from the caller's estimate, each later pose from
+       the result of the one before */
+    for (j = 0; j < EMCMOT_MAX_JOINTS; j++) {
+	q[j] = kinsBatchGet(joints[j], 0);
+    }
+    for (i = 0; i < n; i++) {
+	kinsPoseArraysGet(world, i, &pos);
+	if (kinematicsInverse(&pos, q, iflags, fflags) != 0) {
+	    return i;
+	}
+	for (j = 0; j < EMCMOT_MAX_JOINTS; j++) {
+	    kinsBatchSet(joints[j], i, q[j]);
+	}
+    }
+    return n;
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include "rtapi_app.h"
 
 #include "lineardeltakins-common.h"
+#include "kinematicsbatch.h"
 
 struct haldata
 {
@@ -43,6 +44,99 @@ int kinematicsInverse(const EmcPose *pos, double *joints,
     return kinematics_inverse(pos, joints);
 }
 
+// The batch versions evaluate the closed form for every pose without
+// branching and look for failures afterwards, so the loops vectorize.
+int kinematicsForwardBatch(double * const *joints,
+                           const EmcPoseArrays *world,
+                           int n,
+                           const KINEMATICS_FORWARD_FLAGS * fflags,
+                           KINEMATICS_INVERSE_FLAGS * iflags) {
+    const double * __restrict j0 = joints[0];
+    const double * __restrict j1 = joints[1];
+    const double * __restrict j2 = joints[2];
+    double * __restrict x = world->x;
+    double * __restrict y = world->y;
+    double * __restrict z = world->z;
+    double den, den2;
+    int i;
+
+    if(!j0 || !j1 || !j2 || !x || !y || !z) return 0;
+
+    set_geometry(*haldata->r, *haldata->l);
+    den = (By-Ay)*Cx-(Cy-Ay)*Bx;
+    den2 = den*den;
+
+    for(i = 0; i < n; i++) {
+        double q1 = j0[i], q2 = j1[i], q3 = j2[i];
+
+        double w1 = Ay*Ay + q1*q1;
+        double w2 = Bx*Bx + By*By + q2*q2;
+        double w3 = Cx*Cx + Cy*Cy + q3*q3;
+
+        double a1 = (q2-q1)*(Cy-Ay)-(q3-q1)*(By-Ay);
+        double b1 = -((w2-w1)*(Cy-Ay)-(w3-w1)*(By-Ay))/2.0;
+
+        double a2 = -(q2-q1)*Cx+(q3-q1)*Bx;
+        double b2 = ((w2-w1)*Cx - (w3-w1)*Bx)/2.0;
+
+        double a = a1*a1 + a2*a2 + den2;
+        double b = 2*(a1*b1 + a2*(b2-Ay*den) - q1*den2);
+        double c = (b2-Ay*den)*(b2-Ay*den) + b1*b1 + den2*(q1*q1 - L*L);
+
+        // a negative discriminant (no such point) turns into a NaN here
+        double zz = -0.5*(b+sqrt(b*b - 4.0*a*c))/a;
+        z[i] = zz;
+        x[i] = (a1*zz + b1)/den;
+        y[i] = (a2*zz + b2)/den;
+    }
+
+    kinsBatchCopy(world->a, joints[3], n);
+    kinsBatchCopy(world->b, joints[4], n);
+    kinsBatchCopy(world->c, joints[5], n);
+    kinsBatchCopy(world->u, joints[6], n);
+    kinsBatchCopy(world->v, joints[7], n);
+    kinsBatchCopy(world->w, joints[8], n);
+
+    for(i = 0; i < n; i++)
+        if(isnan(z[i])) return i;
+    return n;
+}
+
+int kinematicsInverseBatch(const EmcPoseArrays *world,
+                           double * const *joints,
+                           int n,
+                           const KINEMATICS_INVERSE_FLAGS * iflags,
+                           KINEMATICS_FORWARD_FLAGS * fflags) {
+    const double * __restrict x = world->x;
+    const double * __restrict y = world->y;
+    const double * __restrict z = world->z;
+    double * __restrict j0 = joints[0];
+    double * __restrict j1 = joints[1];
+    double * __restrict j2 = joints[2];
+    int i;
+
+    if(!x || !y || !z || !j0 || !j1 || !j2) return 0;
+
+    set_geometry(*haldata->r, *haldata->l);
+
+    for(i = 0; i < n; i++) {
+        j0[i] = z[i] + sqrt(L2 - sq(Ax-x[i]) - sq(Ay-y[i]));
+        j1[i] = z[i] + sqrt(L2 - sq(Bx-x[i]) - sq(By-y[i]));
+        j2[i] = z[i] + sqrt(L2 - sq(Cx-x[i]) - sq(Cy-y[i]));
+    }
+
+    kinsBatchCopy(joints[3], world->a, n);
+    kinsBatchCopy(joints[4], world->b, n);
+    kinsBatchCopy(joints[5], world->c, n);
+    kinsBatchCopy(joints[6], world->u, n);
+    kinsBatchCopy(joints[7], world->v, n);
+    kinsBatchCopy(joints[8], world->w, n);
+
+    for(i = 0; i < n; i++)
+        if(isnan(j0[i]) || isnan(j1[i]) || isnan(j2[i])) return i;
+    return n;
+}
+
 KINEMATICS_TYPE kinematicsType()
 {
     return KINEMATICS_BOTH;
@@ -90,4 +184,6 @@ void rtapi_app_exit(void)
 EXPORT_SYMBOL(kinematicsType);
 EXPORT_SYMBOL(kinematicsForward);
 EXPORT_SYMBOL(kinematicsInverse);
+EXPORT_SYMBOL(kinematicsForwardBatch);
+EXPORT_SYMBOL(kinematicsInverseBatch);
 MODULE_LICENSE("GPL");
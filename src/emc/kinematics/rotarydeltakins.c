@@ -21,6 +21,7 @@
 #include "rtapi_app.h"
 
 #include "rotarydeltakins-common.h"
+#include "kinematicsbatch.h"
 
 struct haldata
 {
@@ -47,6 +48,49 @@ int kinematicsInverse(const EmcPose *pos, double *joints,
     return kinematics_inverse(pos, joints);
 }
 
+// The batch versions only save the per-pose geometry check; the
+// solution itself is iterative and branchy.
+int kinematicsForwardBatch(double * const *joints,
+                           const EmcPoseArrays *world,
+                           int n,
+                           const KINEMATICS_FORWARD_FLAGS * fflags,
+                           KINEMATICS_INVERSE_FLAGS * iflags) {
+    double q[EMCMOT_MAX_JOINTS];
+    EmcPose pos;
+    int i, j;
+
+    set_geometry(*haldata->pfr, *haldata->tl, *haldata->sl, *haldata->fr);
+    for(i = 0; i < n; i++) {
+        for(j = 0; j < EMCMOT_MAX_JOINTS; j++)
+            q[j] = kinsBatchGet(joints[j], i);
+        if(kinematics_forward(q, &pos) != 0) return i;
+        kinsPoseArraysSet(world, i, &pos);
+    }
+    return n;
+}
+
+int kinematicsInverseBatch(const EmcPoseArrays *world,
+                           double * const *joints,
+                           int n,
+                           const KINEMATICS_INVERSE_FLAGS * iflags,
+                           KINEMATICS_FORWARD_FLAGS * fflags) {
+    double q[EMCMOT_MAX_JOINTS];
+    EmcPose pos;
+    int i, j;
+
+    set_geometry(*haldata->pfr, *haldata->tl, *haldata->sl, *haldata->fr);
+    // the joints kinematics_inverse leaves alone keep the first estimate
+    for(j = 0; j < EMCMOT_MAX_JOINTS; j++)
+        q[j] = kinsBatchGet(joints[j], 0);
+    for(i = 0; i < n; i++) {
+        kinsPoseArraysGet(world, i, &pos);
+        if(kinematics_inverse(&pos, q) != 0) return i;
+        for(j = 0; j < EMCMOT_MAX_JOINTS; j++)
+            kinsBatchSet(joints[j], i, q[j]);
+    }
+    return n;
+}
+
 KINEMATICS_TYPE kinematicsType()
 {
     return KINEMATICS_BOTH;
@@ -102,4 +146,6 @@ void rtapi_app_exit(void)
 EXPORT_SYMBOL(kinematicsType);
 EXPORT_SYMBOL(kinematicsForward);
 EXPORT_SYMBOL(kinematicsInverse);
+EXPORT_SYMBOL(kinematicsForwardBatch);
+EXPORT_SYMBOL(kinematicsInverseBatch);
 MODULE_LICENSE("GPL");
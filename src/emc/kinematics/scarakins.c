@@ -18,6 +18,7 @@
 #include "posemath.h"
 #include "rtapi_math.h"
 #include "kinematics.h"             /* decls for kinematicsForward, etc. */
+#include "kinematicsbatch.h"
 
 #include "rtapi.h"		/* RTAPI realtime OS API */
 #include "rtapi_app.h"		/* RTAPI realtime module decls */
@@ -169,6 +170,98 @@ int kinematicsInverse(const EmcPose * world,
     return (0);
 }
 
+/* The batch versions are the same math as above, written as flat loops
+   over the pose arrays so the compiler can vectorize them. */
+int kinematicsForwardBatch(double * const *joints,
+                           const EmcPoseArrays * world,
+                           int n,
+                           const KINEMATICS_FORWARD_FLAGS * fflags,
+                           KINEMATICS_INVERSE_FLAGS * iflags)
+{
+    double d2 = D2, d4 = D4, d6 = D6;
+    double dz = D1 + D3 - D5;
+    const double * __restrict j0 = joints[0];
+    const double * __restrict j1 = joints[1];
+    const double * __restrict j2 = joints[2];
+    const double * __restrict j3 = joints[3];
+    double * __restrict x = world->x;
+    double * __restrict y = world->y;
+    double * __restrict z = world->z;
+    double * __restrict c = world->c;
+    int i;
+
+    if (!j0 || !j1 || !j2 || !j3 || !x || !y || !z || !c) return 0;
+
+    for (i = 0; i < n; i++) {
+        double a0 = j0[i] * ( PM_PI / 180 );
+        double a1 = a0 + j1[i] * ( PM_PI / 180 );
+        double a3 = a1 + j3[i] * ( PM_PI / 180 );
+
+        x[i] = d2*cos(a0) + d4*cos(a1) + d6*cos(a3);
+        y[i] = d2*sin(a0) + d4*sin(a1) + d6*sin(a3);
+        z[i] = dz - j2[i];
+        c[i] = a3 * 180 / PM_PI;
+    }
+
+    /* like the single pose call, the flags describe the last pose */
+    *iflags = 0;
+    if (n > 0 && j1[n-1] < 90)
+        *iflags = 1;
+
+    kinsBatchCopy(world->a, joints[4], n);
+    kinsBatchCopy(world->b, joints[5], n);
+
+    return n;
+}
+
+int kinematicsInverseBatch(const EmcPoseArrays * world,
+                           double * const *joints,
+                           int n,
+                           const KINEMATICS_INVERSE_FLAGS * iflags,
+                           KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    double d2 = D2, d4 = D4, d6 = D6;
+    double dz = D1 + D3 - D5;
+    double sign = *iflags ? -1 : 1;
+    const double * __restrict x = world->x;
+    const double * __restrict y = world->y;
+    const double * __restrict z = world->z;
+    const double * __restrict c = world->c;
+    double * __restrict j0 = joints[0];
+    double * __restrict j1 = joints[1];
+    double * __restrict j2 = joints[2];
+    double * __restrict j3 = joints[3];
+    int i;
+
+    if (!x || !y || !z || !c || !j0 || !j1 || !j2 || !j3) return 0;
+
+    for (i = 0; i < n; i++) {
+        double a3 = c[i] * ( PM_PI / 180 );
+        double xt = x[i] - d6*cos(a3);
+        double yt = y[i] - d6*sin(a3);
+        double cc = (xt*xt + yt*yt - d2*d2 - d4*d4) / (2*d2*d4);
+        double q0, q1;
+
+        cc = fmin(fmax(cc, -1), 1);
+        q1 = sign * acos(cc);
+        q0 = atan2(yt, xt) - atan2(d4*sin(q1), d2 + d4*cos(q1));
+        q0 = q0 * (180 / PM_PI);
+        q1 = q1 * (180 / PM_PI);
+
+        j0[i] = q0;
+        j1[i] = q1;
+        j2[i] = dz - z[i];
+        j3[i] = c[i] - (q0 + q1);
+    }
+
+    kinsBatchCopy(joints[4], world->a, n);
+    kinsBatchCopy(joints[5], world->b, n);
+
+    *fflags = 0;
+
+    return n;
+}
+
 int kinematicsHome(EmcPose * world,
                    double * joint,
                    KINEMATICS_FORWARD_FLAGS * fflags,
@@ -194,6 +287,8 @@ EXPORT_SYMBOL(kinematicsType);
 EXPORT_SYMBOL(kinematicsForward);
 EXPORT_SYMBOL(kinematicsInverse);
 EXPORT_SYMBOL(kinematicsHome);
+EXPORT_SYMBOL(kinematicsForwardBatch);
+EXPORT_SYMBOL(kinematicsInverseBatch);
 
 int comp_id;
 
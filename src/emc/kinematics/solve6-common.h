@@ -0,0 +1,84 @@
+#ifndef LINUXCNCSOLVE6_COMMON_H
+#define LINUXCNCSOLVE6_COMMON_H
+/********************************************************************
+* Description: solve6-common.h
+*   Fixed-size 6x6 linear solver shared by the iterative kinematics
+*
+* License: GPL Version 2
+* System: Linux
+*
+*******************************************************************
+
+  The iterative kinematics (genhexkins, genserkins) only ever need to
+  solve J * x = b for a square 6x6 Jacobian once per Newton step.
+  Inverting J first and then multiplying, or going through the
+  variable-size go_matrix routines, costs several times what a
+  direct elimination does.  All loop bounds here are compile time
+  constants so the compiler can unroll them, and nothing is allocated.
+
+  The user must include a math.h-type header first.
+*/
+
+#define SOLVE6_N 6
+
+/* smallest pivot accepted before the matrix is declared singular */
+#define SOLVE6_TINY 1.0e-12
+
+/*
+  solve6() solves A * x = b by Gaussian elimination with partial
+  pivoting.  A and b are used as scratch space and are destroyed.
+  Returns 0 on success, -1 if A is (numerically) singular.
+*/
+static int solve6(double A[SOLVE6_N][SOLVE6_N], double b[SOLVE6_N],
+                  double x[SOLVE6_N])
+{
+    int row, col, k, piv;
+    double m, t, big;
+
+    for (k = 0; k < SOLVE6_N; k++) {
+        /* find the pivot row for column k */
+        piv = k;
+        big = fabs(A[k][k]);
+        for (row = k + 1; row < SOLVE6_N; row++) {
+            t = fabs(A[row][k]);
+            if (t > big) {
+                big = t;
+                piv = row;
+            }
+        }
+        if (big < SOLVE6_TINY) {
+            return -1;
+        }
+        if (piv != k) {
+            for (col = k; col < SOLVE6_N; col++) {
+                t = A[k][col];
+                A[k][col] = A[piv][col];
+                A[piv][col] = t;
+            }
+            t = b[k];
+            b[k] = b[piv];
+            b[piv] = t;
+        }
+        /* eliminate below the pivot */
+        for (row = k + 1; row < SOLVE6_N; row++) {
+            m = A[row][k] / A[k][k];
+            for (col = k + 1; col < SOLVE6_N; col++) {
+                A[row][col] -= m * A[k][col];
+            }
+            b[row] -= m * b[k];
+        }
+    }
+
+    /* back substitution */
+    for (row = SOLVE6_N - 1; row >= 0; row--) {
+        t = b[row];
+        for (col = row + 1; col < SOLVE6_N; col++) {
+            t -= A[row][col] * x[col];
+        }
+        x[row] = t / A[row][row];
+    }
+
+    return 0;
+}
+
+#endif
@@ -17,6 +17,7 @@
 #include "rtapi_app.h"		/* RTAPI realtime module decls */
 #include "rtapi_math.h"
 #include "rtapi_string.h"
+#include "kinematicsbatch.h"
 
 struct data { 
     hal_s32_t joints[EMCMOT_MAX_JOINTS];
@@ -71,6 +72,54 @@ int kinematicsInverse(const EmcPose * pos,
     return 0;
 }
 
+static double *pose_array(const EmcPoseArrays * world, int axis)
+{
+    switch(axis) {
+        case 0: return world->x;
+        case 1: return world->y;
+        case 2: return world->z;
+        case 3: return world->a;
+        case 4: return world->b;
+        case 5: return world->c;
+        case 6: return world->u;
+        case 7: return world->v;
+        case 8: return world->w;
+    }
+    return 0;
+}
+
+int kinematicsForwardBatch(double * const *joints,
+			   const EmcPoseArrays * world,
+			   int n,
+			   const KINEMATICS_FORWARD_FLAGS * fflags,
+			   KINEMATICS_INVERSE_FLAGS * iflags)
+{
+    int i;
+
+    for(i = 0; i < EMCMOT_MAX_JOINTS; i++) {
+        if(data->joints[i] >= 0)
+            kinsBatchCopy(pose_array(world, data->joints[i]), joints[i], n);
+    }
+
+    return n;
+}
+
+int kinematicsInverseBatch(const EmcPoseArrays * world,
+			   double * const *joints,
+			   int n,
+			   const KINEMATICS_INVERSE_FLAGS * iflags,
+			   KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    int i;
+
+    for(i = 0; i < EMCMOT_MAX_JOINTS; i++) {
+        if(data->joints[i] >= 0)
+            kinsBatchCopy(joints[i], pose_array(world, data->joints[i]), n);
+    }
+
+    return n;
+}
+
 /* implemented for these kinematics as giving joints preference */
 int kinematicsHome(EmcPose * world,
 		   double *joint,
@@ -99,6 +148,8 @@ RTAPI_MP_STRING(kinstype, "Kinematics Type (Identity,Both)");
 EXPORT_SYMBOL(kinematicsType);
 EXPORT_SYMBOL(kinematicsForward);
 EXPORT_SYMBOL(kinematicsInverse);
+EXPORT_SYMBOL(kinematicsForwardBatch);
+EXPORT_SYMBOL(kinematicsInverseBatch);
 MODULE_LICENSE("GPL");
 
 static int next_axis_number(void) {
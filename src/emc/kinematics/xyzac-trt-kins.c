@@ -27,6 +27,7 @@
 #include "hal.h"
 #include "rtapi.h"
 #include "rtapi_math.h"
+#include "kinematicsbatch.h"
 
 // sequential joint number assignments
 #define JX 0
@@ -116,6 +117,108 @@ int kinematicsInverse(const EmcPose * pos,
     return 0;
 }
 
+/* The batch versions are the same math as above, written as flat loops
+   over the pose arrays so the compiler can vectorize them. */
+int kinematicsForwardBatch(double * const *joints,
+                           const EmcPoseArrays * world,
+                           int n,
+                           const KINEMATICS_FORWARD_FLAGS * fflags,
+                           KINEMATICS_INVERSE_FLAGS * iflags)
+{
+    double    dy = *(haldata->y_offset);
+    double    dz = *(haldata->z_offset) + *(haldata->tool_offset);
+    const double * __restrict jx = joints[JX];
+    const double * __restrict jy = joints[JY];
+    const double * __restrict jz = joints[JZ];
+    const double * __restrict ja = joints[JA];
+    const double * __restrict jc = joints[JC];
+    double * __restrict x = world->x;
+    double * __restrict y = world->y;
+    double * __restrict z = world->z;
+    int i;
+
+    if (!jx || !jy || !jz || !ja || !jc || !x || !y || !z) return 0;
+
+    for (i = 0; i < n; i++) {
+        double a_rad = ja[i]*TO_RAD;
+        double c_rad = jc[i]*TO_RAD;
+        double sa = sin(a_rad), ca = cos(a_rad);
+        double sc = sin(c_rad), cc = cos(c_rad);
+
+        x[i] = + cc      * (jx[i]     )
+               + sc * ca * (jy[i] - dy)
+               + sc * sa * (jz[i] - dz)
+               + sc * dy;
+
+        y[i] = - sc      * (jx[i]     )
+               + cc * ca * (jy[i] - dy)
+               + cc * sa * (jz[i] - dz)
+               + cc * dy;
+
+        z[i] = - sa * (jy[i] - dy)
+               + ca * (jz[i] - dz)
+               + dz;
+    }
+
+    kinsBatchCopy(world->a, ja, n);
+    kinsBatchCopy(world->c, jc, n);
+    kinsBatchCopy(world->b, 0, n);
+    kinsBatchCopy(world->u, 0, n);
+    kinsBatchCopy(world->v, 0, n);
+    kinsBatchCopy(world->w, 0, n);
+
+    return n;
+}
+
+int kinematicsInverseBatch(const EmcPoseArrays * world,
+                           double * const *joints,
+                           int n,
+                           const KINEMATICS_INVERSE_FLAGS * iflags,
+                           KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    double    dy = *(haldata->y_offset);
+    double    dz = *(haldata->z_offset) + *(haldata->tool_offset);
+    const double * __restrict x = world->x;
+    const double * __restrict y = world->y;
+    const double * __restrict z = world->z;
+    const double * __restrict a = world->a;
+    const double * __restrict c = world->c;
+    double * __restrict jx = joints[JX];
+    double * __restrict jy = joints[JY];
+    double * __restrict jz = joints[JZ];
+    int i;
+
+    if (!x || !y || !z || !a || !c || !jx || !jy || !jz) return 0;
+
+    for (i = 0; i < n; i++) {
+        double a_rad = a[i]*TO_RAD;
+        double c_rad = c[i]*TO_RAD;
+        double sa = sin(a_rad), ca = cos(a_rad);
+        double sc = sin(c_rad), cc = cos(c_rad);
+
+        jx[i] = + cc * x[i]
+                - sc * y[i];
+
+        jy[i] = + sc * ca * x[i]
+                + cc * ca * y[i]
+                - sa      * z[i]
+                - ca * dy
+                + sa * dz + dy;
+
+        jz[i] = + sc * sa * x[i]
+                + cc * sa * y[i]
+                + ca      * z[i]
+                - sa * dy
+                - ca * dz
+                + dz;
+    }
+
+    kinsBatchCopy(joints[JA], a, n);
+    kinsBatchCopy(joints[JC], c, n);
+
+    return n;
+}
+
 KINEMATICS_TYPE kinematicsType()
 {
     return KINEMATICS_BOTH;
@@ -128,6 +231,8 @@ KINEMATICS_TYPE kinematicsType()
 EXPORT_SYMBOL(kinematicsType);
 EXPORT_SYMBOL(kinematicsInverse);
 EXPORT_SYMBOL(kinematicsForward);
+EXPORT_SYMBOL(kinematicsForwardBatch);
+EXPORT_SYMBOL(kinematicsInverseBatch);
 MODULE_LICENSE("GPL");
 
 int comp_id;
@@ -27,6 +27,7 @@
 #include "hal.h"
 #include "rtapi.h"
 #include "rtapi_math.h"
+#include "kinematicsbatch.h"
 
 // sequential joint number assignments
 #define JX 0
@@ -114,6 +115,107 @@ int kinematicsInverse(const EmcPose * pos,
     return 0;
 }
 
+/* The batch versions are the same math as above, written as flat loops
+   over the pose arrays so the compiler can vectorize them. */
+int kinematicsForwardBatch(double * const *joints,
+                           const EmcPoseArrays * world,
+                           int n,
+                           const KINEMATICS_FORWARD_FLAGS * fflags,
+                           KINEMATICS_INVERSE_FLAGS * iflags)
+{
+    double    dx = *(haldata->x_offset);
+    double    dz = *(haldata->z_offset) + *(haldata->tool_offset);
+    const double * __restrict jx = joints[JX];
+    const double * __restrict jy = joints[JY];
+    const double * __restrict jz = joints[JZ];
+    const double * __restrict jb = joints[JB];
+    const double * __restrict jc = joints[JC];
+    double * __restrict x = world->x;
+    double * __restrict y = world->y;
+    double * __restrict z = world->z;
+    int i;
+
+    if (!jx || !jy || !jz || !jb || !jc || !x || !y || !z) return 0;
+
+    for (i = 0; i < n; i++) {
+        double b_rad = jb[i]*TO_RAD;
+        double c_rad = jc[i]*TO_RAD;
+        double sb = sin(b_rad), cb = cos(b_rad);
+        double sc = sin(c_rad), cc = cos(c_rad);
+
+        x[i] =   cc * cb * (jx[i] - dx)
+               + sc *      (jy[i])
+               - cc * sb * (jz[i] - dz)
+               + cc * dx;
+
+        y[i] = - sc * cb * (jx[i] - dx)
+               + cc *      (jy[i])
+               + sc * sb * (jz[i] - dz)
+               - sc * dx;
+
+        z[i] =   sb * (jx[i] - dx)
+               + cb * (jz[i] - dz)
+               + dz;
+    }
+
+    kinsBatchCopy(world->b, jb, n);
+    kinsBatchCopy(world->c, jc, n);
+    kinsBatchCopy(world->a, 0, n);
+    kinsBatchCopy(world->u, 0, n);
+    kinsBatchCopy(world->v, 0, n);
+    kinsBatchCopy(world->w, 0, n);
+
+    return n;
+}
+
+int kinematicsInverseBatch(const EmcPoseArrays * world,
+                           double * const *joints,
+                           int n,
+                           const KINEMATICS_INVERSE_FLAGS * iflags,
+                           KINEMATICS_FORWARD_FLAGS * fflags)
+{
+    double    dx = *(haldata->x_offset);
+    double    dz = *(haldata->z_offset) + *(haldata->tool_offset);
+    const double * __restrict x = world->x;
+    const double * __restrict y = world->y;
+    const double * __restrict z = world->z;
+    const double * __restrict b = world->b;
+    const double * __restrict c = world->c;
+    double * __restrict jx = joints[JX];
+    double * __restrict jy = joints[JY];
+    double * __restrict jz = joints[JZ];
+    int i;
+
+    if (!x || !y || !z || !b || !c || !jx || !jy || !jz) return 0;
+
+    for (i = 0; i < n; i++) {
+        double b_rad = b[i]*TO_RAD;
+        double c_rad = c[i]*TO_RAD;
+        double sb = sin(b_rad), cb = cos(b_rad);
+        double sc = sin(c_rad), cc = cos(c_rad);
+        double dpx = -cb*dx - sb*dz + dx;
+        double dpz =  sb*dx - cb*dz + dz;
+
+        jx[i] =   cc * cb * (x[i])
+                - sc * cb * (y[i])
+                + sb * (z[i])
+                + dpx;
+
+        jy[i] =   sc * (x[i])
+                + cc * (y[i]);
+
+        jz[i] = - cc * sb * (x[i])
+                + sc * sb * (y[i])
+                + cb * (z[i])
+                + dpz;
+    }
+
+    kinsBatchCopy(joints[JB], b, n);
+    kinsBatchCopy(joints[JC], c, n);
+
+    return n;
+}
+
 KINEMATICS_TYPE kinematicsType()
 {
 return KINEMATICS_BOTH;
@@ -125,6 +227,8 @@ return KINEMATICS_BOTH;
 EXPORT_SYMBOL(kinematicsType);
 EXPORT_SYMBOL(kinematicsInverse);
 EXPORT_SYMBOL(kinematicsForward);
+EXPORT_SYMBOL(kinematicsForwardBatch);
+EXPORT_SYMBOL(kinematicsInverseBatch);
 MODULE_LICENSE("GPL");
 
 int comp_id;
@@ -493,6 +493,23 @@ int main(int argc, char* argv[]) {
                 );
                 break;
 
+            case EMCMOT_SET_SPLINE:
+                log_print("SET_SPLINE:\n");
+                log_print(
+                    "    pos: x=%.6f, y=%.6f, z=%.6f, a=%.6f, b=%.6f, c=%.6f, u=%.6f, v=%.6f, w=%.6f\n",
+                    c->pos.tran.x, c->pos.tran.y, c->pos.tran.z,
+                    c->pos.a, c->pos.b, c->pos.c,
+                    c->pos.u, c->pos.v, c->pos.w
+                );
+                log_print("    ctrl1: x=%.6f, y=%.6f, z=%.6f\n", c->ctrl1.x, c->ctrl1.y, c->ctrl1.z);
+                log_print("    ctrl2: x=%.6f, y=%.6f, z=%.6f\n", c->ctrl2.x, c->ctrl2.y, c->ctrl2.z);
+                log_print("    id=%d, motion_type=%d, vel=%.6f, ini_maxvel=%.6f, acc=%.6f\n",
+                    c->id, c->motion_type,
+                    c->vel, c->ini_maxvel,
+                    c->acc
+                );
+                break;
+
             case EMCMOT_SET_TELEOP_VECTOR:
                 log_print("SET_TELEOP_VECTOR\n");
                 break;
@@ -678,6 +695,10 @@ int main(int argc, char* argv[]) {
                 log_print("SETUP_ARC_BLENDS\n");
                 break;
 
+            case EMCMOT_SET_JOINT_LIMIT_SAMPLES:
+                log_print("SET_JOINT_LIMIT_SAMPLES %d\n", c->jointLimitSamples);
+                break;
+
             case EMCMOT_SET_PROBE_ERR_INHIBIT:
                 log_print("SETUP_SET_PROBE_ERR_INHIBIT %d %d\n",
                           c->probe_jog_err_inhibit,
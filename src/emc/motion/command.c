@@ -1111,6 +1111,55 @@ void emcmotCommandHandler(void *arg, long period)
 	    }
 	    break;
 
+	case EMCMOT_SET_SPLINE:
+	    /* emcmotDebug->coord_tp up a spline move */
+	    /* requires coordinated mode, enable on, not on limits */
+	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_SPLINE");
+	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
+		reportError(_("need to be enabled, in coord mode for spline move"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!inRange(emcmotCommand->pos, emcmotCommand->id, "Spline")) {
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		tpAbort(&emcmotDebug->coord_tp);
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    } else if (!limits_ok()) {
+		reportError(_("can't do spline move with limits exceeded"));
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_PARAMS;
+		tpAbort(&emcmotDebug->coord_tp);
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+	    }
+            if(emcmotStatus->atspeed_next_feed) {
+                issue_atspeed = 1;
+                emcmotStatus->atspeed_next_feed = 0;
+            }
+	    /* append it to the emcmotDebug->coord_tp */
+	    tpSetId(&emcmotDebug->coord_tp, emcmotCommand->id);
+	    int res_addspline = tpAddSpline(&emcmotDebug->coord_tp, emcmotCommand->pos,
+                            emcmotCommand->ctrl1, emcmotCommand->ctrl2,
+                            emcmotCommand->motion_type,
+                            emcmotCommand->vel, emcmotCommand->ini_maxvel,
+                            emcmotCommand->acc, emcmotStatus->enables_new, issue_atspeed);
+        if (res_addspline < 0) {
+            reportError(_("can't add spline move at line %d, error code %d"),
+                    emcmotCommand->id, res_addspline);
+		emcmotStatus->commandStatus = EMCMOT_COMMAND_BAD_EXEC;
+		tpAbort(&emcmotDebug->coord_tp);
+		SET_MOTION_ERROR_FLAG(1);
+		break;
+        } else if (res_addspline != 0) {
+            if (issue_atspeed) {
+                emcmotStatus->atspeed_next_feed = 1;
+            }
+        } else {
+		SET_MOTION_ERROR_FLAG(0);
+		rehomeAll = 1;
+	    }
+	    break;
+
 	case EMCMOT_SET_VEL:
 	    /* set the velocity for subsequent moves */
 	    /* can do it at any time */
@@ -1789,6 +1838,9 @@ void emcmotCommandHandler(void *arg, long period)
             emcmotConfig->arcBlendRampFreq = emcmotCommand->arcBlendRampFreq;
             emcmotConfig->arcBlendTangentKinkRatio = emcmotCommand->arcBlendTangentKinkRatio;
             break;
+        case EMCMOT_SET_JOINT_LIMIT_SAMPLES:
+            emcmotConfig->jointLimitSamples = emcmotCommand->jointLimitSamples;
+            break;
         case EMCMOT_SET_PROBE_ERR_INHIBIT:
             emcmotConfig->inhibit_probe_jog_error = emcmotCommand->probe_jog_err_inhibit;
             emcmotConfig->inhibit_probe_home_error = emcmotCommand->probe_home_err_inhibit;
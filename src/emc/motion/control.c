@@ -165,6 +165,11 @@ static void output_to_hal(void);
 */
 static void update_status(void);
 
+/* 'update_telemetry()' appends a record of this servo cycle to the
+   telemetry ring when the telemetry module parameter is set.
+*/
+static void update_telemetry(void);
+
 /***********************************************************************
 *                        PUBLIC FUNCTION CODE                          *
 ************************************************************************/
@@ -220,6 +225,7 @@ void emcmotController(void *arg, long period)
     compute_screw_comp();
     output_to_hal();
     update_status();
+    update_telemetry();
     /* here ends the core of the controller */
     emcmotStatus->heartbeat++;
     /* set tail to head, to indicate work complete */
@@ -1932,3 +1938,24 @@ static void update_status(void)
     }
 #endif
 }
+
+static void update_telemetry(void)
+{
+    emcmot_telemetry_rec_t *rec;
+    int joint_num;
+
+    rec = emcmotTelemetryBegin(emcmotTelemetry);
+    if (!rec) {
+	return;
+    }
+    rec->timestamp = rtapi_get_time();
+    rec->pos_cmd = emcmotStatus->carte_pos_cmd;
+    rec->pos_fb = emcmotStatus->carte_pos_fb;
+    rec->id = emcmotStatus->id;
+    rec->feed_scale = emcmotStatus->net_feed_scale;
+    for (joint_num = 0; joint_num < EMCMOT_MAX_JOINTS; joint_num++) {
+	rec->ferror[joint_num] = joint_num < emcmotConfig->numJoints ?
+	    joints[joint_num].ferror : 0.0;
+    }
+    emcmotTelemetryCommit(emcmotTelemetry, rec);
+}
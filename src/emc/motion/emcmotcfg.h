@@ -34,6 +34,9 @@
 #define EMCMOT_ERROR_NUM 32	/* how many errors we can queue */
 #define EMCMOT_ERROR_LEN 1024	/* how long error string can be */
 
+#define EMCMOT_TELEMETRY_NUM 1024	/* servo cycles kept in the telemetry
+					   ring, must be a power of 2 */
+
 /*
   Shared memory keys for simulated motion process. No base address
   values need to be computed, since operating system does this for us
@@ -85,3 +85,95 @@ int emcmotErrorGet(emcmot_error_t * errlog, char *error)
 
     return 0;
 }
+
+int emcmotTelemetryInit(emcmot_telemetry_t * tlm, int enabled)
+{
+    int n;
+
+    if (tlm == 0) {
+	return -1;
+    }
+
+    tlm->enabled = enabled;
+    tlm->seq = 0;
+    for (n = 0; n < EMCMOT_TELEMETRY_NUM; n++) {
+	tlm->rec[n].head = 0;
+	tlm->rec[n].tail = 0;
+    }
+
+    return 0;
+}
+
+/* returns the slot for the next record, or 0 if telemetry is off */
+emcmot_telemetry_rec_t *emcmotTelemetryBegin(emcmot_telemetry_t * tlm)
+{
+    emcmot_telemetry_rec_t *rec;
+    unsigned int n;
+
+    if (tlm == 0 || !tlm->enabled) {
+	return 0;
+    }
+
+    n = tlm->seq + 1;
+    rec = &tlm->rec[n & (EMCMOT_TELEMETRY_NUM - 1)];
+    rec->head = n;
+    __sync_synchronize();
+
+    return rec;
+}
+
+void emcmotTelemetryCommit(emcmot_telemetry_t * tlm, emcmot_telemetry_rec_t * rec)
+{
+    __sync_synchronize();
+    rec->tail = rec->head;
+    __sync_synchronize();
+    tlm->seq = rec->head;
+}
+
+/* Copies up to max records newer than *cursor into recs and advances
+   *cursor past them.  Start a reader with *cursor set to the current
+   tlm->seq.  Records the writer overwrote before they could be read are
+   added to *overruns.  Returns the number of records copied, or -1 if
+   telemetry is off. */
+int emcmotTelemetryRead(emcmot_telemetry_t * tlm, unsigned int *cursor,
+    emcmot_telemetry_rec_t * recs, int max, unsigned int *overruns)
+{
+    emcmot_telemetry_rec_t *rec;
+    unsigned int seq, avail, n, tail;
+    int count = 0;
+
+    if (tlm == 0 || cursor == 0 || recs == 0 || !tlm->enabled) {
+	return -1;
+    }
+
+    while (count < max) {
+	seq = tlm->seq;
+	__sync_synchronize();
+	avail = seq - *cursor;
+	if (avail == 0) {
+	    break;
+	}
+	if (avail > EMCMOT_TELEMETRY_NUM) {
+	    /* lapped, skip to the oldest record still in the ring */
+	    if (overruns) {
+		*overruns += avail - EMCMOT_TELEMETRY_NUM;
+	    }
+	    *cursor = seq - EMCMOT_TELEMETRY_NUM;
+	}
+	n = *cursor + 1;
+	rec = &tlm->rec[n & (EMCMOT_TELEMETRY_NUM - 1)];
+	tail = rec->tail;
+	__sync_synchronize();
+	recs[count] = *rec;
+	__sync_synchronize();
+	if (tail == n && rec->head == n) {
+	    count++;
+	} else if (overruns) {
+	    /* overwritten while we copied it */
+	    (*overruns)++;
+	}
+	*cursor = n;
+    }
+
+    return count;
+}
@@ -222,6 +222,7 @@ extern struct emcmot_status_t *emcmotStatus;
 extern struct emcmot_config_t *emcmotConfig;
 extern struct emcmot_debug_t *emcmotDebug;
 extern struct emcmot_error_t *emcmotError;
+extern struct emcmot_telemetry_t *emcmotTelemetry;
 
 /***********************************************************************
 *                    PUBLIC FUNCTION PROTOTYPES                        *
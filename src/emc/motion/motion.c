@@ -44,6 +44,8 @@ int base_thread_fp = 0;	/* default is no floating point in base thread */
 RTAPI_MP_INT(base_thread_fp, "floating point in base thread?");
 static long servo_period_nsec = 1000000;	/* servo thread period */
 RTAPI_MP_LONG(servo_period_nsec, "servo thread period (nsecs)");
+static int servo_workers = 0;	/* servo thread helper tasks */
+RTAPI_MP_INT(servo_workers, "servo thread worker tasks");
 static long traj_period_nsec = 0;	/* trajectory planner period */
 RTAPI_MP_LONG(traj_period_nsec, "trajectory planner period (nsecs)");
 static int num_joints = EMCMOT_MAX_JOINTS;	/* default number of joints present */
@@ -55,6 +57,9 @@ RTAPI_MP_INT(num_aio, "number of analog inputs/outputs");
 
 static int unlock_joints_mask = 0;/* mask to select joints for unlock pins */
 RTAPI_MP_INT(unlock_joints_mask, "mask to select joints for unlock pins");
+
+static int telemetry = 0;	/* record every servo cycle in shmem */
+RTAPI_MP_INT(telemetry, "record per servo cycle telemetry");
 /***********************************************************************
 *                  GLOBAL VARIABLE DEFINITIONS                         *
 ************************************************************************/
@@ -85,7 +90,8 @@ emcmot_axis_t axis_array[EMCMOT_MAX_AXIS];
 
   emcmotCommand points to emcmotStruct->command,
   emcmotStatus points to emcmotStruct->status,
-  emcmotError points to emcmotStruct->error, and
+  emcmotError points to emcmotStruct->error,
+  emcmotTelemetry points to emcmotStruct->telemetry, and
  */
 emcmot_struct_t *emcmotStruct = 0;
 /* ptrs to either buffered copies or direct memory for command and status */
@@ -94,6 +100,7 @@ struct emcmot_status_t *emcmotStatus = 0;
 struct emcmot_config_t *emcmotConfig = 0;
 struct emcmot_debug_t *emcmotDebug = 0;
 struct emcmot_error_t *emcmotError = 0;	/* unused for RT_FIFO */
+struct emcmot_telemetry_t *emcmotTelemetry = 0;
 
 /***********************************************************************
 *                  LOCAL VARIABLE DECLARATIONS                         *
@@ -621,10 +628,14 @@ static int init_comm_buffers(void)
     emcmotConfig = &emcmotStruct->config;
     emcmotDebug = &emcmotStruct->debug;
     emcmotError = &emcmotStruct->error;
+    emcmotTelemetry = &emcmotStruct->telemetry;
 
     /* init error struct */
     emcmotErrorInit(emcmotError);
 
+    /* init telemetry ring */
+    emcmotTelemetryInit(emcmotTelemetry, telemetry);
+
     /* init command struct */
     emcmotCommand->head = 0;
     emcmotCommand->command = 0;
@@ -828,6 +839,15 @@ static int init_threads(void)
 	    servo_period_nsec);
 	return -1;
     }
+    if (servo_workers > 0) {
+	retval = hal_thread_set_workers("servo-thread", servo_workers);
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"MOTION: failed to add %d workers to servo thread\n",
+		servo_workers);
+	    return -1;
+	}
+    }
     /* export realtime functions that do the real work */
     retval = hal_export_funct("motion-controller", emcmotController, 0	/* arg 
 	 */ , 1 /* uses_fp */ , 0 /* reentrant */ , mot_comp_id);
@@ -124,6 +124,7 @@ extern "C" {
 
 	EMCMOT_SET_LINE,	/* queue up a linear move */
 	EMCMOT_SET_CIRCLE,	/* queue up a circular move */
+	EMCMOT_SET_SPLINE,	/* queue up a cubic spline move */
 	EMCMOT_SET_TELEOP_VECTOR,	/* Move at a given velocity but in
 					   world cartesian coordinates, not
 					   in joint space like EMCMOT_JOG_* */
@@ -154,6 +155,7 @@ extern "C" {
         EMCMOT_SET_OFFSET, /* set tool offsets */
         EMCMOT_SET_MAX_FEED_OVERRIDE,
         EMCMOT_SETUP_ARC_BLENDS,
+        EMCMOT_SET_JOINT_LIMIT_SAMPLES, /* sample queued segments against joint limits */
 
 	EMCMOT_SET_PROBE_ERR_INHIBIT,
 	EMCMOT_ENABLE_WATCHDOG,         /* enable watchdog sound, parport */
@@ -219,6 +221,7 @@ extern "C" {
 	EmcPose pos;		/* line/circle endpt, or teleop vector */
 	PmCartesian center;	/* center for circle */
 	PmCartesian normal;	/* normal vec for circle */
+	PmCartesian ctrl1, ctrl2;	/* inner control points for spline */
 	int turn;		/* turns for circle or which rotary to unlock for a line */
 	double vel;		/* max velocity */
         double ini_maxvel;      /* max velocity allowed by machine
@@ -267,6 +270,7 @@ extern "C" {
         double arcBlendRampFreq;
         double arcBlendTangentKinkRatio;
         double maxFeedScale;
+        int jointLimitSamples;
     } emcmot_command_t;
 
 /*! \todo FIXME - these packed bits might be replaced with chars
@@ -782,6 +786,8 @@ Suggestion: Split this in to an Error and a Status flag register..
         double maxFeedScale;
         int inhibit_probe_jog_error;
         int inhibit_probe_home_error;
+        int jointLimitSamples;	/* points per segment checked against the
+				   joint limits, 0 to disable */
     } emcmot_config_t;
 
 /*********************************
@@ -814,6 +820,28 @@ Suggestion: Split this in to an Error and a Status flag register..
 	unsigned char tail;	/* flag count for mutex detect */
     } emcmot_error_t;
 
+/* telemetry structure - A ring buffer holding one record per servo cycle.
+   Motion is the only writer and never waits for readers; each reader
+   keeps its own cursor and is told how many records it missed when the
+   writer laps it.  A record is valid when its head and tail both equal
+   its sequence number. */
+    typedef struct emcmot_telemetry_rec_t {
+	volatile unsigned int head;	/* sequence number, written first */
+	long long int timestamp;	/* rtapi_get_time() in nsec */
+	EmcPose pos_cmd;	/* commanded Cartesian position */
+	EmcPose pos_fb;		/* actual Cartesian position */
+	int id;			/* executing motion id (source line) */
+	double feed_scale;	/* net feed scale */
+	double ferror[EMCMOT_MAX_JOINTS];	/* following error per joint */
+	volatile unsigned int tail;	/* sequence number, written last */
+    } emcmot_telemetry_rec_t;
+
+    typedef struct emcmot_telemetry_t {
+	int enabled;		/* set by the motmod telemetry parameter */
+	volatile unsigned int seq;	/* sequence number of newest record */
+	emcmot_telemetry_rec_t rec[EMCMOT_TELEMETRY_NUM];
+    } emcmot_telemetry_t;
+
 /*
   function prototypes for emcmot code
 */
@@ -825,6 +853,15 @@ Suggestion: Split this in to an Error and a Status flag register..
     extern int emcmotErrorPutf(emcmot_error_t * errlog, const char *fmt, ...);
     extern int emcmotErrorGet(emcmot_error_t * errlog, char *error);
 
+/* telemetry ring buffer access functions */
+    extern int emcmotTelemetryInit(emcmot_telemetry_t * tlm, int enabled);
+    extern emcmot_telemetry_rec_t *emcmotTelemetryBegin(emcmot_telemetry_t * tlm);
+    extern void emcmotTelemetryCommit(emcmot_telemetry_t * tlm,
+	emcmot_telemetry_rec_t * rec);
+    extern int emcmotTelemetryRead(emcmot_telemetry_t * tlm,
+	unsigned int *cursor, emcmot_telemetry_rec_t * recs, int max,
+	unsigned int *overruns);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,8 @@
 	struct emcmot_error_t error;	/* ring buffer for error messages */
 	struct emcmot_debug_t debug;	/* Struct used to store RT status and debug
 				   data - 2nd largest block */
+	struct emcmot_telemetry_t telemetry;	/* per servo cycle records,
+						   only filled when enabled */
     } emcmot_struct_t;
 
 
@@ -44,6 +44,7 @@ static emcmot_status_t *emcmotStatus = 0;
 static emcmot_config_t *emcmotConfig = 0;
 static emcmot_debug_t *emcmotDebug = 0;
 static emcmot_error_t *emcmotError = 0;
+static emcmot_telemetry_t *emcmotTelemetry = 0;
 static emcmot_struct_t *emcmotStruct = 0;
 
 /* usrmotIniLoad() loads params (SHMEM_KEY, COMM_TIMEOUT, COMM_WAIT)
@@ -211,6 +212,24 @@ int usrmotReadEmcmotError(char *e)
     return 0;
 }
 
+/* copies up to max telemetry records newer than *cursor to recs */
+int usrmotReadEmcmotTelemetry(unsigned int *cursor,
+    struct emcmot_telemetry_rec_t * recs, int max, unsigned int *overruns)
+{
+    /* check to see if ptr still around */
+    if (emcmotTelemetry == 0) {
+	return -1;
+    }
+
+    return emcmotTelemetryRead(emcmotTelemetry, cursor, recs, max, overruns);
+}
+
+/* sequence number of the newest telemetry record, to start a reader */
+unsigned int usrmotEmcmotTelemetrySeq(void)
+{
+    return emcmotTelemetry ? emcmotTelemetry->seq : 0;
+}
+
 /*
  htostr()
 
@@ -678,6 +697,7 @@ int usrmotInit(const char *modname)
     emcmotDebug = &(emcmotStruct->debug);
     emcmotConfig = &(emcmotStruct->config);
     emcmotError = &(emcmotStruct->error);
+    emcmotTelemetry = &(emcmotStruct->telemetry);
 
     inited = 1;
 
@@ -695,6 +715,7 @@ int usrmotExit(void)
     emcmotCommand = 0;
     emcmotStatus = 0;
     emcmotError = 0;
+    emcmotTelemetry = 0;
 /*! \todo Another #if 0 */
 #if 0
 /*! \todo FIXME - comp structs no longer in shmem */
@@ -20,6 +20,7 @@ struct emcmot_command_t;
 struct emcmot_config_t;
 struct emcmot_debug_t;
 struct emcmot_error_t;
+struct emcmot_telemetry_rec_t;
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +46,15 @@ extern "C" {
    the emcmot controller and puts it in arg */
     extern int usrmotReadEmcmotError(char *e);
 
+/* usrmotReadEmcmotTelemetry() copies up to max per servo cycle records
+   newer than *cursor into recs and advances *cursor.  Records lost to
+   the writer are counted in *overruns.  Returns the number copied, or
+   -1 if motion was loaded without telemetry=1.  Start a reader with
+   *cursor = usrmotEmcmotTelemetrySeq(). */
+    extern int usrmotReadEmcmotTelemetry(unsigned int *cursor,
+	struct emcmot_telemetry_rec_t * recs, int max, unsigned int *overruns);
+    extern unsigned int usrmotEmcmotTelemetrySeq(void);
+
 /* usrmotPrintEmcmotStatus() prints the status in s, using which
    arg to select sub-prints */
     extern void usrmotPrintEmcmotStatus(emcmot_status_t *s, int which);
@@ -163,6 +163,8 @@ typedef struct CanonConfig_t {
    almost any deviation trying to keep speed up. */
    double motionTolerance;
    double naivecamTolerance;
+/* the same tolerance for the rotary axes, in degrees */
+   double naivecamAngularTolerance;
 /* Spindle speed is saved here */
    double spindleSpeed;
    int spindle_dir;
@@ -896,7 +898,8 @@ extern double GET_EXTERNAL_TOOL_LENGTH_UOFFSET();
 extern double GET_EXTERNAL_TOOL_LENGTH_VOFFSET();
 extern double GET_EXTERNAL_TOOL_LENGTH_WOFFSET();
 
-// Returns number of slots in carousel
+// Returns number of slots in carousel.  The interpreter reads this many
+// pockets on every synch, so it may be just the pockets in use.
 extern int GET_EXTERNAL_POCKETS_MAX();
 
 // Returns the system value for the carousel slot in which the tool
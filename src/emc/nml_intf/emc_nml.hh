@@ -864,6 +864,24 @@ class EMC_TRAJ_CIRCULAR_MOVE:public EMC_TRAJ_CMD_MSG {
     int feed_mode;
 };
 
+class EMC_TRAJ_SPLINE_MOVE:public EMC_TRAJ_CMD_MSG {
+  public:
+    EMC_TRAJ_SPLINE_MOVE():EMC_TRAJ_CMD_MSG(EMC_TRAJ_SPLINE_MOVE_TYPE,
+					    sizeof
+					    (EMC_TRAJ_SPLINE_MOVE)) {
+    };
+
+    // For internal NML/CMS use only.
+    void update(CMS * cms);
+
+    EmcPose end;
+    PM_CARTESIAN ctrl1;		// inner control points of the cubic
+    PM_CARTESIAN ctrl2;
+    int type;
+    double vel, ini_maxvel, acc;
+    int feed_mode;
+};
+
 class EMC_TRAJ_SET_TERM_COND:public EMC_TRAJ_CMD_MSG {
   public:
     EMC_TRAJ_SET_TERM_COND():EMC_TRAJ_CMD_MSG(EMC_TRAJ_SET_TERM_COND_TYPE,
@@ -1627,11 +1645,14 @@ class EMC_TOOL_STAT:public EMC_TOOL_STAT_MSG {
 
     // For internal NML/CMS use only.
     void update(CMS * cms);
-    EMC_TOOL_STAT operator =(EMC_TOOL_STAT s);	// need this for [] members
+    EMC_TOOL_STAT operator =(EMC_TOOL_STAT s);
 
     int pocketPrepped;		// pocket ready for loading from
     int toolInSpindle;		// tool loaded, 0 is no tool
-    CANON_TOOL_TABLE toolTable[CANON_POCKETS_MAX];
+    // The tool table itself is in shared memory (see tooldata.hh);
+    // the generation changes whenever any entry of it does.
+    unsigned int toolTableGeneration;
+    CANON_TOOL_TABLE spindleTool;	// copy of pocket 0
 };
 
 // EMC_AUX type declarations
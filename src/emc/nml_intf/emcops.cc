@@ -156,19 +156,16 @@ EMC_TASK_STAT_MSG(EMC_TASK_STAT_TYPE, sizeof(EMC_TASK_STAT))
 EMC_TOOL_STAT::EMC_TOOL_STAT():
 EMC_TOOL_STAT_MSG(EMC_TOOL_STAT_TYPE, sizeof(EMC_TOOL_STAT))
 {
-    int t;
-
     pocketPrepped = 0;
     toolInSpindle = 0;
-
-    for (t = 0; t < CANON_POCKETS_MAX; t++) {
-	toolTable[t].toolno = 0;
-        ZERO_EMC_POSE(toolTable[t].offset);
-	toolTable[t].diameter = 0.0;
-	toolTable[t].orientation = 0;
-	toolTable[t].frontangle = 0.0;
-	toolTable[t].backangle = 0.0;
-    }
+    toolTableGeneration = 0;
+
+    spindleTool.toolno = 0;
+    ZERO_EMC_POSE(spindleTool.offset);
+    spindleTool.diameter = 0.0;
+    spindleTool.orientation = 0;
+    spindleTool.frontangle = 0.0;
+    spindleTool.backangle = 0.0;
 }
 
 EMC_AUX_STAT::EMC_AUX_STAT():
@@ -202,22 +199,12 @@ EMC_LUBE_STAT_MSG(EMC_LUBE_STAT_TYPE, sizeof(EMC_LUBE_STAT))
     level = 1;
 }
 
-// overload = , since class has array elements
 EMC_TOOL_STAT EMC_TOOL_STAT::operator =(EMC_TOOL_STAT s)
 {
-    int t;
-
     pocketPrepped = s.pocketPrepped;
     toolInSpindle = s.toolInSpindle;
-
-    for (t = 0; t < CANON_POCKETS_MAX; t++) {
-	toolTable[t].toolno = s.toolTable[t].toolno;
-	toolTable[t].offset = s.toolTable[t].offset;
-	toolTable[t].diameter = s.toolTable[t].diameter;
-	toolTable[t].frontangle = s.toolTable[t].frontangle;
-	toolTable[t].backangle = s.toolTable[t].backangle;
-	toolTable[t].orientation = s.toolTable[t].orientation;
-    }
+    toolTableGeneration = s.toolTableGeneration;
+    spindleTool = s.spindleTool;
 
     return s;
 }
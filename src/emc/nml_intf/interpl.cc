@@ -17,31 +17,85 @@
 
 
 #include <string.h>		/* memcpy() */
+#include <new>			/* std::nothrow */
 
-#include "rcs.hh"		// LinkedList
+#include "rcs.hh"
 #include "interpl.hh"		// these decls
 #include "emc.hh"
 #include "emcglb.h"
-#include "linklist.hh"
 #include "nmlmsg.hh"            /* class NMLmsg */
 #include "rcs_print.hh"
 
 NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
 
+struct NML_INTERP_LIST_CHUNK {
+    NML_INTERP_LIST_CHUNK *next;
+    NML_INTERP_LIST_NODE nodes[NML_INTERP_LIST_CHUNK_SIZE];
+};
+
 NML_INTERP_LIST::NML_INTERP_LIST()
 {
-    linked_list_ptr = new LinkedList;
+    chunks = NULL;
+    free_list = NULL;
+    head = NULL;
+    tail = NULL;
+    retrieved = NULL;
+    list_size = 0;
 
     next_line_number = 0;
     line_number = 0;
+    tap = NULL;
+
+    // start with one chunk so short programs never allocate; if that
+    // fails, append() reports it
+    NML_INTERP_LIST_NODE *node = alloc_node();
+    if (NULL != node) {
+	free_node(node);
+    }
 }
 
 NML_INTERP_LIST::~NML_INTERP_LIST()
 {
-    if (NULL != linked_list_ptr) {
-	delete linked_list_ptr;
-	linked_list_ptr = NULL;
+    while (NULL != chunks) {
+	NML_INTERP_LIST_CHUNK *next = chunks->next;
+	delete chunks;
+	chunks = next;
+    }
+    free_list = NULL;
+    head = tail = retrieved = NULL;
+    list_size = 0;
+}
+
+NML_INTERP_LIST_NODE *NML_INTERP_LIST::alloc_node()
+{
+    NML_INTERP_LIST_NODE *node;
+
+    if (NULL == free_list) {
+	NML_INTERP_LIST_CHUNK *chunk = new (std::nothrow) NML_INTERP_LIST_CHUNK;
+	if (NULL == chunk) {
+	    return NULL;
+	}
+	chunk->next = chunks;
+	chunks = chunk;
+	for (int i = 0; i < NML_INTERP_LIST_CHUNK_SIZE; i++) {
+	    free_node(&chunk->nodes[i]);
+	}
+	if (emc_debug & EMC_DEBUG_INTERP_LIST) {
+	    rcs_print("NML_INTERP_LIST(%p): grew node pool, list_size=%d\n",
+		      this, list_size);
+	}
     }
+
+    node = free_list;
+    free_list = node->next;
+    node->next = NULL;
+    return node;
+}
+
+void NML_INTERP_LIST::free_node(NML_INTERP_LIST_NODE *node)
+{
+    node->next = free_list;
+    free_list = node;
 }
 
 int NML_INTERP_LIST::append(NMLmsg & nml_msg)
@@ -82,39 +136,36 @@ int NML_INTERP_LIST::append(NMLmsg * nml_msg_ptr)
 	    ("NML_INTERP_LIST::append : command size is invalid.");
 	return -1;
     }
-#ifdef DEBUG_INTERPL
-    if (sizeof(temp_node) < MAX_NML_COMMAND_SIZE + 4 ||
-	sizeof(temp_node) > MAX_NML_COMMAND_SIZE + 16 ||
-	((void *) &temp_node.line_number) >
-	((void *) &temp_node.command.commandbuf)) {
+
+    NML_INTERP_LIST_NODE *node_ptr = alloc_node();
+    if (NULL == node_ptr) {
 	rcs_print_error
-	    ("NML_INTERP_LIST::append : assumptions about NML_INTERP_LIST_NODE have been violated.");
+	    ("NML_INTERP_LIST::append : out of memory.\n");
 	return -1;
     }
-#endif
 
-    if (NULL == linked_list_ptr) {
-	return -1;
-    }
     // fill in the NML_INTERP_LIST_NODE
-    temp_node.line_number = next_line_number;
-    memcpy(temp_node.command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
+    node_ptr->line_number = next_line_number;
+    memcpy(node_ptr->command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
+    if (NULL != tap) {
+	tap(next_line_number, nml_msg_ptr);
+    }
 
     // stick it on the list
-    linked_list_ptr->store_at_tail(&temp_node,
-				   nml_msg_ptr->size +
-				   sizeof(temp_node.line_number) +
-				   sizeof(temp_node.dummy) + 32 + (32 -
-								   nml_msg_ptr->
-								   size %
-								   32), 1);
+    if (NULL == tail) {
+	head = node_ptr;
+    } else {
+	tail->next = node_ptr;
+    }
+    tail = node_ptr;
+    list_size++;
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
 	rcs_print
 	    ("NML_INTERP_LIST(%p)::append(nml_msg_ptr{size=%ld,type=%s}) : list_size=%d, line_number=%d\n",
              this,
 	     nml_msg_ptr->size, emc_symbol_lookup(nml_msg_ptr->type),
-	     linked_list_ptr->list_size, temp_node.line_number);
+	     list_size, node_ptr->line_number);
     }
 
     return 0;
@@ -125,21 +176,29 @@ NMLmsg *NML_INTERP_LIST::get()
     NMLmsg *ret;
     NML_INTERP_LIST_NODE *node_ptr;
 
-    if (NULL == linked_list_ptr) {
-	line_number = 0;
-	return NULL;
-    }
-
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->retrieve_head();
+    node_ptr = head;
 
     if (NULL == node_ptr) {
 	line_number = 0;
 	return NULL;
     }
+    // get it off the front
+    head = node_ptr->next;
+    if (NULL == head) {
+	tail = NULL;
+    }
+    node_ptr->next = NULL;
+    list_size--;
+
+    // the previous message is no longer in use by the caller
+    if (NULL != retrieved) {
+	free_node(retrieved);
+    }
+    retrieved = node_ptr;
+
     // save line number of this one, for use by get_line_number
     line_number = node_ptr->line_number;
 
-    // get it off the front
     ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
@@ -148,7 +207,7 @@ NMLmsg *NML_INTERP_LIST::get()
             this,
             ret->size,
             emc_symbol_lookup(ret->type),
-            linked_list_ptr->list_size
+            list_size
         );
     }
 
@@ -157,8 +216,16 @@ NMLmsg *NML_INTERP_LIST::get()
 
 void NML_INTERP_LIST::clear()
 {
-    if (NULL != linked_list_ptr) {
-	linked_list_ptr->delete_members();
+    while (NULL != head) {
+	NML_INTERP_LIST_NODE *next = head->next;
+	free_node(head);
+	head = next;
+    }
+    tail = NULL;
+    list_size = 0;
+    if (NULL != retrieved) {
+	free_node(retrieved);
+	retrieved = NULL;
     }
 }
 
@@ -168,30 +235,23 @@ void NML_INTERP_LIST::print()
     NML_INTERP_LIST_NODE *node_ptr;
     int line_number;
 
-    if (NULL == linked_list_ptr) {
-	return;
-    }
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_head();
+    node_ptr = head;
 
-    rcs_print("NML_INTERP_LIST::print(): list size=%d\n",linked_list_ptr->list_size);
+    rcs_print("NML_INTERP_LIST::print(): list size=%d\n",list_size);
     while (NULL != node_ptr) {
 	line_number = node_ptr->line_number;
 	ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
 	rcs_print("--> type=%s,  line_number=%d\n",
 		  emc_symbol_lookup((int)ret->type),
 		  line_number);
-	node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_next();
+	node_ptr = node_ptr->next;
     }
     rcs_print("\n");
 }
 
 int NML_INTERP_LIST::len()
 {
-    if (NULL == linked_list_ptr) {
-	return 0;
-    }
-
-    return ((int) linked_list_ptr->list_size);
+    return list_size;
 }
 
 int NML_INTERP_LIST::get_line_number()
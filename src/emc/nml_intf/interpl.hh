@@ -21,6 +21,9 @@
 
 #define MAX_NML_COMMAND_SIZE 1000
 
+// number of nodes the interp list allocates at a time when its pool runs dry
+#define NML_INTERP_LIST_CHUNK_SIZE 256
+
 // these go on the interp list
 struct NML_INTERP_LIST_NODE {
     int line_number;		// line number it was on
@@ -42,8 +45,15 @@ struct NML_INTERP_LIST_NODE {
 	int64_t ll;
 	long double ld;
     } command;
+
+    NML_INTERP_LIST_NODE *next;	// next queued node, or next free node
 };
 
+struct NML_INTERP_LIST_CHUNK;
+
+// sees every message appended, with its line number
+typedef void (*NML_INTERP_LIST_TAP) (int line_number, NMLmsg * msg);
+
 // here's the interp list itself
 class NML_INTERP_LIST {
   public:
@@ -58,12 +68,23 @@ class NML_INTERP_LIST {
     void clear();
     void print();
     int len();
+    void set_tap(NML_INTERP_LIST_TAP t) { tap = t; }
 
   private:
-    class LinkedList * linked_list_ptr;
-    NML_INTERP_LIST_NODE temp_node;	// filled in and put on the list
-    int next_line_number;	// line number used to fill temp_node
+    NML_INTERP_LIST_NODE *alloc_node();
+    void free_node(NML_INTERP_LIST_NODE *node);
+
+    // Nodes come from a pool that only grows, so once the pool is big
+    // enough for the program appending and getting does no allocation.
+    NML_INTERP_LIST_CHUNK *chunks;	// everything ever allocated
+    NML_INTERP_LIST_NODE *free_list;	// unused nodes
+    NML_INTERP_LIST_NODE *head;	// oldest queued node, returned next by get()
+    NML_INTERP_LIST_NODE *tail;	// newest queued node
+    NML_INTERP_LIST_NODE *retrieved;	// node from get(), kept until the next get()
+    int list_size;
+    int next_line_number;	// line number used for appended nodes
     int line_number;		// line number of node from get()
+    NML_INTERP_LIST_TAP tap;
 };
 
 extern NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
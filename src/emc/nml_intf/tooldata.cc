@@ -0,0 +1,369 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <string.h>
+#include <sched.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "tooldata.hh"
+#include "shm.hh"
+#include "timer.hh"
+
+#define TOOLDATA_MAGIC 0x544f4f4c	// "TOOL"
+#define TOOLDATA_INDEX_BITS 13		// twice TOOLDATA_MAX_POCKETS
+#define TOOLDATA_INDEX_SIZE (1 << TOOLDATA_INDEX_BITS)
+#define TOOLDATA_READ_SPINS 1000	// before readers start to yield
+
+// keep the index at most half full so probe sequences stay short
+typedef char tooldata_index_size_check
+    [TOOLDATA_INDEX_SIZE >= 2 * TOOLDATA_MAX_POCKETS ? 1 : -1];
+
+struct tooldata_shm {
+    unsigned int magic;
+    volatile unsigned int seq;		// odd while an update is in progress
+    volatile unsigned int generation;
+    int pockets;
+    int duplicates;			// a tool number is in more than one pocket
+    int index[TOOLDATA_INDEX_SIZE];	// pocket + 1, or 0 for an empty slot
+    tooldata_entry entry[TOOLDATA_MAX_POCKETS];
+};
+
+static inline unsigned int index_hash(int toolno)
+{
+    return ((unsigned int) toolno * 2654435761u) >> (32 - TOOLDATA_INDEX_BITS);
+}
+
+static void entry_clear(tooldata_entry & e)
+{
+    e.tool.toolno = -1;
+    ZERO_EMC_POSE(e.tool.offset);
+    e.tool.diameter = 0.0;
+    e.tool.frontangle = 0.0;
+    e.tool.backangle = 0.0;
+    e.tool.orientation = 0;
+    e.fms = 0;
+    e.comment[0] = '\0';
+}
+
+ToolData::ToolData(int create):shm(0), data(0), depth(0)
+{
+    if (!create) {
+	attach();
+	return;
+    }
+    shm = new RCS_SHAREDMEM(TOOLDATA_SHMEM_KEY, sizeof(tooldata_shm),
+			    RCS_SHAREDMEM_CREATE, 0666);
+    if (!shm->addr) {
+	delete shm;
+	shm = 0;
+	return;
+    }
+    data = (tooldata_shm *) shm->addr;
+    // An odd sequence left behind means the last writer died in the
+    // middle of an update; start over rather than lock the readers out.
+    if (shm->created || data->magic != TOOLDATA_MAGIC || (data->seq & 1)) {
+	data->magic = 0;
+	data->seq = 0;
+	data->generation = 0;
+	clear(0);
+	__sync_synchronize();
+	data->magic = TOOLDATA_MAGIC;
+    }
+}
+
+ToolData::~ToolData()
+{
+    delete shm;
+}
+
+int ToolData::attach()
+{
+    if (valid())
+	return 0;
+    if (shm)
+	return -1;		// attached, the writer is still setting up
+    // RCS_SHAREDMEM complains about a missing segment, so look first
+    if (shmget(TOOLDATA_SHMEM_KEY, 0, 0) == -1)
+	return -1;
+    shm = new RCS_SHAREDMEM(TOOLDATA_SHMEM_KEY, sizeof(tooldata_shm),
+			    RCS_SHAREDMEM_NOCREATE, 0666);
+    if (!shm->addr) {
+	delete shm;
+	shm = 0;
+	return -1;
+    }
+    data = (tooldata_shm *) shm->addr;
+    return valid() ? 0 : -1;
+}
+
+int ToolData::valid() const
+{
+    return data && data->magic == TOOLDATA_MAGIC;
+}
+
+unsigned int ToolData::generation() const
+{
+    return valid() ? data->generation : 0;
+}
+
+int ToolData::pockets() const
+{
+    return valid() ? data->pockets : 0;
+}
+
+// Wait until no update is in progress.  Returns -1 if one takes longer
+// than TOOLDATA_READ_TIMEOUT; the deadline is shared by the retries of one
+// read.  The writer reads its own updates as they are.
+int ToolData::read_begin(unsigned int & seq, double & deadline) const
+{
+    int spins = 0;
+
+    if (depth) {
+	seq = data->seq;
+	return 0;
+    }
+    while ((seq = data->seq) & 1) {
+	if (++spins < TOOLDATA_READ_SPINS)
+	    continue;
+	if (deadline == 0.0)
+	    deadline = etime() + TOOLDATA_READ_TIMEOUT;
+	else if (etime() > deadline)
+	    return -1;
+	sched_yield();
+    }
+    __sync_synchronize();
+    return 0;
+}
+
+// Nonzero if an update began while reading, so the copy must be read again
+int ToolData::read_retry(unsigned int seq, double & deadline) const
+{
+    __sync_synchronize();
+    if (seq == data->seq)
+	return 0;
+    if (deadline == 0.0)
+	deadline = etime() + TOOLDATA_READ_TIMEOUT;
+    return 1;
+}
+
+int ToolData::get(int pocket, tooldata_entry & entry) const
+{
+    unsigned int seq;
+    double deadline = 0.0;
+
+    if (!valid() || pocket < 0 || pocket >= TOOLDATA_MAX_POCKETS)
+	return -1;
+    do {
+	if (read_begin(seq, deadline) != 0)
+	    return -1;
+	entry = data->entry[pocket];
+    } while (read_retry(seq, deadline));
+    return 0;
+}
+
+int ToolData::get(int pocket, CANON_TOOL_TABLE & tool) const
+{
+    unsigned int seq;
+    double deadline = 0.0;
+
+    if (!valid() || pocket < 0 || pocket >= TOOLDATA_MAX_POCKETS)
+	return -1;
+    do {
+	if (read_begin(seq, deadline) != 0)
+	    return -1;
+	tool = data->entry[pocket].tool;
+    } while (read_retry(seq, deadline));
+    return 0;
+}
+
+// Also -1 if the table could not be read
+int ToolData::find(int toolno) const
+{
+    unsigned int seq;
+    double deadline = 0.0;
+    int pocket;
+
+    if (!valid() || toolno < 0)
+	return -1;
+    do {
+	if (read_begin(seq, deadline) != 0)
+	    return -1;
+	pocket = index_lookup(toolno);
+    } while (read_retry(seq, deadline));
+    return pocket;
+}
+
+int ToolData::index_lookup(int toolno) const
+{
+    unsigned int i = index_hash(toolno);
+    int slot;
+
+    while ((slot = data->index[i]) != 0) {
+	if (data->entry[slot - 1].tool.toolno == toolno)
+	    return slot - 1;
+	i = (i + 1) & (TOOLDATA_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+// Pocket 0 is the spindle, which holds a copy of a pocketed tool on
+// nonrandom changers, so it is never indexed.
+void ToolData::index_insert(int pocket)
+{
+    int toolno = data->entry[pocket].tool.toolno;
+    unsigned int i;
+
+    if (pocket == 0 || toolno < 0)
+	return;
+    if (index_lookup(toolno) >= 0) {
+	data->duplicates = 1;
+	return;
+    }
+    i = index_hash(toolno);
+    while (data->index[i] != 0)
+	i = (i + 1) & (TOOLDATA_INDEX_SIZE - 1);
+    data->index[i] = pocket + 1;
+}
+
+void ToolData::index_remove(int pocket)
+{
+    int toolno = data->entry[pocket].tool.toolno;
+    unsigned int i, j, k;
+    int p;
+
+    if (pocket == 0 || toolno < 0)
+	return;
+    i = index_hash(toolno);
+    while (data->index[i] != pocket + 1) {
+	if (data->index[i] == 0)
+	    return;
+	i = (i + 1) & (TOOLDATA_INDEX_SIZE - 1);
+    }
+    // Close the gap so later entries of the probe sequence stay reachable
+    j = i;
+    for (;;) {
+	data->index[i] = 0;
+	do {
+	    j = (j + 1) & (TOOLDATA_INDEX_SIZE - 1);
+	    if (data->index[j] == 0)
+		goto removed;
+	    k = index_hash(data->entry[data->index[j] - 1].tool.toolno);
+	} while (i <= j ? (i < k && k <= j) : (i < k || k <= j));
+	data->index[i] = data->index[j];
+	i = j;
+    }
+  removed:
+    // Another pocket may hold the same tool number and becomes the one
+    // that lookups find.  Only tables with duplicates pay for the scan.
+    if (data->duplicates) {
+	for (p = 1; p < data->pockets; p++) {
+	    if (p != pocket && data->entry[p].tool.toolno == toolno) {
+		index_insert(p);
+		break;
+	    }
+	}
+    }
+}
+
+void ToolData::begin_update()
+{
+    if (depth++ == 0) {
+	data->seq++;
+	__sync_synchronize();
+    }
+}
+
+void ToolData::end_update()
+{
+    if (--depth == 0) {
+	__sync_synchronize();
+	data->generation++;
+	data->seq++;
+    }
+}
+
+// Empty the pockets from first_pocket on.  Nonrandom changers pass 1 to
+// keep the tool in the spindle.
+void ToolData::clear(int first_pocket)
+{
+    int p;
+
+    if (!data)
+	return;
+    begin_update();
+    memset(data->index, 0, sizeof(data->index));
+    for (p = first_pocket; p < TOOLDATA_MAX_POCKETS; p++)
+	entry_clear(data->entry[p]);
+    data->pockets = first_pocket;
+    data->duplicates = 0;
+    end_update();
+}
+
+int ToolData::put(int pocket, const tooldata_entry & entry)
+{
+    if (!valid() || pocket < 0 || pocket >= TOOLDATA_MAX_POCKETS)
+	return -1;
+    begin_update();
+    index_remove(pocket);
+    data->entry[pocket] = entry;
+    index_insert(pocket);
+    if (pocket >= data->pockets)
+	data->pockets = pocket + 1;
+    end_update();
+    return 0;
+}
+
+int ToolData::put(int pocket, const CANON_TOOL_TABLE & tool)
+{
+    if (!valid() || pocket < 0 || pocket >= TOOLDATA_MAX_POCKETS)
+	return -1;
+    begin_update();
+    index_remove(pocket);
+    data->entry[pocket].tool = tool;
+    index_insert(pocket);
+    if (pocket >= data->pockets)
+	data->pockets = pocket + 1;
+    end_update();
+    return 0;
+}
+
+// Exchange the tools (and comments) of two pockets, as a random tool
+// changer does on M6.  The file pocket numbers stay with the pockets.
+int ToolData::swap(int pocket1, int pocket2)
+{
+    tooldata_entry temp;
+    int fms1, fms2;
+
+    if (!valid() || pocket1 < 0 || pocket1 >= TOOLDATA_MAX_POCKETS
+	|| pocket2 < 0 || pocket2 >= TOOLDATA_MAX_POCKETS)
+	return -1;
+    begin_update();
+    index_remove(pocket1);
+    index_remove(pocket2);
+    fms1 = data->entry[pocket1].fms;
+    fms2 = data->entry[pocket2].fms;
+    temp = data->entry[pocket1];
+    data->entry[pocket1] = data->entry[pocket2];
+    data->entry[pocket2] = temp;
+    data->entry[pocket1].fms = fms1;
+    data->entry[pocket2].fms = fms2;
+    index_insert(pocket1);
+    index_insert(pocket2);
+    if (pocket1 >= data->pockets)
+	data->pockets = pocket1 + 1;
+    if (pocket2 >= data->pockets)
+	data->pockets = pocket2 + 1;
+    end_update();
+    return 0;
+}
@@ -0,0 +1,88 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef TOOLDATA_HH
+#define TOOLDATA_HH
+
+#include "emctool.h"
+
+/*
+  The tool table lives in its own shared memory segment instead of the
+  status buffer.  Entries are indexed by pocket, and tool numbers are
+  hashed to their pocket, so neither lookup scans the table.  EMC_TOOL_STAT
+  only carries a generation number that changes whenever the table does.
+
+  There is a single writer (iocontrol, or task when it runs the tool
+  changer itself); any number of processes on the same machine may read.
+  Readers never block the writer: they retry if an update was in progress,
+  and give up with an error after TOOLDATA_READ_TIMEOUT seconds, e.g. when
+  the writer died in the middle of one.
+*/
+
+#define TOOLDATA_SHMEM_KEY 1010
+#define TOOLDATA_MAX_POCKETS CANON_POCKETS_MAX
+#define TOOLDATA_READ_TIMEOUT 0.5
+
+struct tooldata_entry {
+    CANON_TOOL_TABLE tool;		// toolno -1 marks an empty pocket
+    int fms;				// pocket number as written in the file
+    char comment[CANON_TOOL_ENTRY_LEN];
+};
+
+struct tooldata_shm;
+class RCS_SHAREDMEM;
+
+class ToolData {
+  public:
+    // The writer creates the segment, readers attach to an existing one.
+    ToolData(int create);
+    ~ToolData();
+
+    // Readers may start before the writer: attach if the segment exists
+    // by now.  Cheap when already attached.  Returns 0 if valid.
+    int attach();
+    int valid() const;
+    unsigned int generation() const;
+    int pockets() const;		// one more than the highest pocket used
+
+    int get(int pocket, CANON_TOOL_TABLE & tool) const;
+    int get(int pocket, tooldata_entry & entry) const;
+    int find(int toolno) const;		// pocket >= 1 holding toolno, or -1
+
+    // Changes between begin_update() and end_update() appear to readers
+    // as one, e.g. loading a whole file.  Calls may nest.
+    void begin_update();
+    void end_update();
+
+    void clear(int first_pocket);
+    int put(int pocket, const CANON_TOOL_TABLE & tool);
+    int put(int pocket, const tooldata_entry & entry);
+    int swap(int pocket1, int pocket2);
+
+  private:
+    int read_begin(unsigned int & seq, double & deadline) const;
+    int read_retry(unsigned int seq, double & deadline) const;
+    void index_insert(int pocket);
+    void index_remove(int pocket);
+    int index_lookup(int toolno) const;
+
+    RCS_SHAREDMEM *shm;
+    tooldata_shm *data;
+    int depth;				// nesting of begin_update()
+
+    ToolData(const ToolData &);		// Don't copy me.
+    ToolData & operator =(const ToolData &);
+};
+
+#endif
@@ -22,6 +22,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <libgen.h>
+#include <sys/inotify.h>
 
 #include <boost/python/exec.hpp>
 #include <boost/python/extract.hpp>
@@ -62,6 +64,8 @@ bp::object working_execfile(const char *filename, bp::object globals, bp::object
 int PythonPlugin::run_string(const char *cmd, bp::object &retval, bool as_file)
 {
     reload();
+    // the code may rebind anything in the namespace
+    callables.clear();
     try {
 	if (as_file)
 	    retval = working_execfile(cmd, main_namespace, main_namespace);
@@ -112,6 +116,30 @@ int PythonPlugin::call_method(bp::object method, bp::object &retval)
 
 }
 
+// look up [module.]callable, once per (re)load of the toplevel module
+// throws KeyError if there is no such name
+bp::object PythonPlugin::resolve(const char *module, const char *callable)
+{
+    std::string key(callable);
+    if (module != NULL)
+	key = std::string(module) + "." + key;
+
+    std::map<std::string, bp::object>::iterator it = callables.find(key);
+    if (it != callables.end())
+	return it->second;
+
+    bp::object function;
+    if (module == NULL) {  // default to function in toplevel module
+	function = main_namespace[callable];
+    } else {
+	bp::object submod =  main_namespace[module];
+	bp::object submod_namespace = submod.attr("__dict__");
+	function = submod_namespace[callable];
+    }
+    callables[key] = function;
+    return function;
+}
+
 int PythonPlugin::call(const char *module, const char *callable,
 		       bp::object tupleargs, bp::object kwargs, bp::object &retval)
 {
@@ -126,13 +154,7 @@ int PythonPlugin::call(const char *module, const char *callable,
 	return status;
 
     try {
-	if (module == NULL) {  // default to function in toplevel module
-	    function = main_namespace[callable];
-	} else {
-	    bp::object submod =  main_namespace[module];
-	    bp::object submod_namespace = submod.attr("__dict__");
-	    function = submod_namespace[callable];
-	}
+	function = resolve(module, callable);
 	// this wont work with boost-python1.34 - needs 1.40
 	//retval = function(*tupleargs, **kwargs);
 
@@ -177,13 +199,7 @@ bool PythonPlugin::is_callable(const char *module,
 	return false;
     }
     try {
-	if (module == NULL) {  // default to function in toplevel module
-	   function = main_namespace[funcname];
-	} else {
-	    bp::object submod =  main_namespace[module];
-	    bp::object submod_namespace = submod.attr("__dict__");
-	    function = submod_namespace[funcname];
-	}
+	function = resolve(module, funcname);
 	result = PyCallable_Check(function.ptr());
     }
     catch (bp::error_already_set) {
@@ -208,13 +224,62 @@ bool PythonPlugin::is_callable(const char *module,
     return result;
 }
 
-// this should be moved to an inotify-based solution and be done with it
+// watch the directory rather than the file: editors commonly save by
+// writing a new file and renaming it over the old one
+void PythonPlugin::watch(const char *path)
+{
+    char dir[PATH_MAX], base[PATH_MAX];
+
+    strncpy(dir, path, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+    strncpy(base, path, sizeof(base) - 1);
+    base[sizeof(base) - 1] = '\0';
+    toplevel_name = strstore(basename(base));
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+	logPP(1, "inotify_init1: %s, falling back to stat()", strerror(errno));
+	return;
+    }
+    if (inotify_add_watch(inotify_fd, dirname(dir),
+			  IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+	logPP(1, "inotify_add_watch(%s): %s, falling back to stat()",
+	      dir, strerror(errno));
+	close(inotify_fd);
+	inotify_fd = -1;
+    }
+}
+
 int PythonPlugin::reload()
 {
     struct stat st;
     if (!reload_on_change)
 	return PLUGIN_OK;
 
+    if (inotify_fd >= 0) {
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	bool changed = false;
+	ssize_t n;
+
+	while ((n = read(inotify_fd, buf, sizeof(buf))) > 0) {
+	    for (char *p = buf; p < buf + n; ) {
+		struct inotify_event *ev = (struct inotify_event *) p;
+		if ((ev->mask & IN_Q_OVERFLOW) ||
+		    (ev->len && !strcmp(ev->name, toplevel_name)))
+		    changed = true;
+		p += sizeof(struct inotify_event) + ev->len;
+	    }
+	}
+	if (changed) {
+	    initialize();
+	    logPP(1, "reload():  %s reloaded, status=%d", toplevel, status);
+	} else {
+	    logPP(5, "reload: no-op");
+	    status = PLUGIN_OK;
+	}
+	return status;
+    }
+
     if (stat(abs_path, &st)) {
 	logPP(0, "reload: stat(%s) returned %s", abs_path, strerror(errno));
 	status = PLUGIN_STAT_FAILED;
@@ -255,6 +320,7 @@ std::string handle_pyerror()
 int PythonPlugin::initialize()
 {
     std::string msg;
+    callables.clear();
     if (Py_IsInitialized()) {
 	try {
 	    bp::object module = bp::import("__main__");
@@ -293,6 +359,8 @@ PythonPlugin::PythonPlugin(struct _inittab *inittab) :
     status(0),
     module_mtime(0),
     reload_on_change(0),
+    inotify_fd(-1),
+    toplevel_name(0),
     toplevel(0),
     abs_path(0),
     log_level(0)
@@ -353,6 +421,8 @@ int PythonPlugin::configure(const char *iniFilename,
 	}
 	abs_path = strstore(real_path);
 	module_mtime = st.st_mtime;      // record timestamp
+	if (reload_on_change && inotify_fd < 0)
+	    watch(abs_path);
 
     } else {
         if (getcwd(real_path, PATH_MAX) == NULL) {
@@ -23,6 +23,7 @@
 
 #include <vector>
 #include <string>
+#include <map>
 #include <sys/types.h>
 
 
@@ -78,10 +79,17 @@ private:
     ~PythonPlugin() {};
 
     int reload();
+    void watch(const char *path);
+    boost::python::object resolve(const char *module, const char *callable);
     std::vector<std::string> inittab_entries;
+    // [module.]callable -> function object, dropped whenever the namespace
+    // may have been rebound (initialize(), run_string())
+    std::map<std::string, boost::python::object> callables;
     int status;
     time_t module_mtime;                  // toplevel module - last modification time
     bool reload_on_change;                // auto-reload if toplevel module was changed
+    int inotify_fd;                       // watches the toplevel module directory, or -1
+    const char *toplevel_name;            // basename of abs_path
     const char *toplevel;          // toplevel script
     //    const char *plugin_dir;               // directory prefix
     const char *abs_path;                 // normalized path to toplevel module
@@ -18,6 +18,9 @@
 
 #include <Python.h>
 #include <structmember.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <vector>
 
 #include "rs274ngc.hh"
 #include "rs274ngc_interp.hh"
@@ -566,7 +569,25 @@ int GET_EXTERNAL_FLOOD() { return 0; }
 int GET_EXTERNAL_MIST() { return 0; }
 CANON_PLANE GET_EXTERNAL_PLANE() { return 1; }
 double GET_EXTERNAL_SPEED() { return 0; }
-int GET_EXTERNAL_POCKETS_MAX() { return CANON_POCKETS_MAX; }
+// A callback that knows its tool table says how many pockets are in use,
+// so load_tool_table() does not call get_tool for every possible pocket.
+int GET_EXTERNAL_POCKETS_MAX() {
+    if(interp_error) return CANON_POCKETS_MAX;
+    if(!PyObject_HasAttrString(callback, "get_pockets_max"))
+        return CANON_POCKETS_MAX;
+    PyObject *result =
+        callmethod(callback, "get_pockets_max", "");
+    if(!result || !PyInt_Check(result)) {
+        Py_XDECREF(result);
+        interp_error ++;
+        return CANON_POCKETS_MAX;
+    }
+    int pockets = PyInt_AsLong(result);
+    Py_DECREF(result);
+    if(pockets < 1) return 1;
+    if(pockets > CANON_POCKETS_MAX) return CANON_POCKETS_MAX;
+    return pockets;
+}
 void DISABLE_ADAPTIVE_FEED() {} 
 void ENABLE_ADAPTIVE_FEED() {} 
 
@@ -768,11 +789,85 @@ static PyObject *rs274_strerror(PyObject *s, PyObject *o) {
     return PyString_FromString(savedError);
 }
 
+// Preview work that is independent per move (arc tessellation, extents)
+// is split over a few threads with the GIL released.  Small jobs stay on
+// the calling thread, where starting threads would cost more than it saves.
+#define PREVIEW_MAX_THREADS 8
+
+typedef void (*preview_work_fn)(void *data, int part, size_t begin, size_t end);
+
+struct preview_job {
+    preview_work_fn fn;
+    void *data;
+    int part;
+    size_t begin, end;
+};
+
+static void *preview_worker(void *arg) {
+    preview_job *job = (preview_job *)arg;
+    job->fn(job->data, job->part, job->begin, job->end);
+    return NULL;
+}
+
+// returns the number of parts [0, n) was split into
+static int preview_parts(size_t n, size_t min_per_part) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if(ncpu < 1) ncpu = 1;
+    if(ncpu > PREVIEW_MAX_THREADS) ncpu = PREVIEW_MAX_THREADS;
+    size_t parts = n / min_per_part;
+    if(parts < 1) parts = 1;
+    if(parts > (size_t)ncpu) parts = ncpu;
+    return parts;
+}
+
+// Must be called with the GIL released; fn may not touch Python objects.
+static void preview_parallel(preview_work_fn fn, void *data, size_t n, int parts) {
+    preview_job jobs[PREVIEW_MAX_THREADS];
+    pthread_t threads[PREVIEW_MAX_THREADS];
+    bool started[PREVIEW_MAX_THREADS];
+
+    for(int i=0; i<parts; i++) {
+        jobs[i].fn = fn;
+        jobs[i].data = data;
+        jobs[i].part = i;
+        jobs[i].begin = n * i / parts;
+        jobs[i].end = n * (i+1) / parts;
+        started[i] = i > 0 &&
+            pthread_create(&threads[i], NULL, preview_worker, &jobs[i]) == 0;
+    }
+    for(int i=0; i<parts; i++)
+        if(!started[i]) preview_worker(&jobs[i]);
+    for(int i=1; i<parts; i++)
+        if(started[i]) pthread_join(threads[i], NULL);
+}
+
+// one row per point: x, y, z, then the tool offset
+struct extents_work {
+    const double *pts;
+    double lo[PREVIEW_MAX_THREADS][6], hi[PREVIEW_MAX_THREADS][6];
+};
+
+static void extents_part(void *data, int part, size_t begin, size_t end) {
+    extents_work *w = (extents_work *)data;
+    double lo[6] = {9e99, 9e99, 9e99, 9e99, 9e99, 9e99},
+           hi[6] = {-9e99, -9e99, -9e99, -9e99, -9e99, -9e99};
+    for(size_t i=begin; i<end; i++) {
+        const double *p = w->pts + 6*i;
+        for(int k=0; k<3; k++) {
+            lo[k] = std::min(lo[k], p[k]);
+            hi[k] = std::max(hi[k], p[k]);
+            lo[k+3] = std::min(lo[k+3], p[k]+p[k+3]);
+            hi[k+3] = std::max(hi[k+3], p[k]+p[k+3]);
+        }
+    }
+    for(int k=0; k<6; k++) {
+        w->lo[part][k] = lo[k];
+        w->hi[part][k] = hi[k];
+    }
+}
+
 static PyObject *rs274_calc_extents(PyObject *self, PyObject *args) {
-    double min_x = 9e99, min_y = 9e99, min_z = 9e99,
-           min_xt = 9e99, min_yt = 9e99, min_zt = 9e99,
-           max_x = -9e99, max_y = -9e99, max_z = -9e99,
-           max_xt = -9e99, max_yt = -9e99, max_zt = -9e99;
+    std::vector<double> pts;
     for(int i=0; i<PySequence_Length(args); i++) {
         PyObject *si = PyTuple_GetItem(args, i);
         if(!si) return NULL;
@@ -798,37 +893,36 @@ static PyObject *rs274_calc_extents(PyObject *self, PyObject *args) {
                     &unused, &xt, &yt, &zt);
             Py_DECREF(sj);
             if(!r) return NULL;
-            max_x = std::max(max_x, xs);
-            max_y = std::max(max_y, ys);
-            max_z = std::max(max_z, zs);
-            min_x = std::min(min_x, xs);
-            min_y = std::min(min_y, ys);
-            min_z = std::min(min_z, zs);
-            max_xt = std::max(max_xt, xs+xt);
-            max_yt = std::max(max_yt, ys+yt);
-            max_zt = std::max(max_zt, zs+zt);
-            min_xt = std::min(min_xt, xs+xt);
-            min_yt = std::min(min_yt, ys+yt);
-            min_zt = std::min(min_zt, zs+zt);
+            double row[6] = {xs, ys, zs, xt, yt, zt};
+            pts.insert(pts.end(), row, row+6);
         }
         if(j > 0) {
-            max_x = std::max(max_x, xe);
-            max_y = std::max(max_y, ye);
-            max_z = std::max(max_z, ze);
-            min_x = std::min(min_x, xe);
-            min_y = std::min(min_y, ye);
-            min_z = std::min(min_z, ze);
-            max_xt = std::max(max_xt, xe+xt);
-            max_yt = std::max(max_yt, ye+yt);
-            max_zt = std::max(max_zt, ze+zt);
-            min_xt = std::min(min_xt, xe+xt);
-            min_yt = std::min(min_yt, ye+yt);
-            min_zt = std::min(min_zt, ze+zt);
+            double row[6] = {xe, ye, ze, xt, yt, zt};
+            pts.insert(pts.end(), row, row+6);
+        }
+    }
+
+    extents_work w;
+    size_t n = pts.size() / 6;
+    int parts = preview_parts(n, 65536);
+    w.pts = n ? &pts[0] : NULL;
+    if(n) {
+        Py_BEGIN_ALLOW_THREADS
+        preview_parallel(extents_part, &w, n, parts);
+        Py_END_ALLOW_THREADS
+    } else {
+        extents_part(&w, 0, 0, 0);
+    }
+    for(int i=1; i<parts; i++) {
+        for(int k=0; k<6; k++) {
+            w.lo[0][k] = std::min(w.lo[0][k], w.lo[i][k]);
+            w.hi[0][k] = std::max(w.hi[0][k], w.hi[i][k]);
         }
     }
+    double *lo = w.lo[0], *hi = w.hi[0];
     return Py_BuildValue("[ddd][ddd][ddd][ddd]",
-        min_x, min_y, min_z,  max_x, max_y, max_z,
-        min_xt, min_yt, min_zt,  max_xt, max_yt, max_zt);
+        lo[0], lo[1], lo[2],  hi[0], hi[1], hi[2],
+        lo[3], lo[4], lo[5],  hi[3], hi[4], hi[5]);
 }
 
 #if PY_VERSION_HEX < 0x02050000
@@ -883,41 +977,22 @@ static void rotate(double &x, double &y, double c, double s) {
     x = tx;
 }
 
-static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
-    PyObject *canon;
-    double x1, y1, cx, cy, z1, a, b, c, u, v, w;
-    double o[9], n[9], g5xoffset[9], g92offset[9];
-    int rot, plane;
-    int X, Y, Z;
-    double rotation_cos, rotation_sin;
-    int max_segments = 128;
+// An arc, reduced to what is needed to produce its segments.  Setting it
+// up needs the canon state; tessellating it does not.
+struct preview_arc {
+    double o[9], d[9], n[9], g5xoffset[9], g92offset[9];
+    double cx, cy, tx, ty, dc, ds, rotation_cos, rotation_sin;
+    int X, Y, Z, steps;
+    size_t first;       // index of the first segment end in the output
+};
 
-    if(!PyArg_ParseTuple(args, "Oddddiddddddd|i:arcs_to_segments",
-        &canon, &x1, &y1, &cx, &cy, &rot, &z1, &a, &b, &c, &u, &v, &w, &max_segments)) return NULL;
-    if(!get_attr(canon, "lo", "ddddddddd:arcs_to_segments lo", &o[0], &o[1], &o[2],
-                    &o[3], &o[4], &o[5], &o[6], &o[7], &o[8]))
-        return NULL;
-    if(!get_attr(canon, "plane", &plane)) return NULL;
-    if(!get_attr(canon, "rotation_cos", &rotation_cos)) return NULL;
-    if(!get_attr(canon, "rotation_sin", &rotation_sin)) return NULL;
-    if(!get_attr(canon, "g5x_offset_x", &g5xoffset[0])) return NULL;
-    if(!get_attr(canon, "g5x_offset_y", &g5xoffset[1])) return NULL;
-    if(!get_attr(canon, "g5x_offset_z", &g5xoffset[2])) return NULL;
-    if(!get_attr(canon, "g5x_offset_a", &g5xoffset[3])) return NULL;
-    if(!get_attr(canon, "g5x_offset_b", &g5xoffset[4])) return NULL;
-    if(!get_attr(canon, "g5x_offset_c", &g5xoffset[5])) return NULL;
-    if(!get_attr(canon, "g5x_offset_u", &g5xoffset[6])) return NULL;
-    if(!get_attr(canon, "g5x_offset_v", &g5xoffset[7])) return NULL;
-    if(!get_attr(canon, "g5x_offset_w", &g5xoffset[8])) return NULL;
-    if(!get_attr(canon, "g92_offset_x", &g92offset[0])) return NULL;
-    if(!get_attr(canon, "g92_offset_y", &g92offset[1])) return NULL;
-    if(!get_attr(canon, "g92_offset_z", &g92offset[2])) return NULL;
-    if(!get_attr(canon, "g92_offset_a", &g92offset[3])) return NULL;
-    if(!get_attr(canon, "g92_offset_b", &g92offset[4])) return NULL;
-    if(!get_attr(canon, "g92_offset_c", &g92offset[5])) return NULL;
-    if(!get_attr(canon, "g92_offset_u", &g92offset[6])) return NULL;
-    if(!get_attr(canon, "g92_offset_v", &g92offset[7])) return NULL;
-    if(!get_attr(canon, "g92_offset_w", &g92offset[8])) return NULL;
+static void arc_setup(preview_arc &arc, const double *lo,
+        double x1, double y1, double cx, double cy, int rot, double z1,
+        double a, double b, double c, double u, double v, double w,
+        int plane, double rotation_cos, double rotation_sin,
+        const double *g5xoffset, const double *g92offset, int max_segments) {
+    double *o = arc.o, *n = arc.n, *d = arc.d;
+    int X, Y, Z;
 
     if(plane == 1) {
         X=0; Y=1; Z=2;
@@ -935,6 +1010,11 @@ static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     n[6] = u;
     n[7] = v;
     n[8] = w;
+    for(int ax=0; ax<9; ax++) {
+        o[ax] = lo[ax];
+        arc.g5xoffset[ax] = g5xoffset[ax];
+        arc.g92offset[ax] = g92offset[ax];
+    }
     for(int ax=0; ax<9; ax++) o[ax] -= g5xoffset[ax];
     unrotate(o[0], o[1], rotation_cos, rotation_sin);
     for(int ax=0; ax<9; ax++) o[ax] -= g92offset[ax];
@@ -952,21 +1032,35 @@ static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     if(rot < -1) theta2 += 2*M_PI*(rot+1);
     if(rot > 1) theta2 += 2*M_PI*(rot-1);
 
-    int steps = std::max(3, int(max_segments * fabs(theta1 - theta2) / M_PI));
-    double rsteps = 1. / steps;
-    PyObject *segs = PyList_New(steps);
+    arc.steps = std::max(3, int(max_segments * fabs(theta1 - theta2) / M_PI));
+    double rsteps = 1. / arc.steps;
 
     double dtheta = theta2 - theta1;
-    double d[9] = {0, 0, 0, n[3]-o[3], n[4]-o[4], n[5]-o[5], n[6]-o[6], n[7]-o[7], n[8]-o[8]};
+    d[0] = d[1] = d[2] = 0;
+    for(int ax=3; ax<9; ax++) d[ax] = n[ax] - o[ax];
     d[Z] = n[Z] - o[Z];
 
-    double tx = o[X] - cx, ty = o[Y] - cy, dc = cos(dtheta*rsteps), ds = sin(dtheta*rsteps);
+    arc.X = X; arc.Y = Y; arc.Z = Z;
+    arc.cx = cx; arc.cy = cy;
+    arc.tx = o[X] - cx; arc.ty = o[Y] - cy;
+    arc.dc = cos(dtheta*rsteps); arc.ds = sin(dtheta*rsteps);
+    arc.rotation_cos = rotation_cos; arc.rotation_sin = rotation_sin;
+    arc.first = 0;
+}
+
+// writes arc.steps segment ends, 9 coordinates each
+static void arc_tessellate(const preview_arc &arc, double *out) {
+    const double *o = arc.o, *d = arc.d;
+    int X = arc.X, Y = arc.Y, Z = arc.Z, steps = arc.steps;
+    double rsteps = 1. / steps;
+    double tx = arc.tx, ty = arc.ty;
+
     for(int i=0; i<steps-1; i++) {
         double f = (i+1) * rsteps;
-        double p[9];
-        rotate(tx, ty, dc, ds);
-        p[X] = tx + cx;
-        p[Y] = ty + cy;
+        double *p = out + 9*i;
+        rotate(tx, ty, arc.dc, arc.ds);
+        p[X] = tx + arc.cx;
+        p[Y] = ty + arc.cy;
         p[Z] = o[Z] + d[Z] * f;
         p[3] = o[3] + d[3] * f;
         p[4] = o[4] + d[4] * f;
@@ -974,20 +1068,167 @@ static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
         p[6] = o[6] + d[6] * f;
         p[7] = o[7] + d[7] * f;
         p[8] = o[8] + d[8] * f;
-        for(int ax=0; ax<9; ax++) p[ax] += g92offset[ax];
-        rotate(p[0], p[1], rotation_cos, rotation_sin);
-        for(int ax=0; ax<9; ax++) p[ax] += g5xoffset[ax];
-        PyList_SET_ITEM(segs, i,
-            Py_BuildValue("ddddddddd", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]));
+        for(int ax=0; ax<9; ax++) p[ax] += arc.g92offset[ax];
+        rotate(p[0], p[1], arc.rotation_cos, arc.rotation_sin);
+        for(int ax=0; ax<9; ax++) p[ax] += arc.g5xoffset[ax];
     }
-    for(int ax=0; ax<9; ax++) n[ax] += g92offset[ax];
-    rotate(n[0], n[1], rotation_cos, rotation_sin);
-    for(int ax=0; ax<9; ax++) n[ax] += g5xoffset[ax];
-    PyList_SET_ITEM(segs, steps-1,
-        Py_BuildValue("ddddddddd", n[0], n[1], n[2], n[3], n[4], n[5], n[6], n[7], n[8]));
+    double *p = out + 9*(steps-1);
+    for(int ax=0; ax<9; ax++) p[ax] = arc.n[ax] + arc.g92offset[ax];
+    rotate(p[0], p[1], arc.rotation_cos, arc.rotation_sin);
+    for(int ax=0; ax<9; ax++) p[ax] += arc.g5xoffset[ax];
+}
+
+static PyObject *segment_end(const double *p) {
+    return Py_BuildValue("ddddddddd", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], p[8]);
+}
+
+static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
+    PyObject *canon;
+    double x1, y1, cx, cy, z1, a, b, c, u, v, w;
+    double o[9], g5xoffset[9], g92offset[9];
+    int rot, plane;
+    double rotation_cos, rotation_sin;
+    int max_segments = 128;
+
+    if(!PyArg_ParseTuple(args, "Oddddiddddddd|i:arcs_to_segments",
+        &canon, &x1, &y1, &cx, &cy, &rot, &z1, &a, &b, &c, &u, &v, &w, &max_segments)) return NULL;
+    if(!get_attr(canon, "lo", "ddddddddd:arcs_to_segments lo", &o[0], &o[1], &o[2],
+                    &o[3], &o[4], &o[5], &o[6], &o[7], &o[8]))
+        return NULL;
+    if(!get_attr(canon, "plane", &plane)) return NULL;
+    if(!get_attr(canon, "rotation_cos", &rotation_cos)) return NULL;
+    if(!get_attr(canon, "rotation_sin", &rotation_sin)) return NULL;
+    if(!get_attr(canon, "g5x_offset_x", &g5xoffset[0])) return NULL;
+    if(!get_attr(canon, "g5x_offset_y", &g5xoffset[1])) return NULL;
+    if(!get_attr(canon, "g5x_offset_z", &g5xoffset[2])) return NULL;
+    if(!get_attr(canon, "g5x_offset_a", &g5xoffset[3])) return NULL;
+    if(!get_attr(canon, "g5x_offset_b", &g5xoffset[4])) return NULL;
+    if(!get_attr(canon, "g5x_offset_c", &g5xoffset[5])) return NULL;
+    if(!get_attr(canon, "g5x_offset_u", &g5xoffset[6])) return NULL;
+    if(!get_attr(canon, "g5x_offset_v", &g5xoffset[7])) return NULL;
+    if(!get_attr(canon, "g5x_offset_w", &g5xoffset[8])) return NULL;
+    if(!get_attr(canon, "g92_offset_x", &g92offset[0])) return NULL;
+    if(!get_attr(canon, "g92_offset_y", &g92offset[1])) return NULL;
+    if(!get_attr(canon, "g92_offset_z", &g92offset[2])) return NULL;
+    if(!get_attr(canon, "g92_offset_a", &g92offset[3])) return NULL;
+    if(!get_attr(canon, "g92_offset_b", &g92offset[4])) return NULL;
+    if(!get_attr(canon, "g92_offset_c", &g92offset[5])) return NULL;
+    if(!get_attr(canon, "g92_offset_u", &g92offset[6])) return NULL;
+    if(!get_attr(canon, "g92_offset_v", &g92offset[7])) return NULL;
+    if(!get_attr(canon, "g92_offset_w", &g92offset[8])) return NULL;
+
+    preview_arc arc;
+    arc_setup(arc, o, x1, y1, cx, cy, rot, z1, a, b, c, u, v, w,
+            plane, rotation_cos, rotation_sin, g5xoffset, g92offset, max_segments);
+    std::vector<double> ends(9 * arc.steps);
+    arc_tessellate(arc, &ends[0]);
+
+    PyObject *segs = PyList_New(arc.steps);
+    for(int i=0; i<arc.steps; i++)
+        PyList_SET_ITEM(segs, i, segment_end(&ends[9*i]));
     return segs;
 }
 
+struct arcs_work {
+    std::vector<preview_arc> *arcs;
+    double *ends;
+};
+
+static void arcs_part(void *data, int part, size_t begin, size_t end) {
+    arcs_work *w = (arcs_work *)data;
+    for(size_t i=begin; i<end; i++) {
+        const preview_arc &arc = (*w->arcs)[i];
+        arc_tessellate(arc, w->ends + 9*arc.first);
+    }
+}
+
+// Tessellate a whole program's worth of arcs at once.  Each item is
+//   (lineno, lo, feedrate, tlo, (x1, y1, cx, cy, rot, z1, a, b, c, u, v, w),
+//    (plane, rotation_cos, rotation_sin, g5x_offset[9], g92_offset[9]))
+// and the result is the list of arcfeed items, in order.
+static PyObject *rs274_arcs_to_segments(PyObject *self, PyObject *args) {
+    PyObject *items;
+    int max_segments = 128;
+
+    if(!PyArg_ParseTuple(args, "O|i:arcs_to_segments", &items, &max_segments))
+        return NULL;
+    PyObject *fast = PySequence_Fast(items, "arcs_to_segments: expected a sequence");
+    if(!fast) return NULL;
+
+    Py_ssize_t narcs = PySequence_Fast_GET_SIZE(fast);
+    std::vector<preview_arc> arcs(narcs);
+    size_t nends = 0;
+    for(Py_ssize_t i=0; i<narcs; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+        PyObject *lineno, *lo, *feedrate, *tlo;
+        double o[9], g5xoffset[9], g92offset[9];
+        double x1, y1, cx, cy, z1, a, b, c, u, v, w, rotation_cos, rotation_sin;
+        int rot, plane;
+        if(!PyArg_ParseTuple(item,
+                "OOOO(ddddiddddddd)(idd(ddddddddd)(ddddddddd)):arcs_to_segments item",
+                &lineno, &lo, &feedrate, &tlo,
+                &x1, &y1, &cx, &cy, &rot, &z1, &a, &b, &c, &u, &v, &w,
+                &plane, &rotation_cos, &rotation_sin,
+                &g5xoffset[0], &g5xoffset[1], &g5xoffset[2],
+                &g5xoffset[3], &g5xoffset[4], &g5xoffset[5],
+                &g5xoffset[6], &g5xoffset[7], &g5xoffset[8],
+                &g92offset[0], &g92offset[1], &g92offset[2],
+                &g92offset[3], &g92offset[4], &g92offset[5],
+                &g92offset[6], &g92offset[7], &g92offset[8])
+            || !PyArg_ParseTuple(lo, "ddddddddd:arcs_to_segments lo",
+                &o[0], &o[1], &o[2], &o[3], &o[4], &o[5], &o[6], &o[7], &o[8])) {
+            Py_DECREF(fast);
+            return NULL;
+        }
+        arc_setup(arcs[i], o, x1, y1, cx, cy, rot, z1, a, b, c, u, v, w,
+                plane, rotation_cos, rotation_sin, g5xoffset, g92offset, max_segments);
+        arcs[i].first = nends;
+        nends += arcs[i].steps;
+    }
+
+    std::vector<double> ends(9 * nends);
+    if(narcs) {
+        arcs_work w = { &arcs, &ends[0] };
+        int parts = preview_parts(narcs, 256);
+        Py_BEGIN_ALLOW_THREADS
+        preview_parallel(arcs_part, &w, narcs, parts);
+        Py_END_ALLOW_THREADS
+    }
+
+    PyObject *result = PyList_New(nends);
+    if(!result) { Py_DECREF(fast); return NULL; }
+    for(Py_ssize_t i=0; i<narcs; i++) {
+        PyObject *item = PySequence_Fast_GET_ITEM(fast, i);
+        PyObject *lineno = PyTuple_GET_ITEM(item, 0);
+        PyObject *lo = PyTuple_GET_ITEM(item, 1);
+        PyObject *feedrate = PyTuple_GET_ITEM(item, 2);
+        PyObject *tlo = PyTuple_GET_ITEM(item, 3);
+        const preview_arc &arc = arcs[i];
+        Py_INCREF(lo);
+        for(int j=0; j<arc.steps; j++) {
+            PyObject *l = segment_end(&ends[9*(arc.first + j)]);
+            PyObject *seg = l ? PyTuple_New(5) : NULL;
+            if(!seg) {
+                Py_XDECREF(l);
+                Py_DECREF(lo);
+                Py_DECREF(result);
+                Py_DECREF(fast);
+                return NULL;
+            }
+            Py_INCREF(lineno); PyTuple_SET_ITEM(seg, 0, lineno);
+            PyTuple_SET_ITEM(seg, 1, lo);       // steals the reference
+            Py_INCREF(l); PyTuple_SET_ITEM(seg, 2, l);
+            Py_INCREF(feedrate); PyTuple_SET_ITEM(seg, 3, feedrate);
+            Py_INCREF(tlo); PyTuple_SET_ITEM(seg, 4, tlo);
+            PyList_SET_ITEM(result, arc.first + j, seg);
+            lo = l;
+        }
+        Py_DECREF(lo);
+    }
+    Py_DECREF(fast);
+    return result;
+}
+
 static PyMethodDef gcode_methods[] = {
     {"parse", (PyCFunction)parse_file, METH_VARARGS, "Parse a G-Code file"},
     {"strerror", (PyCFunction)rs274_strerror, METH_VARARGS,
@@ -996,6 +1237,8 @@ static PyMethodDef gcode_methods[] = {
         "Calculate information about extents of gcode"},
     {"arc_to_segments", (PyCFunction)rs274_arc_to_segments, METH_VARARGS,
         "Convert an arc to straight segments"},
+    {"arcs_to_segments", (PyCFunction)rs274_arcs_to_segments, METH_VARARGS,
+        "Convert a list of deferred arcs to arcfeed items"},
     {NULL}
 };
 
@@ -16,6 +16,7 @@
  *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 #include <stdlib.h>
+#include <string>
 #include <boost/noncopyable.hpp>
 
 /* Size of certain arrays */
@@ -42,6 +43,11 @@ public:
     virtual int open(const char *filename) = 0;
     virtual int read() = 0;
     virtual int read(const char *line) = 0;
+    virtual int restore_checkpoint(int line) = 0;
+    virtual int save_state(std::string &state) = 0;
+    virtual int restore_state(const char *state, size_t length) = 0;
+    virtual int runtime_reads() = 0;
+    virtual unsigned long long parameter_digest() = 0;
     virtual int close() = 0;
     virtual int reset() = 0;
     virtual int line() = 0;
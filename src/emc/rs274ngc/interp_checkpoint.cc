@@ -0,0 +1,547 @@
+/********************************************************************
+* Description: interp_checkpoint.cc
+*
+* Run-from-line checkpoints: while a program runs, the interpreter
+* keeps copies of its state at toplevel block boundaries so that a run
+* starting at line N only reads the blocks after the last checkpoint
+* before N, not the whole program.  The same state, saved when a run
+* ends, stands in for the run when its canon output is replayed.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "interp_internal.hh"
+#include "rs274ngc_interp.hh"
+
+// setup fields copied verbatim in both directions
+#define CHECKPOINT_FIELDS(X) \
+    X(AA_axis_offset) X(AA_origin_offset) \
+    X(BB_axis_offset) X(BB_origin_offset) \
+    X(CC_axis_offset) X(CC_origin_offset) \
+    X(u_axis_offset) X(u_origin_offset) \
+    X(v_axis_offset) X(v_origin_offset) \
+    X(w_axis_offset) X(w_origin_offset) \
+    X(axis_offset_x) X(axis_offset_y) X(axis_offset_z) \
+    X(origin_offset_x) X(origin_offset_y) X(origin_offset_z) \
+    X(origin_index) X(rotation_xy) \
+    X(control_mode) X(control_tolerance) X(naivecam_tolerance) \
+    X(cycle_cc) X(cycle_i) X(cycle_j) X(cycle_k) X(cycle_l) \
+    X(cycle_p) X(cycle_q) X(cycle_r) X(cycle_il) X(cycle_il_flag) \
+    X(distance_mode) X(ijk_distance_mode) \
+    X(feed_mode) X(feed_override) X(feed_rate) \
+    X(length_units) X(motion_mode) X(plane) X(retract_mode) \
+    X(speed) X(spindle_mode) X(css_maximum) X(speed_override) \
+    X(spindle_turning) X(adaptive_feed) X(feed_hold) \
+    X(lathe_diameter_mode) \
+    X(executed_if) X(return_value) X(value_returned)
+
+// setup fields a saved state has on top of a checkpoint
+#define POSITION_FIELDS(X) \
+    X(current_x) X(current_y) X(current_z) \
+    X(AA_current) X(BB_current) X(CC_current) \
+    X(u_current) X(v_current) X(w_current)
+
+// layout of save_state(); a state of another layout is refused
+#define STATE_VERSION 1
+
+// Parameters that follow the tool in the spindle, the tool changer and
+// the position, which come from the machine and not from the checkpoint.
+static bool machine_parameter(int index)
+{
+    return (index >= 5400 && index <= 5413) ||
+	(index >= 5420 && index <= 5428) ||
+	(index >= 5600 && index <= 5601);
+}
+
+// True if the parameters and toplevel named parameters are those the
+// run that took the checkpoints started from.  Any of them may be read
+// before the program sets it, G92 and G5x offsets touched off since,
+// numbered parameters and globals left over by the last run alike.
+static bool same_start(setup_pointer settings)
+{
+    const std::vector<double> &params = settings->checkpoint_start_parameters;
+    int index;
+
+    if (params.size() != RS274NGC_MAX_PARAMETERS) {
+	return false;
+    }
+    for (index = 0; index < RS274NGC_MAX_PARAMETERS; index++) {
+	if (!machine_parameter(index) &&
+	    params[index] != settings->parameters[index]) {
+	    return false;
+	}
+    }
+
+    // read-only named parameters come from the machine as well
+    const parameter_map &now = settings->sub_context[0].named_params;
+    const parameter_map &then = settings->checkpoint_start_named_params;
+    parameter_map::const_iterator a = now.begin(), b = then.begin();
+    for (;;) {
+	while (a != now.end() && (a->second.attr & PA_READONLY)) {
+	    ++a;
+	}
+	while (b != then.end() && (b->second.attr & PA_READONLY)) {
+	    ++b;
+	}
+	if (a == now.end() || b == then.end()) {
+	    return a == now.end() && b == then.end();
+	}
+	if (strcasecmp(a->first, b->first) != 0 ||
+	    a->second.value != b->second.value ||
+	    a->second.attr != b->second.attr) {
+	    return false;
+	}
+	++a;
+	++b;
+    }
+}
+
+// Copies the state a checkpoint keeps; the caller sets where it is.
+static void fill_checkpoint(setup_pointer settings, checkpoint &cp)
+{
+    cp.parameters.assign(settings->parameters,
+			 settings->parameters + RS274NGC_MAX_PARAMETERS);
+    cp.named_params = settings->sub_context[0].named_params;
+    cp.context_status = settings->sub_context[0].context_status;
+    memcpy(cp.saved_g_codes, settings->sub_context[0].saved_g_codes,
+	   sizeof(cp.saved_g_codes));
+    memcpy(cp.saved_m_codes, settings->sub_context[0].saved_m_codes,
+	   sizeof(cp.saved_m_codes));
+    memcpy(cp.saved_settings, settings->sub_context[0].saved_settings,
+	   sizeof(cp.saved_settings));
+    cp.offset_map = settings->offset_map;
+#define SAVE_FIELD(f) cp.f = settings->f;
+    CHECKPOINT_FIELDS(SAVE_FIELD)
+#undef SAVE_FIELD
+}
+
+// Checkpoints survive closing and reopening a program, but belong to
+// one version of one file.
+void Interp::checkpoint_open(setup_pointer settings)
+{
+    struct stat st;
+
+    if (fstat(fileno(settings->file_pointer), &st) != 0) {
+	memset(&st, 0, sizeof(st));
+    }
+    if (st.st_dev != settings->checkpoint_dev ||
+	st.st_ino != settings->checkpoint_ino ||
+	st.st_size != settings->checkpoint_size ||
+	st.st_mtim.tv_sec != settings->checkpoint_mtime.tv_sec ||
+	st.st_mtim.tv_nsec != settings->checkpoint_mtime.tv_nsec ||
+	st.st_ino == 0) {
+	settings->checkpoints.clear();
+	settings->checkpoint_step = settings->checkpoint_interval;
+	settings->checkpoint_dev = st.st_dev;
+	settings->checkpoint_ino = st.st_ino;
+	settings->checkpoint_size = st.st_size;
+	settings->checkpoint_mtime = st.st_mtim;
+    }
+    settings->checkpoint_next = settings->checkpoint_step;
+    settings->checkpoint_truncate = true;
+    settings->checkpoint_started = false;
+}
+
+// Called before reading the next line of the file.  Only toplevel block
+// boundaries outside o-word definitions, skipped branches and cutter
+// compensation are restartable.  Lines read again by a toplevel loop
+// do not get a second checkpoint.
+int Interp::take_checkpoint(setup_pointer settings)
+{
+    std::vector<checkpoint> &cps = settings->checkpoints;
+    size_t i, n;
+
+    if (settings->checkpoint_interval <= 0) {
+	return INTERP_OK;
+    }
+
+    // the first read of a run: checkpoints taken from another starting
+    // state are of no use to this run or the next
+    if (!settings->checkpoint_started) {
+	if (!same_start(settings)) {
+	    cps.clear();
+	    settings->checkpoint_step = settings->checkpoint_interval;
+	    settings->checkpoint_next = settings->checkpoint_step;
+	}
+	settings->checkpoint_start_parameters.assign(settings->parameters,
+	    settings->parameters + RS274NGC_MAX_PARAMETERS);
+	settings->checkpoint_start_named_params =
+	    settings->sub_context[0].named_params;
+	settings->checkpoint_started = true;
+    }
+
+    if (settings->sequence_number < settings->checkpoint_next ||
+	settings->call_level != 0 ||
+	settings->remap_level != 0 ||
+	settings->defining_sub ||
+	settings->skipping_o ||
+	settings->skipping_to_sub ||
+	settings->cutter_comp_side) {
+	return INTERP_OK;
+    }
+
+    // the first checkpoint of a run replaces what an earlier run left
+    // from here on
+    if (settings->checkpoint_truncate) {
+	while (!cps.empty() &&
+	       cps.back().sequence_number >= settings->sequence_number) {
+	    cps.pop_back();
+	}
+	settings->checkpoint_truncate = false;
+    }
+
+    cps.push_back(checkpoint());
+    checkpoint &cp = cps.back();
+    cp.sequence_number = settings->sequence_number;
+    cp.position = ftell(settings->file_pointer);
+    fill_checkpoint(settings, cp);
+
+    // keep every other one, always including the newest
+    if (cps.size() >= CHECKPOINT_MAX) {
+	n = 0;
+	for (i = (cps.size() + 1) % 2; i < cps.size(); i += 2) {
+	    if (n != i) {
+		cps[n] = cps[i];
+	    }
+	    n++;
+	}
+	cps.resize(n);
+	settings->checkpoint_step *= 2;
+    }
+    settings->checkpoint_next = settings->sequence_number + settings->checkpoint_step;
+    logDebug("take_checkpoint: line %d, %zu checkpoints, next at %d",
+	     settings->sequence_number, cps.size(), settings->checkpoint_next);
+    return INTERP_OK;
+}
+
+// Puts back the state a checkpoint keeps, except for the parameters
+// that come from the machine, and brings the canonical machining
+// functions in line with the modal state.
+void Interp::load_checkpoint(setup_pointer settings, const checkpoint &cp)
+{
+    int index;
+
+    for (index = 0; index < RS274NGC_MAX_PARAMETERS; index++) {
+	if (!machine_parameter(index)) {
+	    settings->parameters[index] = cp.parameters[index];
+	}
+    }
+    settings->sub_context[0].named_params = cp.named_params;
+    settings->sub_context[0].context_status = cp.context_status;
+    memcpy(settings->sub_context[0].saved_g_codes, cp.saved_g_codes,
+	   sizeof(cp.saved_g_codes));
+    memcpy(settings->sub_context[0].saved_m_codes, cp.saved_m_codes,
+	   sizeof(cp.saved_m_codes));
+    memcpy(settings->sub_context[0].saved_settings, cp.saved_settings,
+	   sizeof(cp.saved_settings));
+    settings->offset_map = cp.offset_map;
+#define LOAD_FIELD(f) settings->f = cp.f;
+    CHECKPOINT_FIELDS(LOAD_FIELD)
+#undef LOAD_FIELD
+
+    USE_LENGTH_UNITS(settings->length_units);
+    // the tool offset stays, but in the restored units
+    settings->tool_offset.tran.x = GET_EXTERNAL_TOOL_LENGTH_XOFFSET();
+    settings->tool_offset.tran.y = GET_EXTERNAL_TOOL_LENGTH_YOFFSET();
+    settings->tool_offset.tran.z = GET_EXTERNAL_TOOL_LENGTH_ZOFFSET();
+    settings->tool_offset.a = GET_EXTERNAL_TOOL_LENGTH_AOFFSET();
+    settings->tool_offset.b = GET_EXTERNAL_TOOL_LENGTH_BOFFSET();
+    settings->tool_offset.c = GET_EXTERNAL_TOOL_LENGTH_COFFSET();
+    settings->tool_offset.u = GET_EXTERNAL_TOOL_LENGTH_UOFFSET();
+    settings->tool_offset.v = GET_EXTERNAL_TOOL_LENGTH_VOFFSET();
+    settings->tool_offset.w = GET_EXTERNAL_TOOL_LENGTH_WOFFSET();
+    SET_G5X_OFFSET(settings->origin_index,
+		   settings->origin_offset_x,
+		   settings->origin_offset_y,
+		   settings->origin_offset_z,
+		   settings->AA_origin_offset,
+		   settings->BB_origin_offset,
+		   settings->CC_origin_offset,
+		   settings->u_origin_offset,
+		   settings->v_origin_offset,
+		   settings->w_origin_offset);
+    SET_G92_OFFSET(settings->axis_offset_x,
+		   settings->axis_offset_y,
+		   settings->axis_offset_z,
+		   settings->AA_axis_offset,
+		   settings->BB_axis_offset,
+		   settings->CC_axis_offset,
+		   settings->u_axis_offset,
+		   settings->v_axis_offset,
+		   settings->w_axis_offset);
+    SET_XY_ROTATION(settings->rotation_xy);
+    SELECT_PLANE(settings->plane);
+    SET_FEED_MODE(settings->feed_mode == UNITS_PER_REVOLUTION);
+    SET_FEED_RATE(settings->feed_rate);
+    SET_MOTION_CONTROL_MODE(settings->control_mode,
+			    settings->control_tolerance);
+    SET_NAIVECAM_TOLERANCE(settings->naivecam_tolerance);
+    SET_SPINDLE_MODE(settings->css_maximum);
+    SET_SPINDLE_SPEED(settings->speed);
+    if (settings->spindle_turning == CANON_CLOCKWISE) {
+	START_SPINDLE_CLOCKWISE();
+    } else if (settings->spindle_turning == CANON_COUNTERCLOCKWISE) {
+	START_SPINDLE_COUNTERCLOCKWISE();
+    }
+    if (settings->feed_override) {
+	ENABLE_FEED_OVERRIDE();
+    } else {
+	DISABLE_FEED_OVERRIDE();
+    }
+    if (settings->speed_override) {
+	ENABLE_SPEED_OVERRIDE();
+    } else {
+	DISABLE_SPEED_OVERRIDE();
+    }
+    if (settings->adaptive_feed) {
+	ENABLE_ADAPTIVE_FEED();
+    } else {
+	DISABLE_ADAPTIVE_FEED();
+    }
+    if (settings->feed_hold) {
+	ENABLE_FEED_HOLD();
+    } else {
+	DISABLE_FEED_HOLD();
+    }
+
+    write_g_codes((block_pointer) NULL, settings);
+    write_m_codes((block_pointer) NULL, settings);
+    write_settings(settings);
+}
+
+/***********************************************************************/
+
+/*! Interp::restore_checkpoint
+
+Returned Value: int
+   The number of lines skipped: the next read() returns line number
+   that plus one.  0 if there is no checkpoint before line, or if the
+   parameters are not those the checkpoints' run started from, in which
+   case nothing changed.
+
+Side Effects:
+   The file position, the sequence number, the parameters, the global
+   named parameters, the o-word labels and the modal state are those of
+   the checkpoint.  Canon calls bring the canonical machining functions
+   in line with the restored modal state.
+
+Called By: external programs, right after open()
+
+The tool, tool offset and position are left alone; the caller is
+expected to synch() before executing the line it wanted to start at,
+as it would after reading through the program up to there.
+
+*/
+
+int Interp::restore_checkpoint(int line)
+{
+    setup_pointer settings = &_setup;
+    std::vector<checkpoint>::reverse_iterator it;
+
+    if (settings->file_pointer == NULL || settings->lazy_closing ||
+	settings->call_level != 0 || settings->checkpoint_started) {
+	return 0;
+    }
+    if (!same_start(settings)) {
+	logDebug("restore_checkpoint: parameters changed since the checkpoints were taken");
+	return 0;
+    }
+    for (it = settings->checkpoints.rbegin();
+	 it != settings->checkpoints.rend(); ++it) {
+	if (it->sequence_number < line) {
+	    break;
+	}
+    }
+    if (it == settings->checkpoints.rend()) {
+	logDebug("restore_checkpoint: no checkpoint before line %d", line);
+	return 0;
+    }
+    const checkpoint &cp = *it;
+
+    reset();
+    if (fseek(settings->file_pointer, cp.position, SEEK_SET) != 0) {
+	fseek(settings->file_pointer, 0, SEEK_SET);
+	settings->sequence_number = 0;
+	return 0;
+    }
+    settings->sequence_number = cp.sequence_number;
+
+    // the rest of this run adds to the checkpoints taken so far
+    settings->checkpoint_next =
+	settings->checkpoints.back().sequence_number + settings->checkpoint_step;
+    settings->checkpoint_truncate = false;
+    settings->checkpoint_started = true;
+
+    load_checkpoint(settings, cp);
+
+    logDebug("restore_checkpoint: line %d from checkpoint at line %d",
+	     line, cp.sequence_number);
+    return cp.sequence_number;
+}
+
+static void put(std::string &state, const void *data, size_t length)
+{
+    state.append(static_cast<const char *>(data), length);
+}
+
+// false once the state runs out
+static bool get(const char *&p, const char *end, void *data, size_t length)
+{
+    if ((size_t) (end - p) < length) {
+	return false;
+    }
+    memcpy(data, p, length);
+    p += length;
+    return true;
+}
+
+/***********************************************************************/
+
+/*! Interp::save_state
+
+Returned Value: int (INTERP_OK)
+
+Side Effects:
+   state holds what restore_state() needs to bring back the parameters,
+   the global named parameters, the modal state and the position as
+   they are now.
+
+Called By: external programs, when a run whose output they recorded
+   has ended
+
+The read-only named parameters are left out; like the tool and the
+parameters that follow the machine, they are current when the state is
+restored.
+
+*/
+
+int Interp::save_state(std::string &state)
+{
+    setup_pointer settings = &_setup;
+    parameter_map::const_iterator it;
+    checkpoint cp;
+    uint32_t n;
+
+    fill_checkpoint(settings, cp);
+    state.clear();
+    n = STATE_VERSION;
+    put(state, &n, sizeof(n));
+    put(state, &cp.parameters[0], RS274NGC_MAX_PARAMETERS * sizeof(double));
+
+    n = 0;
+    for (it = cp.named_params.begin(); it != cp.named_params.end(); ++it) {
+	if (!(it->second.attr & PA_READONLY)) {
+	    n++;
+	}
+    }
+    put(state, &n, sizeof(n));
+    for (it = cp.named_params.begin(); it != cp.named_params.end(); ++it) {
+	if (it->second.attr & PA_READONLY) {
+	    continue;
+	}
+	n = strlen(it->first);
+	put(state, &n, sizeof(n));
+	put(state, it->first, n);
+	put(state, &it->second.value, sizeof(it->second.value));
+	put(state, &it->second.attr, sizeof(it->second.attr));
+    }
+
+    put(state, &cp.context_status, sizeof(cp.context_status));
+    put(state, cp.saved_g_codes, sizeof(cp.saved_g_codes));
+    put(state, cp.saved_m_codes, sizeof(cp.saved_m_codes));
+    put(state, cp.saved_settings, sizeof(cp.saved_settings));
+#define PUT_FIELD(f) put(state, &cp.f, sizeof(cp.f));
+    CHECKPOINT_FIELDS(PUT_FIELD)
+#undef PUT_FIELD
+#define PUT_POSITION(f) put(state, &settings->f, sizeof(settings->f));
+    POSITION_FIELDS(PUT_POSITION)
+#undef PUT_POSITION
+    return INTERP_OK;
+}
+
+/***********************************************************************/
+
+/*! Interp::restore_state
+
+Returned Value: int
+   INTERP_OK, or INTERP_ERROR if the state is not one save_state() of
+   this version wrote, in which case nothing changed.
+
+Side Effects:
+   The parameters, the global named parameters, the modal state and the
+   position are those of the saved state.  Canon calls bring the
+   canonical machining functions in line with the restored modal state.
+
+Called By: external programs, after replaying the recorded output of a
+   run instead of running it
+
+*/
+
+int Interp::restore_state(const char *state, size_t length)
+{
+    setup_pointer settings = &_setup;
+    const char *p = state, *end = state + length;
+    const parameter_map &now = settings->sub_context[0].named_params;
+    parameter_map::const_iterator it;
+    parameter_value value;
+    char name[LINELEN];
+    checkpoint cp;
+    uint32_t n, len;
+    bool ok;
+
+    CHKS((settings->call_level != 0),
+	 _("Cannot restore the interpreter state inside a subroutine"));
+
+    cp.parameters.resize(RS274NGC_MAX_PARAMETERS);
+    ok = get(p, end, &n, sizeof(n)) && n == STATE_VERSION &&
+	get(p, end, &cp.parameters[0],
+	    RS274NGC_MAX_PARAMETERS * sizeof(double)) &&
+	get(p, end, &n, sizeof(n));
+
+    // the read-only ones stay as they are
+    for (it = now.begin(); it != now.end(); ++it) {
+	if (it->second.attr & PA_READONLY) {
+	    cp.named_params.insert(*it);
+	}
+    }
+    while (ok && n-- > 0) {
+	ok = get(p, end, &len, sizeof(len)) && len < sizeof(name) &&
+	    get(p, end, name, len) &&
+	    get(p, end, &value.value, sizeof(value.value)) &&
+	    get(p, end, &value.attr, sizeof(value.attr));
+	if (ok) {
+	    name[len] = 0;
+	    cp.named_params[strstore(name)] = value;
+	}
+    }
+
+    ok = ok && get(p, end, &cp.context_status, sizeof(cp.context_status)) &&
+	get(p, end, cp.saved_g_codes, sizeof(cp.saved_g_codes)) &&
+	get(p, end, cp.saved_m_codes, sizeof(cp.saved_m_codes)) &&
+	get(p, end, cp.saved_settings, sizeof(cp.saved_settings));
+#define GET_FIELD(f) ok = ok && get(p, end, &cp.f, sizeof(cp.f));
+    CHECKPOINT_FIELDS(GET_FIELD)
+#undef GET_FIELD
+#define GET_POSITION(f) double f; ok = ok && get(p, end, &f, sizeof(f));
+    POSITION_FIELDS(GET_POSITION)
+#undef GET_POSITION
+    CHKS((!ok || p != end),
+	 _("The saved interpreter state is damaged or from another version"));
+
+    load_checkpoint(settings, cp);
+#define LOAD_POSITION(f) settings->f = f;
+    POSITION_FIELDS(LOAD_POSITION)
+#undef LOAD_POSITION
+    logDebug("restore_state: %zu bytes", length);
+    return INTERP_OK;
+}
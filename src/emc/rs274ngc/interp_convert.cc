@@ -127,6 +127,7 @@ int Interp::comp_set_programmed(setup_pointer settings, double x, double y, doub
 
 static unsigned int nurbs_order;
 static std::vector<CONTROL_POINT> nurbs_control_points;
+static double nurbs_inverse_f;  // last F word of the curve, for G93
 
 int Interp::convert_nurbs(int mode,
       block_pointer block,     //!< pointer to a block of RS274 instructions
@@ -148,7 +149,11 @@ int Interp::convert_nurbs(int mode,
             CHKS((settings->feed_rate == 0.0), (
                  _("Cannot make a NURBS with 0 feedrate")));
         }
-        if (settings->motion_mode != mode) nurbs_control_points.clear();
+        if (settings->motion_mode != mode) {
+            nurbs_control_points.clear();
+            nurbs_inverse_f = 0;
+        }
+        if (block->f_flag) nurbs_inverse_f = block->f_number;
 
         if (nurbs_control_points.empty()) {
             CP.X = settings->current_x;
@@ -185,6 +190,13 @@ int Interp::convert_nurbs(int mode,
         CHKS((settings->motion_mode != G_5_2), (
              _("Cannot use G5.3 without G5.2 first")));
         CHKS((nurbs_control_points.size()<nurbs_order), _("You must specify a number of control points at least equal to the order L = %d"), nurbs_order);
+        if (settings->feed_mode == INVERSE_TIME) {
+            if (block->f_flag) nurbs_inverse_f = block->f_number;
+            CHKS((nurbs_inverse_f == 0),
+                NCE_F_WORD_MISSING_WITH_INVERSE_TIME_ARC_MOVE);
+            inverse_time_rate_nurbs(nurbs_control_points, nurbs_order,
+                                    nurbs_inverse_f, settings);
+        }
 	settings->current_x = nurbs_control_points[nurbs_control_points.size()-1].X;
         settings->current_y = nurbs_control_points[nurbs_control_points.size()-1].Y;
         NURBS_FEED(block->line_number, nurbs_control_points, nurbs_order);
@@ -244,6 +256,7 @@ int Interp::convert_spline(int mode,
       nurbs_control_points.push_back(cp);
       cp.X = x2, cp.Y = y2;
       nurbs_control_points.push_back(cp);
+      inverse_time_rate_nurbs(nurbs_control_points, 3, block->f_number, settings);
       NURBS_FEED(block->line_number, nurbs_control_points, 3);
       nurbs_control_points.clear();
       settings->current_x = x2;
@@ -275,6 +288,7 @@ int Interp::convert_spline(int mode,
       nurbs_control_points.push_back(cp);
       cp.X = x3, cp.Y = y3;
       nurbs_control_points.push_back(cp);
+      inverse_time_rate_nurbs(nurbs_control_points, 4, block->f_number, settings);
       NURBS_FEED(block->line_number, nurbs_control_points, 4);
       nurbs_control_points.clear();
 
@@ -1559,23 +1573,25 @@ int Interp::convert_control_mode(int g_code,     //!< g_code being executed (G_6
   if (g_code == G_61) {
     SET_MOTION_CONTROL_MODE(CANON_EXACT_PATH, 0);
     settings->control_mode = CANON_EXACT_PATH;
+    settings->control_tolerance = 0;
   } else if (g_code == G_61_1) {
     SET_MOTION_CONTROL_MODE(CANON_EXACT_STOP, 0);
     settings->control_mode = CANON_EXACT_STOP;
+    settings->control_tolerance = 0;
   } else if (g_code == G_64) {
-	if (tolerance >= 0) {
-	    SET_MOTION_CONTROL_MODE(CANON_CONTINUOUS, tolerance);
-	} else {
-	    SET_MOTION_CONTROL_MODE(CANON_CONTINUOUS, 0);
+	if (tolerance < 0) {
+	    tolerance = 0;
+	} else if (naivecam_tolerance < 0) {
+	    naivecam_tolerance = tolerance;   // if no naivecam_tolerance specified use same for both
 	}
-	if (naivecam_tolerance >= 0) {
-	    SET_NAIVECAM_TOLERANCE(naivecam_tolerance);
-	} else if (tolerance >= 0) {
-	    SET_NAIVECAM_TOLERANCE(tolerance);   // if no naivecam_tolerance specified use same for both
-	} else {
-	    SET_NAIVECAM_TOLERANCE(0);
+	if (naivecam_tolerance < 0) {
+	    naivecam_tolerance = 0;
 	}
+	SET_MOTION_CONTROL_MODE(CANON_CONTINUOUS, tolerance);
+	SET_NAIVECAM_TOLERANCE(naivecam_tolerance);
     settings->control_mode = CANON_CONTINUOUS;
+    settings->control_tolerance = tolerance;
+    settings->naivecam_tolerance = naivecam_tolerance;
   } else 
     ERS(NCE_BUG_CODE_NOT_G61_G61_1_OR_G64);
   return INTERP_OK;
@@ -4079,14 +4095,15 @@ int Interp::convert_spindle_mode(block_pointer block, setup_pointer settings)
 {
     if(block->g_modes[14] == G_97) {
         settings->spindle_mode = CONSTANT_RPM;
-	enqueue_SET_SPINDLE_MODE(0);
+        settings->css_maximum = 0;
     } else { /* G_96 */
         settings->spindle_mode = CONSTANT_SURFACE;
 	if(block->d_flag)
-	    enqueue_SET_SPINDLE_MODE(fabs(block->d_number_float));
+	    settings->css_maximum = fabs(block->d_number_float);
 	else
-	    enqueue_SET_SPINDLE_MODE(1e30);
+	    settings->css_maximum = 1e30;
     }
+    enqueue_SET_SPINDLE_MODE(settings->css_maximum);
     return INTERP_OK;
 }
 /****************************************************************************/
@@ -713,9 +713,17 @@ int Interp::find_tool_pocket(setup_pointer settings, int toolno, int *pocket)
         return INTERP_OK;
     }
     *pocket = -1;
-    for(int i=0; i<CANON_POCKETS_MAX; i++) {
-        if(settings->tool_table[i].toolno == toolno)
-            *pocket = i;
+    std::unordered_map<int, int>::const_iterator i =
+        settings->tool_pockets.find(toolno);
+    if(i != settings->tool_pockets.end()
+       && settings->tool_table[i->second].toolno == toolno) {
+        *pocket = i->second;
+    } else {
+        // not indexed, or Python changed the table after it was loaded
+        for(int p=0; p<CANON_POCKETS_MAX; p++) {
+            if(settings->tool_table[p].toolno == toolno)
+                *pocket = p;
+        }
     }
 
     CHKS((*pocket == -1), (_("Requested tool %d not found in the tool table")), toolno);
@@ -17,8 +17,12 @@
 #include "config.h"
 #include <limits.h>
 #include <stdio.h>
+#include <sys/types.h>
+#include <time.h>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include <bitset>
 #include "canon.hh"
 #include "emcpos.h"
@@ -590,6 +594,74 @@ typedef std::map<const char *, offset, nocase_cmp>::iterator offset_map_iterator
 
 /*
 
+A checkpoint is the part of the interpreter state that reading the
+program up to a toplevel block builds up: the modal settings, the
+parameters, the global named parameters and the o-word labels seen so
+far.  Run-from-line restores the last checkpoint before the start line
+instead of reading every block from the top of the program.
+
+The tool in the spindle, its offset and the position are not part of
+a checkpoint; they come from the machine when the run starts.  All
+other parameters must be those the run that took the checkpoints
+started with, or reading from the top could give a different result.
+
+*/
+
+typedef struct checkpoint_struct {
+  int sequence_number;          // lines read before the checkpoint
+  long position;                // ftell of the next line
+  std::vector<double> parameters;
+  parameter_map named_params;   // of sub_context[0]
+  unsigned char context_status; // M70/M73 state of sub_context[0]
+  int saved_g_codes[ACTIVE_G_CODES];
+  int saved_m_codes[ACTIVE_M_CODES];
+  double saved_settings[ACTIVE_SETTINGS];
+  offset_map_type offset_map;
+
+  double AA_axis_offset, AA_origin_offset;
+  double BB_axis_offset, BB_origin_offset;
+  double CC_axis_offset, CC_origin_offset;
+  double u_axis_offset, u_origin_offset;
+  double v_axis_offset, v_origin_offset;
+  double w_axis_offset, w_origin_offset;
+  double axis_offset_x, axis_offset_y, axis_offset_z;
+  double origin_offset_x, origin_offset_y, origin_offset_z;
+  int origin_index;
+  double rotation_xy;
+  CANON_MOTION_MODE control_mode;
+  double control_tolerance;
+  double naivecam_tolerance;
+  double cycle_cc, cycle_i, cycle_j, cycle_k;
+  int cycle_l;
+  double cycle_p, cycle_q, cycle_r, cycle_il;
+  int cycle_il_flag;
+  DISTANCE_MODE distance_mode;
+  DISTANCE_MODE ijk_distance_mode;
+  int feed_mode;
+  bool feed_override;
+  double feed_rate;
+  CANON_UNITS length_units;
+  int motion_mode;
+  CANON_PLANE plane;
+  RETRACT_MODE retract_mode;
+  double speed;
+  SPINDLE_MODE spindle_mode;
+  double css_maximum;
+  bool speed_override;
+  CANON_DIRECTION spindle_turning;
+  bool adaptive_feed;
+  bool feed_hold;
+  bool lathe_diameter_mode;
+  int executed_if;
+  double return_value;
+  int value_returned;
+} checkpoint;
+
+#define CHECKPOINT_INTERVAL 1000   // default lines between checkpoints
+#define CHECKPOINT_MAX 128         // thin out and widen the interval beyond
+
+/*
+
 The current_x, current_y, and current_z are the location of the tool
 in the current coordinate system. current_x and current_y differ from
 program_x and program_y when cutter radius compensation is on.
@@ -643,6 +715,8 @@ struct setup
 
   char blocktext[LINELEN];   // linetext downcased, white space gone
   CANON_MOTION_MODE control_mode;       // exact path or cutting mode
+  double control_tolerance;     // P of the last G64
+  double naivecam_tolerance;    // Q of the last G64
   int current_pocket;             // carousel slot number of current tool
   double current_x;             // current X-axis position
   double current_y;             // current Y-axis position
@@ -705,6 +779,7 @@ struct setup
   int sequence_number;          // sequence number of line last read
   double speed;                 // current spindle speed in rpm or SxM
   SPINDLE_MODE spindle_mode;    // CONSTANT_RPM or CONSTANT_SURFACE
+  double css_maximum;           // D of the last G96, 0 for G97
   CANON_SPEED_FEED_MODE speed_feed_mode;        // independent or synched
   bool speed_override;        // whether speed override is enabled
   CANON_DIRECTION spindle_turning;      // direction spindle is turning
@@ -713,6 +788,8 @@ struct setup
   EmcPose tool_offset;          // tool length offset
   int pockets_max;                 // number of pockets in carousel (including pocket 0, the spindle)
   CANON_TOOL_TABLE tool_table[CANON_POCKETS_MAX];      // index is pocket number
+  int tool_table_loaded;           // pockets filled by the last load_tool_table
+  std::unordered_map<int, int> tool_pockets; // tool number to pocket, see find_tool_pocket
   double traverse_rate;         // rate for traverse motions
   double orient_offset;         // added to M19 R word, from [RS274NGC]ORIENT_OFFSET
 
@@ -733,6 +810,26 @@ struct setup
   int call_state;                  //  enum call_states - inidicate Py handler reexecution
   offset_map_type offset_map;      // store label x name, file, line
 
+  // run-from-line checkpoints of the open program, see interp_checkpoint.cc
+  std::vector<checkpoint> checkpoints;
+  int checkpoint_interval;         // from ini, 0 disables checkpoints
+  int checkpoint_step;             // current interval, grows as they thin out
+  int checkpoint_next;             // sequence number due for the next one
+  bool checkpoint_truncate;        // next one replaces those at or after it
+  dev_t checkpoint_dev;            // identity of the file they belong to
+  ino_t checkpoint_ino;
+  off_t checkpoint_size;
+  struct timespec checkpoint_mtime;
+  bool checkpoint_started;         // this run's starting state was checked
+  // parameters and toplevel named parameters the run that took the
+  // checkpoints started from
+  std::vector<double> checkpoint_start_parameters;
+  parameter_map checkpoint_start_named_params;
+
+  // set when the open program read something its parameters do not
+  // determine: HAL pins, system parameters, remaps or Python
+  int runtime_reads;
+
   bool adaptive_feed;              // adaptive feed is enabled
   bool feed_hold;                  // feed hold is enabled
   int loggingLevel;                  // 0 means logging is off
@@ -127,3 +127,59 @@ int Interp::inverse_time_rate_straight(double end_x,     //!< x coordinate of en
 
   return INTERP_OK;
 }
+
+/****************************************************************************/
+
+/*! inverse_time_rate_nurbs
+
+Returned Value: int (INTERP_OK)
+
+Side effects: a call is made to SET_FEED_RATE and _setup.feed_rate is set.
+
+Called by:
+  convert_nurbs
+  convert_spline
+
+This finds the feed rate needed by an inverse time spline or NURBS move,
+so that the whole curve takes 1/f_number minutes like a G1 or G2 would.
+The length is that of a polyline through points on the curve, as fine
+as the one the preview draws.
+
+*/
+
+int Interp::inverse_time_rate_nurbs(const std::vector<CONTROL_POINT> &cp, //!< control points of the curve
+                                    unsigned int k,    //!< order of the curve
+                                    double f_number,   //!< inverse time F word
+                                    setup_pointer settings)    //!< pointer to machine settings
+{
+  double length;
+  double rate;
+
+  if (settings->feed_mode != INVERSE_TIME) return -1;
+
+  unsigned int n = cp.size() - 1;
+  unsigned int div = cp.size() * 15;
+  double umax = n - k + 2;
+  std::vector<unsigned int> knot_vector = knot_vector_creator(n, k);
+  PLANE_POINT p0;
+  p0.X = cp[0].X;
+  p0.Y = cp[0].Y;
+  length = 0;
+  for (unsigned int i = 1; i <= div; i++) {
+    PLANE_POINT p1;
+    if (i == div) {
+      p1.X = cp[n].X;
+      p1.Y = cp[n].Y;
+    } else {
+      p1 = nurbs_point(umax * i / div, k, cp, knot_vector);
+    }
+    length += hypot(p1.X - p0.X, p1.Y - p0.Y);
+    p0 = p1;
+  }
+
+  rate = std::max(0.1, (length * f_number));
+  enqueue_SET_FEED_RATE(rate);
+  settings->feed_rate = rate;
+
+  return INTERP_OK;
+}
@@ -341,6 +341,7 @@ int Interp::find_named_param(
       }
       if (FEATURE(HAL_PIN_VARS) && (strncasecmp(nameBuf,"_hal[",5) == 0)) {
 	  fetch_hal_param(nameBuf, &exists, &inivalue);
+	  _setup.runtime_reads = 1;
 	  if (exists) {
 	      logNP("parameter '%s' retrieved from HAL: %f",nameBuf,inivalue);
 	      *value = inivalue;
@@ -354,6 +355,8 @@ int Interp::find_named_param(
       parameter_pointer pv = &pi->second;
       if (pv->attr & PA_UNSET)
 	  logNP("warning: referencing unset variable '%s'",nameBuf);
+      if (pv->attr & (PA_USE_LOOKUP | PA_PYTHON))
+	  _setup.runtime_reads = 1;
       if (pv->attr & PA_USE_LOOKUP) {
 	  CHP(lookup_named_param(nameBuf, pv->value, value));
 	  *status = 1;
@@ -282,9 +282,7 @@ int Interp::execute_call(setup_pointer settings,
 	    if (remap->remap_py || remap->prolog_func || remap->epilog_func) {
 		CHKS(!PYUSABLE, "%s (remapped) uses Python functions, but the Python plugin is not available", 
 		     remap->name);
-		plist.append(*settings->pythis);   //self
-		current_frame->pystuff.impl->tupleargs = bp::tuple(plist);
-		current_frame->pystuff.impl->kwargs = bp::dict();
+		py_remap_args(settings, current_frame);
 	    }
 	    if (remap->argspec && (strchr(remap->argspec, '@') == NULL)) {
 		// add_parameters will decorate kwargs as per argspec
@@ -38,6 +38,8 @@
 #include <boost/python/extract.hpp>
 #include <boost/python/import.hpp>
 #include <boost/python/str.hpp>
+#include <boost/python/tuple.hpp>
+#include <boost/python/dict.hpp>
 namespace bp = boost::python;
 
 #include <unistd.h>
@@ -130,6 +132,7 @@ int Interp::pycall(setup_pointer settings,
 	logPy("pycall(%s.%s) \n", module ? module : "", funcname);
 
     CHKS(!PYUSABLE, "pycall(%s): Pyhton plugin not initialized",funcname);
+    _setup.runtime_reads = 1;
     frame->pystuff.impl->py_return_type = 0;
 
     switch (calltype) {
@@ -284,6 +287,25 @@ int Interp::pycall(setup_pointer settings,
     return status;
 }
 
+// remap handlers all get (self,) and a kwargs dict filled in by
+// add_parameters(). Keep both from the previous remap call at this level
+// instead of allocating them again, unless a handler held on to the dict.
+void Interp::py_remap_args(setup_pointer settings, context_pointer frame)
+{
+    pycontext_impl *impl = frame->pystuff.impl;
+
+    if (!(PyTuple_Check(impl->tupleargs.ptr()) &&
+	  (PyTuple_GET_SIZE(impl->tupleargs.ptr()) == 1) &&
+	  (PyTuple_GET_ITEM(impl->tupleargs.ptr(), 0) == settings->pythis->ptr())))
+	impl->tupleargs = bp::make_tuple(*settings->pythis);
+
+    if (PyDict_CheckExact(impl->kwargs.ptr()) &&
+	(Py_REFCNT(impl->kwargs.ptr()) == 1))
+	PyDict_Clear(impl->kwargs.ptr());
+    else
+	impl->kwargs = bp::dict();
+}
+
 // called by  (py, ....) or ';py,...' comments
 int Interp::py_execute(const char *cmd, bool as_file)
 {
@@ -1924,6 +1924,8 @@ int Interp::read_parameter(
           NCE_PARAMETER_NUMBER_OUT_OF_RANGE);
       CHKS(((index >= 5420) && (index <= 5428) && (_setup.cutter_comp_side)),
            _("Cannot read current position with cutter radius compensation on"));
+      if (index >= 5000)
+          _setup.runtime_reads = 1;
       *double_ptr = parameters[index];
   }
   return INTERP_OK;
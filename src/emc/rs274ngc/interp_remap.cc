@@ -74,6 +74,7 @@ int Interp::convert_remapped_code(block_pointer block,
     bp::list plist;
     char cmd[LINELEN];
 
+    settings->runtime_reads = 1;
     if (number == -1)
 	logRemap("convert_remapped_code '%c'", letter);
     else
@@ -59,6 +59,8 @@ setup::setup() :
     remap_level(0),
     blocktext{},
     control_mode(0),
+    control_tolerance(0.0),
+    naivecam_tolerance(0.0),
     current_pocket(0),
 
     current_x (0.0),
@@ -122,6 +124,7 @@ setup::setup() :
     sequence_number(0),
     speed (0.0),
     spindle_mode(CONSTANT_RPM),
+    css_maximum(0.0),
     speed_feed_mode(0),
     speed_override(0),
     spindle_turning(0),
@@ -130,6 +133,7 @@ setup::setup() :
     tool_offset{{0,0,0},0,0,0,0,0,0},
     pockets_max(0),
     tool_table{},
+    tool_table_loaded(CANON_POCKETS_MAX),
     traverse_rate (0.0),
     orient_offset (0.0),
 
@@ -148,6 +152,18 @@ setup::setup() :
     call_level(0),
     sub_context{},
     call_state(0),
+    checkpoints(),
+    checkpoint_interval(CHECKPOINT_INTERVAL),
+    checkpoint_step(CHECKPOINT_INTERVAL),
+    checkpoint_next(0),
+    checkpoint_truncate(true),
+    checkpoint_dev(0),
+    checkpoint_ino(0),
+    checkpoint_size(0),
+    checkpoint_mtime{},
+    checkpoint_started(false),
+    checkpoint_start_parameters(),
+    checkpoint_start_named_params(),
     adaptive_feed(0),
     feed_hold(0),
     loggingLevel(0),
@@ -54,6 +54,20 @@ public:
  int read(const char *mdi);
  int read();
 
+// continue reading the open file after the last checkpoint before line
+ int restore_checkpoint(int line);
+
+// the state a finished run left, and putting it back in place of the run
+ int save_state(std::string &state);
+ int restore_state(const char *state, size_t length);
+
+// nonzero if the open program read HAL pins, system parameters, remaps or
+// Python, whose values its parameters do not determine
+ int runtime_reads();
+
+// hash of the numbered and global named parameters
+ unsigned long long parameter_digest();
+
 // reset yourself
  int reset();
 
@@ -394,6 +408,9 @@ public:
                                 double u_end, double v_end, double w_end,
                                 block_pointer block,
                                 setup_pointer settings);
+ int inverse_time_rate_nurbs(const std::vector<CONTROL_POINT> &cp,
+                             unsigned int k, double f_number,
+                             setup_pointer settings);
  int move_endpoint_and_flush(setup_pointer, double, double);
  int parse_line(char *line, block_pointer block,
                       setup_pointer settings);
@@ -458,6 +475,9 @@ public:
     int free_named_parameters(context_pointer frame);
  int save_settings(setup_pointer settings);
  int restore_settings(setup_pointer settings, int from_level);
+ void checkpoint_open(setup_pointer settings);
+ int take_checkpoint(setup_pointer settings);
+ void load_checkpoint(setup_pointer settings, const checkpoint &cp);
  int gen_settings(double *current, double *saved, std::string &cmd);
  int gen_g_codes(int *current, int *saved, std::string &cmd);
  int gen_m_codes(int *current, int *saved, std::string &cmd);
@@ -640,6 +660,7 @@ int read_inputs(setup_pointer settings);
 	       const char *module,
 	       const char *funcname,
 	       int calltype);
+    void py_remap_args(setup_pointer settings, context_pointer frame);
     int py_execute(const char *cmd, bool as_file = false); // for (py, ....) comments
     int py_reload();
     FILE *find_ngc_file(setup_pointer settings,const char *basename, char *foundhere = NULL);
@@ -836,6 +836,7 @@ int Interp::init()
   // we'll try to override these from the ini file below
   _setup.center_arc_radius_tolerance_inch = CENTER_ARC_RADIUS_TOLERANCE_INCH;
   _setup.center_arc_radius_tolerance_mm = CENTER_ARC_RADIUS_TOLERANCE_MM;
+  _setup.checkpoint_interval = CHECKPOINT_INTERVAL;
 
   if(iniFileName != NULL) {
 
@@ -865,6 +866,7 @@ int Interp::init()
               _setup.c_indexer_jnum = atol(inistring);
           }
           inifile.Find(&_setup.orient_offset, "ORIENT_OFFSET", "RS274NGC");
+          inifile.Find(&_setup.checkpoint_interval, "CHECKPOINT_INTERVAL", "RS274NGC");
 
           inifile.Find(&_setup.debugmask, "DEBUG", "EMC");
 
@@ -1027,6 +1029,9 @@ int Interp::init()
       }
   }
 
+  if (_setup.checkpoints.empty())
+      _setup.checkpoint_step = _setup.checkpoint_interval;
+
   _setup.length_units = GET_EXTERNAL_LENGTH_UNIT_TYPE();
   USE_LENGTH_UNITS(_setup.length_units);
   GET_EXTERNAL_PARAMETER_FILE_NAME(filename, LINELEN);
@@ -1258,14 +1263,17 @@ Returned Value: int
    1. _setup.tool_max is larger than CANON_TOOL_MAX: NCE_TOOL_MAX_TOO_LARGE
 
 Side Effects:
-   _setup.tool_table[] is modified.
+   _setup.tool_table[], _setup.tool_pockets and _setup.pockets_max are
+   modified.
 
 Called By:
    Interp::synch
    external programs
 
 This function calls the canonical interface function GET_EXTERNAL_TOOL_TABLE
-to load the whole tool table into the _setup.
+to load the whole tool table into the _setup, and indexes it by tool
+number for find_tool_pocket.  GET_EXTERNAL_POCKETS_MAX tells how many
+pockets are in use; only those are read.
 
 The CANON_TOOL_MAX is an upper limit for this software. The
 _setup.tool_max is intended to be set for a particular machine.
@@ -1274,13 +1282,20 @@ _setup.tool_max is intended to be set for a particular machine.
 
 int Interp::load_tool_table()
 {
-  int n;
+  int n, toolno;
 
+  // the number of pockets in use may change with the table
+  _setup.pockets_max = GET_EXTERNAL_POCKETS_MAX();
   CHKS((_setup.pockets_max > CANON_POCKETS_MAX), NCE_POCKET_MAX_TOO_LARGE);
+  _setup.tool_pockets.clear();
   for (n = 0; n < _setup.pockets_max; n++) {
     _setup.tool_table[n] = GET_EXTERNAL_TOOL_TABLE(n);
+    toolno = _setup.tool_table[n].toolno;
+    if (toolno >= 0)
+      _setup.tool_pockets[toolno] = n;  // the last pocket wins, as in a scan
   }
-  for (; n < CANON_POCKETS_MAX; n++) {
+  // only the pockets filled last time need to be emptied
+  for (; n < _setup.tool_table_loaded; n++) {
     _setup.tool_table[n].toolno = -1;
     ZERO_EMC_POSE(_setup.tool_table[n].offset);
     _setup.tool_table[n].diameter = 0;
@@ -1288,6 +1303,7 @@ int Interp::load_tool_table()
     _setup.tool_table[n].frontangle = 0;
     _setup.tool_table[n].backangle = 0;
   }
+  _setup.tool_table_loaded = _setup.pockets_max;
   set_tool_parameters();
   return INTERP_OK;
 }
@@ -1385,10 +1401,46 @@ int Interp::open(const char *filename) //!< string: the name of the input NC-pro
     _setup.sequence_number = 0; // Going back to line 0
   }
   strcpy(_setup.filename, filename);
+  checkpoint_open(&_setup);
+  _setup.runtime_reads = 0;
   reset();
   return INTERP_OK;
 }
 
+int Interp::runtime_reads()
+{
+  return _setup.runtime_reads;
+}
+
+static unsigned long long digest_bytes(unsigned long long h, const void *p,
+                                       size_t n)
+{
+  const unsigned char *c = (const unsigned char *) p;
+
+  while (n--) {                 // FNV-1a
+    h ^= *c++;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+unsigned long long Interp::parameter_digest()
+{
+  unsigned long long h = 0xcbf29ce484222325ULL;
+  parameter_map_iterator pi;
+  parameter_map &globals = _setup.sub_context[0].named_params;
+
+  h = digest_bytes(h, _setup.parameters, sizeof(_setup.parameters));
+  // the ones that are looked up or come from the ini are not state
+  for (pi = globals.begin(); pi != globals.end(); pi++) {
+    if (pi->second.attr & (PA_USE_LOOKUP | PA_PYTHON | PA_FROM_INI))
+      continue;
+    h = digest_bytes(h, pi->first, strlen(pi->first) + 1);
+    h = digest_bytes(h, &pi->second.value, sizeof(pi->second.value));
+  }
+  return h;
+}
+
 int Interp::read_inputs(setup_pointer settings)
 {
     // logDebug("read_inputs probe=%d input=%d toolchange=%d",
@@ -1565,6 +1617,8 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
 
   if(_setup.file_pointer)
   {
+      if (command == NULL)
+	  CHP(take_checkpoint(&_setup));
       EXECUTING_BLOCK(_setup).offset = ftell(_setup.file_pointer);
   }
 
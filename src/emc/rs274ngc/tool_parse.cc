@@ -19,87 +19,152 @@
 #include "emcglb.h"
 #include "emctool.h"
 #include "tool_parse.h"
+#include "tooldata.hh"
+
+// Where the parsed entries go: the plain arrays of the standalone
+// interpreter, or the shared tool table of iocontrol and task.
+class ToolSink {
+public:
+    virtual ~ToolSink() {}
+    virtual void clear(int first_pocket) = 0;
+    virtual void put(int pocket, const CANON_TOOL_TABLE &tool,
+		     int fms, const char *comment) = 0;
+    virtual int toolno(int pocket) = 0;
+    virtual void put_spindle(const CANON_TOOL_TABLE &tool) = 0;
+};
+
+class ArraySink : public ToolSink {
+public:
+    ArraySink(CANON_TOOL_TABLE *toolTable_, int *fms_, char **ttcomments_) :
+	toolTable(toolTable_), fms(fms_), ttcomments(ttcomments_) {}
+    void clear(int first_pocket) {
+	for (int t = first_pocket; t < CANON_POCKETS_MAX; t++) {
+	    toolTable[t].toolno = -1;
+	    ZERO_EMC_POSE(toolTable[t].offset);
+	    toolTable[t].diameter = 0.0;
+	    toolTable[t].frontangle = 0.0;
+	    toolTable[t].backangle = 0.0;
+	    toolTable[t].orientation = 0;
+	    if(fms) fms[t] = 0;
+	    if(ttcomments) ttcomments[t][0] = '\0';
+	}
+    }
+    void put(int pocket, const CANON_TOOL_TABLE &tool, int f, const char *comment) {
+	toolTable[pocket] = tool;
+	if(fms) fms[pocket] = f;
+	if(ttcomments && comment) strcpy(ttcomments[pocket], comment);
+    }
+    int toolno(int pocket) { return toolTable[pocket].toolno; }
+    void put_spindle(const CANON_TOOL_TABLE &tool) { toolTable[0] = tool; }
+private:
+    CANON_TOOL_TABLE *toolTable;
+    int *fms;
+    char **ttcomments;
+};
+
+class ToolDataSink : public ToolSink {
+public:
+    ToolDataSink(ToolData &tooldata_) : tooldata(tooldata_) {}
+    void clear(int first_pocket) { tooldata.clear(first_pocket); }
+    void put(int pocket, const CANON_TOOL_TABLE &tool, int fms, const char *comment) {
+	tooldata_entry e;
+	e.tool = tool;
+	e.fms = fms;
+	e.comment[0] = '\0';
+	if(comment) strncat(e.comment, comment, CANON_TOOL_ENTRY_LEN - 1);
+	tooldata.put(pocket, e);
+    }
+    int toolno(int pocket) {
+	CANON_TOOL_TABLE tool;
+	if(tooldata.get(pocket, tool) != 0) return -1;
+	return tool.toolno;
+    }
+    void put_spindle(const CANON_TOOL_TABLE &tool) { tooldata.put(0, tool); }
+private:
+    ToolData &tooldata;
+};
+
+static void zero_tool(CANON_TOOL_TABLE &tool)
+{
+    tool.toolno = -1;
+    ZERO_EMC_POSE(tool.offset);
+    tool.diameter = 0.0;
+    tool.frontangle = 0.0;
+    tool.backangle = 0.0;
+    tool.orientation = 0;
+}
+
+// Map the pocket number from the file to the table index.  Nonrandom
+// changers get their tools in pockets 1..n in file order, and the file's
+// pocket number is kept for saving.  Returns false if the tool must be
+// skipped.
+static bool assign_pocket(int &pocket, int &fms, int random_toolchanger,
+	int &fakepocket, int toolno)
+{
+    fms = pocket;
+    if(!random_toolchanger) {
+	fakepocket++;
+	if(fakepocket >= CANON_POCKETS_MAX) {
+	    printf("too many tools. skipping tool %d\n", toolno);
+	    return false;
+	}
+	pocket = fakepocket;
+    }
+    if (pocket < 0 || pocket >= CANON_POCKETS_MAX) {
+	printf("max pocket number is %d. skipping tool %d\n", CANON_POCKETS_MAX-1, toolno);
+	return false;
+    }
+    return true;
+}
 
 static bool scan_old_style(
 	char *buffer,
-	CANON_TOOL_TABLE toolTable[],
-	int fms[],
-	char *ttcomments[],
+	ToolSink &sink,
 	int random_toolchanger,
 	int &fakepocket) {
-    int scanned, toolno, pocket, orientation;
+    int scanned, toolno, pocket, orientation, fms;
     double zoffset, xoffset, diameter, frontangle, backangle;
     char comment[CANON_TOOL_ENTRY_LEN];
+    CANON_TOOL_TABLE tool;
 
     if((scanned = sscanf(buffer, "%d %d %lf %lf %lf %lf %lf %d %[^\n]",
 			 &toolno, &pocket, &zoffset, &xoffset, &diameter,
 			 &frontangle, &backangle, &orientation, comment)) &&
        (scanned == 8 || scanned == 9)) {
-	if(!random_toolchanger) {
-	    fakepocket++;
-	    if(fakepocket >= CANON_POCKETS_MAX) {
-		printf("too many tools. skipping tool %d\n", toolno);
-		return true;
-	    }
-	    if(fms) fms[fakepocket] = pocket;
-	    pocket = fakepocket;
-	}
-	if (pocket < 0 || pocket >= CANON_POCKETS_MAX) {
-	    printf("max pocket number is %d. skipping tool %d\n", CANON_POCKETS_MAX-1, toolno);
-	    return true;
-	} else {
+	if(assign_pocket(pocket, fms, random_toolchanger, fakepocket, toolno)) {
 	    /* lathe tool */
-	    toolTable[pocket].toolno = toolno;
-	    toolTable[pocket].offset.tran.z = zoffset;
-	    toolTable[pocket].offset.tran.x = xoffset;
-	    toolTable[pocket].diameter = diameter;
+	    zero_tool(tool);
+	    tool.toolno = toolno;
+	    tool.offset.tran.z = zoffset;
+	    tool.offset.tran.x = xoffset;
+	    tool.diameter = diameter;
 
-	    toolTable[pocket].frontangle = frontangle;
-	    toolTable[pocket].backangle = backangle;
-	    toolTable[pocket].orientation = orientation;
-	    if(ttcomments && scanned == 9) strcpy(ttcomments[pocket], comment);
-	    return true;
+	    tool.frontangle = frontangle;
+	    tool.backangle = backangle;
+	    tool.orientation = orientation;
+	    sink.put(pocket, tool, fms, scanned == 9 ? comment : 0);
 	}
+	return true;
     } else if ((scanned = sscanf(buffer, "%d %d %lf %lf %[^\n]",
 				 &toolno, &pocket, &zoffset, &diameter, comment)) &&
 	       (scanned == 4 || scanned == 5)) {
-	if(!random_toolchanger) {
-	    fakepocket++;
-	    if(fakepocket >= CANON_POCKETS_MAX) {
-		printf("too many tools. skipping tool %d\n", toolno);
-		return true;
-	    }
-	    if(fms) fms[fakepocket] = pocket;
-	    pocket = fakepocket;
-	}
-	if (pocket < 0 || pocket >= CANON_POCKETS_MAX) {
-	    printf("max pocket number is %d. skipping tool %d\n", CANON_POCKETS_MAX-1, toolno);
-	    return true;
-	} else {
+	if(assign_pocket(pocket, fms, random_toolchanger, fakepocket, toolno)) {
 	    /* mill tool */
-	    toolTable[pocket].toolno = toolno;
-	    toolTable[pocket].offset.tran.z = zoffset;
-	    toolTable[pocket].diameter = diameter;
-
-	    // these aren't used on a mill
-	    toolTable[pocket].frontangle = toolTable[pocket].backangle = 0.0;
-	    toolTable[pocket].offset.tran.x = 0.0;
-	    toolTable[pocket].orientation = 0;
-	    if(ttcomments && scanned == 5) strcpy(ttcomments[pocket], comment);
-	    return true;
+	    zero_tool(tool);
+	    tool.toolno = toolno;
+	    tool.offset.tran.z = zoffset;
+	    tool.diameter = diameter;
+	    sink.put(pocket, tool, fms, scanned == 5 ? comment : 0);
 	}
+	return true;
     }
     return false;
 }
 
-int loadToolTable(const char *filename,
-			 CANON_TOOL_TABLE toolTable[],
-			 int fms[],
-			 char *ttcomments[],
-			 int random_toolchanger)
+static int loadTools(const char *filename, ToolSink &sink,
+		     int random_toolchanger)
 {
     int fakepocket = 0;
-    int t;
     FILE *fp;
     char buffer[CANON_TOOL_ENTRY_LEN];
     char orig_line[CANON_TOOL_ENTRY_LEN];
@@ -113,16 +178,7 @@ int loadToolTable(const char *filename,
 	return -1;
     }
     // clear out tool table
-    for (t = random_toolchanger? 0: 1; t < CANON_POCKETS_MAX; t++) {
-        toolTable[t].toolno = -1;
-        ZERO_EMC_POSE(toolTable[t].offset);
-        toolTable[t].diameter = 0.0;
-        toolTable[t].frontangle = 0.0;
-        toolTable[t].backangle = 0.0;
-        toolTable[t].orientation = 0;
-        if(fms) fms[t] = 0;
-        if(ttcomments) ttcomments[t][0] = '\0';
-    }
+    sink.clear(random_toolchanger? 0: 1);
 
     /*
       Override 0's with codes from tool file
@@ -137,9 +193,8 @@ int loadToolTable(const char *filename,
     while (!feof(fp)) {
         const char *token;
         char *buff, *comment;
-        int toolno, orientation, valid = 1;
-        EmcPose offset;  // tlo
-        double diameter, frontangle, backangle;
+        int toolno, orientation, valid = 1, fms = 0;
+        CANON_TOOL_TABLE tool;
 
         // for nonrandom machines, just read the tools into pockets 1..n
         // no matter their tool numbers.  NB leave the spindle pocket 0
@@ -150,13 +205,11 @@ int loadToolTable(const char *filename,
         }
         strcpy(orig_line, buffer);
 
-        if(scan_old_style(buffer, toolTable, fms, ttcomments,
-                                random_toolchanger, fakepocket)) continue;
+        if(scan_old_style(buffer, sink, random_toolchanger, fakepocket)) continue;
 
+        zero_tool(tool);
         toolno = -1;
-        diameter = frontangle = backangle = 0.0;
         orientation = 0;
-        ZERO_EMC_POSE(offset);
         buff = strtok(buffer, ";");
         comment = strtok(NULL, "\n");
 
@@ -172,68 +225,56 @@ int loadToolTable(const char *filename,
                     valid = 0;
                     break;
                 }
-                if (!random_toolchanger) {
-                    fakepocket++;
-                    if (fakepocket >= CANON_POCKETS_MAX) {
-                        printf("too many tools. skipping tool %d\n", toolno);
-                        valid = 0;
-                        break;
-                    }
-                    if(fms) fms[fakepocket] = pocket;
-                    pocket = fakepocket;
-                }
-                if (pocket < 0 || pocket >= CANON_POCKETS_MAX) {
-                    printf("max pocket number is %d. skipping tool %d\n", CANON_POCKETS_MAX - 1, toolno);
+                if (!assign_pocket(pocket, fms, random_toolchanger,
+                                   fakepocket, toolno))
                     valid = 0;
-                    break;
-                }
                 break;
             case 'D':
-                if (sscanf(&token[1], "%lf", &diameter) != 1)
+                if (sscanf(&token[1], "%lf", &tool.diameter) != 1)
                     valid = 0;
                 break;
             case 'X':
-                if (sscanf(&token[1], "%lf", &offset.tran.x) != 1)
+                if (sscanf(&token[1], "%lf", &tool.offset.tran.x) != 1)
                     valid = 0;
                 break;
             case 'Y':
-                if (sscanf(&token[1], "%lf", &offset.tran.y) != 1)
+                if (sscanf(&token[1], "%lf", &tool.offset.tran.y) != 1)
                     valid = 0;
                 break;
             case 'Z':
-                if (sscanf(&token[1], "%lf", &offset.tran.z) != 1)
+                if (sscanf(&token[1], "%lf", &tool.offset.tran.z) != 1)
                     valid = 0;
                 break;
             case 'A':
-                if (sscanf(&token[1], "%lf", &offset.a) != 1)
+                if (sscanf(&token[1], "%lf", &tool.offset.a) != 1)
                     valid = 0;
                 break;
             case 'B':
-                if (sscanf(&token[1], "%lf", &offset.b) != 1)
+                if (sscanf(&token[1], "%lf", &tool.offset.b) != 1)
                     valid = 0;
                 break;
             case 'C':
-                if (sscanf(&token[1], "%lf", &offset.c) != 1)
+                if (sscanf(&token[1], "%lf", &tool.offset.c) != 1)
                     valid = 0;
                 break;
             case 'U':
-                if (sscanf(&token[1], "%lf", &offset.u) != 1)
+                if (sscanf(&token[1], "%lf", &tool.offset.u) != 1)
                     valid = 0;
                 break;
             case 'V':
-                if (sscanf(&token[1], "%lf", &offset.v) != 1)
+                if (sscanf(&token[1], "%lf", &tool.offset.v) != 1)
                     valid = 0;
                 break;
             case 'W':
-                if (sscanf(&token[1], "%lf", &offset.w) != 1)
+                if (sscanf(&token[1], "%lf", &tool.offset.w) != 1)
                     valid = 0;
                 break;
             case 'I':
-                if (sscanf(&token[1], "%lf", &frontangle) != 1)
+                if (sscanf(&token[1], "%lf", &tool.frontangle) != 1)
                     valid = 0;
                 break;
             case 'J':
-                if (sscanf(&token[1], "%lf", &backangle) != 1)
+                if (sscanf(&token[1], "%lf", &tool.backangle) != 1)
                     valid = 0;
                 break;
             case 'Q':
@@ -248,21 +289,15 @@ int loadToolTable(const char *filename,
             token = strtok(NULL, " ");
         }
         if (valid) {
-            toolTable[pocket].toolno = toolno;
-            toolTable[pocket].offset = offset;
-            toolTable[pocket].diameter = diameter;
-            toolTable[pocket].frontangle = frontangle;
-            toolTable[pocket].backangle = backangle;
-            toolTable[pocket].orientation = orientation;
-
-            if (ttcomments && comment)
-                strcpy(ttcomments[pocket], comment);
+            tool.toolno = toolno;
+            tool.orientation = orientation;
+            sink.put(pocket, tool, fms, comment);
+            if (!random_toolchanger && sink.toolno(0) == toolno) {
+                sink.put_spindle(tool);
+            }
         } else {
             fprintf(stderr, "Unrecognized line skipped: %s", orig_line);
         }
-        if (!random_toolchanger && toolTable[0].toolno == toolTable[pocket].toolno) {
-            toolTable[0] = toolTable[pocket];
-        }
     }
 
     // close the file
@@ -270,3 +305,70 @@ int loadToolTable(const char *filename,
 
     return 0;
 }
+
+int loadToolTable(const char *filename,
+			 CANON_TOOL_TABLE toolTable[],
+			 int fms[],
+			 char *ttcomments[],
+			 int random_toolchanger)
+{
+    ArraySink sink(toolTable, fms, ttcomments);
+    return loadTools(filename, sink, random_toolchanger);
+}
+
+int loadToolData(const char *filename, ToolData &tooldata,
+		 int random_toolchanger)
+{
+    ToolDataSink sink(tooldata);
+    int r;
+
+    // readers see the old table or the new one, never half of each
+    tooldata.begin_update();
+    r = loadTools(filename, sink, random_toolchanger);
+    tooldata.end_update();
+    return r;
+}
+
+int saveToolData(const char *filename, ToolData &tooldata,
+		 int random_toolchanger)
+{
+    int pocket, pockets;
+    FILE *fp;
+    int start_pocket;
+    tooldata_entry e;
+
+    // open tool table file
+    if (NULL == (fp = fopen(filename, "w"))) {
+	// can't open file
+	return -1;
+    }
+
+    if(random_toolchanger) {
+        start_pocket = 0;
+    } else {
+        start_pocket = 1;
+    }
+    pockets = tooldata.pockets();
+    for (pocket = start_pocket; pocket < pockets; pocket++) {
+        if (tooldata.get(pocket, e) != 0 || e.tool.toolno == -1)
+            continue;
+        fprintf(fp, "T%d P%d", e.tool.toolno, random_toolchanger? pocket: e.fms);
+        if (e.tool.diameter) fprintf(fp, " D%f", e.tool.diameter);
+        if (e.tool.offset.tran.x) fprintf(fp, " X%+f", e.tool.offset.tran.x);
+        if (e.tool.offset.tran.y) fprintf(fp, " Y%+f", e.tool.offset.tran.y);
+        if (e.tool.offset.tran.z) fprintf(fp, " Z%+f", e.tool.offset.tran.z);
+        if (e.tool.offset.a) fprintf(fp, " A%+f", e.tool.offset.a);
+        if (e.tool.offset.b) fprintf(fp, " B%+f", e.tool.offset.b);
+        if (e.tool.offset.c) fprintf(fp, " C%+f", e.tool.offset.c);
+        if (e.tool.offset.u) fprintf(fp, " U%+f", e.tool.offset.u);
+        if (e.tool.offset.v) fprintf(fp, " V%+f", e.tool.offset.v);
+        if (e.tool.offset.w) fprintf(fp, " W%+f", e.tool.offset.w);
+        if (e.tool.frontangle) fprintf(fp, " I%+f", e.tool.frontangle);
+        if (e.tool.backangle) fprintf(fp, " J%+f", e.tool.backangle);
+        if (e.tool.orientation) fprintf(fp, " Q%d", e.tool.orientation);
+        fprintf(fp, " ;%s\n", e.comment);
+    }
+
+    fclose(fp);
+    return 0;
+}
@@ -32,4 +32,12 @@ int loadToolTable(const char *filename,
 }
 #endif
 
+class ToolData;
+
+// Same file format, read into and written from the shared tool table
+int loadToolData(const char *filename, ToolData &tooldata,
+	int random_toolchanger);
+int saveToolData(const char *filename, ToolData &tooldata,
+	int random_toolchanger);
+
 #endif
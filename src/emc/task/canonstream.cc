@@ -0,0 +1,488 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <limits.h>
+
+#include "rcs.hh"
+#include "nmlmsg.hh"
+#include "emc.hh"
+#include "canonstream.hh"
+#include "rcs_print.hh"
+
+#define CANON_STREAM_MAGIC 0x5343474e		// "NGCS"
+#define CANON_STREAM_VERSION 2
+// records between checkpoints, taken at the next toplevel block
+#define CANON_STREAM_CHECKPOINT_RECORDS 4096
+
+struct canon_stream_header {
+    uint32_t magic;
+    uint32_t version;
+    canon_stream_key key;
+    uint64_t records;
+    uint64_t data_end;
+    uint64_t checkpoint_offset;
+    uint64_t checkpoints;
+    uint64_t depends_offset;
+    uint64_t depends;
+    uint64_t state_offset;
+    uint64_t state_length;
+};
+
+struct canon_stream_record {
+    int32_t line;
+    int32_t block;
+    uint32_t size;
+    uint32_t reserved;
+};
+
+struct canon_stream_checkpoint {
+    int32_t line;
+    int32_t reserved;
+    uint64_t offset;
+    uint64_t sticky[CANON_STREAM_STICKY];	// 0 if not seen yet
+};
+
+struct canon_stream_depend {
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint32_t length;			// of the name that follows
+    uint32_t reserved;
+};
+
+static inline uint64_t record_space(uint32_t size)
+{
+    return sizeof(canon_stream_record) + ((size + 7) & ~7u);
+}
+
+// FNV-1a
+uint64_t canon_stream_hash(uint64_t h, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *) data;
+
+    if (h == 0)
+	h = 14695981039346656037ull;
+    while (len--) {
+	h ^= *p++;
+	h *= 1099511628211ull;
+    }
+    return h;
+}
+
+uint64_t canon_stream_hash_file(uint64_t h, const char *path)
+{
+    char buf[65536];
+    ssize_t n;
+    int fd;
+
+    h = canon_stream_hash(h, path, strlen(path));
+    if ((fd = ::open(path, O_RDONLY)) < 0)
+	return canon_stream_hash(h, "-", 1);
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+	h = canon_stream_hash(h, buf, n);
+    ::close(fd);
+    return h;
+}
+
+int canon_stream_sticky(int type)
+{
+    switch (type) {
+    case EMC_TRAJ_SET_G5X_TYPE:
+	return 0;
+    case EMC_TRAJ_SET_G92_TYPE:
+	return 1;
+    case EMC_TRAJ_SET_ROTATION_TYPE:
+	return 2;
+    case EMC_TRAJ_SET_OFFSET_TYPE:
+	return 3;
+    case EMC_TRAJ_SET_TERM_COND_TYPE:
+	return 4;
+    }
+    return -1;
+}
+
+CanonStreamWriter::CanonStreamWriter():fp(0), path(0), tmp_path(0),
+offset(0), records(0), since_checkpoint(0), block_line(0), error(0),
+checkpoints(0), n_checkpoints(0), max_checkpoints(0)
+{
+    memset(&key, 0, sizeof(key));
+    memset(sticky, 0, sizeof(sticky));
+}
+
+CanonStreamWriter::~CanonStreamWriter()
+{
+    abandon();
+}
+
+int CanonStreamWriter::open(const char *path_, const canon_stream_key & key_)
+{
+    canon_stream_header header;
+
+    abandon();
+    path = strdup(path_);
+    tmp_path = (char *) malloc(strlen(path_) + 5);
+    if (!path || !tmp_path) {
+	abandon();
+	return -1;
+    }
+    strcpy(tmp_path, path_);
+    strcat(tmp_path, ".tmp");
+    if ((fp = fopen(tmp_path, "w")) == 0) {
+	rcs_print_error("canon stream: can't create %s: %s\n",
+			tmp_path, strerror(errno));
+	abandon();
+	return -1;
+    }
+    // the real header goes in when the stream is complete
+    memset(&header, 0, sizeof(header));
+    if (fwrite(&header, sizeof(header), 1, fp) != 1)
+	error = 1;
+
+    key = key_;
+    offset = sizeof(header);
+    records = 0;
+    since_checkpoint = 0;
+    block_line = 0;
+    n_checkpoints = 0;
+    memset(sticky, 0, sizeof(sticky));
+    depends.clear();
+    return 0;
+}
+
+void CanonStreamWriter::depend(const char *file)
+{
+    if (!fp || !file[0])
+	return;
+    // normally the file just read from is the last one added
+    for (size_t i = depends.size(); i-- > 0;)
+	if (depends[i] == file)
+	    return;
+    depends.push_back(file);
+}
+
+int CanonStreamWriter::write_depends()
+{
+    static const char zero[8] = { 0 };
+    canon_stream_depend d;
+    struct stat st;
+
+    for (size_t i = 0; i < depends.size(); i++) {
+	if (stat(depends[i].c_str(), &st))
+	    return -1;
+	d.size = st.st_size;
+	d.mtime_sec = st.st_mtim.tv_sec;
+	d.mtime_nsec = st.st_mtim.tv_nsec;
+	d.length = depends[i].size();
+	d.reserved = 0;
+	if (fwrite(&d, sizeof(d), 1, fp) != 1
+	    || fwrite(depends[i].c_str(), d.length, 1, fp) != 1
+	    || fwrite(zero, 8 - d.length % 8, 1, fp) != 1)
+	    return -1;
+    }
+    return 0;
+}
+
+int CanonStreamWriter::add_checkpoint()
+{
+    if (n_checkpoints == max_checkpoints) {
+	uint64_t n = max_checkpoints ? 2 * max_checkpoints : 64;
+	canon_stream_checkpoint *c = (canon_stream_checkpoint *)
+	    realloc(checkpoints, n * sizeof(canon_stream_checkpoint));
+	if (!c)
+	    return -1;
+	checkpoints = c;
+	max_checkpoints = n;
+    }
+    canon_stream_checkpoint & c = checkpoints[n_checkpoints++];
+    c.line = block_line;
+    c.reserved = 0;
+    c.offset = offset;
+    memcpy(c.sticky, sticky, sizeof(sticky));
+    since_checkpoint = 0;
+    return 0;
+}
+
+void CanonStreamWriter::block(int line)
+{
+    if (!fp)
+	return;
+    block_line = line;
+    if (since_checkpoint >= CANON_STREAM_CHECKPOINT_RECORDS)
+	if (add_checkpoint())
+	    error = 1;
+}
+
+int CanonStreamWriter::append(int line, NMLmsg * msg)
+{
+    static const char zero[8] = { 0 };
+    canon_stream_record rec;
+    size_t pad;
+    int s;
+
+    if (!fp)
+	return -1;
+    rec.line = line;
+    rec.block = block_line;
+    rec.size = msg->size;
+    rec.reserved = 0;
+    pad = record_space(rec.size) - sizeof(rec) - rec.size;
+    if (fwrite(&rec, sizeof(rec), 1, fp) != 1
+	|| fwrite(msg, rec.size, 1, fp) != 1
+	|| (pad && fwrite(zero, pad, 1, fp) != 1))
+	error = 1;
+
+    if ((s = canon_stream_sticky(msg->type)) >= 0)
+	sticky[s] = offset;
+    offset += record_space(rec.size);
+    records++;
+    since_checkpoint++;
+    return error ? -1 : 0;
+}
+
+int CanonStreamWriter::close(const std::string & state)
+{
+    canon_stream_header header;
+    long state_offset;
+
+    if (!fp)
+	return -1;
+    if (n_checkpoints
+	&& fwrite(checkpoints, sizeof(canon_stream_checkpoint),
+		  n_checkpoints, fp) != n_checkpoints)
+	error = 1;
+    if (write_depends())
+	error = 1;
+    // the depends end on a multiple of 8
+    if ((state_offset = ftell(fp)) < 0
+	|| (state.size() && fwrite(state.data(), state.size(), 1, fp) != 1))
+	error = 1;
+
+    header.magic = CANON_STREAM_MAGIC;
+    header.version = CANON_STREAM_VERSION;
+    header.key = key;
+    header.records = records;
+    header.data_end = offset;
+    header.checkpoint_offset = offset;
+    header.checkpoints = n_checkpoints;
+    header.depends_offset =
+	offset + n_checkpoints * sizeof(canon_stream_checkpoint);
+    header.depends = depends.size();
+    header.state_offset = state_offset;
+    header.state_length = state.size();
+    if (fseek(fp, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, fp) != 1)
+	error = 1;
+    if (fclose(fp))
+	error = 1;
+    fp = 0;
+    if (error || rename(tmp_path, path)) {
+	rcs_print_error("canon stream: can't write %s\n", path);
+	unlink(tmp_path);
+	abandon();
+	return -1;
+    }
+    abandon();
+    return 0;
+}
+
+void CanonStreamWriter::abandon()
+{
+    if (fp) {
+	fclose(fp);
+	fp = 0;
+	unlink(tmp_path);
+    }
+    free(path);
+    free(tmp_path);
+    free(checkpoints);
+    path = tmp_path = 0;
+    checkpoints = 0;
+    n_checkpoints = max_checkpoints = 0;
+    depends.clear();
+    error = 0;
+}
+
+CanonStreamReader::CanonStreamReader():base(0), length(0), data_end(0),
+state_offset(0), state_length(0), offset(0), checkpoints(0),
+n_checkpoints(0), n_pending(0)
+{
+}
+
+CanonStreamReader::~CanonStreamReader()
+{
+    close();
+}
+
+int CanonStreamReader::open(const char *path, const canon_stream_key & key)
+{
+    const canon_stream_header *header;
+    struct stat st;
+    void *p;
+    int fd;
+
+    close();
+    if ((fd = ::open(path, O_RDONLY)) < 0)
+	return -1;
+    if (fstat(fd, &st) || st.st_size < (off_t) sizeof(canon_stream_header)) {
+	::close(fd);
+	return -1;
+    }
+    p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+	return -1;
+    base = (char *) p;
+    length = st.st_size;
+
+    header = (const canon_stream_header *) base;
+    if (header->magic != CANON_STREAM_MAGIC
+	|| header->version != CANON_STREAM_VERSION
+	|| header->key.source != key.source
+	|| header->key.setup != key.setup
+	|| header->data_end > length
+	|| header->checkpoint_offset % 8
+	|| header->checkpoint_offset > length
+	|| header->checkpoints > (length - header->checkpoint_offset)
+	/ sizeof(canon_stream_checkpoint)
+	|| header->state_offset == 0
+	|| header->state_offset > length
+	|| header->state_length > length - header->state_offset
+	|| check_depends(header->depends_offset, header->depends)) {
+	close();
+	return -1;
+    }
+    data_end = header->data_end;
+    state_offset = header->state_offset;
+    state_length = header->state_length;
+    checkpoints = (const canon_stream_checkpoint *)
+	(base + header->checkpoint_offset);
+    n_checkpoints = header->checkpoints;
+    offset = sizeof(canon_stream_header);
+    n_pending = 0;
+    madvise(base, length, MADV_SEQUENTIAL);
+    return 0;
+}
+
+int CanonStreamReader::seek(int line)
+{
+    const canon_stream_checkpoint *found = 0;
+    uint64_t i;
+    int j, k;
+
+    n_pending = 0;
+    offset = sizeof(canon_stream_header);
+    for (i = 0; i < n_checkpoints && checkpoints[i].line < line; i++)
+	found = &checkpoints[i];
+    if (!found)
+	return 0;
+
+    offset = found->offset;
+    // resend the state messages in the order they were recorded
+    for (j = 0; j < CANON_STREAM_STICKY; j++) {
+	uint64_t o = found->sticky[j];
+	if (o == 0)
+	    continue;
+	for (k = n_pending; k > 0 && pending[k - 1] > o; k--)
+	    pending[k] = pending[k - 1];
+	pending[k] = o;
+	n_pending++;
+    }
+    // hand them out from the end
+    for (j = 0; j < n_pending / 2; j++) {
+	uint64_t t = pending[j];
+	pending[j] = pending[n_pending - 1 - j];
+	pending[n_pending - 1 - j] = t;
+    }
+    return found->line;
+}
+
+// the files the recorded run read must not have changed since
+int CanonStreamReader::check_depends(uint64_t o, uint64_t count)
+{
+    const canon_stream_depend *d;
+    char file[PATH_MAX];
+    struct stat st;
+
+    while (count--) {
+	if (o % 8 || o + sizeof(canon_stream_depend) > length)
+	    return -1;
+	d = (const canon_stream_depend *) (base + o);
+	o += sizeof(canon_stream_depend);
+	if (d->length >= sizeof(file) || o + d->length > length)
+	    return -1;
+	memcpy(file, base + o, d->length);
+	file[d->length] = 0;
+	o += d->length + 8 - d->length % 8;
+	if (stat(file, &st)
+	    || st.st_size != d->size
+	    || st.st_mtim.tv_sec != d->mtime_sec
+	    || st.st_mtim.tv_nsec != d->mtime_nsec)
+	    return -1;
+    }
+    return 0;
+}
+
+NMLmsg *CanonStreamReader::record_at(uint64_t o, int *line, int *block)
+{
+    const canon_stream_record *rec;
+
+    if (o % 8 || o + sizeof(canon_stream_record) > data_end)
+	return 0;
+    rec = (const canon_stream_record *) (base + o);
+    if (rec->size < sizeof(NMLmsg)
+	|| o + record_space(rec->size) > data_end)
+	return 0;
+    *line = rec->line;
+    *block = rec->block;
+    return (NMLmsg *) (base + o + sizeof(canon_stream_record));
+}
+
+NMLmsg *CanonStreamReader::next(int *line, int *block)
+{
+    NMLmsg *msg;
+
+    if (!base)
+	return 0;
+    if (n_pending > 0)
+	return record_at(pending[--n_pending], line, block);
+    if ((msg = record_at(offset, line, block)) != 0)
+	offset += record_space(msg->size);
+    return msg;
+}
+
+const char *CanonStreamReader::state(size_t * length_) const
+{
+    if (!base)
+	return 0;
+    *length_ = state_length;
+    return base + state_offset;
+}
+
+void CanonStreamReader::close()
+{
+    if (base)
+	munmap(base, length);
+    base = 0;
+    length = 0;
+    state_offset = state_length = 0;
+    checkpoints = 0;
+    n_checkpoints = 0;
+    n_pending = 0;
+}
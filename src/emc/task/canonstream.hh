@@ -0,0 +1,132 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef CANONSTREAM_HH
+#define CANONSTREAM_HH
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/*
+  A canon stream is the sequence of NML messages the interpreter put on
+  the interp list during one complete run of a program, stored so that
+  a later run from the same starting state can feed it to the interp
+  list directly instead of interpreting the program again.
+
+  The file is a header, the records, a table of checkpoints, the list
+  of files the recorded run read and the state the interpreter was left
+  in at the end of the run.  Each record is the program line the
+  message belongs to, the line of the toplevel block that produced it,
+  and the message as it sat on the interp list.  A checkpoint marks a record at which the interpreter was
+  between toplevel blocks, together with the most recent state setting
+  messages (offsets, rotation, termination condition) before it, so that
+  run-from-line can start reading there.  The end state is put back
+  into the interpreter when a replay is done, in place of the run.
+
+  The key identifies the program and the state the run started from,
+  and the stream lists the files the interpreter read (the program and
+  any subroutine files) with their size and modification time.  A stream
+  whose key does not match or whose files changed is ignored.
+*/
+
+class NMLmsg;
+
+struct canon_stream_key {
+    uint64_t source;			// program file name
+    uint64_t setup;			// task binary, ini, parameters, tools, start state
+};
+
+#define CANON_STREAM_STICKY 5		// state messages kept in a checkpoint
+
+extern uint64_t canon_stream_hash(uint64_t h, const void *data, size_t len);
+extern uint64_t canon_stream_hash_file(uint64_t h, const char *path);
+extern int canon_stream_sticky(int type);	// index into checkpoint state, or -1
+
+class CanonStreamWriter {
+  public:
+    CanonStreamWriter();
+    ~CanonStreamWriter();
+
+    int open(const char *path, const canon_stream_key & key);
+    int active() const { return fp != 0; }
+    void block(int line);		// toplevel block about to execute
+    void depend(const char *file);	// the interpreter read from file
+    int append(int line, NMLmsg * msg);
+    // complete the stream with the interpreter's end state and move it
+    // into place
+    int close(const std::string & state);
+    void abandon();			// forget a partial stream
+
+  private:
+    int add_checkpoint();
+    int write_depends();
+
+    FILE *fp;
+    char *path;
+    char *tmp_path;
+    canon_stream_key key;
+    uint64_t offset;			// of the next record
+    uint64_t records;
+    uint64_t since_checkpoint;
+    int block_line;
+    int error;
+    uint64_t sticky[CANON_STREAM_STICKY];
+    struct canon_stream_checkpoint *checkpoints;
+    uint64_t n_checkpoints, max_checkpoints;
+    std::vector<std::string> depends;
+
+    CanonStreamWriter(const CanonStreamWriter &);	// Don't copy me.
+    CanonStreamWriter & operator =(const CanonStreamWriter &);
+};
+
+class CanonStreamReader {
+  public:
+    CanonStreamReader();
+    ~CanonStreamReader();
+
+    int open(const char *path, const canon_stream_key & key);
+    int active() const { return base != 0; }
+    // Position at the last checkpoint before the toplevel block at
+    // line.  Returns the checkpoint line, 0 for the start of the stream.
+    int seek(int line);
+    // Returns 0 at the end of the stream.  Messages point into the
+    // mapped file and stay valid until close().
+    NMLmsg *next(int *line, int *block);
+    // The interpreter's state at the end of the recorded run, valid
+    // until close().
+    const char *state(size_t * length) const;
+    void close();
+
+  private:
+    NMLmsg *record_at(uint64_t offset, int *line, int *block);
+    int check_depends(uint64_t offset, uint64_t count);
+
+    char *base;
+    size_t length;
+    uint64_t data_end;			// first byte past the records
+    uint64_t state_offset, state_length;
+    uint64_t offset;			// of the next record
+    const struct canon_stream_checkpoint *checkpoints;
+    uint64_t n_checkpoints;
+    uint64_t pending[CANON_STREAM_STICKY];	// state to send before offset
+    int n_pending;
+
+    CanonStreamReader(const CanonStreamReader &);	// Don't copy me.
+    CanonStreamReader & operator =(const CanonStreamReader &);
+};
+
+#endif
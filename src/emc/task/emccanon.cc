@@ -42,6 +42,7 @@
 #include "canon_position.hh"		// data type for a machine position
 #include "interpl.hh"		// interp_list
 #include "emcglb.h"		// TRAJ_MAX_VELOCITY
+#include "tooldata.hh"		// shared tool table
 
 //#define EMCCANON_DEBUG
 
@@ -809,6 +810,148 @@ struct pt { double x, y, z, a, b, c, u, v, w; int line_no;};
 
 static std::vector<struct pt> chained_points;
 
+/* The points in chained_points all follow canon.endPoint, and are fitted
+   as they arrive.  While fit.line is true they all lie within
+   naivecamTolerance of any line from canon.endPoint whose direction is
+   inside the cone around fit.axis with half angle fit.angle; the cone is
+   narrowed by each point, so checking a new end point costs the same no
+   matter how long the chain is.  All nine axes take part, with the
+   rotary axes scaled so that naivecamAngularTolerance degrees count as
+   naivecamTolerance mm; a point within the tolerance of a line in that
+   space is within both tolerances on its own.  When a point leaves the
+   cone, the chain may continue as an arc in the XY plane around
+   (fit.cx, fit.cy). */
+#define MAX_ARC_POINTS 200
+
+static struct {
+    bool line;			// chain is a line, otherwise an arc
+    double axis[9];		// unit direction in the middle of the cone
+    double angle;		// half angle of the cone, < 0 if unconstrained
+    double reach;		// distance of the furthest point so far
+    double cx, cy;		// center of the arc
+    int rotation;		// 1 counterclockwise, -1 clockwise
+    bool emitting;		// flush_segments is inside ARC_FEED
+} fit = { true, {0}, -1, 0, 0, 0, 0, false };
+
+static void fit_reset(void) {
+    fit.line = true;
+    fit.angle = -1;
+    fit.reach = 0;
+}
+
+static double fit_delta(const struct pt &p, double d[9]) {
+    double k = canon.naivecamAngularTolerance ?
+        canon.naivecamTolerance / canon.naivecamAngularTolerance : 1;
+    d[0] = p.x - canon.endPoint.x;
+    d[1] = p.y - canon.endPoint.y;
+    d[2] = p.z - canon.endPoint.z;
+    d[3] = (p.a - canon.endPoint.a) * k;
+    d[4] = (p.b - canon.endPoint.b) * k;
+    d[5] = (p.c - canon.endPoint.c) * k;
+    d[6] = p.u - canon.endPoint.u;
+    d[7] = p.v - canon.endPoint.v;
+    d[8] = p.w - canon.endPoint.w;
+    double len = 0;
+    for(int i = 0; i < 9; i++) len += d[i] * d[i];
+    return sqrt(len);
+}
+
+static double fit_cos(const double *a, const double *b, double len) {
+    double dot = 0;
+    for(int i = 0; i < 9; i++) dot += a[i] * b[i];
+    dot /= len;
+    if(dot > 1) return 1;
+    if(dot < -1) return -1;
+    return dot;
+}
+
+// narrow the cone to the directions that pass within tolerance of p
+static void fit_add_line(const struct pt &p) {
+    double d[9];
+    double len = fit_delta(p, d);
+    if(len > fit.reach) fit.reach = len;
+    if(len <= canon.naivecamTolerance) return;
+
+    double theta = asin(canon.naivecamTolerance / len);
+    if(fit.angle < 0) {
+        for(int i = 0; i < 9; i++) fit.axis[i] = d[i] / len;
+        fit.angle = theta;
+        return;
+    }
+    double phi = acos(fit_cos(d, fit.axis, len));
+    if(phi + theta <= fit.angle) {
+        // new cone is inside the old one
+        for(int i = 0; i < 9; i++) fit.axis[i] = d[i] / len;
+        fit.angle = theta;
+    } else if(phi + fit.angle > theta) {
+        // take the largest cone inside both: it is centered on the arc
+        // between the two axes, where the cones overlap
+        double m = (phi + fit.angle - theta) / 2, wlen = 0, w[9];
+        for(int i = 0; i < 9; i++) {
+            w[i] = d[i] / len - cos(phi) * fit.axis[i];
+            wlen += w[i] * w[i];
+        }
+        wlen = sqrt(wlen);
+        for(int i = 0; i < 9; i++)
+            fit.axis[i] = cos(m) * fit.axis[i] + sin(m) * w[i] / wlen;
+        fit.angle = (fit.angle + theta - phi) / 2;
+    }
+}
+
+static bool line_linkable(const struct pt &p) {
+    double d[9];
+    double len = fit_delta(p, d);
+    if(len == 0) return false;
+    // every point so far must project onto the new line
+    if(len < fit.reach) return false;
+    if(fit.angle < 0) return true;
+    return acos(fit_cos(d, fit.axis, len)) <= fit.angle;
+}
+
+// all points and the chords between them within tolerance of an XY arc
+static bool arc_linkable(const struct pt &p) {
+    if(canon.activePlane != CANON_PLANE_XY) return false;
+    if(chained_points.size() >= MAX_ARC_POINTS) return false;
+
+    double sx = canon.endPoint.x, sy = canon.endPoint.y;
+    const struct pt &m = chained_points[chained_points.size() / 2];
+    double ax = m.x - sx, ay = m.y - sy, bx = p.x - sx, by = p.y - sy;
+    double den = 2 * (ax * by - ay * bx);
+    if(fabs(den) < 1e-12) return false;
+    double a2 = ax * ax + ay * ay, b2 = bx * bx + by * by;
+    double cx = sx + (by * a2 - ay * b2) / den;
+    double cy = sy + (ax * b2 - bx * a2) / den;
+    double r = hypot(sx - cx, sy - cy);
+    int rotation = den > 0 ? 1 : -1;
+
+    double tol = canon.naivecamTolerance;
+    double prev = atan2(sy - cy, sx - cx), total = 0;
+    for(unsigned int i = 0; i <= chained_points.size(); i++) {
+        const struct pt &q =
+            i < chained_points.size() ? chained_points[i] : p;
+        if(q.z != canon.endPoint.z
+                || q.a != canon.endPoint.a || q.b != canon.endPoint.b
+                || q.c != canon.endPoint.c || q.u != canon.endPoint.u
+                || q.v != canon.endPoint.v || q.w != canon.endPoint.w)
+            return false;
+        if(fabs(hypot(q.x - cx, q.y - cy) - r) > tol) return false;
+        double th = atan2(q.y - cy, q.x - cx);
+        double dth = (th - prev) * rotation;
+        while(dth <= 0) dth += 2 * M_PI;
+        while(dth > 2 * M_PI) dth -= 2 * M_PI;
+        if(dth >= M_PI) return false;
+        if(r * (1 - cos(dth / 2)) > tol) return false;
+        total += dth;
+        prev = th;
+    }
+    if(total >= 2 * M_PI) return false;
+
+    fit.cx = cx;
+    fit.cy = cy;
+    fit.rotation = rotation;
+    return true;
+}
+
 static void flush_segments(void) {
     if(chained_points.empty()) return;
 
@@ -821,10 +964,27 @@ static void flush_segments(void) {
     int line_no = pos.line_no;
 
 #ifdef SHOW_JOINED_SEGMENTS
-    for(unsigned int i=0; i != chained_points.size(); i++) { printf("."); }
+    for(unsigned int i=0; i != chained_points.size(); i++) { printf(fit.line ? "." : ")"); }
     printf("\n");
 #endif
 
+    if(!fit.line) {
+        CANON_POSITION end(x, y, z, a, b, c, u, v, w);
+        CANON_POSITION center(fit.cx, fit.cy, z, a, b, c, u, v, w);
+        end = unoffset_and_unrotate_pos(end);
+        center = unoffset_and_unrotate_pos(center);
+        to_prog(end);
+        to_prog(center);
+
+        chained_points.clear();
+        fit_reset();
+        fit.emitting = true;
+        ARC_FEED(line_no, end.x, end.y, center.x, center.y, fit.rotation,
+                 end.z, end.a, end.b, end.c, end.u, end.v, end.w);
+        fit.emitting = false;
+        return;
+    }
+
     VelData linedata = getStraightVelocity(x, y, z, a, b, c, u, v, w);
     double vel = linedata.vel;
 
@@ -875,6 +1035,7 @@ static void flush_segments(void) {
     canonUpdateEndPoint(x, y, z, a, b, c, u, v, w);
 
     chained_points.clear();
+    fit_reset();
 }
 
 static void get_last_pos(double &lx, double &ly, double &lz) {
@@ -891,39 +1052,17 @@ static void get_last_pos(double &lx, double &ly, double &lz) {
 }
 
 static bool
-linkable(double x, double y, double z, 
-         double a, double b, double c, 
-         double u, double v, double w) {
-    struct pt &pos = chained_points.back();
-    if(canon.motionMode != CANON_CONTINUOUS || canon.naivecamTolerance == 0)
+linkable(const struct pt &pos) {
+    if(canon.motionMode != CANON_CONTINUOUS || canon.naivecamTolerance == 0
+            || canon.naivecamAngularTolerance == 0)
         return false;
-    //FIXME make this length controlled elsewhere?
-    if(chained_points.size() > 100) return false;
-
-    //If ABCUVW motion, then the tangent calculation fails?
-    // TODO is there a fundamental reason that we can't handle 9D motion here?
-    if(a != pos.a) return false;
-    if(b != pos.b) return false;
-    if(c != pos.c) return false;
-    if(u != pos.u) return false;
-    if(v != pos.v) return false;
-    if(w != pos.w) return false;
-
-    if(x==canon.endPoint.x && y==canon.endPoint.y && z==canon.endPoint.z) return false;
-    
-    for(std::vector<struct pt>::iterator it = chained_points.begin();
-            it != chained_points.end(); it++) {
-        PM_CARTESIAN M(x-canon.endPoint.x, y-canon.endPoint.y, z-canon.endPoint.z),
-                     B(canon.endPoint.x, canon.endPoint.y, canon.endPoint.z),
-                     P(it->x, it->y, it->z);
-        double t0 = dot(M, P-B) / dot(M, M);
-        if(t0 < 0) t0 = 0;
-        if(t0 > 1) t0 = 1;
-
-        double D = mag(P - (B + t0 * M));
-        if(D > canon.naivecamTolerance) return false;
+
+    if(fit.line && line_linkable(pos)) return true;
+    if(arc_linkable(pos)) {
+        fit.line = false;
+        return true;
     }
-    return true;
+    return false;
 }
 
 static void
@@ -931,22 +1070,12 @@ see_segment(int line_number,
 	    double x, double y, double z, 
             double a, double b, double c,
             double u, double v, double w) {
-    bool changed_abc = (a != canon.endPoint.a)
-        || (b != canon.endPoint.b)
-        || (c != canon.endPoint.c);
-
-    bool changed_uvw = (u != canon.endPoint.u)
-        || (v != canon.endPoint.v)
-        || (w != canon.endPoint.w);
-
-    if(!chained_points.empty() && !linkable(x, y, z, a, b, c, u, v, w)) {
-        flush_segments();
-    }
     pt pos = {x, y, z, a, b, c, u, v, w, line_number};
-    chained_points.push_back(pos);
-    if(changed_abc || changed_uvw) {
+    if(!chained_points.empty() && !linkable(pos)) {
         flush_segments();
     }
+    chained_points.push_back(pos);
+    if(fit.line) fit_add_line(pos);
 }
 
 void FINISH() {
@@ -1138,6 +1267,7 @@ void SET_MOTION_CONTROL_MODE(CANON_MOTION_MODE mode, double tolerance)
 void SET_NAIVECAM_TOLERANCE(double tolerance)
 {
     canon.naivecamTolerance =  FROM_PROG_LEN(tolerance);
+    canon.naivecamAngularTolerance =  FROM_PROG_ANG(tolerance);
 }
 
 void SELECT_PLANE(CANON_PLANE in_plane)
@@ -1211,66 +1341,108 @@ static double chord_deviation(double sx, double sy, double ex, double ey, double
 
 /* Spline and NURBS additional functions; */
 
-static double max(double a, double b) {
-    if(a < b) return b;
-    return a;
-}
-static void unit(double *x, double *y) {
-    double h = hypot(*x, *y);
-    if(h != 0) { *x/=h; *y/=h; }
-}
+/* Largest distance a fitted cubic may stray from a NURBS curve, in mm */
+#define NURBS_FIT_TOLERANCE 0.001
+#define NURBS_FIT_MAX_DEPTH 12
 
-static void
-arc(int lineno, double x0, double y0, double x1, double y1, double dx, double dy) {
-    double small = 0.000001;
-    double x = x1-x0, y=y1-y0;
-    double den = 2 * (y*dx - x*dy);
+/* Queue a cubic Bezier in the XY plane from the current position. The
+   control points are in program units; the other axes stay put. */
+static void spline_feed(int lineno, double x1, double y1, double x2, double y2,
+                        double x, double y) {
     CANON_POSITION p = unoffset_and_unrotate_pos(canon.endPoint);
     to_prog(p);
-    if (fabs(den) > small) {
-        double r = -(x*x+y*y)/den;
-        double i = dy*r, j = -dx*r;
-        double cx = x0+i, cy=y0+j;
-        ARC_FEED(lineno, x1, y1, cx, cy, r<0 ? 1 : -1,
-                 p.z, p.a, p.b, p.c, p.u, p.v, p.w);
-    } else { 
-        STRAIGHT_FEED(lineno, x1, y1, p.z, p.a, p.b, p.c, p.u, p.v, p.w);
-    }
-}
 
-static int
-biarc(int lineno, double p0x, double p0y, double tsx, double tsy,
-      double p4x, double p4y, double tex, double tey, double r=1.0) {
-    unit(&tsx, &tsy);
-    unit(&tex, &tey);
+    double z = p.z, a = p.a, b = p.b, c = p.c, u = p.u, v = p.v, w = p.w;
+    double z1 = p.z, z2 = p.z;
+    double unused = 0;
+
+    from_prog(x, y, z, a, b, c, u, v, w);
+    rotate_and_offset_pos(x, y, z, a, b, c, u, v, w);
+    from_prog(x1, y1, z1, unused, unused, unused, unused, unused, unused);
+    rotate_and_offset_pos(x1, y1, z1, unused, unused, unused, unused, unused, unused);
+    from_prog(x2, y2, z2, unused, unused, unused, unused, unused, unused);
+    rotate_and_offset_pos(x2, y2, z2, unused, unused, unused, unused, unused, unused);
+
+    // The tangent can point anywhere in the plane, so take the slower of
+    // the two axes. The planner lowers this further for curvature.
+    double v_max = MIN(FROM_EXT_LEN(emcAxisGetMaxVelocity(0)),
+                       FROM_EXT_LEN(emcAxisGetMaxVelocity(1)));
+    double a_max = MIN(FROM_EXT_LEN(emcAxisGetMaxAcceleration(0)),
+                       FROM_EXT_LEN(emcAxisGetMaxAcceleration(1)));
+    // Like STRAIGHT_FEED: in G93 the interpreter has already set the
+    // rate that makes the whole curve take 1/F minutes, in G95 it is the
+    // rate per revolution and motion follows the spindle.
+    double vel = MIN(canon.linearFeedRate, v_max);
 
-    double vx = p0x - p4x, vy = p0y - p4y;
-    double c = vx*vx + vy*vy;
-    double b = 2 * (vx * (r*tsx + tex) + vy * (r*tsy + tey));
-    double a = 2 * r * (tsx * tex + tsy * tey - 1);
+    EMC_TRAJ_SPLINE_MOVE splineMoveMsg;
+    splineMoveMsg.end = to_ext_pose(x, y, z, a, b, c, u, v, w);
+    splineMoveMsg.ctrl1 = to_ext_len(PM_CARTESIAN(x1, y1, z1));
+    splineMoveMsg.ctrl2 = to_ext_len(PM_CARTESIAN(x2, y2, z2));
+    splineMoveMsg.type = EMC_MOTION_TYPE_ARC;
+    splineMoveMsg.feed_mode = canon.feed_mode;
+    splineMoveMsg.vel = toExtVel(vel);
+    splineMoveMsg.ini_maxvel = toExtVel(v_max);
+    splineMoveMsg.acc = toExtAcc(a_max);
 
-    double discr = b*b - 4*a*c;
-    if(discr < 0) return 0;
+    canon.cartesian_move = 1;
+    if((vel && a_max) || canon.synched) {
+        interp_list.set_line_number(lineno);
+        interp_list.append(splineMoveMsg);
+    }
+    canonUpdateEndPoint(x, y, z, a, b, c, u, v, w);
+}
 
-    double disq = sqrt(discr);
-    double beta1 = (-b-disq) / 2 / a;
-    double beta2 = (-b+disq) / 2 / a;
+struct nurbs_curve {
+    const std::vector<CONTROL_POINT> &cp;
+    const std::vector<unsigned int> &knots;
+    unsigned int k;
+    double umax;
+    double tol;
 
-    if(beta1 > 0 && beta2 > 0)
-      return 0;
-    double beta = max(beta1, beta2);
-    double alpha = beta * r;
-    double ab = alpha + beta;
-    double p1x = p0x + alpha * tsx, p1y = p0y + alpha * tsy,
-         p3x = p4x - beta * tex, p3y = p4y - beta * tey,
-         p2x = (p1x*beta + p3x*alpha) / ab,
-         p2y = (p1y*beta + p3y*alpha) / ab;
-    double tmx = p3x-p2x, tmy = p3y-p2y;
-    unit(&tmx, &tmy);
+    PLANE_POINT point(double u) const {
+        return nurbs_point(u, k, cp, knots);
+    }
 
-    arc(lineno, p0x, p0y, p2x, p2y, tsx, tsy);
-    arc(lineno, p2x, p2y, p4x, p4y, tmx, tmy);
-    return 1;
+    // parametric derivative, by finite differences clipped to the curve
+    PLANE_POINT deriv(double u) const {
+        double h = 1e-5 * umax;
+        double u0 = fmax(u - h, 0), u1 = fmin(u + h, umax);
+        PLANE_POINT p0 = point(u0), p1 = point(u1), d;
+        d.X = (p1.X - p0.X) / (u1 - u0);
+        d.Y = (p1.Y - p0.Y) / (u1 - u0);
+        return d;
+    }
+};
+
+/* Fit the NURBS between u0 and u1 with a cubic that matches position and
+   derivative at both ends, splitting the interval until it stays within
+   tolerance of the curve. */
+static void nurbs_fit(int lineno, const nurbs_curve &curve,
+                      double u0, const PLANE_POINT &p0, const PLANE_POINT &d0,
+                      double u1, const PLANE_POINT &p3, const PLANE_POINT &d3,
+                      int depth) {
+    double du = (u1 - u0) / 3;
+    double x1 = p0.X + d0.X * du, y1 = p0.Y + d0.Y * du;
+    double x2 = p3.X - d3.X * du, y2 = p3.Y - d3.Y * du;
+
+    if(depth < NURBS_FIT_MAX_DEPTH) {
+        double err = 0;
+        for(int i = 1; i < 4; i++) {
+            double t = i / 4.0, s = 1 - t;
+            double bx = s*s*s*p0.X + 3*s*s*t*x1 + 3*s*t*t*x2 + t*t*t*p3.X;
+            double by = s*s*s*p0.Y + 3*s*s*t*y1 + 3*s*t*t*y2 + t*t*t*p3.Y;
+            PLANE_POINT q = curve.point(u0 + t * (u1 - u0));
+            err = fmax(err, hypot(bx - q.X, by - q.Y));
+        }
+        if(err > curve.tol) {
+            double um = (u0 + u1) / 2;
+            PLANE_POINT pm = curve.point(um), dm = curve.deriv(um);
+            nurbs_fit(lineno, curve, u0, p0, d0, um, pm, dm, depth + 1);
+            nurbs_fit(lineno, curve, um, pm, dm, u1, p3, d3, depth + 1);
+            return;
+        }
+    }
+    spline_feed(lineno, x1, y1, x2, y2, p3.X, p3.Y);
 }
 
 
@@ -1280,23 +1452,46 @@ void NURBS_FEED(int lineno, std::vector<CONTROL_POINT> nurbs_control_points, uns
     flush_segments();
 
     unsigned int n = nurbs_control_points.size() - 1;
+
+    bool rational = false;
+    for(unsigned int i=0; i<=n; i++)
+        if(nurbs_control_points[i].W != 1) rational = true;
+
+    // A single polynomial piece (G5, G5.1) is already a Bezier curve
+    if(!rational && n + 1 == k && k == 4) {
+        spline_feed(lineno,
+                nurbs_control_points[1].X, nurbs_control_points[1].Y,
+                nurbs_control_points[2].X, nurbs_control_points[2].Y,
+                nurbs_control_points[3].X, nurbs_control_points[3].Y);
+        return;
+    }
+    if(!rational && n + 1 == k && k == 3) {
+        // raise the quadratic to a cubic
+        const CONTROL_POINT &q0 = nurbs_control_points[0],
+              &q1 = nurbs_control_points[1], &q2 = nurbs_control_points[2];
+        spline_feed(lineno,
+                q0.X + 2 * (q1.X - q0.X) / 3, q0.Y + 2 * (q1.Y - q0.Y) / 3,
+                q2.X + 2 * (q1.X - q2.X) / 3, q2.Y + 2 * (q1.Y - q2.Y) / 3,
+                q2.X, q2.Y);
+        return;
+    }
+
     double umax = n - k + 2;
-    unsigned int div = nurbs_control_points.size()*4;
-    std::vector<unsigned int> knot_vector = knot_vector_creator(n, k);	
-    PLANE_POINT P0, P0T, P1, P1T;
-
-    P0 = nurbs_point(0,k,nurbs_control_points,knot_vector);
-    P0T = nurbs_tangent(0, k, nurbs_control_points, knot_vector);
-
-    for(unsigned int i=1; i<=div; i++) {
-	double u = umax * i / div;
-        P1 = nurbs_point(u,k,nurbs_control_points,knot_vector);
-	P1T = nurbs_tangent(u,k,nurbs_control_points,knot_vector);
-        biarc(lineno, P0.X,P0.Y, P0T.X,P0T.Y, P1.X,P1.Y, P1T.X,P1T.Y);
+    std::vector<unsigned int> knot_vector = knot_vector_creator(n, k);
+    nurbs_curve curve = { nurbs_control_points, knot_vector, k, umax,
+                          TO_PROG_LEN(NURBS_FIT_TOLERANCE) };
+
+    // one cubic per knot span to start with, split further as needed
+    double u0 = 0;
+    PLANE_POINT P0 = curve.point(u0), D0 = curve.deriv(u0);
+    for(unsigned int i=1; i<=umax; i++) {
+        double u1 = i;
+        PLANE_POINT P1 = curve.point(u1), D1 = curve.deriv(u1);
+        nurbs_fit(lineno, curve, u0, P0, D0, u1, P1, D1, 0);
+        u0 = u1;
         P0 = P1;
-        P0T = P1T;
+        D0 = D1;
     }
-    knot_vector.clear();
 }
 
 
@@ -1410,7 +1605,7 @@ void ARC_FEED(int line_number,
     canon_debug("line = %d\n", line_number);
     canon_debug("first_end = %f, second_end = %f\n", first_end,second_end);
 
-    if( canon.activePlane == CANON_PLANE_XY && canon.motionMode == CANON_CONTINUOUS) {
+    if( !fit.emitting && canon.activePlane == CANON_PLANE_XY && canon.motionMode == CANON_CONTINUOUS) {
         double mx, my;
         double lx, ly, lz;
         double unused;
@@ -2515,6 +2710,17 @@ void CANON_ERROR(const char *fmt, ...)
     interp_list.append(operator_error_msg);
 }
 
+static ToolData *canon_tooldata()
+{
+    static ToolData *tooldata = 0;
+
+    // attach on first use, and until the writer has set it up
+    if (tooldata == 0)
+	tooldata = new ToolData(0);
+    tooldata->attach();
+    return tooldata;
+}
+
 /*
   GET_EXTERNAL_TOOL_TABLE(int pocket)
 
@@ -2528,15 +2734,14 @@ CANON_TOOL_TABLE GET_EXTERNAL_TOOL_TABLE(int pocket)
 {
     CANON_TOOL_TABLE retval;
 
-    if (pocket < 0 || pocket >= CANON_POCKETS_MAX) {
+    if (pocket < 0 || pocket >= CANON_POCKETS_MAX
+	|| canon_tooldata()->get(pocket, retval) != 0) {
 	retval.toolno = -1;
         ZERO_EMC_POSE(retval.offset);
         retval.frontangle = 0.0;
         retval.backangle = 0.0;
 	retval.diameter = 0.0;
         retval.orientation = 0;
-    } else {
-	retval = emcStatus->io.tool.toolTable[pocket];
     }
 
     return retval;
@@ -2700,9 +2905,10 @@ CANON_DIRECTION GET_EXTERNAL_SPINDLE()
     return CANON_COUNTERCLOCKWISE;
 }
 
+// Only the pockets in use, so a small table loads as fast as it used to
 int GET_EXTERNAL_POCKETS_MAX()
 {
-    return CANON_POCKETS_MAX;
+    return canon_tooldata()->pockets();
 }
 
 char _parameter_file_name[LINELEN];	/* Not static.Driver
@@ -2879,16 +3085,12 @@ int GET_EXTERNAL_QUEUE_EMPTY(void)
 // tool in the spindle.
 int GET_EXTERNAL_TOOL_SLOT()
 {
-    int toolno = emcStatus->io.tool.toolInSpindle;
-    int pocket;
+    int pocket = canon_tooldata()->find(emcStatus->io.tool.toolInSpindle);
 
-    for (pocket = 1; pocket < CANON_POCKETS_MAX; pocket++) {
-        if (emcStatus->io.tool.toolTable[pocket].toolno == toolno) {
-            return pocket;
-        }
+    if (pocket < 0) {
+        return 0;  // no tool in spindle
     }
-
-    return 0;  // no tool in spindle
+    return pocket;
 }
 
 // If the tool changer has prepped a pocket (after a Txxx command) and is
@@ -566,6 +566,46 @@ int emcTaskPlanRead()
     return retval;
 }
 
+int emcTaskPlanRestoreCheckpoint(int line)
+{
+    int retval = interp.restore_checkpoint(line);
+
+    if (emc_debug & EMC_DEBUG_INTERP) {
+        rcs_print("emcTaskPlanRestoreCheckpoint(%d) returned %d\n", line, retval);
+    }
+
+    return retval;
+}
+
+int emcTaskPlanRuntimeReads()
+{
+    return interp.runtime_reads();
+}
+
+unsigned long long emcTaskPlanParameterDigest()
+{
+    return interp.parameter_digest();
+}
+
+int emcTaskPlanSaveState(std::string &state)
+{
+    return interp.save_state(state);
+}
+
+int emcTaskPlanRestoreState(const char *state, size_t length)
+{
+    int retval = interp.restore_state(state, length);
+
+    if (retval > INTERP_MIN_ERROR) {
+	print_interp_error(retval);
+    }
+    if (emc_debug & EMC_DEBUG_INTERP) {
+        rcs_print("emcTaskPlanRestoreState() returned %d\n", retval);
+    }
+
+    return retval;
+}
+
 int emcTaskPlanExecute(const char *command)
 {
     int inpos = emcStatus->motion.traj.inpos;	// 1 if in position, 0 if not.
@@ -651,6 +691,14 @@ int emcTaskPlanLevel()
     return retval;
 }
 
+int emcTaskPlanFile(char *file)
+{
+    char buf[LINELEN];
+
+    strcpy(file, interp.file(buf, LINELEN));
+    return 0;
+}
+
 int emcTaskPlanCommand(char *cmd)
 {
     char buf[LINELEN];
@@ -708,6 +756,7 @@ int emcTaskUpdate(EMC_TASK_STAT * stat)
 
 int emcAbortCleanup(int reason, const char *message)
 {
+    emcTaskCanonStreamStop();
     emcTaskPlanSynch();
 
     int status = interp.on_abort(reason,message);
@@ -56,6 +56,9 @@
 #include <unistd.h>		// fork()
 #include <sys/wait.h>		// waitpid(), WNOHANG, WIFEXITED
 #include <ctype.h>		// isspace()
+#include <math.h>		// llround()
+#include <limits.h>		// PATH_MAX
+#include <sys/stat.h>		// stat()
 #include <libintl.h>
 #include <locale.h>
 #include "usrmotintf.h"
@@ -83,6 +86,8 @@ fpu_control_t __fpu_control = _FPU_IEEE & ~(_FPU_MASK_IM | _FPU_MASK_ZM | _FPU_M
 #include "taskclass.hh"
 #include "motion.h"             // EMCMOT_ORIENT_*
 #include "inihal.hh"
+#include "canonstream.hh"
+#include "tooldata.hh"
 
 static emcmot_config_t emcmotConfig;
 
@@ -384,6 +389,7 @@ static EMC_TRAJ_SET_VELOCITY *emcTrajSetVelocityMsg;
 static EMC_TRAJ_SET_ACCELERATION *emcTrajSetAccelerationMsg;
 static EMC_TRAJ_LINEAR_MOVE *emcTrajLinearMoveMsg;
 static EMC_TRAJ_CIRCULAR_MOVE *emcTrajCircularMoveMsg;
+static EMC_TRAJ_SPLINE_MOVE *emcTrajSplineMoveMsg;
 static EMC_TRAJ_DELAY *emcTrajDelayMsg;
 static EMC_TRAJ_SET_TERM_COND *emcTrajSetTermCondMsg;
 static EMC_TRAJ_SET_SPINDLESYNC *emcTrajSetSpindlesyncMsg;
@@ -420,6 +426,13 @@ static EMC_TASK_PLAN_SYNCH taskPlanSynchCmd;
 
 static int interpResumeState = EMC_TASK_INTERP_IDLE;
 static int programStartLine = 0;	// which line to run program from
+
+// canon streams, see canonstream.hh; enabled by [TASK]CANON_CACHE_DIR
+static char canon_cache_dir[LINELEN];
+static CanonStreamWriter canon_record;
+static CanonStreamReader canon_replay;
+static int canon_replaying = 0;
+static char canon_replay_path[PATH_MAX + LINELEN];
 // how long the interp list can be
 
 int stepping = 0;
@@ -475,6 +488,9 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
 	case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
 	    break;
 
+	case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	    break;
+
 	default:
 	    break;
 	}
@@ -489,11 +505,243 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
 }
 extern int emcTaskMopup();
 
+void emcTaskCanonStreamStop()
+{
+    interp_list.set_tap(NULL);
+    canon_record.abandon();
+    canon_replay.close();
+    canon_replaying = 0;
+}
+
+static void canon_record_tap(int line_number, NMLmsg * msg)
+{
+    if (canon_record.append(line_number, msg) != 0) {
+	emcTaskCanonStreamStop();
+    }
+}
+
+// Everything besides the program that the interpreter output depends
+// on: the task binary, ini, parameter file, tool table, the numbered and
+// named parameters in the interpreter, the modal state left by the
+// previous run, and where the machine is.
+static uint64_t canon_stream_setup(void)
+{
+    static ToolData *tooldata = 0;
+    char file[LINELEN];
+    struct stat st;
+    uint64_t h = 0;
+    unsigned long long params;
+    long long pos[9];
+
+    if (stat("/proc/self/exe", &st) == 0) {
+	h = canon_stream_hash(h, &st.st_ino, sizeof(st.st_ino));
+	h = canon_stream_hash(h, &st.st_size, sizeof(st.st_size));
+	h = canon_stream_hash(h, &st.st_mtime, sizeof(st.st_mtime));
+    }
+    h = canon_stream_hash_file(h, emc_inifile);
+    GET_EXTERNAL_PARAMETER_FILE_NAME(file, LINELEN - 1);
+    h = canon_stream_hash_file(h, file[0] ? file :
+			       RS274NGC_PARAMETER_FILE_NAME_DEFAULT);
+    params = emcTaskPlanParameterDigest();
+    h = canon_stream_hash(h, &params, sizeof(params));
+
+    if (tooldata == 0)
+	tooldata = new ToolData(0);
+    tooldata->attach();
+    for (int p = 0; p < tooldata->pockets(); p++) {
+	CANON_TOOL_TABLE tool;
+	if (tooldata->get(p, tool) != 0)
+	    continue;
+	h = canon_stream_hash(h, &tool.toolno, sizeof(tool.toolno));
+	h = canon_stream_hash(h, &tool.offset, sizeof(tool.offset));
+	h = canon_stream_hash(h, &tool.diameter, sizeof(tool.diameter));
+	h = canon_stream_hash(h, &tool.frontangle, sizeof(tool.frontangle));
+	h = canon_stream_hash(h, &tool.backangle, sizeof(tool.backangle));
+	h = canon_stream_hash(h, &tool.orientation, sizeof(tool.orientation));
+    }
+    h = canon_stream_hash(h, &emcStatus->io.tool.toolInSpindle,
+			  sizeof(emcStatus->io.tool.toolInSpindle));
+
+    // element 0 of the active codes and settings is the sequence number
+    EMC_TASK_STAT & task = emcStatus->task;
+    h = canon_stream_hash(h, &task.activeGCodes[1],
+			  sizeof(task.activeGCodes) - sizeof(task.activeGCodes[0]));
+    h = canon_stream_hash(h, &task.activeMCodes[1],
+			  sizeof(task.activeMCodes) - sizeof(task.activeMCodes[0]));
+    h = canon_stream_hash(h, &task.activeSettings[1],
+			  sizeof(task.activeSettings) - sizeof(task.activeSettings[0]));
+    h = canon_stream_hash(h, &task.g5x_offset, sizeof(task.g5x_offset));
+    h = canon_stream_hash(h, &task.g5x_index, sizeof(task.g5x_index));
+    h = canon_stream_hash(h, &task.g92_offset, sizeof(task.g92_offset));
+    h = canon_stream_hash(h, &task.rotation_xy, sizeof(task.rotation_xy));
+    h = canon_stream_hash(h, &task.toolOffset, sizeof(task.toolOffset));
+    h = canon_stream_hash(h, &task.programUnits, sizeof(task.programUnits));
+
+    EmcPose & p = emcStatus->motion.traj.position;
+    pos[0] = llround(p.tran.x * 1e6);
+    pos[1] = llround(p.tran.y * 1e6);
+    pos[2] = llround(p.tran.z * 1e6);
+    pos[3] = llround(p.a * 1e6);
+    pos[4] = llround(p.b * 1e6);
+    pos[5] = llround(p.c * 1e6);
+    pos[6] = llround(p.u * 1e6);
+    pos[7] = llround(p.v * 1e6);
+    pos[8] = llround(p.w * 1e6);
+    return canon_stream_hash(h, pos, sizeof(pos));
+}
+
+// Called when a program run starts.  Replays the stream recorded for
+// the program if there is a valid one, otherwise records a stream if
+// the program runs from the top.
+static void canon_stream_start(int start_line)
+{
+    char file[PATH_MAX], path[PATH_MAX + LINELEN];
+    canon_stream_key key;
+
+    emcTaskCanonStreamStop();
+    if (canon_cache_dir[0] == 0 || start_line < 0 ||
+	emcTaskPlanLevel() != 0 ||
+	realpath(emcStatus->task.file, file) == NULL) {
+	return;
+    }
+    key.source = canon_stream_hash(0, file, strlen(file));
+    key.setup = canon_stream_setup();
+    snprintf(path, sizeof(path), "%s/%016llx.ngcs", canon_cache_dir,
+	     (unsigned long long) key.source);
+
+    if (canon_replay.open(path, key) == 0) {
+	int line = canon_replay.seek(start_line);
+	canon_replaying = 1;
+	strcpy(canon_replay_path, path);
+	if (emc_debug & EMC_DEBUG_INTERP) {
+	    rcs_print("replaying %s from line %d for %s\n", path, line, file);
+	}
+    } else if (start_line == 0 && canon_record.open(path, key) == 0) {
+	canon_record.depend(file);
+	interp_list.set_tap(canon_record_tap);
+    }
+}
+
+// Only a run that reaches M2 or M30 without ever waiting for the
+// machine (probing, inputs, queue busters) and without reading HAL
+// pins, system parameters, remaps or Python is kept.
+static void canon_record_executed(int execRetval)
+{
+    if (execRetval == INTERP_OK) {
+	return;
+    }
+    if (execRetval == INTERP_EXIT && !emcTaskPlanRuntimeReads()) {
+	std::string state;
+	interp_list.set_tap(NULL);
+	if (emcTaskPlanSaveState(state) == INTERP_OK) {
+	    canon_record.close(state);
+	} else {
+	    canon_record.abandon();
+	}
+	return;
+    }
+    emcTaskCanonStreamStop();
+}
+
+// The interpreter did not run the program: put back the state the
+// recorded run left it in, so that parameters, G10/G92 offsets and
+// modes are as if it had.  Its canon output was replayed already.
+static void canon_replay_finish(void)
+{
+    const char *state;
+    size_t length = 0;
+
+    state = canon_replay.state(&length);
+    if (emcTaskPlanRestoreState(state, length) != INTERP_OK) {
+	emcOperatorError(0, "canon stream %s can't be used, removed it",
+			 canon_replay_path);
+	unlink(canon_replay_path);
+    }
+    // the canon calls restoring the modal state are not run, the stream
+    // had the recorded ones
+    interp_list.clear();
+    emcTaskCanonStreamStop();
+    emcTaskPlanClose();
+    CANON_UPDATE_END_POINT(emcStatus->motion.traj.position.tran.x,
+			   emcStatus->motion.traj.position.tran.y,
+			   emcStatus->motion.traj.position.tran.z,
+			   emcStatus->motion.traj.position.a,
+			   emcStatus->motion.traj.position.b,
+			   emcStatus->motion.traj.position.c,
+			   emcStatus->motion.traj.position.u,
+			   emcStatus->motion.traj.position.v,
+			   emcStatus->motion.traj.position.w);
+    emcTaskQueueCommand(&taskPlanSynchCmd);
+}
+
+// Feed the interp list from a canon stream.  Ahead of the start line
+// only state messages go through, the rest is skipped like the
+// interpreter's output is during run-from-line.
+static void readahead_replay(void)
+{
+    NMLmsg *msg;
+    int line, block;
+
+    while (interp_list.len() <= emc_task_interp_max_len) {
+	if ((msg = canon_replay.next(&line, &block)) == 0) {
+	    emcStatus->task.interpState = EMC_TASK_INTERP_WAITING;
+	    return;
+	}
+	if (programStartLine > 0) {
+	    if (block < programStartLine) {
+		if (canon_stream_sticky(msg->type) < 0) {
+		    continue;
+		}
+	    } else {
+		programStartLine = 0;
+	    }
+	}
+	interp_list.set_line_number(line);
+	interp_list.append(msg);
+	emcStatus->task.readLine = line;
+    }
+}
+
+// Run-from-line: let the interpreter resume after its last checkpoint
+// before the start line, so that only the lines after it are read
+// through.
+static void run_from_checkpoint(void)
+{
+    int line;
+
+    if (programStartLine <= 0 || canon_replaying ||
+	(line = emcTaskPlanRestoreCheckpoint(programStartLine)) <= 0) {
+	return;
+    }
+    // the canon calls restoring the modal state are not run, like the
+    // output of the lines that are read through
+    interp_list.clear();
+    CANON_UPDATE_END_POINT(emcStatus->motion.traj.actualPosition.tran.x,
+			   emcStatus->motion.traj.actualPosition.tran.y,
+			   emcStatus->motion.traj.actualPosition.tran.z,
+			   emcStatus->motion.traj.actualPosition.a,
+			   emcStatus->motion.traj.actualPosition.b,
+			   emcStatus->motion.traj.actualPosition.c,
+			   emcStatus->motion.traj.actualPosition.u,
+			   emcStatus->motion.traj.actualPosition.v,
+			   emcStatus->motion.traj.actualPosition.w);
+    emcTaskPlanSynch();
+    emcStatus->task.readLine = line;
+    if (line + 1 >= programStartLine) {
+	programStartLine = 0;
+    }
+}
+
 void readahead_reading(void)
 {
     int readRetval;
     int execRetval;
 
+    if (canon_replaying) {
+	readahead_replay();
+	return;
+    }
+
 		if (interp_list.len() <= emc_task_interp_max_len) {
                     int count = 0;
 interpret_again:
@@ -523,6 +771,9 @@ interpret_again:
 			       (N.B. Watch for negative error codes.) */
 			    emcStatus->task.interpState =
 				EMC_TASK_INTERP_WAITING;
+			    if (canon_record.active()) {
+				emcTaskCanonStreamStop();
+			    }
 			} else {
 			    // got a good line
 			    // record the line number and command
@@ -530,8 +781,19 @@ interpret_again:
 
 			    emcTaskPlanCommand((char *) &emcStatus->task.
 					       command);
+			    if (canon_record.active()) {
+				char file[LINELEN];
+				emcTaskPlanFile(file);
+				canon_record.depend(file);
+				if (emcTaskPlanLevel() == 0) {
+				    canon_record.block(emcStatus->task.readLine);
+				}
+			    }
 			    // and execute it
 			    execRetval = emcTaskPlanExecute(0);
+			    if (canon_record.active()) {
+				canon_record_executed(execRetval);
+			    }
 			    // line number may need update after
 			    // returns from subprograms in external
 			    // files
@@ -709,6 +971,11 @@ void readahead_waiting(void)
 	    emcStatus->io.status == RCS_DONE)
 	    // finished
 	{
+	    if (canon_replaying) {
+		// comes back here once the queued synch is done
+		canon_replay_finish();
+		return;
+	    }
 	    int was_open = taskplanopen;
 	    if (was_open) {
 		emcTaskPlanClose();
@@ -1499,6 +1766,7 @@ static int emcTaskCheckPreconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -1835,6 +2103,16 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
                 emcTrajCircularMoveMsg->acc);
 	break;
 
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
+	emcTrajSplineMoveMsg = (EMC_TRAJ_SPLINE_MOVE *) cmd;
+        retval = emcTrajSplineMove(emcTrajSplineMoveMsg->end,
+                emcTrajSplineMoveMsg->ctrl1, emcTrajSplineMoveMsg->ctrl2,
+                emcTrajSplineMoveMsg->type,
+                emcTrajSplineMoveMsg->vel,
+                emcTrajSplineMoveMsg->ini_maxvel,
+                emcTrajSplineMoveMsg->acc);
+	break;
+
     case EMC_TRAJ_PAUSE_TYPE:
 	emcStatus->task.task_paused = 1;
 	retval = emcTrajPause();
@@ -2270,6 +2548,8 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 	}
 	run_msg = (EMC_TASK_PLAN_RUN *) cmd;
 	programStartLine = run_msg->line;
+	canon_stream_start(programStartLine);
+	run_from_checkpoint();
 	emcStatus->task.interpState = EMC_TASK_INTERP_READING;
 	emcStatus->task.task_paused = 0;
 	retval = 0;
@@ -2396,6 +2676,7 @@ static int emcTaskCheckPostconditions(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
+    case EMC_TRAJ_SPLINE_MOVE_TYPE:
     case EMC_TRAJ_SET_VELOCITY_TYPE:
     case EMC_TRAJ_SET_ACCELERATION_TYPE:
     case EMC_TRAJ_SET_TERM_COND_TYPE:
@@ -3209,6 +3490,11 @@ static int iniLoad(const char *filename)
 	max_mdi_queued_commands = atoi(inistring);
     }
 
+    // where to keep recorded canon streams
+    if (NULL != (inistring = inifile.Find("CANON_CACHE_DIR", "TASK"))) {
+	strncpy(canon_cache_dir, inistring, LINELEN - 1);
+    }
+
     // close it
     inifile.Close();
 
@@ -15,6 +15,7 @@
 //    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef EMC_TASK_HH
 #define EMC_TASK_HH
+#include <string>
 #include "taskclass.hh"
 extern NMLmsg *emcTaskCommand;
 extern int stepping;
@@ -44,6 +45,11 @@ int emcTaskPlanSetBlockDelete(bool state);
 void emcTaskPlanExit();
 int emcTaskPlanOpen(const char *file);
 int emcTaskPlanRead();
+int emcTaskPlanRestoreCheckpoint(int line);
+int emcTaskPlanRuntimeReads();
+unsigned long long emcTaskPlanParameterDigest();
+int emcTaskPlanSaveState(std::string &state);
+int emcTaskPlanRestoreState(const char *state, size_t length);
 int emcTaskPlanExecute(const char *command);
 int emcTaskPlanExecute(const char *command, int line_number); //used in case of MDI to pass the pseudo line number to interp
 int emcTaskPlanPause();
@@ -54,6 +60,8 @@ int emcTaskPlanReset();
 int emcTaskPlanLine();
 int emcTaskPlanLevel();
 int emcTaskPlanCommand(char *cmd);
+int emcTaskPlanFile(char *file);
+void emcTaskCanonStreamStop();
 
 int emcTaskUpdate(EMC_TASK_STAT * stat);
 
@@ -35,6 +35,7 @@
 
 #include "python_plugin.hh"
 #include "taskclass.hh"
+#include "tooldata.hh"
 
 #include <boost/python/dict.hpp>
 #include <boost/python/extract.hpp>
@@ -461,16 +462,15 @@ Task::Task() : use_iocontrol(0), random_toolchanger(0) {
 	if ((t = inifile.Find("TOOL_TABLE", "EMCIO")) != NULL)
 	    tooltable_filename = strdup(t);
     }
-    if (!use_iocontrol) {
-	for(int i = 0; i < CANON_POCKETS_MAX; i++) {
-	    ttcomments[i] = (char *)malloc(CANON_TOOL_ENTRY_LEN);
-	}
-    }
+    // without iocontrol, the Python task code owns the tool table
+    tooldata = new ToolData(!use_iocontrol);
 
 };
 
 
-Task::~Task() {};
+Task::~Task() {
+    delete tooldata;
+};
 
 // NML commands
 
@@ -699,6 +699,8 @@ int Task::emcIoUpdate(EMC_IO_STAT * stat)
 {
     if (!use_iocontrol) {
 	// there's no message to copy - Python directly operates on emcStatus and its io member
+	stat->tool.toolTableGeneration = tooldata->generation();
+	tooldata->get(0, stat->tool.spindleTool);
 	return 0;
     }
     if (0 == emcIoStatusBuffer || !emcIoStatusBuffer->valid()) {
@@ -56,9 +56,7 @@ public:
     int random_toolchanger;
     const char *ini_filename;
     const char *tooltable_filename;
-private:
-
-    char *ttcomments[CANON_POCKETS_MAX];
+    ToolData *tooldata;
 };
 
 extern Task *task_methods;
@@ -1403,6 +1403,42 @@ int emcTrajCircularMove(EmcPose end, PM_CARTESIAN center,
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+int emcTrajSplineMove(EmcPose end, PM_CARTESIAN ctrl1,
+			PM_CARTESIAN ctrl2, int type, double vel, double ini_maxvel, double acc)
+{
+#ifdef ISNAN_TRAP
+    if (std::isnan(end.tran.x) || std::isnan(end.tran.y) || std::isnan(end.tran.z) ||
+	std::isnan(end.a) || std::isnan(end.b) || std::isnan(end.c) ||
+	std::isnan(end.u) || std::isnan(end.v) || std::isnan(end.w) ||
+	std::isnan(ctrl1.x) || std::isnan(ctrl1.y) || std::isnan(ctrl1.z) ||
+	std::isnan(ctrl2.x) || std::isnan(ctrl2.y) || std::isnan(ctrl2.z)) {
+	printf("std::isnan error in emcTrajSplineMove()\n");
+	return 0;		// ignore it for now, just don't send it
+    }
+#endif
+
+    emcmotCommand.command = EMCMOT_SET_SPLINE;
+
+    emcmotCommand.pos = end;
+    emcmotCommand.motion_type = type;
+
+    emcmotCommand.ctrl1.x = ctrl1.x;
+    emcmotCommand.ctrl1.y = ctrl1.y;
+    emcmotCommand.ctrl1.z = ctrl1.z;
+
+    emcmotCommand.ctrl2.x = ctrl2.x;
+    emcmotCommand.ctrl2.y = ctrl2.y;
+    emcmotCommand.ctrl2.z = ctrl2.z;
+
+    emcmotCommand.id = TrajConfig.MotionId;
+
+    emcmotCommand.vel = vel;
+    emcmotCommand.ini_maxvel = ini_maxvel;
+    emcmotCommand.acc = acc;
+
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int emcTrajClearProbeTrippedFlag()
 {
     emcmotCommand.command = EMCMOT_CLEAR_PROBE_FLAGS;
@@ -1933,6 +1969,12 @@ int emcSetupArcBlends(int arcBlendEnable,
     return usrmotWriteEmcmotCommand(&emcmotCommand);
 }
 
+int emcSetJointLimitSamples(int samples) {
+    emcmotCommand.command = EMCMOT_SET_JOINT_LIMIT_SAMPLES;
+    emcmotCommand.jointLimitSamples = samples;
+    return usrmotWriteEmcmotCommand(&emcmotCommand);
+}
+
 int emcSetMaxFeedOverride(double maxFeedScale) {
     emcmotCommand.command = EMCMOT_SET_MAX_FEED_OVERRIDE;
     emcmotCommand.maxFeedScale = maxFeedScale;
@@ -42,6 +42,7 @@ namespace pp = pyplusplus::containers::static_sized;
 #include "rcs.hh"		// NML classes, nmlErrorFormat()
 #include "emc.hh"		// EMC NML
 #include "emc_nml.hh"
+#include "tooldata.hh"
 
 extern void emctask_quit(int sig);
 extern EMC_STAT *emcStatus;
@@ -175,12 +176,61 @@ typedef pp::array_1_t< int, ACTIVE_G_CODES> active_g_codes_array, (*active_g_cod
 typedef pp::array_1_t< int, ACTIVE_M_CODES> active_m_codes_array, (*active_m_codes_tw)( EMC_TASK_STAT &t );
 typedef pp::array_1_t< double, ACTIVE_SETTINGS> active_settings_array, (*active_settings_tw)( EMC_TASK_STAT &t );
 
-typedef pp::array_1_t< CANON_TOOL_TABLE, CANON_POCKETS_MAX> tool_array, (*tool_w)( EMC_TOOL_STAT &t );
+// io.tool.toolTable is a view of the shared tool table.  Entries are
+// returned by value, so change a pocket by assigning a modified entry.
+struct ToolTable {};
 
-static  tool_array tool_wrapper ( EMC_TOOL_STAT & t) {
-    return tool_array(t.toolTable);
+static ToolData *shared_tooldata()
+{
+    static ToolData *tooldata = 0;
+
+    if (tooldata == 0)
+	tooldata = new ToolData(0);
+    tooldata->attach();
+    return tooldata;
+}
+
+static void check_pocket(int pocket)
+{
+    if (!shared_tooldata()->valid()) {
+	PyErr_SetString(PyExc_RuntimeError, "tool table not available");
+	bp::throw_error_already_set();
+    }
+    if (pocket < 0 || pocket >= TOOLDATA_MAX_POCKETS) {
+	PyErr_SetString(PyExc_IndexError, "pocket out of range");
+	bp::throw_error_already_set();
+    }
+}
+
+static int tooltable_len(ToolTable &) { return TOOLDATA_MAX_POCKETS; }
+static int tooltable_pockets(ToolTable &) { return shared_tooldata()->pockets(); }
+static unsigned int tooltable_generation(ToolTable &) { return shared_tooldata()->generation(); }
+
+static CANON_TOOL_TABLE tooltable_getitem(ToolTable &, int pocket) {
+    CANON_TOOL_TABLE tool;
+    check_pocket(pocket);
+    shared_tooldata()->get(pocket, tool);
+    return tool;
 }
 
+static void tooltable_setitem(ToolTable &, int pocket, const CANON_TOOL_TABLE &tool) {
+    check_pocket(pocket);
+    shared_tooldata()->put(pocket, tool);
+}
+
+static void tooltable_swap(ToolTable &, int pocket1, int pocket2) {
+    check_pocket(pocket1);
+    check_pocket(pocket2);
+    shared_tooldata()->swap(pocket1, pocket2);
+}
+
+static void tooltable_clear(ToolTable &, int first_pocket) {
+    check_pocket(first_pocket);
+    shared_tooldata()->clear(first_pocket);
+}
+
+static ToolTable tool_wrapper(EMC_TOOL_STAT &) { return ToolTable(); }
+
 static  axis_array axis_wrapper ( EMC_MOTION_STAT & m) {
     return axis_array(m.axis);
 }
@@ -465,9 +515,19 @@ BOOST_PYTHON_MODULE(emctask) {
     class_ <EMC_TOOL_STAT, noncopyable>("EMC_TOOL_STAT",no_init)
 	.def_readwrite("pocketPrepped", &EMC_TOOL_STAT::pocketPrepped )
 	.def_readwrite("toolInSpindle", &EMC_TOOL_STAT::toolInSpindle )
-	.add_property( "toolTable",
-		       bp::make_function( tool_w(&tool_wrapper),
-					  bp::with_custodian_and_ward_postcall< 0, 1 >()))
+	.def_readonly("toolTableGeneration", &EMC_TOOL_STAT::toolTableGeneration )
+	.def_readonly("spindleTool", &EMC_TOOL_STAT::spindleTool )
+	.add_property( "toolTable", &tool_wrapper)
+	;
+
+    class_ <ToolTable>("ToolTable",no_init)
+	.def("__len__", &tooltable_len)
+	.def("__getitem__", &tooltable_getitem)
+	.def("__setitem__", &tooltable_setitem)
+	.def("swap", &tooltable_swap)
+	.def("clear", &tooltable_clear)
+	.add_property("pockets", &tooltable_pockets)
+	.add_property("generation", &tooltable_generation)
 	;
 
     class_ <EMC_AUX_STAT, noncopyable>("EMC_AUX_STAT",no_init)
@@ -77,6 +77,9 @@ int tcGetStartAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
         case TC_CIRCULAR:
             tcCircleStartAccelUnitVector(tc,out);
             break;
+        case TC_SPLINE:
+            pmSpline9TangentVector(&tc->coords.spline, 0.0, out);
+            break;
         case TC_SPHERICAL:
             return -1;
         default:
@@ -101,6 +104,9 @@ int tcGetEndAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const out)
         case TC_CIRCULAR:
             tcCircleEndAccelUnitVector(tc,out);
             break;
+        case TC_SPLINE:
+            pmSpline9TangentVector(&tc->coords.spline, 1.0, out);
+            break;
        case TC_SPHERICAL:
             return -1;
        default:
@@ -207,6 +213,9 @@ int tcGetStartTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const
         case TC_CIRCULAR:
             pmCircleTangentVector(&tc->coords.circle.xyz, 0.0, out);
             break;
+        case TC_SPLINE:
+            pmSpline9TangentVector(&tc->coords.spline, 0.0, out);
+            break;
         default:
             rtapi_print_msg(RTAPI_MSG_ERR, "Invalid motion type %d!\n",tc->motion_type);
             return -1;
@@ -230,6 +239,9 @@ int tcGetEndTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
             pmCircleTangentVector(&tc->coords.circle.xyz,
                     tc->coords.circle.xyz.angle, out);
             break;
+        case TC_SPLINE:
+            pmSpline9TangentVector(&tc->coords.spline, 1.0, out);
+            break;
         default:
             rtapi_print_msg(RTAPI_MSG_ERR, "Invalid motion type %d!\n",tc->motion_type);
             return -1;
@@ -269,9 +281,6 @@ int tcGetEndpoint(TC_STRUCT const * const tc, EmcPose * const out) {
 
 int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
 {
-    PmCartesian xyz;
-    PmCartesian abc;
-    PmCartesian uvw;
     double progress=0.0;
 
     switch (of_point) {
@@ -286,6 +295,21 @@ int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
             break;
     }
 
+    return tcGetPosAtProgress(tc, progress, pos);
+}
+
+
+/**
+ * Find the position along a segment at an arbitrary progress value.
+ * Used by tcGetPosReal, and by the planner to sample a segment before it is
+ * queued.
+ */
+int tcGetPosAtProgress(TC_STRUCT const * const tc, double progress, EmcPose * const pos)
+{
+    PmCartesian xyz;
+    PmCartesian abc;
+    PmCartesian uvw;
+
 
     // Used for arc-length to angle conversion with spiral segments
     double angle = 0.0;
@@ -334,6 +358,17 @@ int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
             abc = tc->coords.arc.abc;
             uvw = tc->coords.arc.uvw;
             break;
+        case TC_SPLINE:
+            pmSpline9Point(&tc->coords.spline,
+                    pmSpline9ParamFromProgress(&tc->coords.spline, progress),
+                    &xyz);
+            pmCartLinePoint(&tc->coords.spline.abc,
+                    progress * tc->coords.spline.abc.tmag / tc->target,
+                    &abc);
+            pmCartLinePoint(&tc->coords.spline.uvw,
+                    progress * tc->coords.spline.uvw.tmag / tc->target,
+                    &uvw);
+            break;
     }
 
     if (res_fit == TP_ERR_OK) {
@@ -655,6 +690,8 @@ int tcFinalizeLength(TC_STRUCT * const tc)
 
     if (tc->motion_type == TC_CIRCULAR) {
         tc->maxvel = pmCircleActualMaxVel(&tc->coords.circle.xyz, &tc->acc_ratio_tan, tc->maxvel, tc->maxaccel, parabolic);
+    } else if (tc->motion_type == TC_SPLINE) {
+        tc->maxvel = pmSpline9ActualMaxVel(&tc->coords.spline, &tc->acc_ratio_tan, tc->maxvel, tc->maxaccel, parabolic);
     }
 
     tcClampVelocityByLength(tc);
@@ -698,6 +735,222 @@ int tcUpdateTargetFromCircle(TC_STRUCT * const tc)
 
 
 
+/** @section splinefuncs Cubic spline segments */
+
+static void pmSpline9Deriv(PmSpline9 const * const spline, double t,
+        PmCartesian * const d1, PmCartesian * const d2)
+{
+    double u = 1.0 - t;
+    PmCartesian a, b, c;
+
+    pmCartCartSub(&spline->p1, &spline->p0, &a);
+    pmCartCartSub(&spline->p2, &spline->p1, &b);
+    pmCartCartSub(&spline->p3, &spline->p2, &c);
+
+    if (d1) {
+        d1->x = 3.0 * (u * u * a.x + 2.0 * u * t * b.x + t * t * c.x);
+        d1->y = 3.0 * (u * u * a.y + 2.0 * u * t * b.y + t * t * c.y);
+        d1->z = 3.0 * (u * u * a.z + 2.0 * u * t * b.z + t * t * c.z);
+    }
+    if (d2) {
+        d2->x = 6.0 * (u * (b.x - a.x) + t * (c.x - b.x));
+        d2->y = 6.0 * (u * (b.y - a.y) + t * (c.y - b.y));
+        d2->z = 6.0 * (u * (b.z - a.z) + t * (c.z - b.z));
+    }
+}
+
+static double pmSpline9Speed(PmSpline9 const * const spline, double t)
+{
+    PmCartesian d1;
+    double mag;
+    pmSpline9Deriv(spline, t, &d1, NULL);
+    pmCartMag(&d1, &mag);
+    return mag;
+}
+
+/** Arc length between two parameter values by Simpson's rule. */
+static double pmSpline9Length(PmSpline9 const * const spline,
+        double t0, double t1)
+{
+    return (t1 - t0) / 6.0 * (pmSpline9Speed(spline, t0)
+            + 4.0 * pmSpline9Speed(spline, 0.5 * (t0 + t1))
+            + pmSpline9Speed(spline, t1));
+}
+
+int pmSpline9Point(PmSpline9 const * const spline, double t,
+        PmCartesian * const out)
+{
+    double u = 1.0 - t;
+    double b0 = u * u * u;
+    double b1 = 3.0 * u * u * t;
+    double b2 = 3.0 * u * t * t;
+    double b3 = t * t * t;
+
+    out->x = b0 * spline->p0.x + b1 * spline->p1.x + b2 * spline->p2.x + b3 * spline->p3.x;
+    out->y = b0 * spline->p0.y + b1 * spline->p1.y + b2 * spline->p2.y + b3 * spline->p3.y;
+    out->z = b0 * spline->p0.z + b1 * spline->p1.z + b2 * spline->p2.z + b3 * spline->p3.z;
+    return 0;
+}
+
+/**
+ * Unit tangent of a spline at parameter t.
+ * A control point that coincides with its end point gives a zero derivative
+ * there, so fall back to the chord towards the next distinct control point.
+ */
+int pmSpline9TangentVector(PmSpline9 const * const spline, double t,
+        PmCartesian * const out)
+{
+    PmCartesian d1;
+    double mag;
+
+    pmSpline9Deriv(spline, t, &d1, NULL);
+    pmCartMag(&d1, &mag);
+    if (mag < TP_POS_EPSILON) {
+        if (t < 0.5) {
+            pmCartCartSub(&spline->p2, &spline->p0, &d1);
+        } else {
+            pmCartCartSub(&spline->p3, &spline->p1, &d1);
+        }
+        pmCartMag(&d1, &mag);
+        if (mag < TP_POS_EPSILON) {
+            pmCartCartSub(&spline->p3, &spline->p0, &d1);
+        }
+    }
+    return pmCartUnit(&d1, out);
+}
+
+/**
+ * Set up a spline segment: build the arc length table and find the largest
+ * curvature so the velocity limit can be computed once up front.
+ */
+int pmSpline9Init(PmSpline9 * const spline9,
+        EmcPose const * const start,
+        EmcPose const * const end,
+        PmCartesian const * const ctrl1,
+        PmCartesian const * const ctrl2)
+{
+    PmCartesian start_uvw, end_uvw;
+    PmCartesian start_abc, end_abc;
+    int i;
+
+    emcPoseToPmCartesian(start, &spline9->p0, &start_abc, &start_uvw);
+    emcPoseToPmCartesian(end, &spline9->p3, &end_abc, &end_uvw);
+    spline9->p1 = *ctrl1;
+    spline9->p2 = *ctrl2;
+
+    int abc_fail = pmCartLineInit(&spline9->abc, &start_abc, &end_abc);
+    int uvw_fail = pmCartLineInit(&spline9->uvw, &start_uvw, &end_uvw);
+    if (abc_fail || uvw_fail) {
+        rtapi_print_msg(RTAPI_MSG_ERR,"Failed to initialize Spline9, err codes %d, %d\n",
+                abc_fail, uvw_fail);
+        return TP_ERR_FAIL;
+    }
+
+    spline9->s[0] = 0.0;
+    spline9->kappa_max = 0.0;
+    for (i = 0; i < 2 * TC_SPLINE_SAMPLES + 1; ++i) {
+        double t = (double)i / (2 * TC_SPLINE_SAMPLES);
+        if (i % 2 == 0 && i > 0) {
+            int k = i / 2;
+            spline9->s[k] = spline9->s[k - 1] + pmSpline9Length(spline9,
+                    (double)(k - 1) / TC_SPLINE_SAMPLES,
+                    (double)k / TC_SPLINE_SAMPLES);
+        }
+
+        // curvature |B' x B''| / |B'|^3, skipping cusps where it is undefined
+        PmCartesian d1, d2, cross;
+        double v, c;
+        pmSpline9Deriv(spline9, t, &d1, &d2);
+        pmCartMag(&d1, &v);
+        if (v < TP_POS_EPSILON) {
+            continue;
+        }
+        pmCartCartCross(&d1, &d2, &cross);
+        pmCartMag(&cross, &c);
+        spline9->kappa_max = fmax(spline9->kappa_max, c / (v * v * v));
+    }
+    return TP_ERR_OK;
+}
+
+double pmSpline9Target(PmSpline9 const * const spline9)
+{
+    return spline9->s[TC_SPLINE_SAMPLES];
+}
+
+/**
+ * Map progress (arc length) to the curve parameter. The table lookup is
+ * refined with one Newton step against the exact speed, which is plenty for
+ * smooth segments and cheap enough to run every servo cycle.
+ */
+double pmSpline9ParamFromProgress(PmSpline9 const * const spline9,
+        double progress)
+{
+    double const * const s = spline9->s;
+    int lo = 0, hi = TC_SPLINE_SAMPLES;
+
+    if (progress <= 0.0) {
+        return 0.0;
+    }
+    if (progress >= s[TC_SPLINE_SAMPLES]) {
+        return 1.0;
+    }
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (s[mid] <= progress) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    double t0 = (double)lo / TC_SPLINE_SAMPLES;
+    double ds = s[hi] - s[lo];
+    double t = t0;
+    if (ds > 0.0) {
+        t += (progress - s[lo]) / ds / TC_SPLINE_SAMPLES;
+    }
+
+    double v = pmSpline9Speed(spline9, t);
+    if (v > TP_POS_EPSILON) {
+        double err = s[lo] + pmSpline9Length(spline9, t0, t) - progress;
+        t -= err / v;
+    }
+    return fmin(fmax(t, 0.0), 1.0);
+}
+
+/**
+ * Velocity limit for a spline, from the same normal / tangential split of
+ * the acceleration budget used for circles, taking the tightest radius of
+ * curvature found when the segment was set up.
+ */
+double pmSpline9ActualMaxVel(PmSpline9 const * const spline9,
+        double * const acc_ratio_tangential,
+        double v_max,
+        double a_max,
+        int parabolic)
+{
+    if (parabolic) {
+        a_max /= 2.0;
+    }
+    double a_n_max = BLEND_ACC_RATIO_NORMAL * a_max;
+    if (spline9->kappa_max <= 0.0) {
+        if (acc_ratio_tangential) {
+            *acc_ratio_tangential = 1.0;
+        }
+        return v_max;
+    }
+    double eff_radius = 1.0 / spline9->kappa_max;
+    double v_max_acc = pmSqrt(a_n_max * eff_radius);
+    double v_max_eff = fmin(v_max_acc, v_max);
+    if (acc_ratio_tangential) {
+        double a_normal = fmin(pmSq(v_max_eff) / eff_radius, a_n_max);
+        *acc_ratio_tangential = (pmSqrt(pmSq(a_max) - pmSq(a_normal)) / a_max);
+        tp_debug_print("spline acc_ratio_tan = %f\n",*acc_ratio_tangential);
+    }
+    return v_max_eff;
+}
+
+
 int pmRigidTapInit(PmRigidTap * const tap,
         EmcPose const * const start,
         EmcPose const * const end)
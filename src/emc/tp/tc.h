@@ -26,6 +26,7 @@ int tcGetEndpoint(TC_STRUCT const * const tc, EmcPose * const out);
 int tcGetStartpoint(TC_STRUCT const * const tc, EmcPose * const out);
 int tcGetPos(TC_STRUCT const * const tc,  EmcPose * const out);
 int tcGetPosReal(TC_STRUCT const * const tc, int of_endpoint,  EmcPose * const out);
+int tcGetPosAtProgress(TC_STRUCT const * const tc, double progress, EmcPose * const out);
 int tcGetEndAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const out);
 int tcGetStartAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const out);
 int tcGetEndTangentUnitVector(TC_STRUCT const * const tc, PmCartesian * const out);
@@ -69,6 +70,29 @@ int pmCircle9Init(PmCircle9 * const circ9,
         PmCartesian const * const normal,
         int turn);
 
+int pmSpline9Init(PmSpline9 * const spline9,
+        EmcPose const * const start,
+        EmcPose const * const end,
+        PmCartesian const * const ctrl1,
+        PmCartesian const * const ctrl2);
+
+double pmSpline9Target(PmSpline9 const * const spline9);
+
+int pmSpline9Point(PmSpline9 const * const spline, double t,
+        PmCartesian * const out);
+
+int pmSpline9TangentVector(PmSpline9 const * const spline, double t,
+        PmCartesian * const out);
+
+double pmSpline9ParamFromProgress(PmSpline9 const * const spline9,
+        double progress);
+
+double pmSpline9ActualMaxVel(PmSpline9 const * const spline9,
+        double * const acc_ratio_tangential,
+        double v_max,
+        double a_max,
+        int parabolic);
+
 int pmRigidTapInit(PmRigidTap * const tap,
         EmcPose const * const start,
         EmcPose const * const end);
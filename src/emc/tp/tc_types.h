@@ -31,7 +31,8 @@ typedef enum {
     TC_LINEAR = 1,
     TC_CIRCULAR = 2,
     TC_RIGIDTAP = 3,
-    TC_SPHERICAL = 4
+    TC_SPHERICAL = 4,
+    TC_SPLINE = 5
 } tc_motion_type_t;
 
 typedef enum {
@@ -83,6 +84,22 @@ typedef struct {
     PmCartesian uvw;
 } Arc9;
 
+/* Number of intervals in the arc length table of a spline segment */
+#define TC_SPLINE_SAMPLES 32
+
+/**
+ * Cubic Bezier segment in XYZ, with ABC and UVW moving linearly along it.
+ * s[i] is the arc length from the start to parameter i / TC_SPLINE_SAMPLES,
+ * which lets the planner map progress back to the curve parameter.
+ */
+typedef struct {
+    PmCartesian p0, p1, p2, p3; /* control points */
+    PmCartLine abc;
+    PmCartLine uvw;
+    double s[TC_SPLINE_SAMPLES + 1];
+    double kappa_max;           /* largest curvature found while sampling */
+} PmSpline9;
+
 typedef enum {
     TAPPING, REVERSING, RETRACTION, FINAL_REVERSAL, FINAL_PLACEMENT
 } RIGIDTAP_STATE;
@@ -135,11 +152,13 @@ typedef struct {
         PmCircle9 circle;
         PmRigidTap rigidtap;
         Arc9 arc;
+        PmSpline9 spline;
     } coords;
 
     int motion_type;       // TC_LINEAR (coords.line) or
                             // TC_CIRCULAR (coords.circle) or
-                            // TC_RIGIDTAP (coords.rigidtap)
+                            // TC_RIGIDTAP (coords.rigidtap) or
+                            // TC_SPLINE (coords.spline)
     int active;            // this motion is being executed
     int canon_motion_type;  // this motion is due to which canon function?
     int term_cond;          // gcode requests continuous feed at the end of
@@ -21,6 +21,12 @@
 #include "motion_types.h"
 #include "spherical_arc.h"
 #include "blendmath.h"
+#include "kinematics.h"
+#include "kinematicsbatch.h"
+
+/* Batch kinematics are optional; fall back to the per-pose calls when the
+ * loaded kinematics module does not provide them. */
+#pragma weak kinematicsInverseBatch
 //KLUDGE Don't include all of emc.hh here, just hand-copy the TERM COND
 //definitions until we can break the emc constants out into a separate file.
 //#include "emc.hh"
@@ -49,6 +55,13 @@ extern emcmot_status_t *emcmotStatus;
 extern emcmot_debug_t *emcmotDebug;
 extern emcmot_config_t *emcmotConfig;
 
+/* Sample buffers of tpApplyJointLimits, kept off the servo thread stack.
+ * Sample k is stored at 2k, its finite difference partner at 2k+1. */
+static struct {
+    double world[9][2 * TP_JOINT_LIMIT_SAMPLES_MAX];
+    double joints[EMCMOT_MAX_JOINTS][2 * TP_JOINT_LIMIT_SAMPLES_MAX];
+} joint_limit_buf;
+
 /** static function primitives (ugly but less of a pain than moving code around)*/
 STATIC int tpComputeBlendVelocity(TP_STRUCT const * const tp, TC_STRUCT * const tc,
         TC_STRUCT * const nexttc);
@@ -108,6 +121,12 @@ STATIC int tpRotaryMotionCheck(TP_STRUCT const * const tp, TC_STRUCT const * con
             } else {
                 return true;
             }
+        case TC_SPLINE:
+            if (tc->coords.spline.abc.tmag_zero && tc->coords.spline.uvw.tmag_zero) {
+                return false;
+            } else {
+                return true;
+            }
         case TC_SPHERICAL:
             return true;
         default:
@@ -142,9 +161,11 @@ STATIC int tpGetMachineAccelBounds(PmCartesian  * const acc_bound) {
         return TP_ERR_FAIL;
     }
 
-    acc_bound->x = emcmotDebug->joints[0].acc_limit;
-    acc_bound->y = emcmotDebug->joints[1].acc_limit;
-    acc_bound->z = emcmotDebug->joints[2].acc_limit;
+    // These are Cartesian bounds, so they come from the axes, not the joints
+    // (the two only coincide for identity kinematics with XYZ on joints 0-2)
+    acc_bound->x = axes[0].acc_limit;
+    acc_bound->y = axes[1].acc_limit;
+    acc_bound->z = axes[2].acc_limit;
     return TP_ERR_OK;
 }
 
@@ -154,9 +175,9 @@ STATIC int tpGetMachineVelBounds(PmCartesian  * const vel_bound) {
         return TP_ERR_FAIL;
     }
 
-    vel_bound->x = emcmotDebug->joints[0].vel_limit;
-    vel_bound->y = emcmotDebug->joints[1].vel_limit;
-    vel_bound->z = emcmotDebug->joints[2].vel_limit;
+    vel_bound->x = axes[0].vel_limit;
+    vel_bound->y = axes[1].vel_limit;
+    vel_bound->z = axes[2].vel_limit;
     return TP_ERR_OK;
 }
 
@@ -182,6 +203,104 @@ STATIC int tpGetMachineActiveLimit(double * const act_limit, PmCartesian const *
 }
 
 
+/**
+ * Cap a segment's velocity and acceleration by the joint limits.
+ * The limits handed to the planner are Cartesian, which only describes the
+ * joints directly for identity kinematics. Otherwise, sample the segment at a
+ * few points, push each point and a nearby one through the inverse
+ * kinematics to get the joint motion per unit of path length, and lower
+ * maxvel / maxaccel so that no joint exceeds its own limits anywhere we
+ * looked. The curvature of the joint path is not accounted for, so this
+ * bounds the tangential acceleration only.
+ */
+STATIC int tpApplyJointLimits(TP_STRUCT const * const tp, TC_STRUCT * const tc)
+{
+    int samples = emcmotConfig->jointLimitSamples;
+    int num_joints = emcmotConfig->numJoints;
+
+    if (samples <= 0 || emcmotConfig->kinType == KINEMATICS_IDENTITY) {
+        return TP_ERR_NO_ACTION;
+    }
+    if (tc->motion_type != TC_LINEAR && tc->motion_type != TC_CIRCULAR &&
+            tc->motion_type != TC_SPLINE) {
+        return TP_ERR_NO_ACTION;
+    }
+    if (samples > TP_JOINT_LIMIT_SAMPLES_MAX) {
+        samples = TP_JOINT_LIMIT_SAMPLES_MAX;
+    }
+
+    KINEMATICS_FORWARD_FLAGS fflags = 0;
+    KINEMATICS_INVERSE_FLAGS iflags = 0;
+    double (*wbuf)[2 * TP_JOINT_LIMIT_SAMPLES_MAX] = joint_limit_buf.world;
+    double (*qbuf)[2 * TP_JOINT_LIMIT_SAMPLES_MAX] = joint_limit_buf.joints;
+    double *q[EMCMOT_MAX_JOINTS];
+    EmcPoseArrays world = {
+        wbuf[0], wbuf[1], wbuf[2],
+        wbuf[3], wbuf[4], wbuf[5],
+        wbuf[6], wbuf[7], wbuf[8]
+    };
+    EmcPose p;
+    int n = 2 * samples;
+    int i, j, k, res;
+
+    double ds = fmin(TP_JOINT_LIMIT_STEP, tc->target / (2.0 * samples));
+    double span = tc->target - ds;
+    double v_max = tc->maxvel;
+    double a_max = tc->maxaccel;
+
+    for (i = 0; i < n; ++i) {
+        k = i / 2;
+        double s = samples > 1 ? span * k / (samples - 1) : span / 2.0;
+        if (i & 1) {
+            s += ds;
+        }
+        if (tcGetPosAtProgress(tc, s, &p) != TP_ERR_OK) {
+            return TP_ERR_FAIL;
+        }
+        kinsPoseArraysSet(&world, i, &p);
+    }
+
+    // Iterative kinematics need a starting estimate, the current commanded
+    // position is as good as any. The batch calls seed each later sample
+    // from the one before, which is close by.
+    for (j = 0; j < EMCMOT_MAX_JOINTS; ++j) {
+        q[j] = qbuf[j];
+        qbuf[j][0] = j < num_joints ? emcmotDebug->joints[j].pos_cmd : 0.0;
+    }
+
+    if (kinematicsInverseBatch) {
+        res = kinematicsInverseBatch(&world, q, n, &iflags, &fflags);
+    } else {
+        res = kinematicsInverseBatchScalar(&world, q, n, &iflags, &fflags);
+    }
+    if (res != n) {
+        tp_debug_print("joint limits: inverse kins failed at sample %d\n", res);
+        return TP_ERR_FAIL;
+    }
+
+    for (k = 0; k < samples; ++k) {
+        for (j = 0; j < num_joints; ++j) {
+            double dq_ds = fabs(qbuf[j][2 * k + 1] - qbuf[j][2 * k]) / ds;
+            if (dq_ds < TP_VEL_EPSILON) {
+                continue;
+            }
+            if (emcmotDebug->joints[j].vel_limit > 0.0) {
+                v_max = fmin(v_max, emcmotDebug->joints[j].vel_limit / dq_ds);
+            }
+            if (emcmotDebug->joints[j].acc_limit > 0.0) {
+                a_max = fmin(a_max, emcmotDebug->joints[j].acc_limit / dq_ds);
+            }
+        }
+    }
+
+    tp_debug_print("joint limits: maxvel %f -> %f, maxaccel %f -> %f\n",
+            tc->maxvel, v_max, tc->maxaccel, a_max);
+    tc->maxvel = v_max;
+    tc->maxaccel = a_max;
+    return TP_ERR_OK;
+}
+
+
 /**
  * Get a segment's feed scale based on the current planner state and emcmotStatus.
  * @note depends on emcmotStatus for system information.
@@ -295,7 +414,8 @@ STATIC inline double tpGetScaledAccel(TP_STRUCT const * const tp,
     if (tc->term_cond == TC_TERM_COND_PARABOLIC || tc->blend_prev) {
         a_scale *= 0.5;
     }
-    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL) {
+    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL ||
+            tc->motion_type == TC_SPLINE) {
         //Limit acceleration for cirular arcs to allow for normal acceleration
         a_scale *= tc->acc_ratio_tan;
     }
@@ -1755,7 +1875,8 @@ STATIC int tpSetupTangent(TP_STRUCT const * const tp,
     //FIXME this ratio is arbitrary, should be more easily tunable
     double acc_scale_max = pmCartAbsMax(&acc_scale);
     //KLUDGE lumping a few calculations together here
-    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR) {
+    if (prev_tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_CIRCULAR ||
+            prev_tc->motion_type == TC_SPLINE || tc->motion_type == TC_SPLINE) {
         acc_scale_max /= BLEND_ACC_RATIO_TANGENTIAL;
     }
 
@@ -1901,6 +2022,7 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
     }
     tc.nominal_length = tc.target;
     tcClampVelocityByLength(&tc);
+    tpApplyJointLimits(tp, &tc);
 
     // For linear move, set rotary axis settings 
     tc.indexrotary = indexrotary;
@@ -1996,6 +2118,7 @@ int tpAddCircle(TP_STRUCT * const tp,
             vel,
             v_max_actual,
             acc);
+    tpApplyJointLimits(tp, &tc);
 
     TC_STRUCT *prev_tc;
     prev_tc = tcqLast(&tp->queue);
@@ -2016,6 +2139,88 @@ int tpAddCircle(TP_STRUCT * const tp,
 }
 
 
+/**
+ * Adds a cubic spline move from the end of the last move to this new
+ * position, with ctrl1 and ctrl2 as the inner Bezier control points.
+ * Splines never get blend arcs, but join tangentially with their neighbours
+ * like any other segment.
+ */
+int tpAddSpline(TP_STRUCT * const tp,
+        EmcPose end,
+        PmCartesian ctrl1,
+        PmCartesian ctrl2,
+        int canon_motion_type,
+        double vel,
+        double ini_maxvel,
+        double acc,
+        unsigned char enables,
+        char atspeed)
+{
+    if (tpErrorCheck(tp)<0) {
+        return TP_ERR_FAIL;
+    }
+
+    tp_info_print("== AddSpline ==\n");
+
+    TC_STRUCT tc = {0};
+
+    tcInit(&tc,
+            TC_SPLINE,
+            canon_motion_type,
+            tp->cycleTime,
+            enables,
+            atspeed);
+    // Setup any synced IO for this move
+    tpSetupSyncedIO(tp, &tc);
+
+    // Copy over state data from the trajectory planner
+    tcSetupState(&tc, tp);
+
+    int res_init = pmSpline9Init(&tc.coords.spline,
+            &tp->goalPos,
+            &end,
+            &ctrl1,
+            &ctrl2);
+
+    if (res_init) return res_init;
+
+    tc.target = pmSpline9Target(&tc.coords.spline);
+    if (tc.target < TP_POS_EPSILON) {
+        return TP_ERR_ZERO_LENGTH;
+    }
+    tp_debug_print("tc.target = %f, kappa_max = %f\n",
+            tc.target, tc.coords.spline.kappa_max);
+    tc.nominal_length = tc.target;
+
+    tcClampVelocityByLength(&tc);
+
+    double v_max_actual = pmSpline9ActualMaxVel(&tc.coords.spline, &tc.acc_ratio_tan, ini_maxvel, acc, false);
+
+    // Copy in motion parameters
+    tcSetupMotion(&tc,
+            vel,
+            v_max_actual,
+            acc);
+    tpApplyJointLimits(tp, &tc);
+
+    TC_STRUCT *prev_tc;
+    prev_tc = tcqLast(&tp->queue);
+
+    tpCheckCanonType(prev_tc, &tc);
+    if (emcmotConfig->arcBlendEnable){
+        tpHandleBlendArc(tp, &tc);
+    }
+    tcCheckLastParabolic(&tc, prev_tc);
+    tcFinalizeLength(prev_tc);
+    tcFlagEarlyStop(prev_tc, &tc);
+
+    int retval = tpAddSegmentToQueue(tp, &tc, true);
+
+    tpRunOptimization(tp);
+    return retval;
+}
+
+
 /**
  * Adjusts blend velocity and acceleration to safe limits.
  * If we are blending between tc and nexttc, then we need to figure out what a
@@ -40,6 +40,9 @@ int tpAddLine(TP_STRUCT * const tp, EmcPose end, int canon_motion_type, double v
 int tpAddCircle(TP_STRUCT * const tp, EmcPose end, PmCartesian center,
         PmCartesian normal, int turn, int canon_motion_type, double vel, double ini_maxvel,
                        double acc, unsigned char enables, char atspeed);
+int tpAddSpline(TP_STRUCT * const tp, EmcPose end, PmCartesian ctrl1,
+        PmCartesian ctrl2, int canon_motion_type, double vel, double ini_maxvel,
+        double acc, unsigned char enables, char atspeed);
 int tpRunCycle(TP_STRUCT * const tp, long period);
 int tpPause(TP_STRUCT * const tp);
 int tpResume(TP_STRUCT * const tp);
@@ -45,6 +45,10 @@
 #define TP_MIN_ARC_LENGTH 1e-6
 #define TP_BIG_NUM 1e10
 
+/* Joint limit sampling of queued segments (see tpApplyJointLimits) */
+#define TP_JOINT_LIMIT_SAMPLES_MAX 16
+#define TP_JOINT_LIMIT_STEP 1e-3
+
 /**
  * TP return codes.
  * This enum is a catch-all for useful return statuses from TP
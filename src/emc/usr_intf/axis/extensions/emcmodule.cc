@@ -32,8 +32,13 @@
 #include "timer.hh"
 #include "nml_oi.hh"
 #include "rcs_print.hh"
+#include "tooldata.hh"
+#include "motion.h"
+#include "usrmotintf.h"
 
 #include <cmath>
+#include <vector>
+#include <algorithm>
 
 #ifndef T_BOOL
 // The C++ standard probably doesn't specify the amount of storage for a 'bool',
@@ -82,6 +87,9 @@ struct pyStatChannel {
     PyObject_HEAD
     RCS_STAT_CHANNEL *c;
     EMC_STAT status;
+    ToolData *tooldata;
+    PyObject *tool_table;
+    unsigned int tool_table_generation;
 };
 
 struct pyCommandChannel {
@@ -265,11 +273,14 @@ static int Stat_init(pyStatChannel *self, PyObject *a, PyObject *k) {
     }
 
     self->c = c;
+    self->tooldata = new ToolData(0);
     return 0;
 }
 
 static void Stat_dealloc(PyObject *self) {
     delete ((pyStatChannel*)self)->c;
+    delete ((pyStatChannel*)self)->tooldata;
+    Py_XDECREF(((pyStatChannel*)self)->tool_table);
     PyObject_Del(self);
 }
 
@@ -611,31 +622,57 @@ static PyStructSequence_Desc tool_result_desc = {
 
 static PyTypeObject ToolResultType;
 
+static PyObject *tool_result(const CANON_TOOL_TABLE &t) {
+    PyObject *tool = PyStructSequence_New(&ToolResultType);
+    PyStructSequence_SET_ITEM(tool, 0, PyInt_FromLong(t.toolno));
+    PyStructSequence_SET_ITEM(tool, 1, PyFloat_FromDouble(t.offset.tran.x));
+    PyStructSequence_SET_ITEM(tool, 2, PyFloat_FromDouble(t.offset.tran.y));
+    PyStructSequence_SET_ITEM(tool, 3, PyFloat_FromDouble(t.offset.tran.z));
+    PyStructSequence_SET_ITEM(tool, 4, PyFloat_FromDouble(t.offset.a));
+    PyStructSequence_SET_ITEM(tool, 5, PyFloat_FromDouble(t.offset.b));
+    PyStructSequence_SET_ITEM(tool, 6, PyFloat_FromDouble(t.offset.c));
+    PyStructSequence_SET_ITEM(tool, 7, PyFloat_FromDouble(t.offset.u));
+    PyStructSequence_SET_ITEM(tool, 8, PyFloat_FromDouble(t.offset.v));
+    PyStructSequence_SET_ITEM(tool, 9, PyFloat_FromDouble(t.offset.w));
+    PyStructSequence_SET_ITEM(tool, 10, PyFloat_FromDouble(t.diameter));
+    PyStructSequence_SET_ITEM(tool, 11, PyFloat_FromDouble(t.frontangle));
+    PyStructSequence_SET_ITEM(tool, 12, PyFloat_FromDouble(t.backangle));
+    PyStructSequence_SET_ITEM(tool, 13, PyInt_FromLong(t.orientation));
+    return tool;
+}
+
+// The table comes from the shared tool data and is only rebuilt when its
+// generation changes.  Without it (e.g. when the status comes over the
+// network) only the spindle pocket is known.
 static PyObject *Stat_tool_table(pyStatChannel *s) {
-    PyObject *res = PyTuple_New(CANON_POCKETS_MAX);
-    int j=0;
-    for(int i=0; i<CANON_POCKETS_MAX; i++) {
-        struct CANON_TOOL_TABLE &t = s->status.io.tool.toolTable[i];
-        PyObject *tool = PyStructSequence_New(&ToolResultType);
-        PyStructSequence_SET_ITEM(tool, 0, PyInt_FromLong(t.toolno));
-        PyStructSequence_SET_ITEM(tool, 1, PyFloat_FromDouble(t.offset.tran.x));
-        PyStructSequence_SET_ITEM(tool, 2, PyFloat_FromDouble(t.offset.tran.y));
-        PyStructSequence_SET_ITEM(tool, 3, PyFloat_FromDouble(t.offset.tran.z));
-        PyStructSequence_SET_ITEM(tool, 4, PyFloat_FromDouble(t.offset.a));
-        PyStructSequence_SET_ITEM(tool, 5, PyFloat_FromDouble(t.offset.b));
-        PyStructSequence_SET_ITEM(tool, 6, PyFloat_FromDouble(t.offset.c));
-        PyStructSequence_SET_ITEM(tool, 7, PyFloat_FromDouble(t.offset.u));
-        PyStructSequence_SET_ITEM(tool, 8, PyFloat_FromDouble(t.offset.v));
-        PyStructSequence_SET_ITEM(tool, 9, PyFloat_FromDouble(t.offset.w));
-        PyStructSequence_SET_ITEM(tool, 10, PyFloat_FromDouble(t.diameter));
-        PyStructSequence_SET_ITEM(tool, 11, PyFloat_FromDouble(t.frontangle));
-        PyStructSequence_SET_ITEM(tool, 12, PyFloat_FromDouble(t.backangle));
-        PyStructSequence_SET_ITEM(tool, 13, PyInt_FromLong(t.orientation));
-        PyTuple_SetItem(res, j, tool);
-        j++;
-    }
-    _PyTuple_Resize(&res, j);
-    return res;
+    if(!s->tooldata || s->tooldata->attach() != 0) {
+        PyObject *res = PyTuple_New(1);
+        PyTuple_SetItem(res, 0, tool_result(s->status.io.tool.spindleTool));
+        return res;
+    }
+
+    unsigned int generation = s->tooldata->generation();
+    if(!s->tool_table || generation != s->tool_table_generation) {
+        int pockets = s->tooldata->pockets();
+        if(pockets < 1) pockets = 1;	// there is always a spindle
+        PyObject *res = PyTuple_New(pockets);
+        for(int i=0; i<pockets; i++) {
+            CANON_TOOL_TABLE t;
+            if(s->tooldata->get(i, t) != 0) {
+                // the writer is stuck; keep what we had
+                Py_DECREF(res);
+                if(!s->tool_table) return PyTuple_New(0);
+                Py_INCREF(s->tool_table);
+                return s->tool_table;
+            }
+            PyTuple_SetItem(res, i, tool_result(t));
+        }
+        Py_XDECREF(s->tool_table);
+        s->tool_table = res;
+        s->tool_table_generation = generation;
+    }
+    Py_INCREF(s->tool_table);
+    return s->tool_table;
 }
 
 static PyObject *Stat_axes(pyStatChannel *s) {
@@ -643,7 +680,6 @@ static PyObject *Stat_axes(pyStatChannel *s) {
     return PyInt_FromLong(s->status.motion.traj.deprecated_axes);
 }
 
-// XXX io.tool.toolTable
 // XXX EMC_JOINT_STAT motion.joint[]
 
 static PyGetSetDef Stat_getsetlist[] = {
@@ -1755,16 +1791,51 @@ struct logger_point {
 };
 
 #define NUMCOLORS (6)
-#define MAX_POINTS (10000)
+
+/* The backplot is kept in a ring of fixed size chunks.  When the ring is
+ * full the oldest chunk is reused, so points never move once written and
+ * a chunk that has filled up can be compiled into display lists once.
+ * Filled chunks also keep coarser copies for zoomed out views, each with
+ * about one point in four of the level below.
+ *
+ * The plot used to keep LOGGER_MAX_POINTS points, at most one per poll
+ * interval.  The ring grows so that it covers as much time when points
+ * come from every servo cycle.
+ */
+#define LOGGER_CHUNK_POINTS (1024)
+#define LOGGER_MAX_POINTS (10000)
+#define LOGGER_MIN_CHUNKS (16)
+#define LOGGER_MAX_CHUNKS (1024)
+#define LOGGER_LODS (3)
+#define LOGGER_FEED_BATCH (256)
+
+struct logger_chunk {
+    struct logger_point p[LOGGER_CHUNK_POINTS];
+    volatile int npts;
+    unsigned serial;        // changes whenever the chunk is reused
+    bool sealed;            // full, p and lod no longer change
+    struct logger_point *lod[LOGGER_LODS];
+    int lod_npts[LOGGER_LODS];
+    float min[3], max[3];   // bounding box, valid once sealed
+    GLuint lists;           // one display list per level, made by call()
+    GLuint dead_lists;      // lists of the chunk before it was reused
+    unsigned list_serial[LOGGER_LODS+1];
+};
+
 typedef struct {
     PyObject_HEAD
-    int npts, mpts, lpts;
-    struct logger_point *p;
+    int npts;
+    struct logger_chunk **chunks;
+    int maxchunks, first, nchunks;
+    unsigned serial;
+    struct logger_point lastp;  // newest point drawn by call()
+    bool have_lastp;
     struct color colors[NUMCOLORS];
-    bool exit, clear, changed;
+    bool exit, clear;
     char *geometry;
     int is_xyuv;
     double foam_z, foam_w;
+    unsigned int overruns;
     pyStatChannel *st;
 } pyPositionLogger;
 
@@ -1788,17 +1859,23 @@ static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 static void LOCK() { pthread_mutex_lock(&mutex); }
 static void UNLOCK() { pthread_mutex_unlock(&mutex); }
 
+static int Logger_grow(pyPositionLogger *s, int n);
+
 static int Logger_init(pyPositionLogger *self, PyObject *a, PyObject *k) {
     char *geometry;
     struct color *c = self->colors;
-    self->p = (logger_point*)malloc(0);
-    self->npts = self->mpts = 0;
+    self->chunks = 0;
+    self->maxchunks = 0;
+    self->npts = 0;
+    self->first = self->nchunks = 0;
+    self->serial = 0;
+    self->have_lastp = 0;
     self->exit = self->clear = 0;
-    self->changed = 1;
     self->st = 0;
     self->is_xyuv = 0;
     self->foam_z = 0;
     self->foam_w = 1.5;  // temporarily hard-code
+    self->overruns = 0;
     if(!PyArg_ParseTuple(a, "O!(BBBB)(BBBB)(BBBB)(BBBB)(BBBB)(BBBB)s|i",
             &Stat_Type, &self->st,
             &c[0].r,&c[0].g, &c[0].b, &c[0].a,
@@ -1810,13 +1887,40 @@ static int Logger_init(pyPositionLogger *self, PyObject *a, PyObject *k) {
             &geometry, &self->is_xyuv
             ))
         return -1;
+    if(Logger_grow(self, LOGGER_MIN_CHUNKS) < 0) {
+        PyErr_NoMemory();
+        return -1;
+    }
     Py_INCREF(self->st);
     self->geometry = strdup(geometry);
     return 0;
 }
 
+static struct logger_chunk *Logger_new_chunk() {
+    struct logger_chunk *ch =
+        (struct logger_chunk*)calloc(1, sizeof(struct logger_chunk));
+    if(!ch) return NULL;
+    for(int k = 0; k < LOGGER_LODS; k++) {
+        ch->lod[k] = (struct logger_point*)malloc(sizeof(struct logger_point)
+                * ((LOGGER_CHUNK_POINTS >> (2*k+2)) + 2));
+        if(!ch->lod[k]) {
+            while(k--) free(ch->lod[k]);
+            free(ch);
+            return NULL;
+        }
+    }
+    return ch;
+}
+
+static void Logger_free_chunk(struct logger_chunk *ch) {
+    if(!ch) return;
+    for(int k = 0; k < LOGGER_LODS; k++) free(ch->lod[k]);
+    free(ch);
+}
+
 static void Logger_dealloc(pyPositionLogger *s) {
-    free(s->p);
+    for(int i = 0; i < s->maxchunks; i++) Logger_free_chunk(s->chunks[i]);
+    free(s->chunks);
     Py_XDECREF(s->st);
     free(s->geometry);
     PyObject_Del(s);
@@ -1837,11 +1941,208 @@ static double dist2(double x1, double y1, double x2, double y2) {
     return dx*dx + dy*dy;
 }
 
+static struct logger_chunk *Logger_tail(pyPositionLogger *s) {
+    if(!s->nchunks) return NULL;
+    return s->chunks[(s->first + s->nchunks - 1) % s->maxchunks];
+}
+
+// Make room for n chunks, keeping the plot.  Only the sampler thread
+// changes the ring; call() is kept out while it moves.
+static int Logger_grow(pyPositionLogger *s, int n) {
+    if(n > LOGGER_MAX_CHUNKS) n = LOGGER_MAX_CHUNKS;
+    if(n <= s->maxchunks) return 0;
+    struct logger_chunk **chunks =
+        (struct logger_chunk**)calloc(n, sizeof(*chunks));
+    if(!chunks) return -1;
+    LOCK();
+    for(int i = 0; i < s->maxchunks; i++)
+        chunks[i] = s->chunks[(s->first + i) % s->maxchunks];
+    free(s->chunks);
+    s->chunks = chunks;
+    s->maxchunks = n;
+    s->first = 0;
+    UNLOCK();
+    return 0;
+}
+
+static void Logger_reset(pyPositionLogger *s) {
+    LOCK();
+    s->first = s->nchunks = 0;
+    s->npts = 0;
+    s->have_lastp = 0;
+    UNLOCK();
+}
+
+static inline void bbox_add(float *mn, float *mx, float x, float y, float z) {
+    mn[0] = fmin(mn[0], x); mx[0] = fmax(mx[0], x);
+    mn[1] = fmin(mn[1], y); mx[1] = fmax(mx[1], y);
+    mn[2] = fmin(mn[2], z); mx[2] = fmax(mx[2], z);
+}
+
+// Build the bounding box and the decimated copies of a full chunk.  Only
+// the sampler thread writes chunks, and call() ignores these fields until
+// the chunk is marked sealed, so this runs without the lock.
+static void Logger_build_lods(pyPositionLogger *s, struct logger_chunk *ch) {
+    const struct logger_point *src = ch->p;
+    int n = ch->npts;
+
+    ch->min[0] = ch->min[1] = ch->min[2] = HUGE_VAL;
+    ch->max[0] = ch->max[1] = ch->max[2] = -HUGE_VAL;
+    for(int i = 0; i < n; i++) {
+        bbox_add(ch->min, ch->max, src[i].x, src[i].y, src[i].z);
+        if(s->is_xyuv)
+            bbox_add(ch->min, ch->max, src[i].rx, src[i].ry, src[i].rz);
+    }
+
+    for(int k = 0; k < LOGGER_LODS; k++) {
+        struct logger_point *dst = ch->lod[k];
+        int m = 0;
+        for(int i = 0; i < n; i += 4) dst[m++] = src[i];
+        if((n - 1) % 4) dst[m++] = src[n-1];
+        ch->lod_npts[k] = m;
+        src = dst;
+        n = m;
+    }
+}
+
+// Start a new chunk, reusing the oldest one when the ring is full.  The
+// new chunk begins with a copy of the newest point so that line strips
+// drawn chunk by chunk stay connected.
+static struct logger_chunk *Logger_open_chunk(pyPositionLogger *s) {
+    struct logger_chunk *prev = Logger_tail(s), *ch;
+    int slot = (s->first + s->nchunks) % s->maxchunks;
+
+    if(prev) Logger_build_lods(s, prev);
+    if(!s->chunks[slot]) {
+        s->chunks[slot] = Logger_new_chunk();
+        if(!s->chunks[slot]) return NULL;
+    }
+
+    LOCK();
+    if(prev) prev->sealed = true;
+    if(s->nchunks == s->maxchunks) {
+        s->npts -= s->chunks[s->first]->npts;
+        s->first = (s->first + 1) % s->maxchunks;
+        s->nchunks--;
+    }
+    ch = s->chunks[slot];
+    // there is no GL context here; call() deletes the old lists
+    if(ch->lists) {
+        ch->dead_lists = ch->lists;
+        ch->lists = 0;
+    }
+    ch->npts = 0;
+    ch->sealed = false;
+    ch->serial = ++s->serial;
+    if(prev) {
+        ch->p[0] = prev->p[prev->npts-1];
+        ch->npts = 1;
+        s->npts++;
+    }
+    s->nchunks++;
+    UNLOCK();
+    return ch;
+}
+
+static void Logger_sample(pyPositionLogger *s, EMC_STAT *status,
+        const EmcPose &pos) {
+    int colornum = 2;
+    colornum = status->motion.traj.motion_type;
+    if(colornum < 0 || colornum > NUMCOLORS) colornum = 0;
+    struct color c = s->colors[colornum];
+    struct logger_chunk *ch = Logger_tail(s);
+    int n = ch ? ch->npts : 0;
+    struct logger_point *op = n >= 1 ? &ch->p[n-1] : 0;
+    struct logger_point *oop = n >= 2 ? &ch->p[n-2] : op;
+    bool add_point = n < 2 || c != op->c;
+    double x, y, z, rx, ry, rz;
+    if(s->is_xyuv) {
+        x = pos.tran.x - status->task.toolOffset.tran.x,
+        y = pos.tran.y - status->task.toolOffset.tran.y,
+        z = s->foam_z;
+        rx = pos.u - status->task.toolOffset.u,
+        ry = pos.v - status->task.toolOffset.v,
+        rz = s->foam_w;
+        /* TODO .01, the distance at which a preview line is dropped,
+         * should either be dependent on units or configurable, because
+         * 0.1 is inappropriate for mm systems
+         */
+        add_point = add_point || (dist2(x, y, oop->x, oop->y) > .01)
+            || (dist2(rx, ry, oop->rx, oop->ry) > .01);
+        add_point = add_point || !colinear( x, y, z,
+                        op->x, op->y, op->z,
+                        oop->x, oop->y, oop->z);
+        add_point = add_point || !colinear( rx, ry, rz,
+                        op->rx, op->ry, op->rz,
+                        oop->rx, oop->ry, oop->rz);
+    } else {
+        double pt[9] = {
+            pos.tran.x - status->task.toolOffset.tran.x,
+            pos.tran.y - status->task.toolOffset.tran.y,
+            pos.tran.z - status->task.toolOffset.tran.z,
+            pos.a - status->task.toolOffset.a,
+            pos.b - status->task.toolOffset.b,
+            pos.c - status->task.toolOffset.c,
+            pos.u - status->task.toolOffset.u,
+            pos.v - status->task.toolOffset.v,
+            pos.w - status->task.toolOffset.w};
+
+        double p[3];
+        vertex9(pt, p, s->geometry);
+        x = p[0]; y = p[1]; z = p[2];
+        rx = pt[3]; ry = -pt[4]; rz = pt[5];
+
+        add_point = add_point || !colinear( x, y, z,
+                        op->x, op->y, op->z,
+                        oop->x, oop->y, oop->z);
+    }
+    if(add_point) {
+        // 1 or 2 points may be added, start a new chunk whenever
+        // fewer than 2 are left
+        bool changed_color = n && c != op->c;
+        if(!ch || n+2 > LOGGER_CHUNK_POINTS) {
+            ch = Logger_open_chunk(s);
+            if(!ch) return;
+            n = ch->npts;
+            op = n ? &ch->p[n-1] : 0;
+        }
+        if(changed_color) {
+            {
+            struct logger_point &np = ch->p[n];
+            np.x = op->x; np.y = op->y; np.z = op->z;
+            np.rx = rx; np.ry = ry; np.rz = rz;
+            np.c = np.c2 = c;
+            }
+            {
+            struct logger_point &np = ch->p[n+1];
+            np.x = x; np.y = y; np.z = z;
+            np.rx = rx; np.ry = ry; np.rz = rz;
+            np.c = np.c2 = c;
+            }
+            ch->npts = n + 2;
+            s->npts += 2;
+        } else {
+            struct logger_point &np = ch->p[n];
+            np.x = x; np.y = y; np.z = z;
+            np.rx = rx; np.ry = ry; np.rz = rz;
+            np.c = np.c2 = c;
+            ch->npts = n + 1;
+            s->npts++;
+        }
+    } else {
+        struct logger_point &np = ch->p[n-1];
+        np.x = x; np.y = y; np.z = z;
+        np.rx = rx; np.ry = ry; np.rz = rz;
+    }
+}
+
 static PyObject *Logger_start(pyPositionLogger *s, PyObject *o) {
     double interval;
+    int use_feed = 0;
     struct timespec ts;
 
-    if(!PyArg_ParseTuple(o, "d:logger.start", &interval)) return NULL;
+    if(!PyArg_ParseTuple(o, "d|i:logger.start", &interval, &use_feed))
+        return NULL;
     ts.tv_sec = (int)interval;
     ts.tv_nsec = (long int)(1e9 * (interval - ts.tv_sec));
 
@@ -1849,116 +2150,50 @@ static PyObject *Logger_start(pyPositionLogger *s, PyObject *o) {
 
     s->exit = 0;
     s->clear = 0;
-    s->npts = 0;
+    Logger_reset(s);
 
     Py_BEGIN_ALLOW_THREADS
+    // With use_feed, every servo cycle recorded by motion is plotted
+    // instead of one status snapshot per interval.  Without motion
+    // telemetry (motmod telemetry=1) this falls back to polling.
+    emcmot_telemetry_rec_t *recs = 0;
+    unsigned int cursor = 0;
+    bool sized = false;
+    use_feed = use_feed && usrmotInit("positionlogger") == 0;
+    if(use_feed) {
+        recs = (emcmot_telemetry_rec_t*)
+            malloc(sizeof(emcmot_telemetry_rec_t) * LOGGER_FEED_BATCH);
+        cursor = usrmotEmcmotTelemetrySeq();
+    }
     while(!s->exit) {
         if(s->clear) {
-            s->npts = 0;
-            s->lpts = 0;
+            Logger_reset(s);
             s->clear = 0;
         }
         if(s->st->c->valid() && s->st->c->peek() == EMC_STAT_TYPE) {
             EMC_STAT *status = static_cast<EMC_STAT*>(s->st->c->get_address());
-            int colornum = 2;
-            colornum = status->motion.traj.motion_type;
-            if(colornum < 0 || colornum > NUMCOLORS) colornum = 0;
-            struct color c = s->colors[colornum];
-            struct logger_point *op = &s->p[s->npts-1];
-            struct logger_point *oop = &s->p[s->npts-2];
-            bool add_point = s->npts < 2 || c != op->c;
-            double x, y, z, rx, ry, rz;
-            if(s->is_xyuv) {
-                x = status->motion.traj.position.tran.x - status->task.toolOffset.tran.x,
-                y = status->motion.traj.position.tran.y - status->task.toolOffset.tran.y,
-                z = s->foam_z;
-                rx = status->motion.traj.position.u - status->task.toolOffset.u,
-                ry = status->motion.traj.position.v - status->task.toolOffset.v,
-                rz = s->foam_w;
-                /* TODO .01, the distance at which a preview line is dropped,
-                 * should either be dependent on units or configurable, because
-                 * 0.1 is inappropriate for mm systems
-                 */
-                add_point = add_point || (dist2(x, y, oop->x, oop->y) > .01)
-                    || (dist2(rx, ry, oop->rx, oop->ry) > .01);
-                add_point = add_point || !colinear( x, y, z,
-                                op->x, op->y, op->z,
-                                oop->x, oop->y, oop->z);
-                add_point = add_point || !colinear( rx, ry, rz,
-                                op->rx, op->ry, op->rz,
-                                oop->rx, oop->ry, oop->rz);
-            } else {
-                double pt[9] = {
-                    status->motion.traj.position.tran.x - status->task.toolOffset.tran.x,
-                    status->motion.traj.position.tran.y - status->task.toolOffset.tran.y,
-                    status->motion.traj.position.tran.z - status->task.toolOffset.tran.z,
-                    status->motion.traj.position.a - status->task.toolOffset.a,
-                    status->motion.traj.position.b - status->task.toolOffset.b,
-                    status->motion.traj.position.c - status->task.toolOffset.c,
-                    status->motion.traj.position.u - status->task.toolOffset.u,
-                    status->motion.traj.position.v - status->task.toolOffset.v,
-                    status->motion.traj.position.w - status->task.toolOffset.w};
-
-                double p[3];
-                vertex9(pt, p, s->geometry);
-                x = p[0]; y = p[1]; z = p[2];
-                rx = pt[3]; ry = -pt[4]; rz = pt[5];
-
-                add_point = add_point || !colinear( x, y, z,
-                                op->x, op->y, op->z,
-                                oop->x, oop->y, oop->z);
-            }
-            if(add_point) {
-                // 1 or 2 points may be added, make room whenever
-                // fewer than 2 are left
-                bool changed_color = s->npts && c != op->c;
-                if(s->npts+2 > s->mpts) {
-                    LOCK();
-                    if(s->mpts >= MAX_POINTS) {
-                        int adjust = MAX_POINTS / 10;
-                        if(adjust < 2) adjust = 2;
-                        s->npts -= adjust;
-                        memmove(s->p, s->p + adjust, 
-                                sizeof(struct logger_point) * s->npts);
-                    } else {
-                        s->mpts = 2 * s->mpts + 2;
-                        s->changed = 1;
-                        s->p = (struct logger_point*) realloc(s->p,
-                                    sizeof(struct logger_point) * s->mpts);
-                    }
-                    UNLOCK();
-                    op = &s->p[s->npts-1];
-                    oop = &s->p[s->npts-2];
-                }
-                if(changed_color) {
-                    {
-                    struct logger_point &np = s->p[s->npts];
-                    np.x = op->x; np.y = op->y; np.z = op->z;
-                    np.rx = rx; np.ry = ry; np.rz = rz;
-                    np.c = np.c2 = c;
-                    }
-                    {
-                    struct logger_point &np = s->p[s->npts+1];
-                    np.x = x; np.y = y; np.z = z;
-                    np.rx = rx; np.ry = ry; np.rz = rz;
-                    np.c = np.c2 = c;
-                    }
-                    s->npts += 2;
-                } else {
-                    struct logger_point &np = s->p[s->npts];
-                    np.x = x; np.y = y; np.z = z;
-                    np.rx = rx; np.ry = ry; np.rz = rz;
-                    np.c = np.c2 = c;
-                    s->npts++;
-                }
-            } else {
-                struct logger_point &np = s->p[s->npts-1];
-                np.x = x; np.y = y; np.z = z;
-                np.rx = rx; np.ry = ry; np.rz = rz;
+            int n = recs ? usrmotReadEmcmotTelemetry(&cursor, recs,
+                        LOGGER_FEED_BATCH, &s->overruns) : -1;
+            if(n >= 2 && !sized) {
+                // as many more chunks as servo cycles per interval
+                double period = (recs[n-1].timestamp - recs[0].timestamp)
+                    * 1e-9 / (n-1);
+                if(period > 0 && period < interval)
+                    Logger_grow(s, (int)ceil(LOGGER_MAX_POINTS * interval
+                                / period / LOGGER_CHUNK_POINTS));
+                sized = true;
             }
+            if(n < 0)
+                Logger_sample(s, status, status->motion.traj.position);
+            for(int i = 0; i < n; i++)
+                Logger_sample(s, status, recs[i].pos_cmd);
         }
         nanosleep(&ts, NULL);
     }
+    if(use_feed) {
+        free(recs);
+        usrmotExit();
+    }
     Py_END_ALLOW_THREADS
     Py_DECREF(s->st);
     Py_INCREF(Py_None);
@@ -1977,33 +2212,95 @@ static PyObject* Logger_stop(pyPositionLogger *s, PyObject *o) {
     return Py_None;
 }
 
+static void Logger_draw(pyPositionLogger *s, const struct logger_point *p,
+        int n) {
+    if(s->is_xyuv) {
+        glVertexPointer(3, GL_FLOAT, sizeof(struct logger_point)/2, &p->x);
+        glColorPointer(4, GL_UNSIGNED_BYTE,
+                sizeof(struct logger_point)/2, &p->c);
+        glDrawArrays(GL_LINES, 0, 2*n);
+    } else {
+        glVertexPointer(3, GL_FLOAT, sizeof(struct logger_point), &p->x);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(struct logger_point), &p->c);
+        glDrawArrays(GL_LINE_STRIP, 0, n);
+    }
+}
+
+// Pick the coarsest level of a sealed chunk that still has a point for
+// every pixel its bounding box spans on screen.  m is projection *
+// modelview, column major as OpenGL returns it.
+static int Logger_chunk_lod(const struct logger_chunk *ch,
+        const double *m, const GLint *vp) {
+    double sx0 = HUGE_VAL, sy0 = HUGE_VAL, sx1 = -HUGE_VAL, sy1 = -HUGE_VAL;
+    for(int i = 0; i < 8; i++) {
+        double x = (i & 1) ? ch->max[0] : ch->min[0];
+        double y = (i & 2) ? ch->max[1] : ch->min[1];
+        double z = (i & 4) ? ch->max[2] : ch->min[2];
+        double w = m[3]*x + m[7]*y + m[11]*z + m[15];
+        if(w <= 0) return 0;
+        double sx = (m[0]*x + m[4]*y + m[8]*z + m[12]) / w * vp[2] / 2;
+        double sy = (m[1]*x + m[5]*y + m[9]*z + m[13]) / w * vp[3] / 2;
+        sx0 = fmin(sx0, sx); sx1 = fmax(sx1, sx);
+        sy0 = fmin(sy0, sy); sy1 = fmax(sy1, sy);
+    }
+    double pixels = hypot(sx1 - sx0, sy1 - sy0);
+    int level = 0;
+    while(level < LOGGER_LODS && ch->lod_npts[level] >= pixels) level++;
+    return level;
+}
+
+static void Logger_get_transform(double *m, GLint *vp) {
+    double mv[16], pr[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, mv);
+    glGetDoublev(GL_PROJECTION_MATRIX, pr);
+    glGetIntegerv(GL_VIEWPORT, vp);
+    for(int c = 0; c < 4; c++)
+        for(int r = 0; r < 4; r++)
+            m[4*c+r] = pr[r]*mv[4*c] + pr[4+r]*mv[4*c+1]
+                + pr[8+r]*mv[4*c+2] + pr[12+r]*mv[4*c+3];
+}
+
 static PyObject* Logger_call(pyPositionLogger *s, PyObject *o) {
     if(!s->clear) {
+        double m[16];
+        GLint vp[4];
+        Logger_get_transform(m, vp);
         LOCK();
-        if(s->is_xyuv) {
-            if(s->changed) {
-                glVertexPointer(3, GL_FLOAT,
-                        sizeof(struct logger_point)/2, &s->p->x);
-                glColorPointer(4, GL_UNSIGNED_BYTE,
-                        sizeof(struct logger_point)/2, &s->p->c);
-                glEnableClientState(GL_COLOR_ARRAY);
-                glEnableClientState(GL_VERTEX_ARRAY);
-                s->changed = 0;
+        for(int i = 0; i < s->maxchunks; i++) {
+            struct logger_chunk *ch = s->chunks[i];
+            if(ch && ch->dead_lists) {
+                glDeleteLists(ch->dead_lists, LOGGER_LODS+1);
+                ch->dead_lists = 0;
             }
-            s->lpts = s->npts;
-            glDrawArrays(GL_LINES, 0, 2*s->npts);
-        } else {
-            if(s->changed) {
-                glVertexPointer(3, GL_FLOAT,
-                        sizeof(struct logger_point), &s->p->x);
-                glColorPointer(4, GL_UNSIGNED_BYTE,
-                        sizeof(struct logger_point), &s->p->c);
-                glEnableClientState(GL_COLOR_ARRAY);
-                glEnableClientState(GL_VERTEX_ARRAY);
-                s->changed = 0;
+        }
+        glEnableClientState(GL_COLOR_ARRAY);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        for(int i = 0; i < s->nchunks; i++) {
+            struct logger_chunk *ch = s->chunks[(s->first + i) % s->maxchunks];
+            if(!ch->sealed) {
+                Logger_draw(s, ch->p, ch->npts);
+                continue;
+            }
+            int level = Logger_chunk_lod(ch, m, vp);
+            const struct logger_point *p = level ? ch->lod[level-1] : ch->p;
+            int n = level ? ch->lod_npts[level-1] : ch->npts;
+            if(!ch->lists) ch->lists = glGenLists(LOGGER_LODS+1);
+            if(!ch->lists) {
+                Logger_draw(s, p, n);
+                continue;
+            }
+            if(ch->list_serial[level] != ch->serial) {
+                glNewList(ch->lists + level, GL_COMPILE);
+                Logger_draw(s, p, n);
+                glEndList();
+                ch->list_serial[level] = ch->serial;
             }
-            s->lpts = s->npts;
-            glDrawArrays(GL_LINE_STRIP, 0, s->npts);
+            glCallList(ch->lists + level);
+        }
+        struct logger_chunk *tail = Logger_tail(s);
+        if(tail && tail->npts) {
+            s->lastp = tail->p[tail->npts-1];
+            s->have_lastp = 1;
         }
         UNLOCK();
     }
@@ -2016,13 +2313,19 @@ static PyObject *Logger_last(pyPositionLogger *s, PyObject *o) {
     if(!PyArg_ParseTuple(o, "|i:emc.positionlogger.last", &flag)) return NULL;
     PyObject *result = NULL;
     LOCK();
-    int idx = flag ? s->lpts : s->npts;
-    if(!idx) {
+    struct logger_chunk *tail = Logger_tail(s);
+    struct logger_point *pp = 0;
+    if(flag) {
+        if(s->have_lastp) pp = &s->lastp;
+    } else if(tail && tail->npts) {
+        pp = &tail->p[tail->npts-1];
+    }
+    if(!pp) {
         Py_INCREF(Py_None);
         result = Py_None;
     } else {
         result = PyTuple_New(6);
-        struct logger_point &p = s->p[idx-1];
+        struct logger_point &p = *pp;
         PyTuple_SET_ITEM(result, 0, PyFloat_FromDouble(p.x));
         PyTuple_SET_ITEM(result, 1, PyFloat_FromDouble(p.y));
         PyTuple_SET_ITEM(result, 2, PyFloat_FromDouble(p.z));
@@ -2036,12 +2339,15 @@ static PyObject *Logger_last(pyPositionLogger *s, PyObject *o) {
 
 static PyMemberDef Logger_members[] = {
     {(char*)"npts", T_INT, offsetof(pyPositionLogger, npts), READONLY},
+    {(char*)"overruns", T_UINT, offsetof(pyPositionLogger, overruns), READONLY},
     {0, 0, 0, 0},
 };
 
 static PyMethodDef Logger_methods[] = {
     {"start", (PyCFunction)Logger_start, METH_VARARGS,
-        "Start the position logger and run every ARG seconds"},
+        "Start the position logger and run every ARG seconds.  If the "
+        "optional second argument is true, plot every servo cycle from "
+        "the motion telemetry ring when it is enabled"},
     {"clear", (PyCFunction)Logger_clear, METH_NOARGS,
         "Clear the position logger"},
     {"stop", (PyCFunction)Logger_stop, METH_NOARGS,
@@ -2100,6 +2406,529 @@ static PyTypeObject PositionLoggerType = {
     0,                      /*tp_is_gc*/
 };
 
+/* Spatial index over the preview segments, so that picking a line in the
+ * preview does not need to render the whole program in GL_SELECT mode.
+ * The segments are transformed with vertex9 like draw_lines does, and
+ * kept in a bounding volume hierarchy that is built once per load.
+ */
+struct pick_segment {
+    float a[3], b[3];
+    int line;
+};
+
+struct pick_node {
+    float min[3], max[3];
+    int first, count;       // leaf: segments [first, first+count)
+    int right;              // inner node: index of the second child
+};
+
+#define PICK_LEAF_SIZE (4)
+
+struct pick_index {
+    std::vector<pick_segment> seg;
+    std::vector<pick_node> node;
+    bool built;
+};
+
+typedef struct {
+    PyObject_HEAD
+    pick_index *idx;
+} pyPickIndex;
+
+static int Pick_init(pyPickIndex *self, PyObject *a, PyObject *k) {
+    if(!PyArg_ParseTuple(a, ":pickindex")) return -1;
+    delete self->idx;
+    self->idx = new pick_index;
+    self->idx->built = false;
+    return 0;
+}
+
+static void Pick_dealloc(pyPickIndex *self) {
+    delete self->idx;
+    PyObject_Del(self);
+}
+
+static void pick_add(pick_index *idx, const double p1[3], const double p2[3],
+        int line) {
+    pick_segment s;
+    for(int i = 0; i < 3; i++) { s.a[i] = p1[i]; s.b[i] = p2[i]; }
+    s.line = line;
+    idx->seg.push_back(s);
+    idx->built = false;
+}
+
+// Add the segments that line9 would draw between p1 and p2.
+static void pick_add_line9(pick_index *idx, const double p1[9],
+        const double p2[9], const char *geometry, double zoffset, int line) {
+    double a[3], b[3];
+    vertex9(p1, a, geometry);
+    a[2] += zoffset;
+    if(p1[3] != p2[3] || p1[4] != p2[4] || p1[5] != p2[5]) {
+        double dc = max3(
+            fabs(p2[3] - p1[3]),
+            fabs(p2[4] - p1[4]),
+            fabs(p2[5] - p1[5]));
+        int st = (int)ceil(max(10, dc/10));
+
+        for(int i=1; i<=st; i++) {
+            double t = i * 1.0 / st;
+            double v = 1.0 - t;
+            double pt[9];
+            for(int j=0; j<9; j++) { pt[j] = t * p2[j] + v * p1[j]; }
+            vertex9(pt, b, geometry);
+            b[2] += zoffset;
+            pick_add(idx, a, b, line);
+            memcpy(a, b, sizeof(a));
+        }
+    } else {
+        vertex9(p2, b, geometry);
+        b[2] += zoffset;
+        pick_add(idx, a, b, line);
+    }
+}
+
+static void pick_bounds(const pick_segment &s, float *mn, float *mx) {
+    for(int i = 0; i < 3; i++) {
+        mn[i] = s.a[i] < s.b[i] ? s.a[i] : s.b[i];
+        mx[i] = s.a[i] < s.b[i] ? s.b[i] : s.a[i];
+    }
+}
+
+struct pick_centroid_less {
+    int axis;
+    bool operator()(const pick_segment &p, const pick_segment &q) const {
+        return p.a[axis] + p.b[axis] < q.a[axis] + q.b[axis];
+    }
+};
+
+static int pick_build_node(pick_index *idx, int first, int count) {
+    int n = idx->node.size();
+    idx->node.push_back(pick_node());
+    pick_node nd;
+    float cmin[3], cmax[3];
+    pick_bounds(idx->seg[first], nd.min, nd.max);
+    for(int i = 0; i < 3; i++)
+        cmin[i] = cmax[i] = idx->seg[first].a[i] + idx->seg[first].b[i];
+    for(int j = first + 1; j < first + count; j++) {
+        const pick_segment &s = idx->seg[j];
+        float mn[3], mx[3];
+        pick_bounds(s, mn, mx);
+        for(int i = 0; i < 3; i++) {
+            if(mn[i] < nd.min[i]) nd.min[i] = mn[i];
+            if(mx[i] > nd.max[i]) nd.max[i] = mx[i];
+            float c = s.a[i] + s.b[i];
+            if(c < cmin[i]) cmin[i] = c;
+            if(c > cmax[i]) cmax[i] = c;
+        }
+    }
+    nd.first = first;
+    nd.count = count;
+    nd.right = 0;
+    if(count > PICK_LEAF_SIZE) {
+        // split at the median along the widest spread of centroids
+        pick_centroid_less less;
+        less.axis = 0;
+        for(int i = 1; i < 3; i++)
+            if(cmax[i] - cmin[i] > cmax[less.axis] - cmin[less.axis])
+                less.axis = i;
+        int half = count / 2;
+        std::nth_element(idx->seg.begin() + first,
+                idx->seg.begin() + first + half,
+                idx->seg.begin() + first + count, less);
+        nd.count = 0;
+        pick_build_node(idx, first, half);
+        nd.right = pick_build_node(idx, first + half, count - half);
+    }
+    idx->node[n] = nd;
+    return n;
+}
+
+static void pick_build(pick_index *idx) {
+    if(idx->built) return;
+    idx->node.clear();
+    if(!idx->seg.empty())
+        pick_build_node(idx, 0, idx->seg.size());
+    idx->built = true;
+}
+
+static PyObject *Pick_add_lines(pyPickIndex *s, PyObject *o) {
+    PyListObject *li;
+    char *geometry;
+    double zoffset = 0;
+    double p1[9], p2[9];
+    int n;
+
+    if(!PyArg_ParseTuple(o, "sO!|d:pickindex.add_lines",
+                &geometry, &PyList_Type, &li, &zoffset))
+        return NULL;
+
+    for(int i=0; i<PyList_GET_SIZE(li); i++) {
+        PyObject *it = PyList_GET_ITEM(li, i);
+        PyObject *dummy1, *dummy2, *dummy3;
+        if(!PyArg_ParseTuple(it, "i(ddddddddd)(ddddddddd)|OOO", &n,
+                    p1+0, p1+1, p1+2,
+                    p1+3, p1+4, p1+5,
+                    p1+6, p1+7, p1+8,
+                    p2+0, p2+1, p2+2,
+                    p2+3, p2+4, p2+5,
+                    p2+6, p2+7, p2+8,
+                    &dummy1, &dummy2, &dummy3))
+            return NULL;
+        pick_add_line9(s->idx, p1, p2, geometry, zoffset, n);
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *Pick_add_dwells(pyPickIndex *s, PyObject *o) {
+    PyListObject *li;
+    double delta = 0.015625;
+
+    if(!PyArg_ParseTuple(o, "O!:pickindex.add_dwells", &PyList_Type, &li))
+        return NULL;
+
+    for(int i=0; i<PyList_GET_SIZE(li); i++) {
+        PyObject *it = PyList_GET_ITEM(li, i);
+        double red, green, blue, p[3];
+        int n, axis;
+        if(!PyArg_ParseTuple(it, "i(ddd)dddi", &n, &red, &green, &blue,
+                    &p[0], &p[1], &p[2], &axis))
+            return NULL;
+        // the cross drawn for a dwell, as a segment across its box
+        double a[3] = {p[0]-delta, p[1]-delta, p[2]-delta};
+        double b[3] = {p[0]+delta, p[1]+delta, p[2]+delta};
+        pick_add(s->idx, a, b, n);
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *Pick_build(pyPickIndex *s, PyObject *o) {
+    pick_build(s->idx);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static Py_ssize_t Pick_len(pyPickIndex *s) {
+    return s->idx ? s->idx->seg.size() : 0;
+}
+
+// projection * modelview, column major, and its inverse
+static bool pick_get_transform(double *m, double *inv, GLint *vp) {
+    Logger_get_transform(m, vp);
+    double t[4][8];
+    for(int r = 0; r < 4; r++)
+        for(int c = 0; c < 4; c++) {
+            t[r][c] = m[4*c+r];
+            t[r][c+4] = r == c;
+        }
+    for(int c = 0; c < 4; c++) {
+        int p = c;
+        for(int r = c+1; r < 4; r++)
+            if(fabs(t[r][c]) > fabs(t[p][c])) p = r;
+        if(fabs(t[p][c]) < 1e-300) return false;
+        for(int k = 0; k < 8; k++) std::swap(t[c][k], t[p][k]);
+        double d = t[c][c];
+        for(int k = 0; k < 8; k++) t[c][k] /= d;
+        for(int r = 0; r < 4; r++) {
+            if(r == c) continue;
+            double f = t[r][c];
+            for(int k = 0; k < 8; k++) t[r][k] -= f * t[c][k];
+        }
+    }
+    for(int r = 0; r < 4; r++)
+        for(int c = 0; c < 4; c++)
+            inv[4*c+r] = t[r][c+4];
+    return true;
+}
+
+static void pick_unproject(const double *inv, double nx, double ny, double nz,
+        double p[3]) {
+    double w = inv[3]*nx + inv[7]*ny + inv[11]*nz + inv[15];
+    for(int i = 0; i < 3; i++)
+        p[i] = (inv[i]*nx + inv[4+i]*ny + inv[8+i]*nz + inv[12+i]) / w;
+}
+
+// Closest approach of segment a-b to the pick ray o + t*d, 0 <= t <= 1.
+// Returns the squared distance and the ray parameter in *tp.
+static double pick_seg_ray(const float *a, const float *b, const double *o,
+        const double *d, double *tp) {
+    double u[3], w[3];
+    for(int i = 0; i < 3; i++) { u[i] = b[i] - a[i]; w[i] = a[i] - o[i]; }
+    double uu = u[0]*u[0] + u[1]*u[1] + u[2]*u[2];
+    double ud = u[0]*d[0] + u[1]*d[1] + u[2]*d[2];
+    double dd = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+    double uw = u[0]*w[0] + u[1]*w[1] + u[2]*w[2];
+    double dw = d[0]*w[0] + d[1]*w[1] + d[2]*w[2];
+    double den = uu*dd - ud*ud;
+    double s, t;
+    if(uu < tiny) {
+        s = 0;
+        t = dw / dd;
+    } else {
+        s = den > tiny * uu * dd ? (ud*dw - dd*uw) / den : 0;
+        s = s < 0 ? 0 : s > 1 ? 1 : s;
+        t = (s*ud + dw) / dd;
+    }
+    if(t < 0 || t > 1) {
+        t = t < 0 ? 0 : 1;
+        if(uu >= tiny) {
+            s = (t*ud - uw) / uu;
+            s = s < 0 ? 0 : s > 1 ? 1 : s;
+        }
+    }
+    double r2 = 0;
+    for(int i = 0; i < 3; i++) {
+        double e = w[i] + s*u[i] - t*d[i];
+        r2 += e*e;
+    }
+    *tp = t;
+    return r2;
+}
+
+// Ray against a box grown by r on every side; returns the entry parameter
+// or a value > 1 when the ray misses.
+static double pick_ray_box(const pick_node &nd, const double *o,
+        const double *d, double r) {
+    double t0 = 0, t1 = 1;
+    for(int i = 0; i < 3; i++) {
+        double lo = nd.min[i] - r, hi = nd.max[i] + r;
+        if(fabs(d[i]) < tiny) {
+            if(o[i] < lo || o[i] > hi) return 2;
+            continue;
+        }
+        double ta = (lo - o[i]) / d[i], tb = (hi - o[i]) / d[i];
+        if(ta > tb) std::swap(ta, tb);
+        if(ta > t0) t0 = ta;
+        if(tb < t1) t1 = tb;
+        if(t0 > t1) return 2;
+    }
+    return t0;
+}
+
+static PyObject *Pick_pick(pyPickIndex *s, PyObject *o) {
+    double x, y, radius = 2.5;
+    if(!PyArg_ParseTuple(o, "dd|d:pickindex.pick", &x, &y, &radius))
+        return NULL;
+
+    double m[16], inv[16];
+    GLint vp[4];
+    if(!pick_get_transform(m, inv, vp) || vp[2] <= 0 || vp[3] <= 0) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    pick_index *idx = s->idx;
+    pick_build(idx);
+
+    // The ray runs from the near plane (t=0) to the far plane (t=1).  A
+    // pixel covers a world distance that changes linearly along it.
+    double nx = 2 * (x - vp[0]) / vp[2] - 1;
+    double ny = 2 * (y - vp[1]) / vp[3] - 1;
+    double dx = 2 * radius / vp[2];
+    double org[3], end[3], orgr[3], endr[3], dir[3];
+    pick_unproject(inv, nx, ny, -1, org);
+    pick_unproject(inv, nx, ny, 1, end);
+    pick_unproject(inv, nx + dx, ny, -1, orgr);
+    pick_unproject(inv, nx + dx, ny, 1, endr);
+    double r0 = 0, r1 = 0;
+    for(int i = 0; i < 3; i++) {
+        dir[i] = end[i] - org[i];
+        r0 += (orgr[i] - org[i]) * (orgr[i] - org[i]);
+        r1 += (endr[i] - end[i]) * (endr[i] - end[i]);
+    }
+    r0 = sqrt(r0);
+    r1 = sqrt(r1);
+    double rmax = r0 > r1 ? r0 : r1;
+
+    double best = 2;
+    int best_line = 0;
+    std::vector<int> stack;
+    if(!idx->node.empty()) stack.push_back(0);
+    while(!stack.empty()) {
+        const pick_node &nd = idx->node[stack.back()];
+        int n = stack.back();
+        stack.pop_back();
+        double tb = pick_ray_box(nd, org, dir, rmax);
+        if(tb > 1 || tb > best) continue;
+        if(nd.count) {
+            for(int j = nd.first; j < nd.first + nd.count; j++) {
+                double t;
+                double d2 = pick_seg_ray(idx->seg[j].a, idx->seg[j].b,
+                        org, dir, &t);
+                double r = r0 + (r1 - r0) * t;
+                if(d2 <= r*r && t < best) {
+                    best = t;
+                    best_line = idx->seg[j].line;
+                }
+            }
+        } else {
+            stack.push_back(nd.right);
+            stack.push_back(n + 1);
+        }
+    }
+
+    if(best > 1) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    return Py_BuildValue("(di)", best, best_line);
+}
+
+static PyObject *Pick_pick_box(pyPickIndex *s, PyObject *o) {
+    double x0, y0, x1, y1;
+    if(!PyArg_ParseTuple(o, "dddd:pickindex.pick_box", &x0, &y0, &x1, &y1))
+        return NULL;
+
+    double m[16], inv[16];
+    GLint vp[4];
+    PyObject *result = PyList_New(0);
+    if(!result) return NULL;
+    if(!pick_get_transform(m, inv, vp) || vp[2] <= 0 || vp[3] <= 0)
+        return result;
+
+    pick_index *idx = s->idx;
+    pick_build(idx);
+
+    if(x0 > x1) std::swap(x0, x1);
+    if(y0 > y1) std::swap(y0, y1);
+    double nx0 = 2 * (x0 - vp[0]) / vp[2] - 1, nx1 = 2 * (x1 - vp[0]) / vp[2] - 1;
+    double ny0 = 2 * (y0 - vp[1]) / vp[3] - 1, ny1 = 2 * (y1 - vp[1]) / vp[3] - 1;
+
+    // The box and the clip volume as planes p.(x,y,z,1) >= 0, taken from
+    // the rows of the combined matrix.
+    double pl[6][4];
+    for(int c = 0; c < 4; c++) {
+        double r0 = m[c*4], r1 = m[c*4+1], r2 = m[c*4+2], r3 = m[c*4+3];
+        pl[0][c] = r0 - nx0 * r3;
+        pl[1][c] = nx1 * r3 - r0;
+        pl[2][c] = r1 - ny0 * r3;
+        pl[3][c] = ny1 * r3 - r1;
+        pl[4][c] = r3 + r2;
+        pl[5][c] = r3 - r2;
+    }
+
+    std::vector<int> lines;
+    std::vector<int> stack;
+    if(!idx->node.empty()) stack.push_back(0);
+    while(!stack.empty()) {
+        int n = stack.back();
+        const pick_node &nd = idx->node[n];
+        stack.pop_back();
+        bool outside = false;
+        for(int k = 0; k < 6 && !outside; k++) {
+            double d = pl[k][3];
+            for(int i = 0; i < 3; i++)
+                d += pl[k][i] * (pl[k][i] > 0 ? nd.max[i] : nd.min[i]);
+            outside = d < 0;
+        }
+        if(outside) continue;
+        if(!nd.count) {
+            stack.push_back(nd.right);
+            stack.push_back(n + 1);
+            continue;
+        }
+        for(int j = nd.first; j < nd.first + nd.count; j++) {
+            const pick_segment &sg = idx->seg[j];
+            double t0 = 0, t1 = 1;
+            for(int k = 0; k < 6 && t0 <= t1; k++) {
+                double da = pl[k][3], db = pl[k][3];
+                for(int i = 0; i < 3; i++) {
+                    da += pl[k][i] * sg.a[i];
+                    db += pl[k][i] * sg.b[i];
+                }
+                if(da < 0 && db < 0) t0 = 2;
+                else if(da < 0) {
+                    double t = da / (da - db);
+                    if(t > t0) t0 = t;
+                } else if(db < 0) {
+                    double t = da / (da - db);
+                    if(t < t1) t1 = t;
+                }
+            }
+            if(t0 <= t1) lines.push_back(sg.line);
+        }
+    }
+
+    std::sort(lines.begin(), lines.end());
+    lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+    for(size_t i = 0; i < lines.size(); i++) {
+        PyObject *v = PyInt_FromLong(lines[i]);
+        PyList_Append(result, v);
+        Py_DECREF(v);
+    }
+    return result;
+}
+
+static PyMethodDef Pick_methods[] = {
+    {"add_lines", (PyCFunction)Pick_add_lines, METH_VARARGS,
+        "Add a list of lines in the 'rs274.glcanon' format, drawn with "
+        "the given geometry and optionally raised by a Z offset"},
+    {"add_dwells", (PyCFunction)Pick_add_dwells, METH_VARARGS,
+        "Add a list of dwells in the 'rs274.glcanon' format"},
+    {"build", (PyCFunction)Pick_build, METH_NOARGS,
+        "Build the index now instead of on the first pick"},
+    {"pick", (PyCFunction)Pick_pick, METH_VARARGS,
+        "pick(x, y[, radius]): nearest segment within radius pixels of "
+        "window position x, y under the current GL matrices, as "
+        "(depth, line), or None"},
+    {"pick_box", (PyCFunction)Pick_pick_box, METH_VARARGS,
+        "pick_box(x0, y0, x1, y1): sorted line numbers of the segments "
+        "inside a window rectangle under the current GL matrices"},
+    {NULL, NULL, 0, NULL},
+};
+
+static PySequenceMethods Pick_as_sequence = {
+    (lenfunc)Pick_len,      /*sq_length*/
+};
+
+static PyTypeObject PickIndexType = {
+    PyObject_HEAD_INIT(NULL)
+    0,                      /*ob_size*/
+    "linuxcnc.pickindex",   /*tp_name*/
+    sizeof(pyPickIndex),    /*tp_basicsize*/
+    0,                      /*tp_itemsize*/
+    /* methods */
+    (destructor)Pick_dealloc, /*tp_dealloc*/
+    0,                      /*tp_print*/
+    0,                      /*tp_getattr*/
+    0,                      /*tp_setattr*/
+    0,                      /*tp_compare*/
+    0,                      /*tp_repr*/
+    0,                      /*tp_as_number*/
+    &Pick_as_sequence,      /*tp_as_sequence*/
+    0,                      /*tp_as_mapping*/
+    0,                      /*tp_hash*/
+    0,                      /*tp_call*/
+    0,                      /*tp_str*/
+    0,                      /*tp_getattro*/
+    0,                      /*tp_setattro*/
+    0,                      /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,     /*tp_flags*/
+    0,                      /*tp_doc*/
+    0,                      /*tp_traverse*/
+    0,                      /*tp_clear*/
+    0,                      /*tp_richcompare*/
+    0,                      /*tp_weaklistoffset*/
+    0,                      /*tp_iter*/
+    0,                      /*tp_iternext*/
+    Pick_methods,           /*tp_methods*/
+    0,                      /*tp_members*/
+    0,                      /*tp_getset*/
+    0,                      /*tp_base*/
+    0,                      /*tp_dict*/
+    0,                      /*tp_descr_get*/
+    0,                      /*tp_descr_set*/
+    0,                      /*tp_dictoffset*/
+    (initproc)Pick_init,    /*tp_init*/
+    0,                      /*tp_alloc*/
+    PyType_GenericNew,      /*tp_new*/
+    0,                      /*tp_free*/
+    0,                      /*tp_is_gc*/
+};
+
 static PyMethodDef emc_methods[] = {
 #define METH(name, doc) { #name, (PyCFunction) py##name, METH_VARARGS, doc }
 METH(draw_lines, "Draw a bunch of lines in the 'rs274.glcanon' format"),
@@ -2139,6 +2968,8 @@ initlinuxcnc(void) {
 
     PyType_Ready(&PositionLoggerType);
     PyModule_AddObject(m, "positionlogger", (PyObject*)&PositionLoggerType);
+    PyType_Ready(&PickIndexType);
+    PyModule_AddObject(m, "pickindex", (PyObject*)&PickIndexType);
     pthread_mutex_init(&mutex, NULL);
 
     PyModule_AddStringConstant(m, "PREFIX", EMC2_HOME);
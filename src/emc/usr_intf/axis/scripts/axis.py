@@ -381,7 +381,6 @@ class MyOpengl(GlCanonDraw, Opengl):
         self.bind('<Button1-Motion>', self.select_cancel, add=True)
         self.highlight_line = None
         self.select_event = None
-        self.select_buffer_size = 100
         self.select_primed = None
         self.last_position = None
         self.last_homed = None
@@ -703,7 +702,7 @@ class LivePlotter:
             C('backplotprobing'),
             geometry, foam
         )
-        o.after_idle(lambda: thread.start_new_thread(self.logger.start, (.01,)))
+        o.after_idle(lambda: thread.start_new_thread(self.logger.start, (.01, 1)))
 
         global feedrate_blackout, rapidrate_blackout, spindlerate_blackout, maxvel_blackout
         feedrate_blackout=rapidrate_blackout=spindlerate_blackout=maxvel_blackout=time.time()+1
@@ -1427,6 +1426,7 @@ class DummyCanon:
     def get_axis_mask(self): return 7
     def get_tool(self, tool):
         return tool, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0
+    def get_pockets_max(self): return 1
     def set_feed_rate(self, rate): pass
 
     def user_defined_function(self, m, p, q):
@@ -27,7 +27,6 @@
 #include <sys/socket.h>
 #include <sys/uio.h>
 #include <netinet/in.h>
-#include <pthread.h>
 #include <errno.h>
 #include <limits.h>
 
@@ -43,6 +42,7 @@
 #include "rcs_print.hh"
 #include "timer.hh"             // etime()
 #include "shcom.hh"             // NML Messaging functions
+#include "hal/utils/rmtserver.h"	// client event loop
 
 /*
   Using linuxcncrsh:
@@ -62,6 +62,11 @@
             Make sure to include the final slash (/).
   With -- -ini <inifile>, uses inifile instead of emc.ini. 
 
+  One process serves all connections. A client may send several commands
+  without waiting for the replies; they are handled in order, the replies
+  come back in the same order, and the get commands that arrive together
+  share one status update.
+
   There are six commands supported, Where the commands set and get contain LinuxCNC
   specific sub-commands based on the commands supported by linuxcncrsh, but where the 
   usual prefix ( "emc_") is omitted. Commands and most parameters are not case sensitive.
@@ -139,6 +144,18 @@
   set the communications mode to the specified mode. The binary protocol 
   is TBD.
   
+  watch [<get command>]
+  With set, adds a get command with its parameters (e.g. "joint_pos 0") to
+  the watch list of the connection, or empties the list if none is given.
+  With get, runs every command on the list and returns their replies, all
+  taken from the same status update. This state is local to each connection.
+
+  push on | off
+  With set on, the commands on the watch list are run every 100 ms and
+  their replies are sent to the connection, without a get, whenever they
+  differ from the last reply sent. With get, returns the current push state.
+  This state is local to each connection.
+
   comm_prot <version no>
   With get, returns the current protocol version used by the server,
   with set, sets the server to use the specified protocol version,
@@ -425,7 +442,7 @@ typedef enum {
   cmdHello, cmdSet, cmdGet, cmdQuit, cmdShutdown, cmdHelp, cmdUnknown} commandTokenType;
   
 typedef enum {
-  scEcho, scVerbose, scEnable, scConfig, scCommMode, scCommProt, scIniFile,
+  scEcho, scVerbose, scEnable, scConfig, scCommMode, scWatch, scPush, scCommProt, scIniFile,
   scPlat, scIni, scDebug, scSetWait, scWait, scSetTimeout, scUpdate, scError,
   scOperatorDisplay, scOperatorText, scTime, scEStop, scMachine, scMode,
   scMist, scFlood, scLube, scLubeLevel, scSpindle, scBrake, scTool, scToolOffset,
@@ -444,6 +461,8 @@ typedef enum {
   rtNoError, rtHandledNoError, rtStandardError, rtCustomError, rtCustomHandledError
   } cmdResponseType;
   
+#define MAX_WATCH 64
+
 typedef struct {  
   int cliSock;
   char hostName[80];
@@ -456,13 +475,26 @@ typedef struct {
   int commProt;
   char inBuf[256];
   char outBuf[4096];
-  char progName[PATH_MAX];} connectionRecType;
+  char progName[PATH_MAX];
+  int watchCount;
+  char *watch[MAX_WATCH];		// get commands, e.g. "ABS_ACT_POS"
+  char *watchSent[MAX_WATCH];		// their last pushed reply
+  bool push;
+  EMC_WAIT_TYPE waitType;		// set_wait of this connection
+  double timeout;			// set_timeout of this connection
+  int lastSerial;			// the last command it sent
+  EMC_WAIT_TYPE waitFor;		// what it waits for, EMC_WAIT_POLL if nothing
+  int waitSerial;
+  double waitSince;
+  char waitCmd[32];} connectionRecType;	// set command whose reply waits
+
+#define WATCH_PERIOD 100		// ms between watch pushes
+#define RECEIVE_TIMEOUT 5.0		// s other connections wait for a command to be received
 
 int port = 5007;
 int server_sockfd;
-socklen_t server_len, client_len;
+socklen_t server_len;
 struct sockaddr_in server_address;
-struct sockaddr_in client_address;
 bool useSockets = true;
 int tokenIdx;
 const char *delims = " \n\r\0";
@@ -471,10 +503,12 @@ char pwd[16] = "EMC\0";
 char enablePWD[16] = "EMCTOO\0";
 char serverName[24] = "EMCNETSVR\0";
 int sessions = 0;
+bool statusFresh = false;		// emcStatus was updated in this pass
+double sentAt = 0.0;			// when the last command was sent
 int maxSessions = -1;
 
 const char *setCommands[] = {
-  "ECHO", "VERBOSE", "ENABLE", "CONFIG", "COMM_MODE", "COMM_PROT", "INIFILE", "PLAT", "INI", "DEBUG",
+  "ECHO", "VERBOSE", "ENABLE", "CONFIG", "COMM_MODE", "WATCH", "PUSH", "COMM_PROT", "INIFILE", "PLAT", "INI", "DEBUG",
   "SET_WAIT", "WAIT", "TIMEOUT", "UPDATE", "ERROR", "OPERATOR_DISPLAY", "OPERATOR_TEXT",
   "TIME", "ESTOP", "MACHINE", "MODE", "MIST", "FLOOD", "LUBE", "LUBE_LEVEL",
   "SPINDLE", "BRAKE", "TOOL", "TOOL_OFFSET", "LOAD_TOOL_TABLE", "HOME",
@@ -571,7 +605,7 @@ static void sigQuit(int sig)
 static int sockWrite(connectionRecType *context)
 {
    strcat(context->outBuf, "\r\n");
-   return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+   return rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
 }
 
 static setCommandType lookupSetCommand(char *s)
@@ -790,6 +824,55 @@ static cmdResponseType setCommMode(char *s, connectionRecType *context)
   return rtNoError;
 }
 
+static void clearWatch(connectionRecType *context)
+{
+  int i;
+
+  for (i = 0; i < context->watchCount; i++) {
+    free(context->watch[i]);
+    free(context->watchSent[i]);
+    }
+  context->watchCount = 0;
+}
+
+static cmdResponseType setWatch(char *s, connectionRecType *context)
+{
+  char item[256];
+  char *pch;
+  setCommandType cmd;
+
+  if (s == NULL) {
+    clearWatch(context);
+    return rtNoError;
+    }
+  while (isspace(*s)) s++;
+  if (context->watchCount >= MAX_WATCH) return rtStandardError;
+  // the first word must be something get knows
+  snprintf(item, sizeof(item), "%s", s);
+  pch = strtok(item, delims);
+  if (pch == NULL) return rtStandardError;
+  strupr(pch);
+  cmd = lookupSetCommand(pch);
+  if ((cmd == scUnknown) || (cmd == scWatch) || (cmd == scPush))
+    return rtStandardError;
+  context->watch[context->watchCount] = strdup(s);
+  if (context->watch[context->watchCount] == NULL) return rtStandardError;
+  context->watchSent[context->watchCount] = NULL;
+  context->watchCount++;
+  return rtNoError;
+}
+
+static cmdResponseType setPush(char *s, connectionRecType *context)
+{
+   
+   switch (checkOnOff(s)) {
+     case -1: return rtStandardError;
+     case 0: context->push = true; break;
+     case 1: context->push = false;
+     }
+   return rtNoError;
+}
+
 static cmdResponseType setCommProt(char *s, connectionRecType *context)
 {
   char *pVersion;
@@ -817,11 +900,11 @@ static cmdResponseType setSetWait(char *s, connectionRecType *context)
    switch (checkReceivedDoneNone(s)) {
      case -1: return rtStandardError;
      case 0: {
-       emcWaitType = EMC_WAIT_RECEIVED;
+       context->waitType = EMC_WAIT_RECEIVED;
        break;
      }
      case 1: {
-       emcWaitType = EMC_WAIT_DONE;
+       context->waitType = EMC_WAIT_DONE;
        break;
      }
      case 2: {
@@ -853,15 +936,23 @@ static cmdResponseType setEStop(char *s, connectionRecType *context)
    return rtNoError;
 }
 
+// the wait is done by the event loop, see waitBusy()
+static void startWait(connectionRecType *context, EMC_WAIT_TYPE type)
+{
+  context->waitFor = type;
+  context->waitSerial = context->lastSerial;
+  context->waitSince = etime();
+}
+
 static cmdResponseType setWait(char *s, connectionRecType *context)
 {
   switch (checkReceivedDoneNone(s)) {
     case -1: return rtStandardError;
     case 0: 
-      if (emcCommandWaitReceived() != 0) return rtStandardError;
+      startWait(context, EMC_WAIT_RECEIVED);
       break;
     case 1: 
-      if (emcCommandWaitDone() != 0) return rtStandardError;
+      startWait(context, EMC_WAIT_DONE);
       break;
     case 2: ;
     default: return rtStandardError;
@@ -875,7 +966,7 @@ static cmdResponseType setTimeout(char *s, connectionRecType *context)
   
   if (s == NULL) return rtStandardError;
   if (sscanf(s, "%f", &Timeout) < 1) return rtStandardError;
-  emcTimeout = Timeout;
+  context->timeout = Timeout;
   return rtNoError;
 }
 
@@ -1284,16 +1375,17 @@ int commandSet(connectionRecType *context)
   setCommandType cmd;
   char *pch;
   cmdResponseType ret = rtNoError;
+  int serial = emcCommandSerialNumber;
   
   pch = strtok(NULL, delims);
   if (pch == NULL) {
-    return write(context->cliSock, setNakStr, strlen(setNakStr));
+    return rmtWrite(context->cliSock, setNakStr, strlen(setNakStr));
     }
   strupr(pch);
   cmd = lookupSetCommand(pch);
   if ((cmd >= scIniFile) && (context->cliSock != enabledConn)) {
     sprintf(context->outBuf, setCmdNakStr, pch);
-    return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+    return rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
     }
   if ((cmd > scMachine) && (emcStatus->task.state != EMC_TASK_STATE_ON)) {
 //  Extra check in the event of an undetected change in Machine state resulting in
@@ -1301,7 +1393,7 @@ int commandSet(connectionRecType *context)
 //  and appropriate error messages are generated, however erratic behavior has been
 //  seen when doing certain set commands when the Machine state is other than 'On'.
     sprintf(context->outBuf, setCmdNakStr, pch);
-    return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+    return rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
     }
   switch (cmd) {
     case scEcho: ret = setEcho(strtok(NULL, delims), context); break;
@@ -1309,6 +1401,8 @@ int commandSet(connectionRecType *context)
     case scEnable: ret = setEnable(strtok(NULL, delims), context); break;
     case scConfig: ret = setConfig(strtok(NULL, delims), context); break;
     case scCommMode: ret = setCommMode(strtok(NULL, delims), context); break;
+    case scWatch: ret = setWatch(strtok(NULL, "\r\n"), context); break;
+    case scPush: ret = setPush(strtok(NULL, delims), context); break;
     case scCommProt: ret = setCommProt(strtok(NULL, delims), context); break;
     case scIniFile: break;
     case scPlat: break;
@@ -1382,21 +1476,35 @@ int commandSet(connectionRecType *context)
     case scOptionalStop: ret = setOptionalStop(strtok(NULL, delims), context); break;
     case scUnknown: ret = rtStandardError;
     }
+  // later gets must see what this set did
+  statusFresh = false;
+  if (emcCommandSerialNumber != serial) {
+    // it sent a command, wait for it as set_wait says
+    context->lastSerial = emcCommandSerialNumber;
+    sentAt = etime();
+    if ((ret == rtNoError) || (ret == rtHandledNoError))
+      startWait(context, context->waitType);
+    }
+  if ((context->waitFor != EMC_WAIT_POLL) && (ret == rtNoError)) {
+    // the reply is sent when the wait is over
+    snprintf(context->waitCmd, sizeof(context->waitCmd), "%s", pch);
+    return 0;
+    }
   switch (ret) {
     case rtNoError:  
       if (context->verbose) {
         sprintf(context->outBuf, ackStr, pch);
-        return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+        return rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
         }
       break;
     case rtHandledNoError: // Custom ok response already handled, take no action
       break; 
     case rtStandardError:
       sprintf(context->outBuf, setCmdNakStr, pch);
-      return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+      return rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
       break;
     case rtCustomError: // Custom error response entered in buffer
-      return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+      return rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
       break;
     case rtCustomHandledError: ;// Custom error respose handled, take no action
     }
@@ -1451,6 +1559,34 @@ static cmdResponseType getCommMode(char *s, connectionRecType *context)
   return rtNoError;
 }
 
+int parseCommand(connectionRecType *context);
+
+// run the get command of watch list entry i
+static void runWatch(connectionRecType *context, int i)
+{
+  snprintf(context->inBuf, sizeof(context->inBuf), "GET %s", context->watch[i]);
+  parseCommand(context);
+}
+
+static cmdResponseType getWatch(char *s, connectionRecType *context)
+{
+  int i;
+
+  if (context->watchCount == 0) return rtStandardError;
+  for (i = 0; i < context->watchCount; i++)
+    runWatch(context, i);
+  return rtHandledNoError;
+}
+
+static cmdResponseType getPush(char *s, connectionRecType *context)
+{
+  const char *pPushStr = "PUSH %s";
+  
+  if (context->push) sprintf(context->outBuf, pPushStr, "ON");
+  else sprintf(context->outBuf, pPushStr, "OFF");
+  return rtNoError;
+}
+
 static cmdResponseType getCommProt(char *s, connectionRecType *context)
 {
   const char *pCommProtStr = "COMM_PROT %s";
@@ -1471,7 +1607,7 @@ static cmdResponseType getSetWait(char *s, connectionRecType *context)
 {
   const char *pSetWaitStr = "SET_WAIT %s";
   
-  switch (emcWaitType) {
+  switch (context->waitType) {
     case EMC_WAIT_RECEIVED: sprintf(context->outBuf, pSetWaitStr, "RECEIVED"); break;
     case EMC_WAIT_DONE: sprintf(context->outBuf, pSetWaitStr, "DONE"); break;
     default: return rtStandardError;
@@ -1501,7 +1637,7 @@ static cmdResponseType getTimeout(char *s, connectionRecType *context)
 {
   const char *pTimeoutStr = "SET_TIMEOUT %f";
   
-  sprintf(context->outBuf, pTimeoutStr, emcTimeout);
+  sprintf(context->outBuf, pTimeoutStr, context->timeout);
   return rtNoError;
 }
 
@@ -2346,19 +2482,23 @@ int commandGet(connectionRecType *context)
   
   pch = strtok(NULL, delims);
   if (pch == NULL) {
-    return write(context->cliSock, setNakStr, strlen(setNakStr));
+    return rmtWrite(context->cliSock, setNakStr, strlen(setNakStr));
+    }
+  // all gets of one pass share a status update, until a set changes things
+  if ((emcUpdateType == EMC_UPDATE_AUTO) && !statusFresh) {
+    updateStatus();
+    statusFresh = true;
     }
-  if (emcUpdateType == EMC_UPDATE_AUTO) updateStatus();
   strupr(pch);
   cmd = lookupSetCommand(pch);
-  if (cmd > scIni)
-    if (emcUpdateType == EMC_UPDATE_AUTO) updateStatus();
   switch (cmd) {
     case scEcho: ret = getEcho(pch, context); break;
     case scVerbose: ret = getVerbose(pch, context); break;
     case scEnable: ret = getEnable(pch, context); break;
     case scConfig: ret = getConfig(pch, context); break;
     case scCommMode: ret = getCommMode(pch, context); break;
+    case scWatch: ret = getWatch(pch, context); break;
+    case scPush: ret = getPush(pch, context); break;
     case scCommProt: ret = getCommProt(pch, context); break;
     case scIniFile: getIniFile(pch, context); break;
     case scPlat: ret = getPlat(pch, context); break;
@@ -2560,6 +2700,7 @@ static int helpGet(connectionRecType *context)
   strcat(context->outBuf, "    User_angular_units\n\r");
   strcat(context->outBuf, "    User_linear_units\n\r");
   strcat(context->outBuf, "    Verbose\n\r");
+  strcat(context->outBuf, "    Watch\n\r");
 //  strcat(context->outBuf, "CONFIG\n\r");
   sockWrite(context);
   return 0;
@@ -2575,7 +2716,9 @@ static int helpSet(connectionRecType *context)
   strcat(context->outBuf, "    Comm_prot <protocol>\n\r");
   strcat(context->outBuf, "    Echo <On | Off>\n\r");
   strcat(context->outBuf, "    Enable <Pwd | Off>\n\r");
-  strcat(context->outBuf, "    Verbose <On | Off>\n\r\n\r");
+  strcat(context->outBuf, "    Verbose <On | Off>\n\r");
+  strcat(context->outBuf, "    Push <On | Off>\n\r");
+  strcat(context->outBuf, "    Watch [<get command>]\n\r\n\r");
   strcat(context->outBuf, "  The set commands requiring control enabled are:\n\r");
   strcat(context->outBuf, "    Abort\n\r");
   strcat(context->outBuf, "    Angular_unit_conversion <Deg | Rad | Grad | Auto | Custom>\n\r");
@@ -2696,15 +2839,15 @@ int parseCommand(connectionRecType *context)
     switch (lookupToken(pch)) {
       case cmdHello: 
         if (commandHello(context) == -1)
-          ret = write(context->cliSock, helloNakStr, strlen(helloNakStr));
-        else ret = write(context->cliSock, s, strlen(s));
+          ret = rmtWrite(context->cliSock, helloNakStr, strlen(helloNakStr));
+        else ret = rmtWrite(context->cliSock, s, strlen(s));
         break;
       case cmdGet: 
         ret = commandGet(context);
         break;
       case cmdSet:
         if (!context->linked)
-	  ret = write(context->cliSock, setNakStr, strlen(setNakStr));
+	  ret = rmtWrite(context->cliSock, setNakStr, strlen(setNakStr));
         else ret = commandSet(context);
         break;
       case cmdQuit: 
@@ -2713,7 +2856,7 @@ int parseCommand(connectionRecType *context)
       case cmdShutdown:
         ret = commandShutdown(context);
         if(ret ==0){
-          ret = write(context->cliSock, shutdownNakStr, strlen(shutdownNakStr));
+          ret = rmtWrite(context->cliSock, shutdownNakStr, strlen(shutdownNakStr));
         }
 	break;
       case cmdHelp:
@@ -2725,123 +2868,169 @@ int parseCommand(connectionRecType *context)
   return ret;
 }  
 
-void *readClient(void *arg)
+static void *openClient(int fd, void *data)
 {
-  char buf[1600];
-  int context_index;
-  int i;
-  int len;
-  connectionRecType *context = (connectionRecType *)arg;
+  connectionRecType *context;
 
-  context_index = 0;
+  context = (connectionRecType *) malloc(sizeof(connectionRecType));
+  if (context == NULL) {
+    fprintf(stderr, "linuxcncrsh: out of memory\n");
+    return NULL;
+  }
 
-  while (1) {
-    // We always start this loop with an empty buf, though there may be one
-    // partial line in context->inBuf[0..context_index].
-    len = read(context->cliSock, buf, sizeof(buf));
-    if (len < 0) {
-      fprintf(stderr, "linuxcncrsh: error reading from client: %s\n", strerror(errno));
-      goto finished;
-    }
-    if (len == 0) {
-      printf("linuxcncrsh: eof from client\n");
-      goto finished;
-    }
+  sessions++;
+  context->cliSock = fd;
+  context->linked = false;
+  context->echo = true;
+  context->verbose = false;
+  strcpy(context->version, "1.0");
+  strcpy(context->hostName, "Default");
+  context->enabled = false;
+  context->commMode = 0;
+  context->commProt = 0;
+  context->inBuf[0] = 0;
+  context->watchCount = 0;
+  context->push = false;
+  context->waitType = EMC_WAIT_RECEIVED;
+  context->timeout = 0.0;
+  context->lastSerial = emcCommandSerialNumber;
+  context->waitFor = EMC_WAIT_POLL;
+  return context;
+}
+
+static int readClient(void *client, char *line, void *data)
+{
+  connectionRecType *context = (connectionRecType *)client;
+
+  if (context->echo && context->linked) {
+    rmtWrite(context->cliSock, line, strlen(line));
+    rmtWrite(context->cliSock, "\r\n", 2);
+  }
+  snprintf(context->inBuf, sizeof(context->inBuf), "%s", line);
 
-    if (context->echo && context->linked)
-      if(write(context->cliSock, buf, len) != (ssize_t)len) {
-        fprintf(stderr, "linuxcncrsh: write() failed: %s", strerror(errno));
-      }
+  // The return value from parseCommand was meant to indicate success or
+  // error, but it is mostly unusable.  Some paths return the number of
+  // bytes written and some paths return small positive integers
+  // (cmdResponseType) to indicate failure.  Only -1, from quit or from a
+  // failed write, reliably means the connection is done.
+  return parseCommand(context) == -1 ? -1 : 0;
+}
 
-    for (i = 0; i < len; i ++) {
-        if ((buf[i] != '\n') && (buf[i] != '\r')) {
-            context->inBuf[context_index] = buf[i];
-            context_index ++;
-            continue;
-        }
+static void dropClient(void *client, void *data)
+{
+  connectionRecType *context = (connectionRecType *)client;
 
-        // if we get here, i is the index of a line terminator in buf
+  printf("linuxcncrsh: disconnecting client %s (%s)\n", context->hostName, context->version);
+  // the next client may get the same socket
+  if (enabledConn == context->cliSock) enabledConn = -1;
+  clearWatch(context);
+  free(context);
+  sessions--;
+}
 
-        if (context_index > 0) {
-            // we have some bytes in the context buffer, parse them now
-            context->inBuf[context_index] = '\0';
+// a new pass, the status has to be read again
+static void statusTick(void *data)
+{
+  statusFresh = false;
+}
 
-            // The return value from parseCommand was meant to indicate
-            // success or error, but it is unusable.  Some paths return
-            // the return value of write(2) and some paths return small
-            // positive integers (cmdResponseType) to indicate failure.
-            // We're best off just ignoring it.
-            (void)parseCommand(context);
+// the wait of a set command is over, send the reply it held back
+static void finishWait(connectionRecType *context, bool ok)
+{
+  static const char *setCmdNakStr = "SET %s NAK\n\r";
+  static const char *ackStr = "SET %s ACK\n\r";
 
-            context_index = 0;
-        }
-    }
-  }
+  context->waitFor = EMC_WAIT_POLL;
+  if (ok && !context->verbose) return;
+  sprintf(context->outBuf, ok ? ackStr : setCmdNakStr, context->waitCmd);
+  rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
+}
 
-finished:
-  printf("linuxcncrsh: disconnecting client %s (%s)\n", context->hostName, context->version);
-  close(context->cliSock);
-  free(context);
-  pthread_exit((void *)0);
-  sessions--;  // FIXME: not reached
+// Asked by the event loop before each line of a connection, and every
+// pass while it returns true.  The connection's lines are held back
+// while its own set_wait or wait is not over, which with a timeout of
+// 0 may be forever, and while any command is not received yet, since
+// the next one would overwrite it.  The latter is bounded by
+// RECEIVE_TIMEOUT, so a task that stopped reading commands does not
+// hold every connection.
+static int waitBusy(void *client, void *data)
+{
+  connectionRecType *context = (connectionRecType *)client;
+  int ret;
+
+  if (!statusFresh) {
+    updateStatus();
+    statusFresh = true;
+  }
+  if (context->waitFor != EMC_WAIT_POLL) {
+    ret = emcCommandPoll(context->waitFor, context->waitSerial);
+    if ((ret == 1) && (context->timeout > 0.0) &&
+        (etime() - context->waitSince >= context->timeout))
+      ret = -1;
+    if (ret == 1) return 1;
+    finishWait(context, ret == 0);
+  }
+  return (emcCommandPoll(EMC_WAIT_RECEIVED, emcCommandSerialNumber) == 1) &&
+    (etime() - sentAt < RECEIVE_TIMEOUT);
 }
 
-int sockMain()
+// run the watched gets and send the replies that changed
+static void pushWatch(void *client, void *data)
 {
-    int res;
-    
-    while (1) {
-      int client_sockfd;
-
-      client_len = sizeof(client_address);
-      client_sockfd = accept(server_sockfd,
-        (struct sockaddr *)&client_address, &client_len);
-      if (client_sockfd < 0) exit(0);
-      sessions++;
-      if ((maxSessions == -1) || (sessions <= maxSessions)) {
-        pthread_t *thrd;
-        connectionRecType *context;
-
-        thrd = (pthread_t *)calloc(1, sizeof(pthread_t));
-        if (thrd == NULL) {
-          fprintf(stderr, "linuxcncrsh: out of memory\n");
-          exit(1);
-        }
+  connectionRecType *context = (connectionRecType *)client;
+  const char *reply;
+  size_t mark, len;
+  int i;
 
-        context = (connectionRecType *) malloc(sizeof(connectionRecType));
-        if (context == NULL) {
-          fprintf(stderr, "linuxcncrsh: out of memory\n");
-          exit(1);
-        }
+  if (!context->push) return;
+  for (i = 0; i < context->watchCount; i++) {
+    mark = rmtPending(context->cliSock);
+    runWatch(context, i);
+    reply = rmtQueued(context->cliSock, mark);
+    if (reply == NULL) return;
+    len = rmtPending(context->cliSock) - mark;
+    if ((context->watchSent[i] != NULL) && (strlen(context->watchSent[i]) == len) &&
+        (memcmp(context->watchSent[i], reply, len) == 0)) {
+      // same as last time, take it back
+      rmtTruncate(context->cliSock, mark);
+      continue;
+    }
+    free(context->watchSent[i]);
+    context->watchSent[i] = (char *) malloc(len + 1);
+    if (context->watchSent[i] != NULL) {
+      memcpy(context->watchSent[i], reply, len);
+      context->watchSent[i][len] = '\0';
+    }
+  }
+}
 
-        context->cliSock = client_sockfd;
-        context->linked = false;
-        context->echo = true;
-        context->verbose = false;
-        strcpy(context->version, "1.0");
-        strcpy(context->hostName, "Default");
-        context->enabled = false;
-        context->commMode = 0;
-        context->commProt = 0;
-        context->inBuf[0] = 0;
-
-        res = pthread_create(thrd, NULL, readClient, (void *)context);
-      } else {
-        res = -1;
-      }
-      if (res != 0) {
-        close(client_sockfd);
-        sessions--;
-        }
-     }
+int sockMain()
+{
+    rmt_server_t server;
+
+    memset(&server, 0, sizeof(server));
+    server.open = openClient;
+    server.line = readClient;
+    server.close = dropClient;
+    server.tick = statusTick;
+    server.period = pushWatch;
+    server.busy = waitBusy;
+    server.period_ms = WATCH_PERIOD;
+    server.max_clients = maxSessions;
+    if (rmtServe(server_sockfd, &server, NULL) < 0) {
+      fprintf(stderr, "linuxcncrsh: %s\n", strerror(errno));
+      return -1;
+    }
     return 0;
 }
 
 static void initMain()
 {
-    emcWaitType = EMC_WAIT_RECEIVED;
+    // never block in the send functions, waitBusy() does the waiting;
+    // the timeout only bounds the wait in thisQuit()
+    emcWaitType = EMC_WAIT_POLL;
     emcCommandSerialNumber = 0;
-    emcTimeout = 0.0;
+    emcTimeout = RECEIVE_TIMEOUT;
     emcUpdateType = EMC_UPDATE_AUTO;
     linearUnitConversion = LINEAR_UNITS_AUTO;
     angularUnitConversion = ANGULAR_UNITS_AUTO;
@@ -281,6 +281,33 @@ int updateError()
 
 #define EMC_COMMAND_DELAY   0.1	// how long to sleep between checks
 
+/*
+  Checks once, without waiting, whether command 'serial' was received
+  (EMC_WAIT_RECEIVED) or is done (EMC_WAIT_DONE), from the status last
+  read with updateStatus().  Returns 1 while it is not, 0 when it is,
+  and -1 if the command failed.  For servers that cannot block, with
+  emcWaitType set to EMC_WAIT_POLL; such a caller must not send another
+  command before the previous one was received, or it may be lost.
+*/
+int emcCommandPoll(EMC_WAIT_TYPE type, int serial)
+{
+    int serial_diff = emcStatus->echo_serial_number - serial;
+
+    if (serial_diff < 0) {
+	return 1;
+    }
+    if (type != EMC_WAIT_DONE || serial_diff > 0) {
+	return 0;
+    }
+    if (emcStatus->status == RCS_DONE) {
+	return 0;
+    }
+    if (emcStatus->status == RCS_ERROR) {
+	return -1;
+    }
+    return 1;
+}
+
 int emcCommandWaitDone()
 {
     double end;
@@ -291,15 +318,10 @@ int emcCommandWaitDone()
 	    continue;
 	}
 
-	if (serial_diff > 0) {
-	    return 0;
-	}
-
-	if (emcStatus->status == RCS_DONE) {
+	switch (emcCommandPoll(EMC_WAIT_DONE, emcCommandSerialNumber)) {
+	case 0:
 	    return 0;
-	}
-
-	if (emcStatus->status == RCS_ERROR) {
+	case -1:
 	    return -1;
 	}
 
@@ -315,8 +337,7 @@ int emcCommandWaitReceived()
     for (end = 0.0; emcTimeout <= 0.0 || end < emcTimeout; end += EMC_COMMAND_DELAY) {
 	updateStatus();
 
-	int serial_diff = emcStatus->echo_serial_number - emcCommandSerialNumber;
-	if (serial_diff >= 0) {
+	if (emcCommandPoll(EMC_WAIT_RECEIVED, emcCommandSerialNumber) == 0) {
 	    return 0;
 	}
 
@@ -75,7 +75,8 @@ enum EMC_UPDATE_TYPE {
 extern EMC_UPDATE_TYPE emcUpdateType;
 
 enum EMC_WAIT_TYPE {
-    EMC_WAIT_RECEIVED = 2,
+    EMC_WAIT_POLL = 1,		// send only, the caller checks emcCommandPoll()
+    EMC_WAIT_RECEIVED,
     EMC_WAIT_DONE
 };
 extern EMC_WAIT_TYPE emcWaitType;
@@ -92,6 +93,7 @@ extern int updateStatus();
 extern int updateError();
 extern int emcCommandWaitReceived();
 extern int emcCommandWaitDone();
+extern int emcCommandPoll(EMC_WAIT_TYPE type, int serial);
 extern int emcCommandSend(RCS_CMD_MSG & cmd);
 extern double convertLinearUnits(double u);
 extern double convertAngularUnits(double u);
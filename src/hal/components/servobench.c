@@ -0,0 +1,370 @@
+/********************************************************************
+* Description:  servobench.c
+*               A HAL component that collects latency and execution
+*               time histograms of the functions of a realtime thread,
+*               for the servo-bench script.
+*
+* License: GPL Version 2
+*
+********************************************************************/
+/** This file, 'servobench.c', is the realtime part of the servo-bench
+    benchmark.  Each instance watches one thread: its 'start' function
+    is added first to the thread and measures the scheduling jitter,
+    its 'sample' function is added last and bins the execution time of
+    the thread and of every function connected to its 'funct-NN' pins
+    (the '<funct>.time' pins of the functions of the thread).
+
+    The histograms are kept in an RTAPI shared memory segment, one per
+    instance, with key SERVOBENCH_SHMEM_KEY + instance.  The layout is
+    'servobench_shm_t' below; servo-bench reads it after stopping the
+    threads, so no locking is needed.
+
+    Loading:
+
+    loadrt servobench count=2
+
+    Bins are 1/8 octave wide, so a percentile read from them is at most
+    12.5% above the true value.  The maximum of each series is exact.
+*/
+
+/** This program is free software; you can redistribute it and/or
+    modify it under the terms of version 2 of the GNU General
+    Public License as published by the Free Software Foundation.
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111 USA
+
+    THE AUTHORS OF THIS LIBRARY ACCEPT ABSOLUTELY NO LIABILITY FOR
+    ANY HARM OR LOSS RESULTING FROM ITS USE.  IT IS _EXTREMELY_ UNWISE
+    TO RELY ON SOFTWARE ALONE FOR SAFETY.  Any machinery capable of
+    harming persons must have provisions for completely removing power
+    from all motors, etc, before persons enter any danger area.  All
+    machinery must be designed to comply with local and national safety
+    codes, and the authors of this software can not, and do not, take
+    any responsibility for such compliance.
+
+    This code was written as part of the EMC HAL project.  For more
+    information, go to www.linuxcnc.org.
+*/
+
+#include "rtapi.h"		/* RTAPI realtime OS API */
+#include "rtapi_app.h"		/* RTAPI realtime module decls */
+#include "hal.h"		/* HAL public API decls */
+#include "rtapi_errno.h"
+#include "rtapi_string.h"
+
+/* module information */
+MODULE_AUTHOR("LinuxCNC");
+MODULE_DESCRIPTION("Thread latency and function time histograms");
+MODULE_LICENSE("GPL");
+static int count = 1;		/* number of threads to watch */
+RTAPI_MP_INT(count, "number of instances");
+
+/* keep these in sync with scripts/servo-bench */
+#define SERVOBENCH_SHMEM_KEY	0x48534230
+#define MAX_INSTANCES		8
+#define MAX_FUNCTS		48	/* functions per thread */
+#define NUM_SERIES		(MAX_FUNCTS + 2)
+#define NUM_BINS		256
+
+/* series 0 is the jitter in ns, series 1 the thread time in CPU
+   clocks, series 2 on are the funct-NN pins in CPU clocks */
+#define SERIES_LATENCY		0
+#define SERIES_THREAD		1
+#define SERIES_FUNCT		2
+
+/***********************************************************************
+*                STRUCTURES AND GLOBAL VARIABLES                       *
+************************************************************************/
+
+/* this structure is the shared memory segment of one instance */
+
+typedef struct {
+    rtapi_u32 periods;		/* number of periods sampled */
+    rtapi_s32 latency_min;	/* smallest start jitter, ns */
+    rtapi_s32 latency_max;	/* largest start jitter, ns */
+    rtapi_s32 pad;
+    rtapi_u64 total_ns;		/* time covered by the samples, ns */
+    rtapi_u64 total_clocks;	/* and in CPU clocks, for the conversion */
+    rtapi_s32 max[NUM_SERIES];	/* largest value of each series */
+    rtapi_s32 worst[NUM_SERIES];/* all series in the longest period */
+    rtapi_u32 hist[NUM_SERIES][NUM_BINS];
+} servobench_shm_t;
+
+/* this structure contains the HAL shared memory data for one instance */
+
+typedef struct {
+    hal_s32_t *thread_time;	/* pin: '<thread>.time' */
+    hal_s32_t *funct[MAX_FUNCTS];	/* pins: '<funct>.time' */
+    hal_bit_t *reset;		/* pin: clear the histograms */
+    hal_u32_t *periods;		/* pin: periods sampled */
+    hal_s32_t *latency;		/* pin: jitter of the last start, ns */
+    int shmem_id;
+    servobench_shm_t *shm;
+    long long last_ns;		/* last start */
+    long long last_clocks;
+    rtapi_s32 this_latency;	/* jitter of the running period */
+    rtapi_s32 prev[NUM_SERIES];	/* series of the previous period */
+    int have_prev;
+    int resetting;		/* reset seen, histograms cleared */
+} servobench_t;
+
+/* other globals */
+static int comp_id;		/* component ID */
+static int ninstances;
+static servobench_t *instances;
+
+/***********************************************************************
+*                  LOCAL FUNCTION DECLARATIONS                         *
+************************************************************************/
+
+static int export_servobench(int num, servobench_t *sb);
+static void start(void *arg, long period);
+static void sample(void *arg, long period);
+
+/***********************************************************************
+*                       INIT AND EXIT CODE                             *
+************************************************************************/
+
+int rtapi_app_main(void)
+{
+    int n, retval;
+
+    if ((count <= 0) || (count > MAX_INSTANCES)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: invalid count: %d\n", count);
+	return -EINVAL;
+    }
+    comp_id = hal_init("servobench");
+    if (comp_id < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: hal_init() failed\n");
+	return -EINVAL;
+    }
+    instances = hal_malloc(count * sizeof(servobench_t));
+    if (instances == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: hal_malloc() failed\n");
+	hal_exit(comp_id);
+	return -ENOMEM;
+    }
+    for (n = 0; n < count; n++) {
+	retval = export_servobench(n, &instances[n]);
+	if (retval != 0) {
+	    goto fail;
+	}
+	ninstances++;
+    }
+    hal_ready(comp_id);
+    return 0;
+fail:
+    for (n = 0; n < ninstances; n++) {
+	rtapi_shmem_delete(instances[n].shmem_id, comp_id);
+    }
+    hal_exit(comp_id);
+    return retval;
+}
+
+void rtapi_app_exit(void)
+{
+    int n;
+
+    for (n = 0; n < ninstances; n++) {
+	rtapi_shmem_delete(instances[n].shmem_id, comp_id);
+    }
+    hal_exit(comp_id);
+}
+
+/***********************************************************************
+*                     REALTIME FUNCTIONS                               *
+************************************************************************/
+
+/* 0..15 are exact, then 8 bins per octave up to 2^31 */
+static int bin_of(rtapi_s32 value)
+{
+    rtapi_u32 v;
+    int msb;
+
+    if (value < 16) {
+	return value < 0 ? 0 : value;
+    }
+    v = value;
+    msb = 31 - __builtin_clz(v);
+    return 16 + (msb - 4) * 8 + ((v >> (msb - 3)) & 7);
+}
+
+static void clear(servobench_t *sb)
+{
+    memset(sb->shm, 0, sizeof(servobench_shm_t));
+    sb->last_ns = 0;
+    sb->this_latency = -1;
+    sb->have_prev = 0;
+}
+
+/* first function of the thread: measures the start jitter */
+static void start(void *arg, long period)
+{
+    servobench_t *sb = arg;
+    servobench_shm_t *shm = sb->shm;
+    long long now_ns, now_clocks;
+    rtapi_s32 jitter;
+
+    now_ns = rtapi_get_time();
+    now_clocks = rtapi_get_clocks();
+    if (*(sb->reset)) {
+	if (!sb->resetting) {
+	    clear(sb);
+	}
+	sb->resetting = 1;
+	return;
+    }
+    sb->resetting = 0;
+    if (sb->last_ns != 0) {
+	jitter = (rtapi_s32)(now_ns - sb->last_ns - period);
+	*(sb->latency) = jitter;
+	if (shm->periods == 0 || jitter < shm->latency_min) {
+	    shm->latency_min = jitter;
+	}
+	if (shm->periods == 0 || jitter > shm->latency_max) {
+	    shm->latency_max = jitter;
+	}
+	sb->this_latency = jitter < 0 ? -jitter : jitter;
+	shm->total_ns += now_ns - sb->last_ns;
+	shm->total_clocks += now_clocks - sb->last_clocks;
+    } else {
+	sb->this_latency = -1;
+    }
+    sb->last_ns = now_ns;
+    sb->last_clocks = now_clocks;
+}
+
+/* last function of the thread: bins the function times of this period
+   and the thread time of the previous one, which is only known now */
+static void sample(void *arg, long period)
+{
+    servobench_t *sb = arg;
+    servobench_shm_t *shm = sb->shm;
+    rtapi_s32 value;
+    int n;
+
+    if (*(sb->reset) || sb->this_latency < 0) {
+	return;
+    }
+    if (sb->have_prev) {
+	value = *(sb->thread_time);
+	shm->hist[SERIES_THREAD][bin_of(value)]++;
+	if (value > shm->max[SERIES_THREAD]) {
+	    /* new worst period, keep what it was made of */
+	    shm->max[SERIES_THREAD] = value;
+	    sb->prev[SERIES_THREAD] = value;
+	    memcpy(shm->worst, sb->prev, sizeof(shm->worst));
+	}
+    }
+    value = sb->this_latency;
+    shm->hist[SERIES_LATENCY][bin_of(value)]++;
+    if (value > shm->max[SERIES_LATENCY]) {
+	shm->max[SERIES_LATENCY] = value;
+    }
+    sb->prev[SERIES_LATENCY] = value;
+    for (n = 0; n < MAX_FUNCTS; n++) {
+	value = *(sb->funct[n]);
+	shm->hist[SERIES_FUNCT + n][bin_of(value)]++;
+	if (value > shm->max[SERIES_FUNCT + n]) {
+	    shm->max[SERIES_FUNCT + n] = value;
+	}
+	sb->prev[SERIES_FUNCT + n] = value;
+    }
+    sb->have_prev = 1;
+    shm->periods++;
+    *(sb->periods) = shm->periods;
+}
+
+/***********************************************************************
+*                   LOCAL FUNCTION DEFINITIONS                         *
+************************************************************************/
+
+static int export_servobench(int num, servobench_t *sb)
+{
+    int retval, n;
+    char buf[HAL_NAME_LEN + 1];
+    void *shm;
+
+    retval = hal_pin_s32_newf(HAL_IN, &(sb->thread_time), comp_id,
+	"servobench.%d.thread-time", num);
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: 'thread-time' pin export failed\n");
+	return -EIO;
+    }
+    for (n = 0; n < MAX_FUNCTS; n++) {
+	retval = hal_pin_s32_newf(HAL_IN, &(sb->funct[n]), comp_id,
+	    "servobench.%d.funct-%02d", num, n);
+	if (retval != 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"SERVOBENCH: ERROR: 'funct-%02d' pin export failed\n", n);
+	    return -EIO;
+	}
+    }
+    retval = hal_pin_bit_newf(HAL_IN, &(sb->reset), comp_id,
+	"servobench.%d.reset", num);
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: 'reset' pin export failed\n");
+	return -EIO;
+    }
+    retval = hal_pin_u32_newf(HAL_OUT, &(sb->periods), comp_id,
+	"servobench.%d.periods", num);
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: 'periods' pin export failed\n");
+	return -EIO;
+    }
+    retval = hal_pin_s32_newf(HAL_OUT, &(sb->latency), comp_id,
+	"servobench.%d.latency", num);
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: 'latency' pin export failed\n");
+	return -EIO;
+    }
+
+    sb->shmem_id = rtapi_shmem_new(SERVOBENCH_SHMEM_KEY + num, comp_id,
+	sizeof(servobench_shm_t));
+    if (sb->shmem_id < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: couldn't allocate shared memory\n");
+	return -ENOMEM;
+    }
+    retval = rtapi_shmem_getptr(sb->shmem_id, &shm);
+    if (retval < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: couldn't map shared memory\n");
+	rtapi_shmem_delete(sb->shmem_id, comp_id);
+	return -ENOMEM;
+    }
+    sb->shm = shm;
+    sb->resetting = 0;
+    clear(sb);
+
+    rtapi_snprintf(buf, sizeof(buf), "servobench.%d.start", num);
+    retval = hal_export_funct(buf, start, sb, 0, 0, comp_id);
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: start funct export failed\n");
+	rtapi_shmem_delete(sb->shmem_id, comp_id);
+	return -EIO;
+    }
+    rtapi_snprintf(buf, sizeof(buf), "servobench.%d.sample", num);
+    retval = hal_export_funct(buf, sample, sb, 0, 0, comp_id);
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "SERVOBENCH: ERROR: sample funct export failed\n");
+	rtapi_shmem_delete(sb->shmem_id, comp_id);
+	return -EIO;
+    }
+    return 0;
+}
@@ -51,6 +51,26 @@
     values of the position feedback counters.  Both 'update-freq' and
     'capture-position' use floating point, 'make-pulses' does not.
 
+    Scheduled mode:
+
+    Loading with 'sched=1' moves the pulse generation work out of
+    the fast thread.  Each time 'stepgen.update-freq' runs, it carries
+    the step generator forward over every base period of the coming
+    servo period, for all channels, and appends the result to a
+    queue of 32 bit words, one per base period.  Channel N owns
+    bits 2N and 2N+1 (step and dir, or up and down).  The planner
+    always continues from where its last plan ended, and every word
+    it queues is played, so the waveform is the one the normal mode
+    would produce, delayed by the few base periods the queue holds.
+    'stepgen.make-pulses' then only has to fetch the next word, write
+    the pins whose bits changed, and count the steps.  The combined
+    word is also available on the 'stepgen.sched-bits' pin.  Only step
+    types 0 and 1 can be scheduled.  Edges still fall on base period
+    boundaries; the gain is a much shorter and more predictable fast
+    thread.  If the fast thread empties the queue the outputs hold
+    their state until more words are queued; this only stretches
+    whatever pulse, space or direction setup is in progress.
+
     Polarity:
 
     All signals from this module have fixed polarity (active high
@@ -319,6 +339,8 @@ RTAPI_MP_ARRAY_STRING(ctrl_type,MAX_CHAN,"control type (pos or vel) for up to 16
 int user_step_type[] = { [0 ... MAX_CYCLE-1] = -1 };
 RTAPI_MP_ARRAY_INT(user_step_type, MAX_CYCLE,
 	"lookup table for user-defined step type");
+int sched = 0;
+RTAPI_MP_INT(sched, "precompute a timeline of outputs in update-freq (step types 0 and 1 only)");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -371,11 +393,35 @@ typedef struct {
     hal_u32_t old_dir_hold_dly;
     hal_u32_t old_dir_setup;
     int printed_error;		/* flag to avoid repeated printing */
+    long long sched_accum;	/* accumulator as planned by update_freq */
 } stepgen_t;
 
 /* ptr to array of stepgen_t structs in shared memory, 1 per channel */
 static stepgen_t *stepgen_array;
 
+#define MAX_SCHED_TICKS 1024	/* queued base periods, max (power of 2) */
+#define SCHED_SLACK 2		/* extra base periods kept queued */
+
+/** This structure holds the output queue used in scheduled mode.
+    update_freq plans into 'plan', copies it to the ring at 'head'
+    and then advances 'head'; make_pulses plays the ring at 'tail'
+    and advances 'tail'.  Each index is written by one side only. */
+
+typedef struct {
+    /* written by update_freq */
+    volatile unsigned head;	/* words queued so far */
+    hal_u32_t plan[MAX_SCHED_TICKS];	/* scratch for the next plan */
+    hal_u32_t ring[MAX_SCHED_TICKS];	/* the queued words */
+    /* written by make_pulses */
+    volatile unsigned tail;	/* words played so far */
+    hal_u32_t out;		/* word currently on the outputs */
+    hal_u32_t *bits;		/* pin: combined output word */
+    int printed_error;		/* flag to avoid repeated printing */
+} sched_t;
+
+/* ptr to timeline in shared memory, only allocated if sched != 0 */
+static sched_t *sched_data;
+
 /* lookup tables for stepping types 2 and higher - phase A is the LSB */
 
 static unsigned char master_lut[][MAX_CYCLE] = {
@@ -432,6 +478,9 @@ typedef enum CONTROL { POSITION, VELOCITY, INVALID } CONTROL;
 
 static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode);
 static void make_pulses(void *arg, long period);
+static void play_pulses(stepgen_t *stepgen);
+static void plan_pulses(stepgen_t *stepgen, hal_u32_t *timeline, int ticks,
+    int shift);
 static void update_freq(void *arg, long period);
 static void update_pos(void *arg, long period);
 static int setup_user_step_type(void);
@@ -464,6 +513,12 @@ int rtapi_app_main(void)
 			    ctrl_type[n], n);
 	    return -1;
 	}
+	if (sched && step_type[n] > 1) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "STEPGEN: ERROR: step type '%i', axis %i can not be scheduled (must be 0 or 1)\n",
+			    step_type[n], n);
+	    return -1;
+	}
 	num_chan++;
     }
     if (num_chan == 0) {
@@ -510,6 +565,29 @@ int rtapi_app_main(void)
 	    return -1;
 	}
     }
+    if (sched) {
+	/* allocate and export the timeline */
+	sched_data = hal_malloc(sizeof(sched_t));
+	if (sched_data == 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+			    "STEPGEN: ERROR: hal_malloc() failed\n");
+	    hal_exit(comp_id);
+	    return -1;
+	}
+	retval = hal_pin_u32_newf(HAL_OUT, &(sched_data->bits), comp_id,
+	    "stepgen.sched-bits");
+	if (retval != 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"STEPGEN: ERROR: sched-bits pin export failed\n");
+	    hal_exit(comp_id);
+	    return -1;
+	}
+	*(sched_data->bits) = 0;
+	sched_data->head = 0;
+	sched_data->tail = 0;
+	sched_data->out = 0;
+	sched_data->printed_error = 0;
+    }
     /* export functions */
     retval = hal_export_funct("stepgen.make-pulses", make_pulses,
 	stepgen_array, 0, 0, comp_id);
@@ -555,10 +633,77 @@ void rtapi_app_exit(void)
     toggles, a step is generated.
 */
 
+/* decrement "timing constraint" timers */
+static inline void update_timers(stepgen_t *stepgen)
+{
+    if ( stepgen->timer1 > 0 ) {
+	if ( stepgen->timer1 > periodns ) {
+	    stepgen->timer1 -= periodns;
+	} else {
+	    stepgen->timer1 = 0;
+	}
+    }
+    if ( stepgen->timer2 > 0 ) {
+	if ( stepgen->timer2 > periodns ) {
+	    stepgen->timer2 -= periodns;
+	} else {
+	    stepgen->timer2 = 0;
+	}
+    }
+    if ( stepgen->timer3 > 0 ) {
+	if ( stepgen->timer3 > periodns ) {
+	    stepgen->timer3 -= periodns;
+	} else {
+	    stepgen->timer3 = 0;
+	    /* last timer timed out, cancel hold */
+	    stepgen->hold_dds = 0;
+	}
+    }
+}
+
+/* move addval towards target_addval, within the accel limit */
+static inline void update_addval(stepgen_t *stepgen)
+{
+    long old_addval, target_addval, new_addval;
+
+    if ( !stepgen->hold_dds && *(stepgen->enable) ) {
+	/* update addval (ramping) */
+	old_addval = stepgen->addval;
+	target_addval = stepgen->target_addval;
+	if (stepgen->deltalim != 0) {
+	    /* implement accel/decel limit */
+	    if (target_addval > (old_addval + stepgen->deltalim)) {
+		/* new value is too high, increase addval as far as possible */
+		new_addval = old_addval + stepgen->deltalim;
+	    } else if (target_addval < (old_addval - stepgen->deltalim)) {
+		/* new value is too low, decrease addval as far as possible */
+		new_addval = old_addval - stepgen->deltalim;
+	    } else {
+		/* new value can be reached in one step - do it */
+		new_addval = target_addval;
+	    }
+	} else {
+	    /* go to new freq without any ramping */
+	    new_addval = target_addval;
+	}
+	/* save result */
+	stepgen->addval = new_addval;
+	/* check for direction reversal */
+	if (((new_addval >= 0) && (old_addval < 0)) ||
+	    ((new_addval < 0) && (old_addval >= 0))) {
+	    /* reversal required, can we do so now? */
+	    if ( stepgen->timer3 != 0 ) {
+		/* no - hold everything until delays time out */
+		stepgen->hold_dds = 1;
+	    }
+	}
+    }
+}
+
 static void make_pulses(void *arg, long period)
 {
     stepgen_t *stepgen;
-    long old_addval, target_addval, new_addval, step_now;
+    long step_now;
     int n, p;
     unsigned char outbits;
 
@@ -567,63 +712,16 @@ static void make_pulses(void *arg, long period)
     /* point to stepgen data structures */
     stepgen = arg;
 
+    if (sched) {
+	/* update_freq did the work, just play it back */
+	play_pulses(stepgen);
+	return;
+    }
+
     for (n = 0; n < num_chan; n++) {
-	/* decrement "timing constraint" timers */
-	if ( stepgen->timer1 > 0 ) {
-	    if ( stepgen->timer1 > periodns ) {
-		stepgen->timer1 -= periodns;
-	    } else {
-		stepgen->timer1 = 0;
-	    }
-	}
-	if ( stepgen->timer2 > 0 ) {
-	    if ( stepgen->timer2 > periodns ) {
-		stepgen->timer2 -= periodns;
-	    } else {
-		stepgen->timer2 = 0;
-	    }
-	}
-	if ( stepgen->timer3 > 0 ) {
-	    if ( stepgen->timer3 > periodns ) {
-		stepgen->timer3 -= periodns;
-	    } else {
-		stepgen->timer3 = 0;
-		/* last timer timed out, cancel hold */
-		stepgen->hold_dds = 0;
-	    }
-	}
-	if ( !stepgen->hold_dds && *(stepgen->enable) ) {
-	    /* update addval (ramping) */
-	    old_addval = stepgen->addval;
-	    target_addval = stepgen->target_addval;
-	    if (stepgen->deltalim != 0) {
-		/* implement accel/decel limit */
-		if (target_addval > (old_addval + stepgen->deltalim)) {
-		    /* new value is too high, increase addval as far as possible */
-		    new_addval = old_addval + stepgen->deltalim;
-		} else if (target_addval < (old_addval - stepgen->deltalim)) {
-		    /* new value is too low, decrease addval as far as possible */
-		    new_addval = old_addval - stepgen->deltalim;
-		} else {
-		    /* new value can be reached in one step - do it */
-		    new_addval = target_addval;
-		}
-	    } else {
-		/* go to new freq without any ramping */
-		new_addval = target_addval;
-	    }
-	    /* save result */
-	    stepgen->addval = new_addval;
-	    /* check for direction reversal */
-	    if (((new_addval >= 0) && (old_addval < 0)) ||
-		((new_addval < 0) && (old_addval >= 0))) {
-		/* reversal required, can we do so now? */
-		if ( stepgen->timer3 != 0 ) {
-		    /* no - hold everything until delays time out */
-		    stepgen->hold_dds = 1;
-		}
-	    }
-	}
+	/* decrement timers, ramp addval */
+	update_timers(stepgen);
+	update_addval(stepgen);
 	/* update DDS */
 	if ( !stepgen->hold_dds && *(stepgen->enable) ) {
 	    /* save current value of low half of accum */
@@ -711,6 +809,118 @@ static void make_pulses(void *arg, long period)
     /* done */
 }
 
+/** In scheduled mode, make_pulses only copies the next queued word
+    to the outputs.  The position feedback is counted here,
+    from the step edges that actually went out, so update_pos works
+    the same in both modes.
+*/
+
+static void play_pulses(stepgen_t *stepgen)
+{
+    sched_t *s;
+    hal_u32_t word, diff, rise;
+    int n;
+
+    s = sched_data;
+    if (s->tail != s->head) {
+	__sync_synchronize();
+	word = s->ring[s->tail & (MAX_SCHED_TICKS - 1)];
+	__sync_synchronize();
+	s->tail++;
+    } else {
+	/* queue is empty, stretch the current word until update_freq
+	   queues more; dropping a step bit here would let the next word
+	   raise it again as an extra step */
+	word = s->out;
+    }
+    diff = word ^ s->out;
+    s->out = word;
+    *(s->bits) = word;
+    /* only visit the channels whose outputs changed */
+    for (n = 0; diff != 0; n++, diff >>= 2, word >>= 2, stepgen++) {
+	if ((diff & 3) == 0) {
+	    continue;
+	}
+	*(stepgen->phase[0]) = word & 1;
+	*(stepgen->phase[1]) = (word >> 1) & 1;
+	rise = diff & word & 3;
+	if (stepgen->step_type == 0) {
+	    /* dir changes are not steps */
+	    rise &= 1;
+	}
+	if (rise) {
+	    if ((rise & 2) || (stepgen->step_type == 0 && (word & 2))) {
+		stepgen->accum -= 1LL << PICKOFF;
+	    } else {
+		stepgen->accum += 1LL << PICKOFF;
+	    }
+	    stepgen->rawcount = stepgen->accum >> PICKOFF;
+	}
+    }
+}
+
+/** Runs the make_pulses logic for one channel over the next 'ticks'
+    base periods, ORing its outputs into bits 'shift' and 'shift'+1
+    of each word of the timeline.  The timers, direction and DDS pick
+    up where the previous call left them, which is where the queued
+    words end.  Step types 0 and 1 only.
+*/
+
+static void plan_pulses(stepgen_t *stepgen, hal_u32_t *timeline, int ticks,
+    int shift)
+{
+    long long step_now;
+    hal_u32_t outbits;
+    int k;
+
+    for (k = 0; k < ticks; k++) {
+	update_timers(stepgen);
+	update_addval(stepgen);
+	/* update DDS */
+	if ( !stepgen->hold_dds && *(stepgen->enable) ) {
+	    step_now = stepgen->sched_accum;
+	    stepgen->sched_accum += stepgen->addval;
+	    step_now ^= stepgen->sched_accum;
+	    step_now &= (1L << PICKOFF);
+	} else {
+	    step_now = 0;
+	}
+	if ( stepgen->timer2 == 0 ) {
+	    /* update direction - do not change if addval = 0 */
+	    if ( stepgen->addval > 0 ) {
+		stepgen->curr_dir = 1;
+	    } else if ( stepgen->addval < 0 ) {
+		stepgen->curr_dir = -1;
+	    }
+	}
+	if ( step_now ) {
+	    /* (re)start various timers */
+	    stepgen->timer1 = stepgen->step_len;
+	    stepgen->timer2 = stepgen->timer1 + stepgen->dir_hold_dly;
+	    stepgen->timer3 = stepgen->timer2 + stepgen->dir_setup;
+	}
+	/* generate output, based on stepping type */
+	outbits = 0;
+	if (stepgen->step_type == 0) {
+	    /* step/dir output */
+	    if ( stepgen->timer1 != 0 ) {
+		outbits |= 1;
+	    }
+	    if ( stepgen->curr_dir < 0 ) {
+		outbits |= 2;
+	    }
+	} else if ( stepgen->timer1 != 0 ) {
+	    /* up/down */
+	    if ( stepgen->curr_dir < 0 ) {
+		outbits |= 2;
+	    } else {
+		outbits |= 1;
+	    }
+	}
+	timeline[k] |= outbits << shift;
+    }
+}
+
 static void update_pos(void *arg, long period)
 {
     long long int accum_a, accum_b;
@@ -765,9 +975,11 @@ static unsigned long ulceil(unsigned long value, unsigned long increment)
 static void update_freq(void *arg, long period)
 {
     stepgen_t *stepgen;
-    int n, newperiod;
+    int n, k, newperiod, ticks;
+    unsigned head, queued;
     long min_step_period;
     long long int accum_a, accum_b;
+    hal_u32_t *timeline;
     double pos_cmd, vel_cmd, curr_pos, curr_vel, avg_v, max_freq, max_ac;
     double match_ac, match_time, est_out, est_cmd, est_err, dp, dv, new_vel;
     double desired_freq;
@@ -802,6 +1014,36 @@ static void update_freq(void *arg, long period)
 	/* calc the reciprocal once here, to avoid multiple divides later */
 	recip_dt = 1.0 / dt;
     }
+    timeline = 0;
+    ticks = 0;
+    head = 0;
+    if (sched) {
+	timeline = sched_data->plan;
+	/* keep one word per make_pulses run until the next update_freq
+	   queued, plus a little slack for the order the threads run in */
+	ticks = (period + periodns / 2) / periodns + SCHED_SLACK;
+	if (ticks > MAX_SCHED_TICKS) {
+	    if (!sched_data->printed_error) {
+		rtapi_print_msg(RTAPI_MSG_ERR,
+		    "STEPGEN: %d base periods per servo period is too many to schedule, limit is %d\n",
+		    ticks, MAX_SCHED_TICKS);
+		sched_data->printed_error = 1;
+	    }
+	    ticks = MAX_SCHED_TICKS;
+	}
+	/* only plan what the queue is short of; words already queued
+	   are played as planned, never replaced */
+	head = sched_data->head;
+	queued = head - sched_data->tail;
+	if (queued >= (unsigned) ticks) {
+	    ticks = 0;
+	} else {
+	    ticks -= queued;
+	}
+	for (k = 0; k < ticks; k++) {
+	    timeline[k] = 0;
+	}
+    }
 
     /* point at stepgen data */
     stepgen = arg;
@@ -869,6 +1111,10 @@ static void update_freq(void *arg, long period)
 	    stepgen->freq = 0;
 	    stepgen->addval = 0;
 	    stepgen->target_addval = 0;
+	    if (sched) {
+		/* let any pulse in progress finish */
+		plan_pulses(stepgen, timeline, ticks, 2 * n);
+	    }
 	    /* and skip to next one */
 	    stepgen++;
 	    continue;
@@ -926,13 +1172,18 @@ static void update_freq(void *arg, long period)
 	    /* calculate velocity command in counts/sec */
 	    vel_cmd = (pos_cmd - stepgen->old_pos_cmd) * recip_dt;
 	    stepgen->old_pos_cmd = pos_cmd;
-	    /* 'accum' is a long long, and its remotely possible that
-	       make_pulses could change it half-way through a read.
-	       So we have a crude atomic read routine */
-	    do {
-		accum_a = stepgen->accum;
-		accum_b = stepgen->accum;
-	    } while ( accum_a != accum_b );
+	    if (sched) {
+		/* control the end of the queue, all of it will be played */
+		accum_a = stepgen->sched_accum;
+	    } else {
+		/* 'accum' is a long long, and its remotely possible that
+		   make_pulses could change it half-way through a read.
+		   So we have a crude atomic read routine */
+		do {
+		    accum_a = stepgen->accum;
+		    accum_b = stepgen->accum;
+		} while ( accum_a != accum_b );
+	    }
 	    /* convert from fixed point to double, after subtracting
 	       the one-half step offset */
 	    curr_pos = (accum_a-(1<< (PICKOFF-1))) * (1.0 / (1L << PICKOFF));
@@ -1019,9 +1270,21 @@ static void update_freq(void *arg, long period)
 	stepgen->target_addval = stepgen->freq * freqscale;
 	/* calculate new deltalim */
 	stepgen->deltalim = max_ac * accelscale;
+	if (sched) {
+	    /* work out this channel's outputs until the next update */
+	    plan_pulses(stepgen, timeline, ticks, 2 * n);
+	}
 	/* move on to next channel */
 	stepgen++;
     }
+    if (sched) {
+	/* queue the new words */
+	for (k = 0; k < ticks; k++) {
+	    sched_data->ring[(head + k) & (MAX_SCHED_TICKS - 1)] = timeline[k];
+	}
+	__sync_synchronize();
+	sched_data->head = head + ticks;
+    }
     /* done */
 }
 
@@ -1178,6 +1441,7 @@ static int export_stepgen(int num, stepgen_t * addr, int step_type, int pos_mode
     /* accumulator gets a half step offset, so it will step half
        way between integer positions, not at the integer positions */
     addr->accum = 1 << (PICKOFF-1);
+    addr->sched_accum = addr->accum;
     addr->rawcount = 0;
     addr->curr_dir = 0;
     addr->state = 0;
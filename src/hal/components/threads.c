@@ -63,18 +63,30 @@ static int fp1 = 1;		/* use floating point? default = yes */
 RTAPI_MP_INT(fp1, "thread1 uses floating point");
 static long period1 = 1000000;	/* thread period - default = 1ms thread */
 RTAPI_MP_LONG(period1,  "thread1 period (nsecs)");
+static int cpu1 = -1;		/* processor - default = let RTAPI choose */
+RTAPI_MP_INT(cpu1, "thread1 processor");
+static int workers1 = 0;	/* helper tasks - default = none */
+RTAPI_MP_INT(workers1, "thread1 worker tasks");
 static char *name2 = NULL;	/* name of thread */
 RTAPI_MP_STRING(name2, "name of thread 2");
 static int fp2 = 1;		/* use floating point? default = yes */
 RTAPI_MP_INT(fp2, "thread2 uses floating point");
 static long period2 = 0;	/* thread period - default = no thread */
 RTAPI_MP_LONG(period2, "thread2 period (nsecs)");
+static int cpu2 = -1;		/* processor - default = let RTAPI choose */
+RTAPI_MP_INT(cpu2, "thread2 processor");
+static int workers2 = 0;	/* helper tasks - default = none */
+RTAPI_MP_INT(workers2, "thread2 worker tasks");
 static char *name3 = NULL;	/* name of thread */
 RTAPI_MP_STRING(name3, "name of thread 3");
 static int fp3 = 1;		/* use floating point? default = yes */
 RTAPI_MP_INT(fp3, "thread1 uses floating point");
 static long period3 = 0;	/* thread period - default = no thread */
 RTAPI_MP_LONG(period3, "thread3 period (nsecs)");
+static int cpu3 = -1;		/* processor - default = let RTAPI choose */
+RTAPI_MP_INT(cpu3, "thread3 processor");
+static int workers3 = 0;	/* helper tasks - default = none */
+RTAPI_MP_INT(workers3, "thread3 worker tasks");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -106,7 +118,7 @@ int rtapi_app_main(void)
     /* was 'period' specified in the insmod command? */
     if ((period1 > 0) && (name1 != NULL) && (*name1 != '\0')) {
 	/* create a thread */
-	retval = hal_create_thread(name1, period1, fp1);
+	retval = hal_create_thread_cpu(name1, period1, fp1, cpu1);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"THREADS: ERROR: could not create thread '%s'\n", name1);
@@ -115,10 +127,16 @@ int rtapi_app_main(void)
 	} else {
 	    rtapi_print_msg(RTAPI_MSG_INFO, "THREADS: created %ld uS thread\n", period1 / 1000);
 	}
+	if (workers1 > 0 && hal_thread_set_workers(name1, workers1) < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"THREADS: ERROR: could not add workers to thread '%s'\n", name1);
+	    hal_exit(comp_id);
+	    return -1;
+	}
     }
     if ((period2 > 0) && (name2 != NULL) && (*name2 != '\0')) {
 	/* create a thread */
-	retval = hal_create_thread(name2, period2, fp2);
+	retval = hal_create_thread_cpu(name2, period2, fp2, cpu2);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"THREADS: ERROR: could not create thread '%s'\n", name2);
@@ -127,10 +145,16 @@ int rtapi_app_main(void)
 	} else {
 	    rtapi_print_msg(RTAPI_MSG_INFO, "THREADS: created %ld uS thread\n", period2 / 1000);
 	}
+	if (workers2 > 0 && hal_thread_set_workers(name2, workers2) < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"THREADS: ERROR: could not add workers to thread '%s'\n", name2);
+	    hal_exit(comp_id);
+	    return -1;
+	}
     }
     if ((period3 > 0) && (name3 != NULL) && (*name3 != '\0')) {
 	/* create a thread */
-	retval = hal_create_thread(name3, period3, fp3);
+	retval = hal_create_thread_cpu(name3, period3, fp3, cpu3);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"THREADS: ERROR: could not create thread '%s'\n", name3);
@@ -139,6 +163,12 @@ int rtapi_app_main(void)
 	} else {
 	    rtapi_print_msg(RTAPI_MSG_INFO, "THREADS: created %ld uS thread\n", period3 / 1000);
 	}
+	if (workers3 > 0 && hal_thread_set_workers(name3, workers3) < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"THREADS: ERROR: could not add workers to thread '%s'\n", name3);
+	    hal_exit(comp_id);
+	    return -1;
+	}
     }
     hal_ready(comp_id);
     return 0;
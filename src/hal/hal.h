@@ -653,6 +653,28 @@ extern int hal_export_funct(const char *name, void (*funct) (void *, long),
 extern int hal_create_thread(const char *name, unsigned long period_nsec,
     int uses_fp);
 
+/** hal_create_thread_cpu() is hal_create_thread() for a thread that
+    should run on processor 'cpu'.  A 'cpu' of -1 leaves the choice to
+    RTAPI, exactly like hal_create_thread().  If RTAPI cannot honor the
+    request, a warning is printed and the thread is created anyway.
+*/
+extern int hal_create_thread_cpu(const char *name, unsigned long period_nsec,
+    int uses_fp, int cpu);
+
+/** hal_thread_set_workers() lets thread 'name' run functions that do
+    not depend on each other at the same time, with the help of
+    'workers' extra realtime tasks.  A function depends on an earlier
+    one in the thread if both belong to the same component, or if one
+    writes a signal that the other reads or writes.  Functions run in
+    list order otherwise, and the thread still finishes all of them
+    before its period ends.  The workers only help if RTAPI puts them
+    on processors of their own.  'workers' may be at most
+    HAL_MAX_WORKERS (4), and can only be set once per thread.
+    Returns 0 on success or a negative error code.  Call only from
+    realtime init code, not from user space or realtime code.
+*/
+extern int hal_thread_set_workers(const char *name, int workers);
+
 /** hal_thread_delete() deletes a realtime thread.
     'name' is the name of the thread, which must have been created
     by 'hal_create_thread()'.
@@ -715,6 +737,22 @@ extern int hal_start_threads(void);
 */
 extern int hal_stop_threads(void);
 
+/** hal_compact_signals() moves the data of every signal that is used
+    by a thread into a new, contiguous block of shared memory.  Each
+    thread gets its own cache line aligned region, and within it the
+    signals are placed in the order the thread's functions use them
+    (in funct order, then in pin name order within each component).
+    Signals not used by any thread are left where they are.  All pin
+    pointers are rewritten to the new locations.  Signals placed in
+    the block by an earlier call stay in it; the block is rewritten
+    when the new layout fits, and left alone when nothing changed, so
+    only a call that needs a bigger block consumes shared memory.
+    Threads must be stopped.  Returns 0, or a negative error code.
+    Call only from within user space or init code, not from
+    realtime code.
+*/
+extern int hal_compact_signals(void);
+
 /** HAL 'constructor' typedef
     If it is not NULL, this points to a function which can construct a new
     instance of its component.  Return value is >=0 for success,
@@ -777,6 +815,52 @@ extern bool hal_stream_writable(hal_stream_t *stream);
 extern void hal_stream_wait_writable(hal_stream_t *stream, sig_atomic_t *stop);
 #endif
 
+struct hal_watch_entry;
+
+typedef struct {
+    int count;			/* number of names watched */
+    double *value;		/* their values, as of the last read */
+    hal_type_t *type;		/* their types, HAL_TYPE_UNSPECIFIED if
+				   the name does not exist */
+    int serial;			/* HAL change serial of the lookup */
+    struct hal_watch_entry *entry;
+} hal_watch_t;
+
+/**
+ * HAL watches let a userspace program that displays or logs many values
+ * (halrmt, the python hal module) register a list of pin, parameter and
+ * signal names once, and then refresh all of their values with one call
+ * into a contiguous array of doubles, instead of looking up and reading
+ * each name on every refresh.
+ *
+ * A name is looked up as a pin, then a parameter, then a signal.  The
+ * lookup is repeated only when pins, parameters, signals or threads have
+ * been created, deleted, linked, aliased or moved since the last read.
+ * A name that does not exist (yet) reads as 0.
+ *
+ * The values are copied while no thread is running its functions, so
+ * that every value in the array comes from the same set of completed
+ * thread periods.
+ */
+#ifdef ULAPI
+#define HAL_WATCH_TRIES (100)
+/** hal_watch_new() sets up 'watch' for the 'count' names in 'names'.
+    Returns 0, or -EINVAL if a name is too long or HAL is not
+    initialized, or -ENOMEM.
+*/
+extern int hal_watch_new(hal_watch_t *watch, int count, const char **names);
+/** hal_watch_read() refreshes watch->value and watch->type.  Returns
+    0 if all values were read in one quiet window, 1 if no quiet window
+    was found in HAL_WATCH_TRIES attempts (the values are read anyway;
+    the HAL mutex is released between attempts),
+    or -ENOENT if at least one name does not exist.
+*/
+extern int hal_watch_read(hal_watch_t *watch);
+extern const char *hal_watch_name(hal_watch_t *watch, int idx);
+/** hal_watch_free() releases what hal_watch_new() allocated. */
+extern void hal_watch_free(hal_watch_t *watch);
+#endif
+
 RTAPI_END_DECLS
 
 #endif /* HAL_H */
@@ -71,6 +71,7 @@ MODULE_LICENSE("GPL");
 #if defined(ULAPI)
 #include <sys/types.h>		/* pid_t */
 #include <unistd.h>		/* getpid() */
+#include <stdlib.h>		/* malloc() */
 #include <time.h>
 #endif
 
@@ -151,12 +152,28 @@ static void free_funct_entry_struct(hal_funct_entry_t * funct_entry);
 static void free_thread_struct(hal_thread_t * thread);
 #endif /* RTAPI */
 
+/** 'plan_thread()' works out which functs of a thread may run at the
+    same time, see hal_thread_set_workers(); 'plan_threads()' marks the
+    plan of every thread that has workers out of date, the thread then
+    runs serially until it replans at the end of its next period.
+    'plan_unlink_entry()' keeps the plan safe while a funct entry is
+    removed.  Call them with the mutex held.
+*/
+static void plan_thread(hal_thread_t * thread);
+static void plan_threads(void);
+static void plan_unlink_entry(hal_list_t * entry, hal_list_t * root);
+
 #ifdef RTAPI
 /** 'thread_task()' is a function that is invoked as a realtime task.
     It implements a thread, by running down the thread's function list
     and calling each function in turn.
 */
 static void thread_task(void *arg);
+
+/** 'worker_task()' helps a thread run independent functs at the same
+    time as the thread's own task.
+*/
+static void worker_task(void *arg);
 #endif /* RTAPI */
 
 /***********************************************************************
@@ -819,6 +836,7 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	    free_oldname_struct(oldname);
 	}
     }
+    hal_data->change_serial++;
     /* insert pin back into list in proper place */
     prev = &(hal_data->pin_list_ptr);
     next = *prev;
@@ -1145,6 +1163,9 @@ int hal_link(const char *pin_name, const char *sig_name)
     }
     /* and update the pin */
     pin->signal = SHMOFF(sig);
+    hal_data->change_serial++;
+    /* the new connection may order functs */
+    plan_threads();
     /* done, release the mutex and return */
     rtapi_mutex_give(&(hal_data->mutex));
     return 0;
@@ -1185,6 +1206,7 @@ int hal_unlink(const char *pin_name)
     }
     /* found pin, unlink it */
     unlink_pin(pin);
+    plan_threads();
     /* done, release the mutex and return */
     rtapi_mutex_give(&(hal_data->mutex));
     return 0;
@@ -1587,6 +1609,7 @@ int hal_param_alias(const char *param_name, const char *alias)
 	    free_oldname_struct(oldname);
 	}
     }
+    hal_data->change_serial++;
     /* insert param back into list in proper place */
     prev = &(hal_data->param_list_ptr);
     next = *prev;
@@ -1746,6 +1769,12 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
 }
 
 int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
+{
+    return hal_create_thread_cpu(name, period_nsec, uses_fp, -1);
+}
+
+int hal_create_thread_cpu(const char *name, unsigned long period_nsec,
+    int uses_fp, int cpu)
 {
     int next, cmp, prev_priority;
     int retval, n;
@@ -1874,6 +1903,14 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
 	return -EINVAL;
     }
     new->task_id = retval;
+    if (cpu >= 0) {
+	retval = rtapi_task_set_cpu(new->task_id, cpu);
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_WARN,
+		"HAL_LIB: could not put thread %s on cpu %d: %d\n",
+		name, cpu, retval);
+	}
+    }
     /* start task */
     retval = rtapi_task_start(new->task_id, new->period);
     if (retval < 0) {
@@ -1910,6 +1947,21 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
         return -EINVAL;
     }
     *(new->runtime) = 0;
+
+    rtapi_snprintf(buf, sizeof(buf), "%s.wake-late-max", new->name);
+    new->wake_late_max = 0;
+    if (hal_param_s32_new(buf, HAL_RW, &(new->wake_late_max), new->comp_id)) {
+        rtapi_print_msg(RTAPI_MSG_ERR,
+           "HAL: ERROR: fail to create param '%s.wake-late-max'\n", new->name);
+        return -EINVAL;
+    }
+
+    if (hal_pin_s32_newf(HAL_OUT, &(new->wake_late), new->comp_id,"%s.wake-late",new->name)) {
+        rtapi_print_msg(RTAPI_MSG_ERR,
+           "HAL: ERROR: fail to create pin '%s.wake-late'\n", new->name);
+        return -EINVAL;
+    }
+    *(new->wake_late) = 0;
     hal_ready(new->comp_id);
 
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: thread created\n");
@@ -1965,6 +2017,91 @@ extern int hal_thread_delete(const char *name)
     return -EINVAL;
 }
 
+int hal_thread_set_workers(const char *name, int workers)
+{
+    hal_thread_t *thread;
+    int n, m, retval, cpus[HAL_MAX_WORKERS + 1];
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread_set_workers called before init\n");
+	return -EINVAL;
+    }
+    if (workers < 1 || workers > HAL_MAX_WORKERS) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' can have 1 to %d workers, not %d\n",
+	    name, HAL_MAX_WORKERS, workers);
+	return -EINVAL;
+    }
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread_set_workers called while HAL is locked\n");
+	return -EPERM;
+    }
+    /* get mutex before accessing shared data */
+    rtapi_mutex_get(&(hal_data->mutex));
+    thread = halpr_find_thread_by_name(name);
+    if (thread == 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' not found\n", name);
+	return -EINVAL;
+    }
+    if (thread->workers > 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' already has workers\n", name);
+	return -EINVAL;
+    }
+    /* a worker that shares a processor with its thread, or with another
+       worker, could be stuck behind it for the whole period */
+    cpus[0] = rtapi_task_get_cpu(thread->task_id);
+    retval = 0;
+    for (n = 0; n < workers; n++) {
+	retval = rtapi_task_new(worker_task, thread, thread->priority,
+	    lib_module_id, HAL_STACKSIZE, thread->uses_fp);
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL_LIB: could not create worker task for thread %s\n", name);
+	    break;
+	}
+	thread->worker_task_id[thread->workers++] = retval;
+	/* the worker runs free; it pauses itself until its thread needs it */
+	retval = rtapi_task_resume(retval);
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL_LIB: could not start worker task for thread %s: %d\n",
+		name, retval);
+	    break;
+	}
+	cpus[n + 1] = rtapi_task_get_cpu(thread->worker_task_id[n]);
+	for (m = 0; m <= n; m++) {
+	    if (cpus[n + 1] < 0 || cpus[m] < 0 || cpus[m] == cpus[n + 1]) {
+		retval = -EINVAL;
+	    }
+	}
+	if (retval < 0) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL_LIB: worker %d of thread %s has no processor of its own\n",
+		n, name);
+	    break;
+	}
+    }
+    if (retval < 0) {
+	while (thread->workers > 0) {
+	    thread->workers--;
+	    rtapi_task_pause(thread->worker_task_id[thread->workers]);
+	    rtapi_task_delete(thread->worker_task_id[thread->workers]);
+	}
+	rtapi_mutex_give(&(hal_data->mutex));
+	return -EINVAL;
+    }
+    plan_thread(thread);
+    thread->plan_dirty = 0;
+    rtapi_mutex_give(&(hal_data->mutex));
+    return 0;
+}
+
 #endif /* RTAPI */
 
 int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int position)
@@ -2095,6 +2232,7 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     list_add_after((hal_list_t *) funct_entry, list_entry);
     /* update the function usage count */
     funct->users++;
+    plan_threads();
     rtapi_mutex_give(&(hal_data->mutex));
     return 0;
 }
@@ -2177,9 +2315,11 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
 	funct_entry = (hal_funct_entry_t *) list_entry;
 	if (SHMPTR(funct_entry->funct_ptr) == funct) {
 	    /* this funct entry points to our funct, unlink */
+	    plan_unlink_entry(list_entry, list_root);
 	    list_remove_entry(list_entry);
 	    /* and delete it */
 	    free_funct_entry_struct(funct_entry);
+	    plan_threads();
 	    /* done */
 	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
@@ -2191,7 +2331,9 @@ int hal_del_funct_from_thread(const char *funct_name, const char *thread_name)
 
 int hal_start_threads(void)
 {
-    /* a trivial function for a change! */
+    hal_thread_t *thread;
+    int next;
+
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: start_threads called before init\n");
@@ -2206,6 +2348,18 @@ int hal_start_threads(void)
 
 
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: starting threads\n");
+    /* bring the plans up to date now rather than in the threads */
+    rtapi_mutex_get(&(hal_data->mutex));
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	thread = SHMPTR(next);
+	if (thread->plan_dirty) {
+	    plan_thread(thread);
+	    thread->plan_dirty = 0;
+	}
+	next = thread->next_ptr;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
     hal_data->threads_running = 1;
     return 0;
 }
@@ -2230,6 +2384,198 @@ int hal_stop_threads(void)
     return 0;
 }
 
+static long sig_data_size(hal_type_t type)
+{
+    switch (type) {
+    case HAL_BIT:
+	return sizeof(hal_bit_t);
+    case HAL_S32:
+	return sizeof(hal_s32_t);
+    case HAL_U32:
+	return sizeof(hal_u32_t);
+    case HAL_FLOAT:
+	return sizeof(hal_float_t);
+    default:
+	return sizeof(hal_data_u);
+    }
+}
+
+/* gives sig the next slot of the layout being built, unless it has one */
+static void compact_place(hal_sig_t * sig, int *cursor)
+{
+    long size;
+
+    if (sig->compact_off != 0) {
+	return;
+    }
+    size = sig_data_size(sig->type);
+    *cursor = (*cursor + size - 1) & ~(size - 1);
+    sig->compact_off = *cursor + 1;
+    *cursor += size;
+}
+
+int hal_compact_signals(void)
+{
+    int next, base, start, scratch, cursor, moved, off;
+    hal_sig_t *sig;
+    hal_pin_t *pin;
+    hal_thread_t *thread;
+    hal_list_t *entry;
+    hal_comp_t *comp;
+    void *old_addr, *new_addr;
+
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: compact_signals called before init\n");
+	return -EINVAL;
+    }
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: compact_signals called while HAL locked\n");
+	return -EPERM;
+    }
+    rtapi_mutex_get(&(hal_data->mutex));
+    if (hal_data->threads_running) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: compact_signals called while threads are running\n");
+	return -EBUSY;
+    }
+    /* lay out the signals of each thread, in the order its functs use
+       them, at offsets from a cache line aligned base; each thread
+       region starts on a fresh cache line */
+    next = hal_data->sig_list_ptr;
+    while (next != 0) {
+	sig = SHMPTR(next);
+	sig->compact_off = 0;
+	next = sig->next_ptr;
+    }
+    cursor = 0;
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	thread = SHMPTR(next);
+	cursor = (cursor + HAL_CACHELINE - 1) & ~(HAL_CACHELINE - 1);
+	entry = 0;
+	pin = 0;
+	while ((pin = halpr_thread_pin_next(thread, &entry, pin)) != 0) {
+	    if (pin->signal != 0) {
+		compact_place(SHMPTR(pin->signal), &cursor);
+	    }
+	}
+	next = thread->next_ptr;
+    }
+    /* signals an earlier call put in the block that no thread uses now
+       go along, so that the block can be rewritten */
+    start = hal_data->compact_ptr;
+    next = hal_data->sig_list_ptr;
+    while (next != 0) {
+	sig = SHMPTR(next);
+	if (start != 0 && sig->data_ptr >= start &&
+	    sig->data_ptr < start + hal_data->compact_size) {
+	    compact_place(sig, &cursor);
+	}
+	next = sig->next_ptr;
+    }
+    if (cursor == 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	return 0;
+    }
+    if (start != 0 && cursor <= hal_data->compact_size) {
+	/* the block of the last call is big enough; leave it alone if
+	   every signal already sits where the layout puts it */
+	base = start;
+	moved = 0;
+	next = hal_data->sig_list_ptr;
+	while (next != 0) {
+	    sig = SHMPTR(next);
+	    if (sig->compact_off != 0 &&
+		sig->data_ptr != base + sig->compact_off - 1) {
+		moved++;
+	    }
+	    next = sig->next_ptr;
+	}
+	if (moved == 0) {
+	    rtapi_mutex_give(&(hal_data->mutex));
+	    rtapi_print_msg(RTAPI_MSG_DBG,
+		"HAL: signals already compacted\n");
+	    return 0;
+	}
+	/* values still to be moved may sit in the block, so build its new
+	   contents in free memory first */
+	scratch = (hal_data->shmem_bot + HAL_CACHELINE - 1) &
+	    ~(HAL_CACHELINE - 1);
+	if (hal_data->shmem_top - scratch < cursor) {
+	    rtapi_mutex_give(&(hal_data->mutex));
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: insufficient memory to compact signals\n");
+	    return -ENOMEM;
+	}
+    } else {
+	new_addr = shmalloc_up(cursor + HAL_CACHELINE - 1);
+	if (new_addr == 0) {
+	    rtapi_mutex_give(&(hal_data->mutex));
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: insufficient memory to compact signals\n");
+	    return -ENOMEM;
+	}
+	base = (SHMOFF(new_addr) + HAL_CACHELINE - 1) & ~(HAL_CACHELINE - 1);
+	scratch = base;
+	hal_data->compact_ptr = base;
+	hal_data->compact_size = cursor;
+    }
+    moved = 0;
+    next = hal_data->sig_list_ptr;
+    while (next != 0) {
+	sig = SHMPTR(next);
+	next = sig->next_ptr;
+	if (sig->compact_off == 0) {
+	    continue;
+	}
+	off = sig->compact_off - 1;
+	old_addr = SHMPTR(sig->data_ptr);
+	new_addr = SHMPTR(scratch + off);
+	switch (sig->type) {
+	case HAL_BIT:
+	    *((hal_bit_t *) new_addr) = *((hal_bit_t *) old_addr);
+	    break;
+	case HAL_S32:
+	    *((hal_s32_t *) new_addr) = *((hal_s32_t *) old_addr);
+	    break;
+	case HAL_U32:
+	    *((hal_u32_t *) new_addr) = *((hal_u32_t *) old_addr);
+	    break;
+	case HAL_FLOAT:
+	    *((hal_float_t *) new_addr) = *((hal_float_t *) old_addr);
+	    break;
+	default:
+	    break;
+	}
+	if (sig->data_ptr != base + off) {
+	    moved++;
+	}
+	sig->data_ptr = base + off;
+    }
+    if (scratch != base) {
+	memcpy(SHMPTR(base), SHMPTR(scratch), cursor);
+    }
+    /* point every linked pin at the new location of its signal */
+    next = hal_data->pin_list_ptr;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	if (pin->signal != 0) {
+	    sig = SHMPTR(pin->signal);
+	    comp = SHMPTR(pin->owner_ptr);
+	    *((void **) SHMPTR(pin->data_ptr_addr)) =
+		comp->shmem_base + sig->data_ptr;
+	}
+	next = pin->next_ptr;
+    }
+    hal_data->change_serial++;
+    rtapi_mutex_give(&(hal_data->mutex));
+    rtapi_print_msg(RTAPI_MSG_DBG, "HAL: compacted %d signals\n", moved);
+    return 0;
+}
+
 /***********************************************************************
 *                    PRIVATE FUNCTION CODE                             *
 ************************************************************************/
@@ -2576,6 +2922,30 @@ hal_pin_t *halpr_find_pin_by_sig(hal_sig_t * sig, hal_pin_t * start)
     return 0;
 }
 
+hal_pin_t *halpr_thread_pin_next(hal_thread_t * thread, hal_list_t ** entry,
+    hal_pin_t * start)
+{
+    hal_list_t *list_root;
+    hal_funct_t *funct;
+
+    list_root = &(thread->funct_list);
+    /* is this the first call? */
+    if (*entry == 0) {
+	*entry = list_next(list_root);
+	start = 0;
+    }
+    while (*entry != list_root) {
+	funct = SHMPTR(((hal_funct_entry_t *) *entry)->funct_ptr);
+	start = halpr_find_pin_by_owner(SHMPTR(funct->owner_ptr), start);
+	if (start != 0) {
+	    return start;
+	}
+	/* no more pins for this funct, go on to the next one */
+	*entry = list_next(*entry);
+    }
+    return 0;
+}
+
 /***********************************************************************
 *                     LOCAL FUNCTION CODE                              *
 ************************************************************************/
@@ -2710,10 +3080,113 @@ void rtapi_app_exit(void)
 
 /* this is the task function that implements threads in realtime */
 
+#if defined(__i386__) || defined(__x86_64__)
+#define cpu_relax() __builtin_ia32_pause()
+#else
+#define cpu_relax() __sync_synchronize()
+#endif
+
+/* calls one funct and updates its execution time data, returns the
+   time it finished */
+static long long run_funct(hal_funct_entry_t * funct_entry, long period,
+    long long start_time)
+{
+    hal_funct_t *funct;
+    long long end_time;
+
+    /* call the function */
+    funct_entry->funct(funct_entry->arg, period);
+    /* capture execution time */
+    end_time = rtapi_get_clocks();
+    /* point to function structure */
+    funct = SHMPTR(funct_entry->funct_ptr);
+    /* update execution time data */
+    *(funct->runtime) = (hal_s32_t)(end_time - start_time);
+    if ( *(funct->runtime) > funct->maxtime) {
+	funct->maxtime = *(funct->runtime);
+	funct->maxtime_increased = 1;
+    } else {
+	funct->maxtime_increased = 0;
+    }
+    return end_time;
+}
+
+/* runs every funct of stage 'seq' that nobody else has claimed yet */
+static void run_stage(hal_thread_t * thread, int first, int end, int seq)
+{
+    hal_funct_entry_t *funct_entry;
+    int next, old;
+
+    next = first;
+    while (next != end) {
+	funct_entry = SHMPTR(next);
+	old = funct_entry->claim;
+	/* a worker that is late for this stage must not claim the
+	   entries of a later one again */
+	if (thread->stage_seq != seq) {
+	    return;
+	}
+	if ((int)((unsigned) old - (unsigned) seq) < 0 &&
+	    __sync_bool_compare_and_swap(&funct_entry->claim, old, seq)) {
+	    run_funct(funct_entry, thread->period, rtapi_get_clocks());
+	    __sync_fetch_and_sub(&thread->stage_pending, 1);
+	}
+	next = funct_entry->links.next;
+    }
+}
+
+/* runs the function list one stage at a time; a stage ends before the
+   next entry that has to wait for the ones before it */
+static long long run_stages(hal_thread_t * thread, long long start_time)
+{
+    hal_list_t *funct_root;
+    hal_funct_entry_t *funct_entry, *end_entry;
+    int n, w, seq, woken;
+
+    woken = 0;
+    funct_root = &(thread->funct_list);
+    funct_entry = SHMPTR(funct_root->next);
+    while ((hal_list_t *) funct_entry != funct_root) {
+	end_entry = funct_entry;
+	n = 0;
+	do {
+	    end_entry = SHMPTR(end_entry->links.next);
+	    n++;
+	} while ((hal_list_t *) end_entry != funct_root && !end_entry->barrier);
+	if (n == 1) {
+	    /* nothing to share */
+	    start_time = run_funct(funct_entry, thread->period, start_time);
+	} else {
+	    /* publish the stage, then take part in it */
+	    seq = thread->stage_seq + 1;
+	    thread->stage_first = SHMOFF(funct_entry);
+	    thread->stage_end = SHMOFF(end_entry);
+	    thread->stage_pending = n;
+	    __sync_synchronize();
+	    thread->stage_seq = seq;
+	    /* a period that shares nothing leaves the workers asleep */
+	    if (!woken) {
+		for (w = 0; w < thread->workers; w++) {
+		    rtapi_task_resume(thread->worker_task_id[w]);
+		}
+		woken = 1;
+	    }
+	    run_stage(thread, SHMOFF(funct_entry), SHMOFF(end_entry), seq);
+	    /* wait for the functs the workers took */
+	    while (thread->stage_pending > 0) {
+		cpu_relax();
+	    }
+	    __sync_synchronize();
+	    start_time = rtapi_get_clocks();
+	}
+	funct_entry = end_entry;
+    }
+    return start_time;
+}
+
 static void thread_task(void *arg)
 {
     hal_thread_t *thread;
-    hal_funct_t *funct;
     hal_funct_entry_t *funct_root, *funct_entry;
     long long int start_time, end_time;
     long long int thread_start_time;
@@ -2728,26 +3201,31 @@ static void thread_task(void *arg)
 	    start_time = rtapi_get_clocks();
 	    end_time = start_time;
 	    thread_start_time = start_time;
-	    /* run thru function list */
-	    while (funct_entry != funct_root) {
-		/* call the function */
-		funct_entry->funct(funct_entry->arg, thread->period);
-		/* capture execution time */
-		end_time = rtapi_get_clocks();
-		/* point to function structure */
-		funct = SHMPTR(funct_entry->funct_ptr);
-		/* update execution time data */
-		*(funct->runtime) = (hal_s32_t)(end_time - start_time);
-		if ( *(funct->runtime) > funct->maxtime) {
-		    funct->maxtime = *(funct->runtime);
-		    funct->maxtime_increased = 1;
-		} else {
-		    funct->maxtime_increased = 0;
+	    /* workers and watch readers both look at these */
+	    thread->period_busy = 1;
+	    __sync_synchronize();
+	    if (thread->workers > 0 && !thread->plan_dirty) {
+		end_time = run_stages(thread, start_time);
+	    } else {
+		/* run thru function list */
+		while (funct_entry != funct_root) {
+		    end_time = run_funct(funct_entry, thread->period, start_time);
+		    /* point to next next entry in list */
+		    funct_entry = SHMPTR(funct_entry->links.next);
+		    /* prepare to measure time for next funct */
+		    start_time = end_time;
 		}
-		/* point to next next entry in list */
-		funct_entry = SHMPTR(funct_entry->links.next);
-		/* prepare to measure time for next funct */
-		start_time = end_time;
+	    }
+	    thread->period_count++;
+	    __sync_synchronize();
+	    thread->period_busy = 0;
+	    /* the configuration changed: replan once, unless userspace
+	       holds the mutex, then try again next period */
+	    if (thread->workers > 0 && thread->plan_dirty &&
+		rtapi_mutex_try(&(hal_data->mutex)) == 0) {
+		plan_thread(thread);
+		thread->plan_dirty = 0;
+		rtapi_mutex_give(&(hal_data->mutex));
 	    }
 	    /* update thread execution time */
 	    *(thread->runtime) = (hal_s32_t)(end_time - thread_start_time);
@@ -2757,6 +3235,44 @@ static void thread_task(void *arg)
 	}
 	/* wait until next period */
 	rtapi_wait();
+	/* wakeup time logging */
+	*(thread->wake_late) = (hal_s32_t) rtapi_wait_lateness();
+	if ( *(thread->wake_late) > thread->wake_late_max) {
+	    thread->wake_late_max = *(thread->wake_late);
+	}
+    }
+}
+
+static void worker_task(void *arg)
+{
+    hal_thread_t *thread;
+    int self, seen, seq, first, end;
+
+    thread = arg;
+    self = rtapi_task_self();
+    seen = thread->stage_seq;
+    while (1) {
+	/* sleep until the thread publishes the first stage it shares in a
+	   period; a worker that misses the wakeup leaves the stages to the
+	   thread, which can run all of them by itself */
+	rtapi_task_pause(self);
+	while (thread->period_busy) {
+	    seq = thread->stage_seq;
+	    if (seq == seen) {
+		cpu_relax();
+		continue;
+	    }
+	    __sync_synchronize();
+	    first = thread->stage_first;
+	    end = thread->stage_end;
+	    __sync_synchronize();
+	    if (thread->stage_seq != seq) {
+		/* the stage moved on while reading it */
+		continue;
+	    }
+	    run_stage(thread, first, end, seq);
+	    seen = seq;
+	}
     }
 }
 #endif /* RTAPI */
@@ -2806,6 +3322,10 @@ static int init_hal_data(void)
     hal_data->shmem_bot = sizeof(hal_data_t);
     hal_data->shmem_top = HAL_SIZE;
     hal_data->lock = HAL_LOCK_NONE;
+    hal_data->plan_token = 0;
+    hal_data->change_serial = 0;
+    hal_data->compact_ptr = 0;
+    hal_data->compact_size = 0;
     /* done, release mutex */
     rtapi_mutex_give(&(hal_data->mutex));
     return 0;
@@ -2922,6 +3442,7 @@ static hal_pin_t *alloc_pin_struct(void)
 	p->signal = 0;
 	memset(&p->dummysig, 0, sizeof(hal_data_u));
 	p->name[0] = '\0';
+	hal_data->change_serial++;
     }
     return p;
 }
@@ -2950,6 +3471,7 @@ static hal_sig_t *alloc_sig_struct(void)
 	p->writers = 0;
 	p->bidirs = 0;
 	p->name[0] = '\0';
+	hal_data->change_serial++;
     }
     return p;
 }
@@ -2976,6 +3498,7 @@ static hal_param_t *alloc_param_struct(void)
 	p->owner_ptr = 0;
 	p->type = 0;
 	p->name[0] = '\0';
+	hal_data->change_serial++;
     }
     return p;
 }
@@ -3057,6 +3580,10 @@ static hal_funct_entry_t *alloc_funct_entry_struct(void)
 	p->funct_ptr = 0;
 	p->arg = 0;
 	p->funct = 0;
+	/* run alone until the planner says otherwise */
+	p->barrier = 1;
+	p->plan_barrier = 1;
+	p->claim = 0;
     }
     return p;
 }
@@ -3086,6 +3613,13 @@ static hal_thread_t *alloc_thread_struct(void)
 	p->task_id = 0;
 	list_init_entry(&(p->funct_list));
 	p->name[0] = '\0';
+	p->workers = 0;
+	p->period_busy = 0;
+	p->period_count = 0;
+	p->stage_seq = 0;
+	p->stage_pending = 0;
+	p->plan_dirty = 0;
+	hal_data->change_serial++;
     }
     return p;
 }
@@ -3216,6 +3750,7 @@ static void unlink_pin(hal_pin_t * pin)
 	}
 	/* mark pin as unlinked */
 	pin->signal = 0;
+	hal_data->change_serial++;
     }
 }
 
@@ -3235,6 +3770,7 @@ static void free_pin_struct(hal_pin_t * pin)
     /* add it to free list */
     pin->next_ptr = hal_data->pin_free_ptr;
     hal_data->pin_free_ptr = SHMOFF(pin);
+    hal_data->change_serial++;
 }
 
 static void free_sig_struct(hal_sig_t * sig)
@@ -3259,6 +3795,7 @@ static void free_sig_struct(hal_sig_t * sig)
     /* add it to free list */
     sig->next_ptr = hal_data->sig_free_ptr;
     hal_data->sig_free_ptr = SHMOFF(sig);
+    hal_data->change_serial++;
 }
 
 static void free_param_struct(hal_param_t * p)
@@ -3272,6 +3809,7 @@ static void free_param_struct(hal_param_t * p)
     /* add it to free list (params use the same struct as src vars) */
     p->next_ptr = hal_data->param_free_ptr;
     hal_data->param_free_ptr = SHMOFF(p);
+    hal_data->change_serial++;
 }
 
 static void free_oldname_struct(hal_oldname_t * oldname)
@@ -3313,6 +3851,7 @@ static void free_funct_struct(hal_funct_t * funct)
 		/* test it */
 		if (SHMPTR(funct_entry->funct_ptr) == funct) {
 		    /* this funct entry points to our funct, unlink */
+		    plan_unlink_entry(list_entry, list_root);
 		    list_entry = list_remove_entry(list_entry);
 		    /* and delete it */
 		    free_funct_entry_struct(funct_entry);
@@ -3357,6 +3896,157 @@ static void free_funct_entry_struct(hal_funct_entry_t * funct_entry)
     list_add_after((hal_list_t *) funct_entry, &(hal_data->funct_entry_free));
 }
 
+/* The planner groups a thread's functs into stages that may run at the
+   same time.  A funct starts a new stage if it conflicts with the stage
+   so far: same component, or a signal that one of them writes and the
+   other reads or writes.  Stages are marked with a fresh token in the
+   components and signals they touch, so checking a funct is one pass
+   over the pin list.
+*/
+/* chains the linked pins of each component through 'plan_next', so
+   that a plan looks at every pin once rather than once per funct */
+static void plan_index_pins(void)
+{
+    hal_comp_t *comp;
+    hal_pin_t *pin;
+    int next;
+
+    next = hal_data->comp_list_ptr;
+    while (next != 0) {
+	comp = SHMPTR(next);
+	comp->plan_pins = 0;
+	next = comp->next_ptr;
+    }
+    next = hal_data->pin_list_ptr;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	if (pin->signal != 0 && pin->owner_ptr != 0) {
+	    comp = SHMPTR(pin->owner_ptr);
+	    pin->plan_next = comp->plan_pins;
+	    comp->plan_pins = next;
+	}
+	next = pin->next_ptr;
+    }
+}
+
+static int plan_conflicts(hal_comp_t * comp, int token)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    int next;
+
+    if (comp->plan_mark == token) {
+	return 1;
+    }
+    next = comp->plan_pins;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	next = pin->plan_next;
+	sig = SHMPTR(pin->signal);
+	if (sig->plan_write == token) {
+	    return 1;
+	}
+	if ((pin->dir & HAL_OUT) && sig->plan_read == token) {
+	    return 1;
+	}
+    }
+    return 0;
+}
+
+static void plan_mark(hal_comp_t * comp, int token)
+{
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    int next;
+
+    comp->plan_mark = token;
+    next = comp->plan_pins;
+    while (next != 0) {
+	pin = SHMPTR(next);
+	next = pin->plan_next;
+	sig = SHMPTR(pin->signal);
+	if (pin->dir & HAL_IN) {
+	    sig->plan_read = token;
+	}
+	if (pin->dir & HAL_OUT) {
+	    sig->plan_write = token;
+	}
+    }
+}
+
+static void plan_thread(hal_thread_t * thread)
+{
+    hal_list_t *list_root, *list_entry;
+    hal_funct_entry_t *funct_entry;
+    hal_funct_t *funct;
+    hal_comp_t *comp;
+    int token = 0;
+
+    plan_index_pins();
+    list_root = &(thread->funct_list);
+    /* work out the new plan */
+    for (list_entry = list_next(list_root); list_entry != list_root;
+	list_entry = list_next(list_entry)) {
+	funct_entry = (hal_funct_entry_t *) list_entry;
+	funct = SHMPTR(funct_entry->funct_ptr);
+	comp = funct->owner_ptr ? SHMPTR(funct->owner_ptr) : 0;
+	if (token == 0 || comp == 0 || plan_conflicts(comp, token)) {
+	    token = ++hal_data->plan_token;
+	    funct_entry->plan_barrier = 1;
+	} else {
+	    funct_entry->plan_barrier = 0;
+	}
+	if (comp) {
+	    plan_mark(comp, token);
+	}
+    }
+    /* the thread may be running: first add the barriers the new plan
+       needs, then drop the ones it doesn't, so that it never sees
+       fewer barriers than either plan has */
+    for (list_entry = list_next(list_root); list_entry != list_root;
+	list_entry = list_next(list_entry)) {
+	funct_entry = (hal_funct_entry_t *) list_entry;
+	if (funct_entry->plan_barrier) {
+	    funct_entry->barrier = 1;
+	}
+    }
+    __sync_synchronize();
+    for (list_entry = list_next(list_root); list_entry != list_root;
+	list_entry = list_next(list_entry)) {
+	funct_entry = (hal_funct_entry_t *) list_entry;
+	funct_entry->barrier = funct_entry->plan_barrier;
+    }
+}
+
+static void plan_threads(void)
+{
+    hal_thread_t *thread;
+    int next;
+
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	thread = SHMPTR(next);
+	if (thread->workers > 0) {
+	    thread->plan_dirty = 1;
+	}
+	next = thread->next_ptr;
+    }
+    __sync_synchronize();
+}
+
+static void plan_unlink_entry(hal_list_t * entry, hal_list_t * root)
+{
+    hal_funct_entry_t *next;
+
+    /* the functs after 'entry' in its stage were checked against the
+       stage, not against whatever comes before it */
+    if (list_next(entry) != root) {
+	next = (hal_funct_entry_t *) list_next(entry);
+	next->barrier = 1;
+	__sync_synchronize();
+    }
+}
+
 #ifdef RTAPI
 static void free_thread_struct(hal_thread_t * thread)
 {
@@ -3374,6 +4064,12 @@ static void free_thread_struct(hal_thread_t * thread)
     /* and stop the task associated with this thread */
     rtapi_task_pause(thread->task_id);
     rtapi_task_delete(thread->task_id);
+    /* and its helpers */
+    while (thread->workers > 0) {
+	thread->workers--;
+	rtapi_task_pause(thread->worker_task_id[thread->workers]);
+	rtapi_task_delete(thread->worker_task_id[thread->workers]);
+    }
     /* clear contents of struct */
     thread->uses_fp = 0;
     thread->period = 0;
@@ -3423,6 +4119,7 @@ static void free_thread_struct(hal_thread_t * thread)
     /* add thread to free list */
     thread->next_ptr = hal_data->thread_free_ptr;
     hal_data->thread_free_ptr = SHMOFF(thread);
+    hal_data->change_serial++;
 }
 #endif /* RTAPI */
 
@@ -3701,6 +4398,198 @@ int hal_stream_num_underruns(hal_stream_t *stream) {
     return stream->fifo->num_underruns;
 }
 
+#ifdef ULAPI
+struct hal_watch_entry {
+    char name[HAL_NAME_LEN + 1];
+    int data;			/* offset of the value, 0 if not found */
+};
+
+void hal_watch_free(hal_watch_t *watch)
+{
+    free(watch->value);
+    free(watch->type);
+    free(watch->entry);
+    watch->value = 0;
+    watch->type = 0;
+    watch->entry = 0;
+    watch->count = 0;
+}
+
+int hal_watch_new(hal_watch_t *watch, int count, const char **names)
+{
+    int n;
+
+    watch->count = 0;
+    watch->serial = 0;
+    watch->value = 0;
+    watch->type = 0;
+    watch->entry = 0;
+    if (hal_data == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: watch_new called before init\n");
+	return -EINVAL;
+    }
+    if (count < 0) {
+	return -EINVAL;
+    }
+    /* allocate at least one of each, so that an empty watch is valid */
+    watch->value = calloc(count ? count : 1, sizeof(double));
+    watch->type = calloc(count ? count : 1, sizeof(hal_type_t));
+    watch->entry = calloc(count ? count : 1, sizeof(struct hal_watch_entry));
+    if (watch->value == 0 || watch->type == 0 || watch->entry == 0) {
+	hal_watch_free(watch);
+	return -ENOMEM;
+    }
+    for (n = 0; n < count; n++) {
+	if (strlen(names[n]) > HAL_NAME_LEN) {
+	    rtapi_print_msg(RTAPI_MSG_ERR,
+		"HAL: ERROR: watch name '%s' is too long\n", names[n]);
+	    hal_watch_free(watch);
+	    return -EINVAL;
+	}
+	rtapi_snprintf(watch->entry[n].name, sizeof(watch->entry[n].name),
+	    "%s", names[n]);
+	watch->type[n] = HAL_TYPE_UNSPECIFIED;
+    }
+    watch->count = count;
+    /* force a lookup on the first read */
+    watch->serial = hal_data->change_serial - 1;
+    return 0;
+}
+
+const char *hal_watch_name(hal_watch_t *watch, int idx)
+{
+    return watch->entry[idx].name;
+}
+
+/* look up every name again, the mutex must be held */
+static void watch_lookup(hal_watch_t *watch)
+{
+    struct hal_watch_entry *e;
+    hal_pin_t *pin;
+    hal_param_t *param;
+    hal_sig_t *sig;
+    int n;
+
+    for (n = 0; n < watch->count; n++) {
+	e = &(watch->entry[n]);
+	e->data = 0;
+	watch->type[n] = HAL_TYPE_UNSPECIFIED;
+	if ((pin = halpr_find_pin_by_name(e->name)) != 0) {
+	    if (pin->signal != 0) {
+		sig = SHMPTR(pin->signal);
+		e->data = sig->data_ptr;
+	    } else {
+		e->data = SHMOFF(&(pin->dummysig));
+	    }
+	    watch->type[n] = pin->type;
+	} else if ((param = halpr_find_param_by_name(e->name)) != 0) {
+	    e->data = param->data_ptr;
+	    watch->type[n] = param->type;
+	} else if ((sig = halpr_find_sig_by_name(e->name)) != 0) {
+	    e->data = sig->data_ptr;
+	    watch->type[n] = sig->type;
+	}
+    }
+    watch->serial = hal_data->change_serial;
+}
+
+/* sum of the period counts of all threads, returns non-zero if any
+   thread is running its functs */
+static int watch_periods(unsigned *sum)
+{
+    hal_thread_t *thread;
+    int next, busy;
+    unsigned s;
+
+    busy = 0;
+    s = 0;
+    next = hal_data->thread_list_ptr;
+    while (next != 0) {
+	thread = SHMPTR(next);
+	busy |= thread->period_busy;
+	s += (unsigned) thread->period_count;
+	next = thread->next_ptr;
+    }
+    *sum = s;
+    return busy;
+}
+
+static void watch_copy(hal_watch_t *watch)
+{
+    hal_data_u *d;
+    int n;
+
+    for (n = 0; n < watch->count; n++) {
+	if (watch->entry[n].data == 0) {
+	    watch->value[n] = 0.0;
+	    continue;
+	}
+	d = SHMPTR(watch->entry[n].data);
+	switch (watch->type[n]) {
+	case HAL_BIT:
+	    watch->value[n] = d->b ? 1.0 : 0.0;
+	    break;
+	case HAL_S32:
+	    watch->value[n] = d->s;
+	    break;
+	case HAL_U32:
+	    watch->value[n] = d->u;
+	    break;
+	case HAL_FLOAT:
+	    watch->value[n] = d->f;
+	    break;
+	default:
+	    watch->value[n] = 0.0;
+	    break;
+	}
+    }
+}
+
+int hal_watch_read(hal_watch_t *watch)
+{
+    unsigned before, after;
+    int n, tries, retval;
+
+    if (hal_data == 0) {
+	return -EINVAL;
+    }
+    /* the mutex keeps the names and threads where they are, realtime
+       code never takes it */
+    for (tries = 1;; tries++) {
+	rtapi_mutex_get(&(hal_data->mutex));
+	if (watch->serial != hal_data->change_serial) {
+	    watch_lookup(watch);
+	}
+	if (!watch_periods(&before)) {
+	    __sync_synchronize();
+	    watch_copy(watch);
+	    __sync_synchronize();
+	    if (!watch_periods(&after) && before == after) {
+		retval = 0;
+		break;
+	    }
+	}
+	if (tries == HAL_WATCH_TRIES) {
+	    /* no quiet window, settle for a plain copy */
+	    watch_copy(watch);
+	    retval = 1;
+	    break;
+	}
+	/* other HAL users get the mutex while a thread is running */
+	rtapi_mutex_give(&(hal_data->mutex));
+	sched_yield();
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    for (n = 0; n < watch->count; n++) {
+	if (watch->type[n] == HAL_TYPE_UNSPECIFIED) {
+	    return -ENOENT;
+	}
+    }
+    return retval;
+}
+#endif /* ULAPI */
+
 #ifdef RTAPI
 /* only export symbols when we're building a kernel module */
 
@@ -3749,12 +4638,15 @@ EXPORT_SYMBOL(hal_set_constructor);
 EXPORT_SYMBOL(hal_export_funct);
 
 EXPORT_SYMBOL(hal_create_thread);
+EXPORT_SYMBOL(hal_create_thread_cpu);
+EXPORT_SYMBOL(hal_thread_set_workers);
 
 EXPORT_SYMBOL(hal_add_funct_to_thread);
 EXPORT_SYMBOL(hal_del_funct_from_thread);
 
 EXPORT_SYMBOL(hal_start_threads);
 EXPORT_SYMBOL(hal_stop_threads);
+EXPORT_SYMBOL(hal_compact_signals);
 
 EXPORT_SYMBOL(hal_shmem_base);
 EXPORT_SYMBOL(halpr_find_comp_by_name);
@@ -3770,6 +4662,7 @@ EXPORT_SYMBOL(halpr_find_param_by_owner);
 EXPORT_SYMBOL(halpr_find_funct_by_owner);
 
 EXPORT_SYMBOL(halpr_find_pin_by_sig);
+EXPORT_SYMBOL(halpr_thread_pin_next);
 
 EXPORT_SYMBOL(hal_pin_alias);
 EXPORT_SYMBOL(hal_param_alias);
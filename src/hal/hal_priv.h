@@ -193,6 +193,11 @@ typedef struct {
     int exact_base_period;      /* if set, pretend that rtapi satisfied our
 				   period request exactly */
     unsigned char lock;         /* hal locking, can be one of the HAL_LOCK_* types */
+    int plan_token;		/* last mark used by the funct planner */
+    volatile int change_serial;	/* bumped when an object comes or goes,
+				   is renamed, or its data moves */
+    int compact_ptr;		/* block of the last hal_compact_signals() */
+    int compact_size;		/* and its size */
 } hal_data_t;
 
 /** HAL 'component' data structure.
@@ -211,6 +216,8 @@ typedef struct {
     char name[HAL_NAME_LEN + 1];	/* component name */
     constructor make;
     int insmod_args;		/* args passed to insmod when loaded */
+    int plan_mark;		/* planner: has a funct in the stage */
+    int plan_pins;		/* planner: first of its linked pins */
 } hal_comp_t;
 
 /** HAL 'pin' data structure.
@@ -226,6 +233,7 @@ typedef struct {
     hal_type_t type;		/* data type */
     hal_pin_dir_t dir;		/* pin direction */
     char name[HAL_NAME_LEN + 1];	/* pin name */
+    int plan_next;		/* planner: next linked pin of its owner */
 } hal_pin_t;
 
 /** HAL 'signal' data structure.
@@ -238,6 +246,9 @@ typedef struct {
     int readers;		/* number of input pins linked */
     int writers;		/* number of output pins linked */
     int bidirs;			/* number of I/O pins linked */
+    int plan_read;		/* planner: read by the stage */
+    int plan_write;		/* planner: written by the stage */
+    int compact_off;		/* compaction: offset in the block + 1 */
     char name[HAL_NAME_LEN + 1];	/* signal name */
 } hal_sig_t;
 
@@ -289,9 +300,14 @@ typedef struct {
     void *arg;			/* argument for function */
     void (*funct) (void *, long);	/* ptr to function code */
     int funct_ptr;		/* pointer to function */
+    int barrier;		/* must wait for the functs before it */
+    int plan_barrier;		/* planner: the next value of barrier */
+    volatile int claim;		/* stage that last ran it */
 } hal_funct_entry_t;
 
 #define HAL_STACKSIZE 16384	/* realtime task stacksize */
+#define HAL_CACHELINE 64	/* signal data packing granularity */
+#define HAL_MAX_WORKERS 4	/* worker tasks per thread */
 
 typedef struct {
     int next_ptr;		/* next thread in linked list */
@@ -301,9 +317,20 @@ typedef struct {
     int task_id;		/* ID of the task that runs this thread */
     hal_s32_t* runtime;	/* (pin) duration of last run, in CPU cycles */
     hal_s32_t maxtime;	/* (param) duration of longest run, in CPU cycles */
+    hal_s32_t* wake_late;	/* (pin) lateness of the last period start, nsec */
+    hal_s32_t wake_late_max;	/* (param) worst lateness so far, nsec */
     hal_list_t funct_list;	/* list of functions to run */
     char name[HAL_NAME_LEN + 1];	/* thread name */
     int comp_id;
+    int workers;		/* number of worker tasks */
+    int worker_task_id[HAL_MAX_WORKERS];	/* their task IDs */
+    volatile int period_busy;	/* thread is running its functs */
+    volatile int period_count;	/* periods run so far */
+    volatile int stage_seq;	/* ID of the stage being run */
+    volatile int stage_first;	/* first entry of the stage */
+    volatile int stage_end;	/* entry after the stage */
+    volatile int stage_pending;	/* functs of the stage not yet done */
+    volatile int plan_dirty;	/* plan is out of date, run serially */
 } hal_thread_t;
 
 /* IMPORTANT:  If any of the structures in this file are changed, the
@@ -329,7 +356,7 @@ typedef struct {
 */
 
 #define HAL_KEY   0x48414C32	/* key used to open HAL shared memory */
-#define HAL_VER   0x0000000D	/* version code */
+#define HAL_VER   0x00000011	/* version code */
 #define HAL_SIZE  (75*4096)
 #define HAL_PSEUDO_COMP_PREFIX "__" /* prefix to identify a pseudo component */
 
@@ -427,6 +454,15 @@ extern hal_funct_t *halpr_find_funct_by_owner(hal_comp_t * owner,
 */
 extern hal_pin_t *halpr_find_pin_by_sig(hal_sig_t * sig, hal_pin_t * start);
 
+/** 'thread_pin_next()' steps through the pins of the components whose
+    functions are on 'thread', in the order the thread runs them.  Set
+    '*entry' to NULL to start; then pass back the returned pin as
+    'start'.  A component with several functions on the thread has its
+    pins returned once per function.  Returns NULL at the end.
+*/
+extern hal_pin_t *halpr_thread_pin_next(hal_thread_t * thread,
+    hal_list_t ** entry, hal_pin_t * start);
+
 #define HAL_STREAM_MAGIC_NUM		0x4649464F
 struct hal_stream_shm {
     unsigned int magic;
@@ -1347,6 +1347,213 @@ PyTypeObject stream_type = {
 };
 
 
+struct watchobj {
+    PyObject_HEAD
+    hal_watch_t watch;
+};
+
+static int pywatch_init(PyObject *_self, PyObject *args, PyObject *kw) {
+    watchobj *self = (watchobj *)_self;
+    PyObject *names;
+
+    if(!PyArg_ParseTuple(args, "O:hal.watch", &names)) return -1;
+    if(!SHMPTR(0)) {
+	PyErr_Format(PyExc_RuntimeError,
+		"Cannot call before creating component");
+	return -1;
+    }
+    /* the values may be exported through the buffer interface, so
+       they are never reallocated */
+    if(self->watch.value) {
+	PyErr_Format(PyExc_RuntimeError, "hal.watch is already initialized");
+	return -1;
+    }
+
+    PyObject *seq = PySequence_Fast(names, "hal.watch: names must be a sequence");
+    if(!seq) return -1;
+
+    int n = PySequence_Fast_GET_SIZE(seq);
+    const char *cnames[n ? n : 1];
+    for(int i=0; i<n; i++) {
+        cnames[i] = PyString_AsString(PySequence_Fast_GET_ITEM(seq, i));
+        if(!cnames[i]) { Py_DECREF(seq); return -1; }
+    }
+
+    int r = hal_watch_new(&self->watch, n, cnames);
+    Py_DECREF(seq);
+    if(r < 0) { errno = -r; PyErr_SetFromErrno(PyExc_IOError); return -1; }
+    return 0;
+}
+
+static PyObject *watch_value(watchobj *self, int i) {
+    double v = self->watch.value[i];
+    switch(self->watch.type[i]) {
+    case HAL_BIT: return to_python(v != 0);
+    case HAL_FLOAT: return to_python(v);
+    case HAL_S32: return to_python((int32_t)v);
+    case HAL_U32: return to_python((uint32_t)v);
+    default: Py_RETURN_NONE;
+    }
+}
+
+PyObject *watch_read(PyObject *_self, PyObject *unused) {
+    watchobj *self = (watchobj *)_self;
+    int r = hal_watch_read(&self->watch);
+    if(r < 0 && r != -ENOENT) {
+        errno = -r; PyErr_SetFromErrno(PyExc_IOError); return 0;
+    }
+    return to_python(r != 1);
+}
+
+PyObject *watch_values(PyObject *_self, void *unused) {
+    watchobj *self = (watchobj *)_self;
+    PyObject *r = PyTuple_New(self->watch.count);
+    if(!r) return 0;
+    for(int i=0; i<self->watch.count; i++) {
+        PyObject *o = watch_value(self, i);
+        if(!o) { Py_DECREF(r); return 0; }
+        PyTuple_SET_ITEM(r, i, o);
+    }
+    return r;
+}
+
+PyObject *watch_names(PyObject *_self, void *unused) {
+    watchobj *self = (watchobj *)_self;
+    PyObject *r = PyTuple_New(self->watch.count);
+    if(!r) return 0;
+    for(int i=0; i<self->watch.count; i++) {
+        PyObject *o = PyString_FromString(hal_watch_name(&self->watch, i));
+        if(!o) { Py_DECREF(r); return 0; }
+        PyTuple_SET_ITEM(r, i, o);
+    }
+    return r;
+}
+
+PyObject *watch_types(PyObject *_self, void *unused) {
+    watchobj *self = (watchobj *)_self;
+    PyObject *r = PyTuple_New(self->watch.count);
+    if(!r) return 0;
+    for(int i=0; i<self->watch.count; i++) {
+        PyObject *o = PyInt_FromLong(self->watch.type[i]);
+        if(!o) { Py_DECREF(r); return 0; }
+        PyTuple_SET_ITEM(r, i, o);
+    }
+    return r;
+}
+
+static Py_ssize_t watch_len(PyObject *_self) {
+    watchobj *self = (watchobj *)_self;
+    return self->watch.count;
+}
+
+static PyObject *watch_item(PyObject *_self, Py_ssize_t i) {
+    watchobj *self = (watchobj *)_self;
+    if(i < 0 || i >= self->watch.count) {
+        PyErr_SetString(PyExc_IndexError, "watch index out of range");
+        return NULL;
+    }
+    return watch_value(self, i);
+}
+
+// the values as an array of doubles, e.g. for numpy.frombuffer(w)
+static Py_ssize_t watch_buffer(PyObject *_self, Py_ssize_t segment, void **ptrptr){
+    watchobj *self = (watchobj *)_self;
+    if(ptrptr) *ptrptr = self->watch.value;
+    return self->watch.count * sizeof(double);
+}
+static Py_ssize_t watch_segcount(PyObject *_self, Py_ssize_t *lenp) {
+    watchobj *self = (watchobj *)_self;
+    if(lenp) *lenp = self->watch.count * sizeof(double);
+    return 1;
+}
+
+static
+PyBufferProcs watchbuffer_procs = {
+    watch_buffer,
+    NULL,
+    watch_segcount,
+    NULL
+};
+
+static PySequenceMethods watch_as_sequence = {
+    watch_len,                 /*sq_length*/
+    0,                         /*sq_concat*/
+    0,                         /*sq_repeat*/
+    watch_item,                /*sq_item*/
+};
+
+static PyMethodDef watch_methods[] = {
+    {"read", watch_read, METH_NOARGS,
+	"Refresh the values.  Returns True if they were all read while no\n"
+	"thread was running, False otherwise"},
+    {}
+};
+
+#pragma GCC diagnostic ignored "-Wwrite-strings"
+static PyGetSetDef watch_getset[] = {
+    {"values", watch_values, NULL, NULL, NULL},
+    {"names", watch_names, NULL, NULL, NULL},
+    {"types", watch_types, NULL, NULL, NULL},
+    {}
+};
+#pragma GCC diagnostic warning "-Wwrite-strings"
+
+static void pywatch_delete(PyObject *_self) {
+    watchobj *self = reinterpret_cast<watchobj*>(_self);
+    hal_watch_free(&self->watch);
+    self->ob_type->tp_free(self);
+}
+
+static PyObject *pywatch_repr(PyObject *_self) {
+    watchobj *self = reinterpret_cast<watchobj*>(_self);
+    return PyString_FromFormat("<watch of %d items>", self->watch.count);
+}
+
+static
+PyTypeObject watch_type = {
+    PyObject_HEAD_INIT(NULL)
+    0,                         /*ob_size*/
+    "hal.watch",               /*tp_name*/
+    sizeof(watchobj),          /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    pywatch_delete,            /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    pywatch_repr,              /*tp_repr*/
+    0,                         /*tp_as_number*/
+    &watch_as_sequence,        /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    &watchbuffer_procs,        /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,        /*tp_flags*/
+    "HAL Watch: the values of many pins, params and signals",  /*tp_doc*/
+    0,                         /*tp_traverse*/
+    0,                         /*tp_clear*/
+    0,                         /*tp_richcompare*/
+    0,                         /*tp_weaklistoffset*/
+    0,                         /*tp_iter*/
+    0,                         /*tp_iternext*/
+    watch_methods,             /*tp_methods*/
+    0,                         /*tp_members*/
+    watch_getset,              /*tp_getset*/
+    0,                         /*tp_base*/
+    0,                         /*tp_dict*/
+    0,                         /*tp_descr_get*/
+    0,                         /*tp_descr_set*/
+    0,                         /*tp_dictoffset*/
+    pywatch_init,              /*tp_init*/
+    0,                         /*tp_alloc*/
+    PyType_GenericNew,         /*tp_new*/
+    0,                         /*tp_free*/
+    0,                         /*tp_is_gc*/
+};
+
 PyMethodDef module_methods[] = {
     {"pin_has_writer", pin_has_writer, METH_VARARGS,
 	"Return a FALSE value if a pin has no writers and TRUE if it does"},
@@ -1405,10 +1612,12 @@ void init_hal(void) {
     PyType_Ready(&shm_type);
     PyType_Ready(&halpin_type);
     PyType_Ready(&stream_type);
+    PyType_Ready(&watch_type);
     PyModule_AddObject(m, "component", (PyObject*)&halobject_type);
     PyModule_AddObject(m, "shm", (PyObject*)&shm_type);
     PyModule_AddObject(m, "item", (PyObject*)&halpin_type);
     PyModule_AddObject(m, "stream", (PyObject*)&stream_type);
+    PyModule_AddObject(m, "watch", (PyObject*)&watch_type);
 
     PyModule_AddIntConstant(m, "MSG_NONE", RTAPI_MSG_NONE);
     PyModule_AddIntConstant(m, "MSG_ERR", RTAPI_MSG_ERR);
@@ -136,6 +136,8 @@ void halcmd_shutdown(void) {
 struct halcmd_command halcmd_commands[] = {
     {"addf",    FUNCT(do_addf_cmd),    A_TWO | A_PLUS },
     {"alias",   FUNCT(do_alias_cmd),   A_THREE },
+    {"apply",   FUNCT(do_apply_cmd),   A_PLUS | A_TILDE },
+    {"compact", FUNCT(do_compact_cmd), A_ZERO },
     {"delf",    FUNCT(do_delf_cmd),    A_TWO | A_OPTIONAL },
     {"delsig",  FUNCT(do_delsig_cmd),  A_ONE },
     {"echo",    FUNCT(do_echo_cmd),    A_ZERO },
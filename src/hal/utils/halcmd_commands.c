@@ -299,6 +299,79 @@ int do_stop_cmd(void) {
     return retval;
 }
 
+static int compare_int(const void *a, const void *b) {
+    int ia = *(const int *)a, ib = *(const int *)b;
+    return (ia > ib) - (ia < ib);
+}
+
+/* number of distinct cache lines of pin data touched by a thread's functs;
+   call with the HAL mutex held */
+static int thread_cache_lines(hal_thread_t *thread) {
+    hal_list_t *entry = 0;
+    hal_pin_t *pin = 0;
+    int n = 0, i, lines, *line;
+
+    while((pin = halpr_thread_pin_next(thread, &entry, pin)) != 0) n++;
+    if(n == 0) return 0;
+    line = malloc(n * sizeof(int));
+    if(!line) return -ENOMEM;
+    n = 0;
+    entry = 0;
+    while((pin = halpr_thread_pin_next(thread, &entry, pin)) != 0) {
+        if(pin->signal) {
+            hal_sig_t *sig = SHMPTR(pin->signal);
+            line[n++] = sig->data_ptr / HAL_CACHELINE;
+        } else {
+            line[n++] = SHMOFF(&pin->dummysig) / HAL_CACHELINE;
+        }
+    }
+    qsort(line, n, sizeof(int), compare_int);
+    lines = 1;
+    for(i = 1; i < n; i++)
+        if(line[i] != line[i-1]) lines++;
+    free(line);
+    return lines;
+}
+
+int do_compact_cmd(void) {
+    int next, n, i, retval;
+    int *before;
+    hal_thread_t *tptr;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    n = 0;
+    for(next = hal_data->thread_list_ptr; next != 0; next = tptr->next_ptr) {
+        tptr = SHMPTR(next);
+        n++;
+    }
+    before = malloc((n + 1) * sizeof(int));
+    if(!before) {
+        rtapi_mutex_give(&(hal_data->mutex));
+        halcmd_error("out of memory\n");
+        return -ENOMEM;
+    }
+    for(next = hal_data->thread_list_ptr, i = 0; next != 0 && i < n; i++) {
+        tptr = SHMPTR(next);
+        before[i] = thread_cache_lines(tptr);
+        next = tptr->next_ptr;
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+
+    retval = hal_compact_signals();
+    if(retval == 0) {
+        rtapi_mutex_get(&(hal_data->mutex));
+        for(next = hal_data->thread_list_ptr, i = 0; next != 0 && i < n; i++) {
+            tptr = SHMPTR(next);
+            halcmd_output("%-20s %5d -> %5d cache lines\n", tptr->name,
+                before[i], thread_cache_lines(tptr));
+            next = tptr->next_ptr;
+        }
+        rtapi_mutex_give(&(hal_data->mutex));
+    }
+    free(before);
+    return retval;
+}
+
 int do_echo_cmd(void) {
     printf("Echo on\n");
     return 0;
@@ -2686,6 +2759,1147 @@ static void save_threads(FILE *dst)
     rtapi_mutex_give(&(hal_data->mutex));
 }
 
+/* 'apply' reads HAL files as the description of the configuration that
+   should be running, compares it with the live HAL and makes only the
+   changes needed to get from one to the other, while the threads keep
+   running.  Nothing is changed until the whole new configuration has
+   been checked, and every change is logged with the step that reverses
+   it, so a failure part way through puts the old configuration back.
+*/
+
+#define APPLY_MAX_DEPTH 16	/* files sourcing files */
+
+enum {
+    APPLY_LOADRT, APPLY_UNLOADRT,
+    APPLY_ADDF, APPLY_DELF,
+    APPLY_LINK, APPLY_UNLINK,
+    APPLY_NEWSIG, APPLY_DELSIG,
+    APPLY_SETP, APPLY_SETP_PIN, APPLY_SETS
+};
+
+#define APPLY_RECREATE 1	/* live signal has the wrong type */
+#define APPLY_VALUE 2		/* newsig: give the signal 'data' */
+
+typedef struct {
+    char *name;		/* component, signal, pin, param or funct */
+    char *value;	/* module args, signal, thread or value */
+    int type;		/* signal/value type, or addf position */
+    int op;		/* APPLY_xxx for steps */
+    int flags;
+    int writers, bidirs;
+    int seq;		/* order of appearance */
+    char *file;
+    int line;
+    void *ptr;		/* live object, or module argv for loadrt */
+    hal_data_u data;	/* parsed value */
+} apply_item_t;
+
+typedef struct {
+    apply_item_t *item;
+    int count, size;
+} apply_list_t;
+
+typedef struct {
+    apply_list_t files;		/* names, kept for error messages */
+    apply_list_t comps;		/* loadrt <comp> <args> */
+    apply_list_t sigs;		/* newsig/sets, and every signal named */
+    apply_list_t links;		/* <pin> linked to <signal> */
+    apply_list_t values;	/* setp <name> <value> */
+    apply_list_t functs;	/* addf <funct> <thread> <position> */
+    apply_list_t steps;		/* the change set */
+    apply_list_t later;		/* addf steps, which go last */
+    apply_list_t undo;
+    char *file;
+    int seq;
+} apply_config_t;
+
+static apply_item_t *apply_add(apply_config_t *cfg, apply_list_t *list,
+    const char *name, const char *value)
+{
+    apply_item_t *item;
+
+    if (list->count == list->size) {
+	int size = list->size ? 2 * list->size : 64;
+	apply_item_t *p = realloc(list->item, size * sizeof(*p));
+	if (p == NULL) {
+	    halcmd_error("out of memory\n");
+	    return NULL;
+	}
+	list->item = p;
+	list->size = size;
+    }
+    item = &list->item[list->count++];
+    memset(item, 0, sizeof(*item));
+    item->name = strdup(name);
+    item->value = value ? strdup(value) : NULL;
+    item->type = -1;
+    item->seq = cfg->seq++;
+    item->file = cfg->file;
+    item->line = halcmd_get_linenumber();
+    return item;
+}
+
+static void apply_free_list(apply_list_t *list, int free_ptr)
+{
+    int i;
+
+    for (i = 0; i < list->count; i++) {
+	free(list->item[i].name);
+	free(list->item[i].value);
+	if (free_ptr) {
+	    free(list->item[i].ptr);
+	}
+    }
+    free(list->item);
+    list->item = NULL;
+    list->count = list->size = 0;
+}
+
+/* point error messages at the line an item came from */
+static void apply_locate(apply_item_t *item)
+{
+    if (item->file) {
+	halcmd_set_filename(item->file);
+	halcmd_set_linenumber(item->line);
+    }
+}
+
+static int apply_compare_name(const void *a, const void *b)
+{
+    const apply_item_t *ia = a, *ib = b;
+    int r = strcmp(ia->name, ib->name);
+    return r ? r : ia->seq - ib->seq;
+}
+
+static int apply_compare_key(const void *key, const void *b)
+{
+    return strcmp(key, ((const apply_item_t *) b)->name);
+}
+
+static int apply_compare_ptr(const void *a, const void *b)
+{
+    const apply_item_t *ia = a, *ib = b;
+    if (ia->ptr != ib->ptr) {
+	return (char *) ia->ptr < (char *) ib->ptr ? -1 : 1;
+    }
+    return ia->seq - ib->seq;
+}
+
+static int apply_compare_pin(const void *key, const void *b)
+{
+    const apply_item_t *ib = b;
+    if (key != ib->ptr) {
+	return (const char *) key < (char *) ib->ptr ? -1 : 1;
+    }
+    return 0;
+}
+
+static apply_item_t *apply_find(apply_list_t *list, const char *name)
+{
+    return bsearch(name, list->item, list->count, sizeof(apply_item_t),
+	apply_compare_key);
+}
+
+static apply_item_t *apply_find_pin(apply_list_t *list, hal_pin_t *pin)
+{
+    return bsearch(pin, list->item, list->count, sizeof(apply_item_t),
+	apply_compare_pin);
+}
+
+static apply_item_t *apply_find_comp(apply_config_t *cfg, const char *name)
+{
+    int i;
+
+    for (i = 0; i < cfg->comps.count; i++) {
+	if (strcmp(cfg->comps.item[i].name, name) == 0) {
+	    return &cfg->comps.item[i];
+	}
+    }
+    return NULL;
+}
+
+static int apply_sig_type(const char *type)
+{
+    if (strcasecmp(type, "bit") == 0) return HAL_BIT;
+    if (strcasecmp(type, "float") == 0) return HAL_FLOAT;
+    if (strcasecmp(type, "u32") == 0) return HAL_U32;
+    if (strcasecmp(type, "s32") == 0) return HAL_S32;
+    return -1;
+}
+
+static void apply_copy(int type, void *dst, void *src)
+{
+    switch (type) {
+    case HAL_BIT: *(hal_bit_t *) dst = *(hal_bit_t *) src; break;
+    case HAL_FLOAT: *(hal_float_t *) dst = *(hal_float_t *) src; break;
+    case HAL_S32: *(hal_s32_t *) dst = *(hal_s32_t *) src; break;
+    case HAL_U32: *(hal_u32_t *) dst = *(hal_u32_t *) src; break;
+    }
+}
+
+static int apply_equal(int type, void *a, void *b)
+{
+    switch (type) {
+    case HAL_BIT: return *(hal_bit_t *) a == *(hal_bit_t *) b;
+    case HAL_FLOAT: return *(hal_float_t *) a == *(hal_float_t *) b;
+    case HAL_S32: return *(hal_s32_t *) a == *(hal_s32_t *) b;
+    case HAL_U32: return *(hal_u32_t *) a == *(hal_u32_t *) b;
+    }
+    return 0;
+}
+
+static int apply_read_file(apply_config_t *cfg, char *filename, int depth);
+
+static int apply_parse_line(apply_config_t *cfg, char **tokens, int depth)
+{
+    char *argv[MAX_TOK+1];
+    char args[MAX_CMD_LEN+1], *cp;
+    int argc = 0, i, n;
+    apply_item_t *item;
+    static const char *ignored[] = {
+	"alias", "compact", "echo", "getp", "gets", "help", "list",
+	"loadusr", "lock", "ptype", "save", "show", "start", "status",
+	"stop", "stype", "unecho", "unlock", "waitusr", NULL
+    };
+
+    /* drop the arrows, as net and the link commands do */
+    for (i = 0; tokens[i] && tokens[i][0]; i++) {
+	if (strcmp(tokens[i], "<=") && strcmp(tokens[i], "=>")
+	    && strcmp(tokens[i], "<=>")) {
+	    argv[argc++] = tokens[i];
+	}
+    }
+    argv[argc] = NULL;
+    if (argc == 0) {
+	return 0;
+    }
+    if (argc == 3 && strcmp(argv[1], "=") == 0) {
+	return apply_add(cfg, &cfg->values, argv[0], argv[2]) ? 0 : -ENOMEM;
+    }
+    if (strcmp(argv[0], "loadrt") == 0 && argc >= 2) {
+	if (apply_find_comp(cfg, argv[1])) {
+	    halcmd_error("module '%s' is loaded more than once\n", argv[1]);
+	    return -EINVAL;
+	}
+	/* the args as do_loadrt_cmd() keeps them, and as an argv */
+	args[0] = '\0';
+	n = 0;
+	for (i = 2; i < argc; i++) {
+	    strncat(args, argv[i], MAX_CMD_LEN - strlen(args));
+	    strncat(args, " ", MAX_CMD_LEN - strlen(args));
+	    n += strlen(argv[i]) + 1;
+	}
+	item = apply_add(cfg, &cfg->comps, argv[1], args);
+	if (item == NULL || (item->ptr = malloc(n + 1)) == NULL) {
+	    return -ENOMEM;
+	}
+	cp = item->ptr;
+	for (i = 2; i < argc; i++) {
+	    strcpy(cp, argv[i]);
+	    cp += strlen(argv[i]) + 1;
+	}
+	*cp = '\0';
+    } else if (strcmp(argv[0], "newsig") == 0 && argc == 3) {
+	int type = apply_sig_type(argv[2]);
+	if (type < 0) {
+	    halcmd_error("Unknown signal type '%s'\n", argv[2]);
+	    return -EINVAL;
+	}
+	if ((item = apply_add(cfg, &cfg->sigs, argv[1], NULL)) == NULL) {
+	    return -ENOMEM;
+	}
+	item->type = type;
+    } else if (strcmp(argv[0], "net") == 0 && argc >= 2) {
+	if (apply_add(cfg, &cfg->sigs, argv[1], NULL) == NULL) {
+	    return -ENOMEM;
+	}
+	for (i = 2; i < argc; i++) {
+	    if (apply_add(cfg, &cfg->links, argv[i], argv[1]) == NULL) {
+		return -ENOMEM;
+	    }
+	}
+    } else if ((strcmp(argv[0], "linkps") == 0
+	    || strcmp(argv[0], "linksp") == 0
+	    || strcmp(argv[0], "linkpp") == 0) && argc == 3) {
+	char *pin = argv[1], *sig = argv[2];
+	if (argv[0][5] == 'p') {
+	    /* linkpp names the signal after the first pin */
+	    if (apply_add(cfg, &cfg->links, argv[2], argv[1]) == NULL) {
+		return -ENOMEM;
+	    }
+	    sig = argv[1];
+	} else if (argv[0][4] == 's') {
+	    pin = argv[2];
+	    sig = argv[1];
+	}
+	if (apply_add(cfg, &cfg->sigs, sig, NULL) == NULL
+	    || apply_add(cfg, &cfg->links, pin, sig) == NULL) {
+	    return -ENOMEM;
+	}
+    } else if (strcmp(argv[0], "setp") == 0 && argc == 3) {
+	if (apply_add(cfg, &cfg->values, argv[1], argv[2]) == NULL) {
+	    return -ENOMEM;
+	}
+    } else if (strcmp(argv[0], "sets") == 0 && argc == 3) {
+	if (apply_add(cfg, &cfg->sigs, argv[1], argv[2]) == NULL) {
+	    return -ENOMEM;
+	}
+    } else if (strcmp(argv[0], "addf") == 0 && (argc == 3 || argc == 4)) {
+	if ((item = apply_add(cfg, &cfg->functs, argv[1], argv[2])) == NULL) {
+	    return -ENOMEM;
+	}
+	item->type = argc == 4 ? atoi(argv[3]) : -1;
+	if (item->type == 0) {
+	    halcmd_error("bad position: 0\n");
+	    return -EINVAL;
+	}
+    } else if (strcmp(argv[0], "source") == 0 && argc == 2) {
+	return apply_read_file(cfg, argv[1], depth + 1);
+    } else {
+	for (i = 0; ignored[i]; i++) {
+	    if (strcmp(argv[0], ignored[i]) == 0) {
+		halcmd_info("apply: ignoring '%s'\n", argv[0]);
+		return 0;
+	    }
+	}
+	halcmd_error("'%s' with %d arguments cannot be used with apply\n",
+	    argv[0], argc - 1);
+	return -EINVAL;
+    }
+    return 0;
+}
+
+static int apply_read_file(apply_config_t *cfg, char *filename, int depth)
+{
+    char buf[MAX_CMD_LEN+1];
+    char *tokens[MAX_TOK+1];
+    char *file_save = cfg->file;
+    apply_item_t *item;
+    int linenumber = 1;
+    int result = 0;
+    FILE *f;
+
+    if (depth > APPLY_MAX_DEPTH) {
+	halcmd_error("files are sourced more than %d deep\n", APPLY_MAX_DEPTH);
+	return -EINVAL;
+    }
+    f = fopen(filename, "r");
+    if (!f) {
+	halcmd_error("Could not open hal file '%s': %s\n",
+	    filename, strerror(errno));
+	return -EINVAL;
+    }
+    if ((item = apply_add(cfg, &cfg->files, filename, NULL)) == NULL) {
+	fclose(f);
+	return -ENOMEM;
+    }
+    cfg->file = item->name;
+    halcmd_set_filename(cfg->file);
+
+    while (1) {
+	char *readresult = fgets(buf, MAX_CMD_LEN, f);
+	halcmd_set_linenumber(linenumber++);
+	if (readresult == 0) {
+	    if (feof(f)) break;
+	    halcmd_error("Error reading file: %s\n", strerror(errno));
+	    result = -EINVAL;
+	    break;
+	}
+	result = halcmd_preprocess_line(buf, tokens);
+	if (result == 0) {
+	    result = apply_parse_line(cfg, tokens, depth);
+	}
+	if (result != 0) break;
+    }
+    fclose(f);
+    cfg->file = file_save;
+    if (file_save) {
+	halcmd_set_filename(file_save);
+    }
+    return result;
+}
+
+/* sort the signals and values, and fold repeats together */
+static int apply_merge(apply_config_t *cfg)
+{
+    apply_item_t *prev, *item;
+    int i, n;
+
+    qsort(cfg->sigs.item, cfg->sigs.count, sizeof(apply_item_t),
+	apply_compare_name);
+    for (i = n = 0; i < cfg->sigs.count; i++) {
+	item = &cfg->sigs.item[i];
+	prev = n ? &cfg->sigs.item[n - 1] : NULL;
+	if (!prev || strcmp(prev->name, item->name)) {
+	    cfg->sigs.item[n++] = *item;
+	    continue;
+	}
+	if (item->type >= 0) {
+	    if (prev->type >= 0 && prev->type != item->type) {
+		apply_locate(item);
+		halcmd_error("signal '%s' is declared as %s and as %s\n",
+		    item->name, data_type2(prev->type), data_type2(item->type));
+		return -EINVAL;
+	    }
+	    prev->type = item->type;
+	}
+	if (item->value) {
+	    free(prev->value);
+	    prev->value = item->value;
+	    prev->file = item->file;
+	    prev->line = item->line;
+	    item->value = NULL;
+	}
+	free(item->name);
+	free(item->value);
+    }
+    cfg->sigs.count = n;
+
+    /* the last setp of a name wins */
+    qsort(cfg->values.item, cfg->values.count, sizeof(apply_item_t),
+	apply_compare_name);
+    for (i = n = 0; i < cfg->values.count; i++) {
+	item = &cfg->values.item[i];
+	if (n && strcmp(cfg->values.item[n - 1].name, item->name) == 0) {
+	    prev = &cfg->values.item[n - 1];
+	    free(prev->name);
+	    free(prev->value);
+	    *prev = *item;
+	} else {
+	    cfg->values.item[n++] = *item;
+	}
+    }
+    cfg->values.count = n;
+    return 0;
+}
+
+/* add a step to the change set */
+static apply_item_t *apply_step(apply_config_t *cfg, apply_list_t *list,
+    int op, const char *name, const char *value, int type)
+{
+    apply_item_t *item = apply_add(cfg, list, name, value);
+
+    if (item) {
+	item->op = op;
+	item->type = type;
+	item->file = NULL;
+    }
+    return item;
+}
+
+static void apply_print(apply_item_t *step, int dry_run)
+{
+    char buf[MAX_CMD_LEN+1];
+
+    switch (step->op) {
+    case APPLY_LOADRT:
+	snprintf(buf, sizeof(buf), "loadrt %s %s", step->name, step->value);
+	break;
+    case APPLY_UNLOADRT:
+	snprintf(buf, sizeof(buf), "unloadrt %s", step->name);
+	break;
+    case APPLY_ADDF:
+	snprintf(buf, sizeof(buf), "addf %s %s %d",
+	    step->name, step->value, step->type);
+	break;
+    case APPLY_DELF:
+	snprintf(buf, sizeof(buf), "delf %s %s", step->name, step->value);
+	break;
+    case APPLY_LINK:
+	snprintf(buf, sizeof(buf), "linkps %s %s", step->name, step->value);
+	break;
+    case APPLY_UNLINK:
+	snprintf(buf, sizeof(buf), "unlinkp %s", step->name);
+	break;
+    case APPLY_NEWSIG:
+	if (step->flags & APPLY_VALUE) {
+	    snprintf(buf, sizeof(buf), "newsig %s %s; sets %s %s",
+		step->name, data_type2(step->type), step->name,
+		data_value2(step->type, &step->data));
+	} else {
+	    snprintf(buf, sizeof(buf), "newsig %s %s",
+		step->name, data_type2(step->type));
+	}
+	break;
+    case APPLY_DELSIG:
+	snprintf(buf, sizeof(buf), "delsig %s", step->name);
+	break;
+    case APPLY_SETP:
+    case APPLY_SETP_PIN:
+    case APPLY_SETS:
+	snprintf(buf, sizeof(buf), "%s %s %s",
+	    step->op == APPLY_SETS ? "sets" : "setp", step->name,
+	    data_value2(step->type, &step->data));
+	break;
+    default:
+	snprintf(buf, sizeof(buf), "# unknown step %d", step->op);
+    }
+    if (dry_run) {
+	halcmd_output("%s\n", buf);
+    } else {
+	halcmd_info("apply: %s\n", buf);
+    }
+}
+
+/* the storage behind a param, an unlinked pin or a signal; call with
+   the mutex held */
+static void *apply_value_ptr(int op, const char *name)
+{
+    hal_param_t *param;
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+
+    switch (op) {
+    case APPLY_SETP:
+	param = halpr_find_param_by_name(name);
+	return param ? SHMPTR(param->data_ptr) : NULL;
+    case APPLY_SETP_PIN:
+	pin = halpr_find_pin_by_name(name);
+	return (pin && pin->signal == 0) ? (void *) &pin->dummysig : NULL;
+    case APPLY_SETS:
+	sig = halpr_find_sig_by_name(name);
+	return sig ? SHMPTR(sig->data_ptr) : NULL;
+    }
+    return NULL;
+}
+
+/* carry out one step; if 'undo' is given, the step that reverses it is
+   added there first */
+static int apply_run(apply_config_t *cfg, apply_item_t *step,
+    apply_list_t *undo)
+{
+    apply_item_t *u = NULL;
+    char *argv[MAX_TOK+1], *cp;
+    void *ptr;
+    int retval = 0, n;
+
+    switch (step->op) {
+    case APPLY_LOADRT:
+	if (undo && !(u = apply_step(cfg, undo, APPLY_UNLOADRT, step->name,
+		    NULL, 0))) {
+	    return -ENOMEM;
+	}
+	for (n = 0, cp = step->ptr; *cp && n < MAX_TOK; cp += strlen(cp) + 1) {
+	    argv[n++] = cp;
+	}
+	argv[n] = NULL;
+	retval = do_loadrt_cmd(step->name, argv);
+	break;
+    case APPLY_UNLOADRT:
+	retval = unloadrt_comp(step->name);
+	break;
+    case APPLY_ADDF:
+	if (undo && !(u = apply_step(cfg, undo, APPLY_DELF, step->name,
+		    step->value, 0))) {
+	    return -ENOMEM;
+	}
+	retval = hal_add_funct_to_thread(step->name, step->value, step->type);
+	break;
+    case APPLY_DELF:
+	if (undo && !(u = apply_step(cfg, undo, APPLY_ADDF, step->name,
+		    step->value, step->type))) {
+	    return -ENOMEM;
+	}
+	retval = hal_del_funct_from_thread(step->name, step->value);
+	break;
+    case APPLY_LINK:
+	if (undo) {
+	    /* unlinking alone would leave the pin at the signal's value */
+	    hal_type_t type;
+	    hal_pin_t *pin;
+	    rtapi_mutex_get(&(hal_data->mutex));
+	    pin = halpr_find_pin_by_name(step->name);
+	    type = pin ? pin->type : HAL_BIT;
+	    ptr = apply_value_ptr(APPLY_SETP_PIN, step->name);
+	    if (ptr && (u = apply_step(cfg, undo, APPLY_SETP_PIN, step->name,
+		    NULL, type))) {
+		apply_copy(type, &u->data, ptr);
+	    }
+	    rtapi_mutex_give(&(hal_data->mutex));
+	    u = apply_step(cfg, undo, APPLY_UNLINK, step->name, NULL, 0);
+	    if (u == NULL) {
+		return -ENOMEM;
+	    }
+	}
+	retval = hal_link(step->name, step->value);
+	break;
+    case APPLY_UNLINK:
+	if (undo && !(u = apply_step(cfg, undo, APPLY_LINK, step->name,
+		    step->value, 0))) {
+	    return -ENOMEM;
+	}
+	retval = hal_unlink(step->name);
+	break;
+    case APPLY_NEWSIG:
+	if (undo && !(u = apply_step(cfg, undo, APPLY_DELSIG, step->name,
+		    NULL, 0))) {
+	    return -ENOMEM;
+	}
+	retval = hal_signal_new(step->name, step->type);
+	if (retval == 0 && (step->flags & APPLY_VALUE)) {
+	    rtapi_mutex_get(&(hal_data->mutex));
+	    ptr = apply_value_ptr(APPLY_SETS, step->name);
+	    if (ptr) {
+		apply_copy(step->type, ptr, &step->data);
+	    }
+	    rtapi_mutex_give(&(hal_data->mutex));
+	}
+	break;
+    case APPLY_DELSIG:
+	if (undo && !(u = apply_step(cfg, undo, APPLY_NEWSIG, step->name,
+		    NULL, step->type))) {
+	    return -ENOMEM;
+	}
+	if (u) {
+	    /* a signal nothing writes keeps the value of its last sets */
+	    rtapi_mutex_get(&(hal_data->mutex));
+	    ptr = apply_value_ptr(APPLY_SETS, step->name);
+	    if (ptr) {
+		apply_copy(step->type, &u->data, ptr);
+		u->flags |= APPLY_VALUE;
+	    }
+	    rtapi_mutex_give(&(hal_data->mutex));
+	}
+	retval = hal_signal_delete(step->name);
+	break;
+    case APPLY_SETP:
+    case APPLY_SETP_PIN:
+    case APPLY_SETS:
+	rtapi_mutex_get(&(hal_data->mutex));
+	ptr = apply_value_ptr(step->op, step->name);
+	if (ptr == NULL) {
+	    retval = -EINVAL;
+	} else if (undo && !(u = apply_step(cfg, undo, step->op, step->name,
+		    NULL, step->type))) {
+	    retval = -ENOMEM;
+	} else {
+	    if (u) {
+		apply_copy(step->type, &u->data, ptr);
+	    }
+	    apply_copy(step->type, ptr, &step->data);
+	}
+	rtapi_mutex_give(&(hal_data->mutex));
+	break;
+    default:
+	retval = -EINVAL;
+    }
+    if (undo && u && retval != 0) {
+	/* nothing happened, so there is nothing to reverse */
+	free(u->name);
+	free(u->value);
+	undo->count--;
+    }
+    return retval;
+}
+
+static void apply_rollback(apply_config_t *cfg)
+{
+    int i, failed = 0;
+
+    if (cfg->undo.count == 0) {
+	return;
+    }
+    halcmd_warning("apply failed, undoing %d changes\n", cfg->undo.count);
+    for (i = cfg->undo.count; i--;) {
+	apply_print(&cfg->undo.item[i], 0);
+	if (apply_run(cfg, &cfg->undo.item[i], NULL) != 0) {
+	    failed++;
+	}
+    }
+    if (failed) {
+	halcmd_error("%d changes could not be undone, "
+	    "the HAL configuration is inconsistent\n", failed);
+    }
+}
+
+/* realtime components: new ones are loaded, but changing the args of a
+   running one or removing it needs a restart */
+static int apply_plan_comps(apply_config_t *cfg)
+{
+    hal_comp_t *comp;
+    apply_item_t *item, *step;
+    int i, next, retval = 0;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    for (i = 0; i < cfg->comps.count; i++) {
+	item = &cfg->comps.item[i];
+	comp = halpr_find_comp_by_name(item->name);
+	if (comp == 0) {
+	    step = apply_step(cfg, &cfg->steps, APPLY_LOADRT, item->name,
+		item->value, 0);
+	    if (step == NULL) {
+		retval = -ENOMEM;
+		break;
+	    }
+	    step->ptr = item->ptr;
+	} else if (comp->type != 1) {
+	    apply_locate(item);
+	    halcmd_error("'%s' is a user space component\n", item->name);
+	    retval = -EINVAL;
+	} else if (comp->insmod_args != 0
+	    && strcmp(SHMPTR(comp->insmod_args), item->value) != 0) {
+	    apply_locate(item);
+	    halcmd_error("module '%s' was loaded with '%s', changing its "
+		"arguments needs a restart\n", item->name,
+		(char *) SHMPTR(comp->insmod_args));
+	    retval = -EINVAL;
+	}
+    }
+    for (next = hal_data->comp_list_ptr; next; next = comp->next_ptr) {
+	comp = SHMPTR(next);
+	if (comp->type == 1 && comp->insmod_args != 0
+	    && !apply_find_comp(cfg, comp->name)) {
+	    halcmd_warning("module '%s' is not in the new configuration, "
+		"it stays loaded until a restart\n", comp->name);
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+    return retval;
+}
+
+/* the functs of one thread: the ones that keep their relative order
+   stay put, the others are removed and added where they belong */
+static int apply_plan_thread(apply_config_t *cfg, hal_thread_t *thread)
+{
+    hal_list_t *root = &(thread->funct_list), *entry;
+    hal_funct_t *funct;
+    apply_item_t *item;
+    char **live = NULL, **want = NULL, *keep_live = NULL, *keep_want = NULL;
+    int *lcs = NULL;
+    int nlive = 0, nwant = 0, n, i, j, idx, deleted, retval = -ENOMEM;
+
+    for (entry = list_next(root); entry != root; entry = list_next(entry)) {
+	nlive++;
+    }
+    for (i = 0; i < cfg->functs.count; i++) {
+	if (strcmp(cfg->functs.item[i].value, thread->name) == 0) {
+	    nwant++;
+	}
+    }
+    if (nlive + nwant == 0) {
+	return 0;
+    }
+    live = malloc((nlive + 1) * sizeof(char *));
+    want = malloc((nwant + 1) * sizeof(char *));
+    keep_live = calloc(nlive + 1, 1);
+    keep_want = calloc(nwant + 1, 1);
+    lcs = calloc((nlive + 1) * (nwant + 1), sizeof(int));
+    if (!live || !want || !keep_live || !keep_want || !lcs) {
+	halcmd_error("out of memory\n");
+	goto out;
+    }
+    n = 0;
+    for (entry = list_next(root); entry != root; entry = list_next(entry)) {
+	funct = SHMPTR(((hal_funct_entry_t *) entry)->funct_ptr);
+	live[n++] = funct->name;
+    }
+    /* insert the addf's in order, as hal_add_funct_to_thread() would */
+    n = 0;
+    for (i = 0; i < cfg->functs.count; i++) {
+	item = &cfg->functs.item[i];
+	if (strcmp(item->value, thread->name) != 0) {
+	    continue;
+	}
+	idx = item->type > 0 ? item->type - 1 : n + item->type + 1;
+	if (idx < 0 || idx > n) {
+	    apply_locate(item);
+	    halcmd_error("position '%d' is out of range\n", item->type);
+	    retval = -EINVAL;
+	    goto out;
+	}
+	memmove(want + idx + 1, want + idx, (n - idx) * sizeof(char *));
+	want[idx] = item->name;
+	n++;
+    }
+    /* longest common subsequence of the live and the wanted order */
+#define LCS(i, j) lcs[(i) * (nwant + 1) + (j)]
+    for (i = nlive; i--;) {
+	for (j = nwant; j--;) {
+	    if (strcmp(live[i], want[j]) == 0) {
+		LCS(i, j) = LCS(i + 1, j + 1) + 1;
+	    } else if (LCS(i + 1, j) >= LCS(i, j + 1)) {
+		LCS(i, j) = LCS(i + 1, j);
+	    } else {
+		LCS(i, j) = LCS(i, j + 1);
+	    }
+	}
+    }
+    for (i = j = 0; i < nlive && j < nwant;) {
+	if (strcmp(live[i], want[j]) == 0) {
+	    keep_live[i++] = 1;
+	    keep_want[j++] = 1;
+	} else if (LCS(i + 1, j) >= LCS(i, j + 1)) {
+	    i++;
+	} else {
+	    j++;
+	}
+    }
+#undef LCS
+    /* a delf records the position the funct had, for the undo */
+    for (i = deleted = 0; i < nlive; i++) {
+	if (!keep_live[i]) {
+	    if (!apply_step(cfg, &cfg->steps, APPLY_DELF, live[i],
+		    thread->name, i - deleted + 1)) {
+		goto out;
+	    }
+	    deleted++;
+	}
+    }
+    /* once want[0..j-1] are in place, want[j] goes right after them */
+    for (j = 0; j < nwant; j++) {
+	if (!keep_want[j]) {
+	    if (!apply_step(cfg, &cfg->later, APPLY_ADDF, want[j],
+		    thread->name, j + 1)) {
+		goto out;
+	    }
+	}
+    }
+    retval = 0;
+out:
+    free(live);
+    free(want);
+    free(keep_live);
+    free(keep_want);
+    free(lcs);
+    return retval;
+}
+
+/* work out the change set; call with the mutex held */
+static int apply_plan(apply_config_t *cfg)
+{
+    apply_item_t *item, *s, *l;
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+    hal_param_t *param;
+    hal_thread_t *thread;
+    hal_funct_t *funct;
+    void *ptr;
+    int i, n, next, retval, pass;
+
+    /* resolve the pins, a pin can only be on one signal */
+    for (i = 0; i < cfg->links.count; i++) {
+	item = &cfg->links.item[i];
+	item->ptr = halpr_find_pin_by_name(item->name);
+	if (item->ptr == 0) {
+	    apply_locate(item);
+	    halcmd_error("pin '%s' not found\n", item->name);
+	    return -EINVAL;
+	}
+    }
+    qsort(cfg->links.item, cfg->links.count, sizeof(apply_item_t),
+	apply_compare_ptr);
+    for (i = n = 0; i < cfg->links.count; i++) {
+	item = &cfg->links.item[i];
+	if (n && cfg->links.item[n - 1].ptr == item->ptr) {
+	    if (strcmp(cfg->links.item[n - 1].value, item->value) != 0) {
+		apply_locate(item);
+		halcmd_error("pin '%s' is linked to '%s' and to '%s'\n",
+		    item->name, cfg->links.item[n - 1].value, item->value);
+		return -EINVAL;
+	    }
+	    free(item->name);
+	    free(item->value);
+	} else {
+	    cfg->links.item[n++] = *item;
+	}
+    }
+    cfg->links.count = n;
+
+    /* the signals: types, writers, values */
+    for (i = 0; i < cfg->links.count; i++) {
+	item = &cfg->links.item[i];
+	pin = item->ptr;
+	s = apply_find(&cfg->sigs, item->value);
+	if (s->type < 0) {
+	    s->type = pin->type;
+	} else if (s->type != pin->type) {
+	    apply_locate(item);
+	    halcmd_error("pin '%s' is %s, signal '%s' is %s\n", item->name,
+		data_type2(pin->type), s->name, data_type2(s->type));
+	    return -EINVAL;
+	}
+	if (pin->dir == HAL_OUT) {
+	    s->writers++;
+	} else if (pin->dir == HAL_IO) {
+	    s->bidirs++;
+	}
+    }
+    for (i = 0; i < cfg->sigs.count; i++) {
+	s = &cfg->sigs.item[i];
+	apply_locate(s);
+	sig = halpr_find_sig_by_name(s->name);
+	s->ptr = sig;
+	if (s->type < 0) {
+	    if (sig == 0) {
+		halcmd_error("signal '%s' has no pins, its type is not known\n",
+		    s->name);
+		return -EINVAL;
+	    }
+	    s->type = sig->type;
+	}
+	if (s->writers > 1 || (s->writers && s->bidirs)) {
+	    halcmd_error("signal '%s' has more than one output or I/O pin\n",
+		s->name);
+	    return -EINVAL;
+	}
+	if (s->value) {
+	    if (s->writers) {
+		halcmd_error("signal '%s' has a writer and cannot be set\n",
+		    s->name);
+		return -EINVAL;
+	    }
+	    if ((retval = set_common(s->type, &s->data, s->value)) != 0) {
+		return retval;
+	    }
+	}
+	if (sig && sig->type != s->type) {
+	    s->flags |= APPLY_RECREATE;
+	}
+    }
+
+    /* the functs */
+    for (i = 0; i < cfg->functs.count; i++) {
+	item = &cfg->functs.item[i];
+	funct = halpr_find_funct_by_name(item->name);
+	if (funct == 0 || halpr_find_thread_by_name(item->value) == 0) {
+	    apply_locate(item);
+	    halcmd_error("%s '%s' not found\n", funct ? "thread" : "function",
+		funct ? item->value : item->name);
+	    return -EINVAL;
+	}
+	if (!funct->reentrant) {
+	    for (n = i + 1; n < cfg->functs.count; n++) {
+		if (strcmp(cfg->functs.item[n].name, item->name) == 0) {
+		    apply_locate(&cfg->functs.item[n]);
+		    halcmd_error("function '%s' may only be added to one "
+			"thread\n", item->name);
+		    return -EINVAL;
+		}
+	    }
+	}
+    }
+    for (next = hal_data->thread_list_ptr; next; next = thread->next_ptr) {
+	thread = SHMPTR(next);
+	if ((retval = apply_plan_thread(cfg, thread)) != 0) {
+	    return retval;
+	}
+    }
+
+    /* pins leave signals they are not on in the new configuration */
+    for (next = hal_data->pin_list_ptr; next; next = pin->next_ptr) {
+	pin = SHMPTR(next);
+	if (pin->signal == 0) {
+	    continue;
+	}
+	sig = SHMPTR(pin->signal);
+	l = apply_find_pin(&cfg->links, pin);
+	s = l ? apply_find(&cfg->sigs, l->value) : NULL;
+	if (!s || strcmp(s->name, sig->name) || (s->flags & APPLY_RECREATE)) {
+	    if (!apply_step(cfg, &cfg->steps, APPLY_UNLINK, pin->name,
+		    sig->name, 0)) {
+		return -ENOMEM;
+	    }
+	}
+    }
+    for (next = hal_data->sig_list_ptr; next; next = sig->next_ptr) {
+	sig = SHMPTR(next);
+	s = apply_find(&cfg->sigs, sig->name);
+	if (!s || (s->flags & APPLY_RECREATE)) {
+	    if (!apply_step(cfg, &cfg->steps, APPLY_DELSIG, sig->name, NULL,
+		    sig->type)) {
+		return -ENOMEM;
+	    }
+	}
+    }
+    for (i = 0; i < cfg->sigs.count; i++) {
+	s = &cfg->sigs.item[i];
+	if (!s->ptr || (s->flags & APPLY_RECREATE)) {
+	    if (!apply_step(cfg, &cfg->steps, APPLY_NEWSIG, s->name, NULL,
+		    s->type)) {
+		return -ENOMEM;
+	    }
+	}
+    }
+
+    /* writers go first, so the first link of a new signal gives it the
+       writer's value rather than some reader's */
+    for (pass = 0; pass < 2; pass++) {
+	for (i = 0; i < cfg->links.count; i++) {
+	    l = &cfg->links.item[i];
+	    pin = l->ptr;
+	    if ((pin->dir == HAL_IN) != pass) {
+		continue;
+	    }
+	    s = apply_find(&cfg->sigs, l->value);
+	    sig = pin->signal ? SHMPTR(pin->signal) : NULL;
+	    if (!sig || strcmp(sig->name, s->name)
+		|| (s->flags & APPLY_RECREATE)) {
+		if (!apply_step(cfg, &cfg->steps, APPLY_LINK, pin->name,
+			s->name, 0)) {
+		    return -ENOMEM;
+		}
+	    }
+	}
+    }
+
+    /* signal values, after the readers are on */
+    for (i = 0; i < cfg->sigs.count; i++) {
+	s = &cfg->sigs.item[i];
+	sig = s->ptr;
+	if (!s->value || (sig && !(s->flags & APPLY_RECREATE)
+		&& apply_equal(s->type, SHMPTR(sig->data_ptr), &s->data))) {
+	    continue;
+	}
+	if (!(item = apply_step(cfg, &cfg->steps, APPLY_SETS, s->name, NULL,
+		    s->type))) {
+	    return -ENOMEM;
+	}
+	apply_copy(s->type, &item->data, &s->data);
+    }
+
+    /* params and unlinked pins, before any new funct runs */
+    for (i = 0; i < cfg->values.count; i++) {
+	item = &cfg->values.item[i];
+	apply_locate(item);
+	param = halpr_find_param_by_name(item->name);
+	pin = param ? 0 : halpr_find_pin_by_name(item->name);
+	if (param) {
+	    if (param->dir == HAL_RO) {
+		halcmd_error("param '%s' is not writable\n", item->name);
+		return -EINVAL;
+	    }
+	    item->type = param->type;
+	    ptr = SHMPTR(param->data_ptr);
+	} else if (pin) {
+	    if (pin->dir == HAL_OUT) {
+		halcmd_error("pin '%s' is not writable\n", item->name);
+		return -EINVAL;
+	    }
+	    if ((l = apply_find_pin(&cfg->links, pin))) {
+		halcmd_error("pin '%s' is connected to signal '%s'\n",
+		    item->name, l->value);
+		return -EINVAL;
+	    }
+	    item->type = pin->type;
+	    ptr = pin->signal ? NULL : (void *) &pin->dummysig;
+	} else {
+	    halcmd_error("parameter or pin '%s' not found\n", item->name);
+	    return -EINVAL;
+	}
+	if ((retval = set_common(item->type, &item->data, item->value)) != 0) {
+	    return retval;
+	}
+	if (ptr && apply_equal(item->type, ptr, &item->data)) {
+	    continue;
+	}
+	s = apply_step(cfg, &cfg->steps, param ? APPLY_SETP : APPLY_SETP_PIN,
+	    item->name, NULL, item->type);
+	if (!s) {
+	    return -ENOMEM;
+	}
+	apply_copy(item->type, &s->data, &item->data);
+    }
+
+    /* and the new functs start running last */
+    for (i = 0; i < cfg->later.count; i++) {
+	item = &cfg->later.item[i];
+	if (!apply_step(cfg, &cfg->steps, item->op, item->name, item->value,
+		item->type)) {
+	    return -ENOMEM;
+	}
+    }
+    return 0;
+}
+
+int do_apply_cmd(char **args)
+{
+    apply_config_t cfg;
+    int lineno_save = halcmd_get_linenumber();
+    char *filename_save = halcmd_get_filename() ?
+	strdup(halcmd_get_filename()) : NULL;
+    int dry_run = 0, loaded = 0, retval = 0, i;
+
+    memset(&cfg, 0, sizeof(cfg));
+    if (args[0] && strcmp(args[0], "-n") == 0) {
+	dry_run = 1;
+	args++;
+    }
+    if (!args[0] || !args[0][0]) {
+	halcmd_error("apply needs the HAL files of the new configuration\n");
+	free(filename_save);
+	return -EINVAL;
+    }
+    if (!dry_run && (hal_get_lock() & (HAL_LOCK_LOAD | HAL_LOCK_CONFIG))) {
+	halcmd_error("HAL is locked, apply is not permitted\n");
+	free(filename_save);
+	return -EPERM;
+    }
+
+    for (i = 0; args[i] && args[i][0]; i++) {
+	if ((retval = apply_read_file(&cfg, args[i], 0)) != 0) {
+	    goto out;
+	}
+    }
+    if ((retval = apply_merge(&cfg)) != 0
+	|| (retval = apply_plan_comps(&cfg)) != 0) {
+	goto out;
+    }
+
+    /* new components first, their pins are part of the plan */
+    for (i = 0; i < cfg.steps.count; i++) {
+	apply_print(&cfg.steps.item[i], dry_run);
+	if (!dry_run
+	    && (retval = apply_run(&cfg, &cfg.steps.item[i], &cfg.undo)) != 0) {
+	    goto out;
+	}
+    }
+    loaded = cfg.steps.count;
+    if (dry_run && loaded) {
+	halcmd_output("# the other changes depend on the modules above\n");
+	goto out;
+    }
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    retval = apply_plan(&cfg);
+    rtapi_mutex_give(&(hal_data->mutex));
+    if (retval != 0) {
+	goto out;
+    }
+    halcmd_set_filename(filename_save ? filename_save : "apply");
+    halcmd_set_linenumber(lineno_save);
+    for (i = loaded; i < cfg.steps.count; i++) {
+	apply_print(&cfg.steps.item[i], dry_run);
+	if (!dry_run
+	    && (retval = apply_run(&cfg, &cfg.steps.item[i], &cfg.undo)) != 0) {
+	    halcmd_error("apply step failed\n");
+	    goto out;
+	}
+    }
+    if (!dry_run) {
+	halcmd_info("apply: %d changes\n", cfg.steps.count);
+    }
+
+out:
+    if (filename_save) {
+	halcmd_set_filename(filename_save);
+    }
+    halcmd_set_linenumber(lineno_save);
+    if (retval != 0) {
+	apply_rollback(&cfg);
+    }
+    free(filename_save);
+    apply_free_list(&cfg.comps, 1);
+    apply_free_list(&cfg.sigs, 0);
+    apply_free_list(&cfg.links, 0);
+    apply_free_list(&cfg.values, 0);
+    apply_free_list(&cfg.functs, 0);
+    apply_free_list(&cfg.steps, 0);
+    apply_free_list(&cfg.later, 0);
+    apply_free_list(&cfg.undo, 0);
+    apply_free_list(&cfg.files, 0);
+    return retval;
+}
+
 int do_setexact_cmd() {
     int retval = 0;
     rtapi_mutex_get(&(hal_data->mutex));
@@ -2860,12 +4074,29 @@ int do_help_cmd(char *command)
 	printf("  or 'thread'.  ('linka' and 'neta' show arrows for pin\n");
 	printf("  direction.)  If 'type' is omitted or 'all', does the\n");
 	printf("  equivalent of 'comp', 'netl', 'param', and 'thread'.\n");
+    } else if (strcmp(command, "apply") == 0) {
+	printf("apply [-n] filename [filename...]\n");
+	printf("  Reads the HAL files of a complete configuration and changes\n");
+	printf("  the running HAL to match, without stopping the threads: new\n");
+	printf("  modules are loaded, and nets, values and thread functions\n");
+	printf("  that differ are changed.  Nothing changes if a file has an\n");
+	printf("  error, and a change that fails undoes the ones before it.\n");
+	printf("  Pins not linked in the files are unlinked, so give all the\n");
+	printf("  files of the configuration.  '-n' prints the changes\n");
+	printf("  instead of making them.\n");
     } else if (strcmp(command, "start") == 0) {
 	printf("start\n");
 	printf("  Starts all realtime threads.\n");
     } else if (strcmp(command, "stop") == 0) {
 	printf("stop\n");
 	printf("  Stops all realtime threads.\n");
+    } else if (strcmp(command, "compact") == 0) {
+	printf("compact\n");
+	printf("  Moves the values of the signals used by each thread into\n");
+	printf("  contiguous, cache line aligned blocks, in the order the\n");
+	printf("  thread's functions use them, and reports the number of\n");
+	printf("  cache lines of pin data each thread touches before and\n");
+	printf("  after.  Threads must be stopped.\n");
     } else if (strcmp(command, "quit") == 0) {
 	printf("quit\n");
 	printf("  Stop processing input and terminate halcmd (when\n");
@@ -2925,7 +4156,9 @@ static void print_help_commands(void)
     printf("  source              Execute commands from another .hal file\n");
     printf("  status              Display status information\n");
     printf("  save                Print config as commands\n");
+    printf("  apply               Change the running config to match files\n");
     printf("  start, stop         Start/stop realtime threads\n");
+    printf("  compact             Pack signal values in thread order\n");
     printf("  alias, unalias      Add or remove pin or parameter name aliases\n");
     printf("  echo, unecho        Echo commands from stdin to stderr\n");
     printf("  quit, exit          Exit from halcmd\n");
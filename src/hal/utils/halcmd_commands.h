@@ -55,6 +55,7 @@ extern int do_linkps_cmd(char *pin, char *signal);
 extern int do_linksp_cmd(char *signal, char *pin);
 extern int do_start_cmd();
 extern int do_stop_cmd();
+extern int do_compact_cmd();
 extern int do_help_cmd(char *command);
 extern int do_lock_cmd(char *command);
 extern int do_unlock_cmd(char *command);
@@ -83,6 +84,7 @@ extern int do_unloadusr_cmd(char *mod_name);
 extern int do_loadusr_cmd(char *args[]);
 extern int do_waitusr_cmd(char *comp_name);
 extern int do_save_cmd(char *type, char *filename);
+extern int do_apply_cmd(char *args[]);
 extern int do_setexact_cmd(void);
 
 pid_t hal_systemv_nowait(char *const argv[]);
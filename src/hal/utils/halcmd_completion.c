@@ -51,7 +51,8 @@ static const char *command_table[] = {
     "linkps", "linksp", "linkpp", "unlinkp",
     "net", "newsig", "delsig", "getp", "gets", "setp", "sets", "ptype", "stype",
     "addf", "delf", "show", "list", "status", "save", "source",
-    "start", "stop", "quit", "exit", "help", "alias", "unalias", 
+    "apply",
+    "start", "stop", "compact", "quit", "exit", "help", "alias", "unalias", 
     NULL,
 };
 
@@ -720,6 +721,10 @@ char **halcmd_completer(const char *text, int start, int end, hal_completer_func
         rtapi_mutex_give(&(hal_data->mutex));
         // leaves rl_attempted_completion_over = 0 to complete from filesystem
         return 0;
+    } else if(startswith(buffer, "apply ")) {
+        rtapi_mutex_give(&(hal_data->mutex));
+        // leaves rl_attempted_completion_over = 0 to complete from filesystem
+        return 0;
     } else if(startswith(buffer, "loadusr ") && argno < 3) {
         rtapi_mutex_give(&(hal_data->mutex));
         // leaves rl_attempted_completion_over = 0 to complete from filesystem
@@ -292,6 +292,16 @@ static int comp_id;
 
 
     has_data = options.get("data")
+    batch = options.get("batch")
+
+    # how instance item 'name' is spelled inside export() and inside the
+    # user's functions
+    def ref(name):
+        if batch: return "__comp_soa.%s[__comp_i]" % name
+        return "inst->%s" % name
+    def cref(name):
+        if batch: return "__comp_soa.%s[__comp_i]" % name
+        return "__comp_inst->%s" % name
 
     has_array = False
     has_personality = False
@@ -312,52 +322,94 @@ static int comp_id;
             print >>f, "%s(%s, %s);" % (decl, name, q(doc))
             
     print >>f
-    print >>f, "struct __comp_state {"
-    print >>f, "    struct __comp_state *_next;"
-    if has_personality:
-        print >>f, "    int _personality;"
+    # With option batch the instance state is kept as structure-of-arrays:
+    # one array per item, indexed by instance number, so that the function
+    # which loops over all instances touches each item contiguously.
+    if batch:
+        print >>f, "struct __comp_state {"
+        print >>f, "    int _count, _max;"
+        if has_personality:
+            print >>f, "    int *_personality;"
+    else:
+        print >>f, "struct __comp_state {"
+        print >>f, "    struct __comp_state *_next;"
+        if has_personality:
+            print >>f, "    int _personality;"
 
     for name, type, array, dir, value, personality in pins:
         if array:
             if isinstance(array, tuple): array = array[0]
-            print >>f, "    hal_%s_t *%s[%s];" % (type, to_c(name), array)
+            if batch:
+                print >>f, "    hal_%s_t *(*%s)[%s];" % (type, to_c(name), array)
+            else:
+                print >>f, "    hal_%s_t *%s[%s];" % (type, to_c(name), array)
         else:
-            print >>f, "    hal_%s_t *%s;" % (type, to_c(name))
+            if batch:
+                print >>f, "    hal_%s_t **%s;" % (type, to_c(name))
+            else:
+                print >>f, "    hal_%s_t *%s;" % (type, to_c(name))
         names[name] = 1
 
     for name, type, array, dir, value, personality in params:
         if array:
             if isinstance(array, tuple): array = array[0]
-            print >>f, "    hal_%s_t %s[%s];" % (type, to_c(name), array)
+            if batch:
+                print >>f, "    hal_%s_t (*%s)[%s];" % (type, to_c(name), array)
+            else:
+                print >>f, "    hal_%s_t %s[%s];" % (type, to_c(name), array)
         else:
-            print >>f, "    hal_%s_t %s;" % (type, to_c(name))
+            if batch:
+                print >>f, "    hal_%s_t *%s;" % (type, to_c(name))
+            else:
+                print >>f, "    hal_%s_t %s;" % (type, to_c(name))
         names[name] = 1
 
     for type, name, array, value in variables:
-        if array:
+        if batch:
+            if array:
+                print >>f, "    %s (*%s)[%d];\n" % (type, name, array)
+            else:
+                print >>f, "    %s (*%s);\n" % (type, name)
+        elif array:
             print >>f, "    %s %s[%d];\n" % (type, name, array)
         else:
             print >>f, "    %s %s;\n" % (type, name)
     if has_data:
-        print >>f, "    void *_data;"
+        if batch:
+            print >>f, "    char *_data;"
+        else:
+            print >>f, "    void *_data;"
 
     print >>f, "};"
 
     if options.get("userspace"):
         print >>f, "#include <stdlib.h>"
 
-    print >>f, "struct __comp_state *__comp_first_inst=0, *__comp_last_inst=0;"
+    if batch:
+        print >>f, "static struct __comp_state __comp_soa;"
+    else:
+        print >>f, "struct __comp_state *__comp_first_inst=0, *__comp_last_inst=0;"
     
+
     print >>f
     for name, fp in functions:
         if names.has_key(name):
             Error("Duplicate item name: %s" % name)
-        print >>f, "static void %s(struct __comp_state *__comp_inst, long period);" % to_c(name)
+        if batch:
+            print >>f, "static inline void %s(int __comp_i, long period);" % to_c(name)
+            print >>f, "static void __comp_inst_%s(void *arg, long period);" % to_c(name)
+            print >>f, "static void __comp_all_%s(void *arg, long period);" % to_c(name)
+        else:
+            print >>f, "static void %s(struct __comp_state *__comp_inst, long period);" % to_c(name)
         names[name] = 1
 
-    print >>f, "static int __comp_get_data_size(void);"
+    if has_data or not batch:
+        print >>f, "static int __comp_get_data_size(void);"
     if options.get("extra_setup"):
-        print >>f, "static int extra_setup(struct __comp_state *__comp_inst, char *prefix, long extra_arg);"
+        if batch:
+            print >>f, "static int extra_setup(int __comp_i, char *prefix, long extra_arg);"
+        else:
+            print >>f, "static int extra_setup(struct __comp_state *__comp_inst, char *prefix, long extra_arg);"
     if options.get("extra_cleanup"):
         print >>f, "static void extra_cleanup(void);"
 
@@ -381,39 +433,46 @@ static int comp_id;
     print >>f, "    int r = 0;"
     if has_array:
         print >>f, "    int j = 0;"
-    print >>f, "    int sz = sizeof(struct __comp_state) + __comp_get_data_size();"
-    print >>f, "    struct __comp_state *inst = hal_malloc(sz);"
-    print >>f, "    memset(inst, 0, sz);"
-    if has_data:
-        print >>f, "    inst->_data = (char*)inst + sizeof(struct __comp_state);"
+    if batch:
+        print >>f, "    int __comp_i = __comp_soa._count;"
+        print >>f, "    if(__comp_i >= __comp_soa._max) return -ENOMEM;"
+    else:
+        print >>f, "    int sz = sizeof(struct __comp_state) + __comp_get_data_size();"
+        print >>f, "    struct __comp_state *inst = hal_malloc(sz);"
+        print >>f, "    memset(inst, 0, sz);"
+        if has_data:
+            print >>f, "    inst->_data = (char*)inst + sizeof(struct __comp_state);"
     if has_personality:
-        print >>f, "    inst->_personality = personality;"
+        print >>f, "    %s = personality;" % ref("_personality")
     if options.get("extra_setup"):
-        print >>f, "    r = extra_setup(inst, prefix, extra_arg);"
+        if batch:
+            print >>f, "    r = extra_setup(__comp_i, prefix, extra_arg);"
+        else:
+            print >>f, "    r = extra_setup(inst, prefix, extra_arg);"
 	print >>f, "    if(r != 0) return r;"
         # the extra_setup() function may have changed the personality
         if has_personality:
-            print >>f, "    personality = inst->_personality;"
+            print >>f, "    personality = %s;" % ref("_personality")
     for name, type, array, dir, value, personality in pins:
         if personality:
             print >>f, "if(%s) {" % personality
         if array:
             if isinstance(array, tuple): array = array[1]
             print >>f, "    for(j=0; j < (%s); j++) {" % array
-            print >>f, "        r = hal_pin_%s_newf(%s, &(inst->%s[j]), comp_id," % (
-                type, dirmap[dir], to_c(name))
+            print >>f, "        r = hal_pin_%s_newf(%s, &(%s[j]), comp_id," % (
+                type, dirmap[dir], ref(to_c(name)))
             print >>f, "            \"%%s%s\", prefix, j);" % to_hal("." + name)
             print >>f, "        if(r != 0) return r;"
             if value is not None:
-                print >>f, "    *(inst->%s[j]) = %s;" % (to_c(name), value)
+                print >>f, "    *(%s[j]) = %s;" % (ref(to_c(name)), value)
             print >>f, "    }"
         else:
-            print >>f, "    r = hal_pin_%s_newf(%s, &(inst->%s), comp_id," % (
-                type, dirmap[dir], to_c(name))
+            print >>f, "    r = hal_pin_%s_newf(%s, &(%s), comp_id," % (
+                type, dirmap[dir], ref(to_c(name)))
             print >>f, "        \"%%s%s\", prefix);" % to_hal("." + name)
             print >>f, "    if(r != 0) return r;"
             if value is not None:
-                print >>f, "    *(inst->%s) = %s;" % (to_c(name), value)
+                print >>f, "    *(%s) = %s;" % (ref(to_c(name)), value)
         if personality:
             print >>f, "}"
 
@@ -423,44 +482,89 @@ static int comp_id;
         if array:
             if isinstance(array, tuple): array = array[1]
             print >>f, "    for(j=0; j < %s; j++) {" % array
-            print >>f, "        r = hal_param_%s_newf(%s, &(inst->%s[j]), comp_id," % (
-                type, dirmap[dir], to_c(name))
+            print >>f, "        r = hal_param_%s_newf(%s, &(%s[j]), comp_id," % (
+                type, dirmap[dir], ref(to_c(name)))
             print >>f, "            \"%%s%s\", prefix, j);" % to_hal("." + name)
             print >>f, "        if(r != 0) return r;"
             if value is not None:
-                print >>f, "    inst->%s[j] = %s;" % (to_c(name), value)
+                print >>f, "    %s[j] = %s;" % (ref(to_c(name)), value)
             print >>f, "    }"
         else:
-            print >>f, "    r = hal_param_%s_newf(%s, &(inst->%s), comp_id," % (
-                type, dirmap[dir], to_c(name))
+            print >>f, "    r = hal_param_%s_newf(%s, &(%s), comp_id," % (
+                type, dirmap[dir], ref(to_c(name)))
             print >>f, "        \"%%s%s\", prefix);" % to_hal("." + name)
             if value is not None:
-                print >>f, "    inst->%s = %s;" % (to_c(name), value)
+                print >>f, "    %s = %s;" % (ref(to_c(name)), value)
             print >>f, "    if(r != 0) return r;"
         if personality:
             print >>f, "}"
 
     for type, name, array, value in variables:
         if value is None: continue
+        if batch: name = name.replace("*", "")
         if array:
             print >>f, "    for(j=0; j < %s; j++) {" % array
-            print >>f, "        inst->%s[j] = %s;" % (name, value)
+            print >>f, "        %s[j] = %s;" % (ref(name), value)
             print >>f, "    }"
         else:
-            print >>f, "    inst->%s = %s;" % (name, value)
+            print >>f, "    %s = %s;" % (ref(name), value)
 
     for name, fp in functions:
         print >>f, "    rtapi_snprintf(buf, sizeof(buf), \"%%s%s\", prefix);"\
             % to_hal("." + name)
-        print >>f, "    r = hal_export_funct(buf, (void(*)(void *inst, long))%s, inst, %s, 0, comp_id);" % (
-            to_c(name), int(fp))
+        if batch:
+            print >>f, "    r = hal_export_funct(buf, __comp_inst_%s, (void*)(long)__comp_i, %s, 0, comp_id);" % (
+                to_c(name), int(fp))
+        else:
+            print >>f, "    r = hal_export_funct(buf, (void(*)(void *inst, long))%s, inst, %s, 0, comp_id);" % (
+                to_c(name), int(fp))
         print >>f, "    if(r != 0) return r;"
-    print >>f, "    if(__comp_last_inst) __comp_last_inst->_next = inst;"
-    print >>f, "    __comp_last_inst = inst;"
-    print >>f, "    if(!__comp_first_inst) __comp_first_inst = inst;"
+    if batch:
+        print >>f, "    __comp_soa._count++;"
+    else:
+        print >>f, "    if(__comp_last_inst) __comp_last_inst->_next = inst;"
+        print >>f, "    __comp_last_inst = inst;"
+        print >>f, "    if(!__comp_first_inst) __comp_first_inst = inst;"
     print >>f, "    return 0;"
     print >>f, "}"
 
+    if batch:
+        items = [to_c(name) for name, type, array, dir, value, personality in pins]
+        items += [to_c(name) for name, type, array, dir, value, personality in params]
+        items += [name.replace("*", "") for type, name, array, value in variables]
+        if has_personality: items.append("_personality")
+        print >>f
+        print >>f, "static void *__comp_zalloc(long sz) {"
+        print >>f, "    void *p = hal_malloc(sz);"
+        print >>f, "    if(p) memset(p, 0, sz);"
+        print >>f, "    return p;"
+        print >>f, "}"
+        print >>f
+        print >>f, "static int __comp_alloc(int n) {"
+        print >>f, "    __comp_soa._max = n;"
+        print >>f, "    if(n == 0) return 0;"
+        for name in items:
+            print >>f, "    __comp_soa.%s = __comp_zalloc(n * sizeof(*__comp_soa.%s));" % (name, name)
+            print >>f, "    if(!__comp_soa.%s) return -ENOMEM;" % name
+        if has_data:
+            print >>f, "    __comp_soa._data = __comp_zalloc(n * __comp_get_data_size());"
+            print >>f, "    if(!__comp_soa._data) return -ENOMEM;"
+        print >>f, "    return 0;"
+        print >>f, "}"
+        print >>f
+        print >>f, "static int __comp_export_batch(void) {"
+        if len(functions) > 0:
+            print >>f, "    char buf[HAL_NAME_LEN + 1];"
+        print >>f, "    int r = 0;"
+        for name, fp in functions:
+            print >>f, "    rtapi_snprintf(buf, sizeof(buf), \"%s\");" % \
+                to_hal(removeprefix(comp_name, "hal_") + ".all." + name)
+            print >>f, "    r = hal_export_funct(buf, __comp_all_%s, 0, %s, 0, comp_id);" % (
+                to_c(name), int(fp))
+            print >>f, "    if(r != 0) return r;"
+        print >>f, "    return r;"
+        print >>f, "}"
+
     if options.get("count_function"):
         print >>f, "static int get_count(void);"
 
@@ -493,6 +597,19 @@ static int comp_id;
         print >>f, "    comp_id = hal_init(\"%s\");" % comp_name
         print >>f, "    if(comp_id < 0) return comp_id;"
 
+        def batch_alloc(indent, n):
+            print >>f, "%sr = __comp_alloc(%s);" % (indent, n)
+            print >>f, "%sif(r != 0) {" % indent
+            print >>f, "%s    hal_exit(comp_id);" % indent
+            print >>f, "%s    return r;" % indent
+            print >>f, "%s}" % indent
+
+        if batch:
+            if options.get("singleton"):
+                batch_alloc("    ", "1")
+            elif options.get("count_function"):
+                batch_alloc("    ", "count")
+
         if options.get("singleton"):
             if has_personality:
                 print >>f, "    r = export(\"%s\", 0, personality[0]);" % \
@@ -518,6 +635,8 @@ static int comp_id;
             print >>f, "        return -EINVAL;"
             print >>f, "    }"
             print >>f, "    if(!count && !names[0]) count = default_count;"
+            if batch:
+                batch_alloc("    ", "count ? count : (int)(sizeof(names)/sizeof(names[0]))")
             print >>f, "    if(count) {"
             print >>f, "        for(i=0; i<count; i++) {"
             print >>f, "            char buf[HAL_NAME_LEN + 1];"
@@ -548,6 +667,8 @@ static int comp_id;
 
         if options.get("constructable") and not options.get("singleton"):
             print >>f, "    hal_set_constructor(comp_id, export_1);"
+        if batch:
+            print >>f, "    if(r == 0) r = __comp_export_batch();"
         print >>f, "    if(r) {"
 	if options.get("extra_cleanup"):
             print >>f, "    extra_cleanup();"
@@ -637,9 +758,15 @@ int __comp_parse_names(int *argc, char **argv) {
     print >>f
     if not options.get("no_convenience_defines"):
         print >>f, "#undef FUNCTION"
-        print >>f, "#define FUNCTION(name) static void name(struct __comp_state *__comp_inst, long period)"
+        if batch:
+            print >>f, "#define FUNCTION(name) static inline void name(int __comp_i, long period)"
+        else:
+            print >>f, "#define FUNCTION(name) static void name(struct __comp_state *__comp_inst, long period)"
         print >>f, "#undef EXTRA_SETUP"
-        print >>f, "#define EXTRA_SETUP() static int extra_setup(struct __comp_state *__comp_inst, char *prefix, long extra_arg)"
+        if batch:
+            print >>f, "#define EXTRA_SETUP() static int extra_setup(int __comp_i, char *prefix, long extra_arg)"
+        else:
+            print >>f, "#define EXTRA_SETUP() static int extra_setup(struct __comp_state *__comp_inst, char *prefix, long extra_arg)"
         print >>f, "#undef EXTRA_CLEANUP"
         print >>f, "#define EXTRA_CLEANUP() static void extra_cleanup(void)"
         print >>f, "#undef fperiod"
@@ -648,32 +775,36 @@ int __comp_parse_names(int *argc, char **argv) {
             print >>f, "#undef %s" % to_c(name)
             if array:
                 if dir == 'in':
-                    print >>f, "#define %s(i) (0+*(__comp_inst->%s[i]))" % (to_c(name), to_c(name))
+                    print >>f, "#define %s(i) (0+*(%s[i]))" % (to_c(name), cref(to_c(name)))
                 else:
-                    print >>f, "#define %s(i) (*(__comp_inst->%s[i]))" % (to_c(name), to_c(name))
+                    print >>f, "#define %s(i) (*(%s[i]))" % (to_c(name), cref(to_c(name)))
             else:
                 if dir == 'in':
-                    print >>f, "#define %s (0+*__comp_inst->%s)" % (to_c(name), to_c(name))
+                    print >>f, "#define %s (0+*%s)" % (to_c(name), cref(to_c(name)))
                 else:
-                    print >>f, "#define %s (*__comp_inst->%s)" % (to_c(name), to_c(name))
+                    print >>f, "#define %s (*%s)" % (to_c(name), cref(to_c(name)))
         for name, type, array, dir, value, personality in params:
             print >>f, "#undef %s" % to_c(name)
             if array:
-                print >>f, "#define %s(i) (__comp_inst->%s[i])" % (to_c(name), to_c(name))
+                print >>f, "#define %s(i) (%s[i])" % (to_c(name), cref(to_c(name)))
             else:
-                print >>f, "#define %s (__comp_inst->%s)" % (to_c(name), to_c(name))
+                print >>f, "#define %s (%s)" % (to_c(name), cref(to_c(name)))
 
         for type, name, array, value in variables:
             name = name.replace("*", "")
             print >>f, "#undef %s" % name
-            print >>f, "#define %s (__comp_inst->%s)" % (name, name)
+            print >>f, "#define %s (%s)" % (name, cref(name))
 
         if has_data:
             print >>f, "#undef data"
-            print >>f, "#define data (*(%s*)(__comp_inst->_data))" % options['data']
+            if batch:
+                print >>f, "#define data (*(%s*)(__comp_soa._data + __comp_i * sizeof(%s)))" % (
+                    options['data'], options['data'])
+            else:
+                print >>f, "#define data (*(%s*)(__comp_inst->_data))" % options['data']
         if has_personality:
             print >>f, "#undef personality"
-            print >>f, "#define personality (__comp_inst->_personality)"
+            print >>f, "#define personality (%s)" % cref("_personality")
 
         if options.get("userspace"):
             print >>f, "#undef FOR_ALL_INSTS"
@@ -684,9 +815,20 @@ int __comp_parse_names(int *argc, char **argv) {
 def epilogue(f):
     data = options.get('data')
     print >>f
+    if options.get("batch"):
+        for name, fp in functions:
+            print >>f, "static void __comp_inst_%s(void *arg, long period) {" % to_c(name)
+            print >>f, "    %s((long)arg, period);" % to_c(name)
+            print >>f, "}"
+            print >>f, "static void __comp_all_%s(void *arg, long period) {" % to_c(name)
+            print >>f, "    int __comp_i, __comp_n = __comp_soa._count;"
+            print >>f, "    for(__comp_i = 0; __comp_i < __comp_n; __comp_i++)"
+            print >>f, "        %s(__comp_i, period);" % to_c(name)
+            print >>f, "}"
+        print >>f
     if data:
         print >>f, "static int __comp_get_data_size(void) { return sizeof(%s); }" % data
-    else:
+    elif not options.get("batch"):
         print >>f, "static int __comp_get_data_size(void) { return 0; }"
 
 INSTALL, COMPILE, PREPROCESS, DOCUMENT, INSTALLDOC, VIEWDOC, MODINC = range(7)
@@ -872,6 +1014,16 @@ def document(filename, outfilename):
             else:
                 print >>f
             print >>f, doc
+        if options.get("batch"):
+            for _, name, fp, doc in finddocs('funct'):
+                print >>f, ".TP"
+                print >>f, "\\fB%s\\fR" % to_hal_man_unnumbered("all." + name),
+                if fp:
+                    print >>f, "(requires a floating-point thread)"
+                else:
+                    print >>f
+                print >>f, "Runs \\fB%s\\fR for every instance in turn." % to_hal_man(name),
+                print >>f, "Add it to a thread instead of the per-instance functions."
 
     lead = ".TP"
     print >>f, ".SH PINS"
@@ -965,6 +1117,11 @@ def process(filename, mode, outfilename):
         if options.get("userspace"):
             if functions:
                 raise SystemExit, "Userspace components may not have functions"
+        if options.get("batch"):
+            if options.get("userspace"):
+                raise SystemExit, "Userspace components may not use option batch"
+            if options.get("constructable") or not options.get("rtapi_app", 1):
+                raise SystemExit, "Option batch requires that all instances are created by the automatic rtapi_app_main"
         if not pins:
             raise SystemExit, "Component must have at least one pin"
         prologue(f)
@@ -31,6 +31,10 @@
             to max sessions. Default is no limit (-1).
   With -- -ini <inifile>, uses inifile instead of emc.ini. 
 
+  One process serves all connections. A client may send several commands
+  without waiting for the replies; they are handled in order and the replies
+  come back in the same order.
+
   There are six commands supported, Where the commands set and get contain HAL
   specific sub-commands based on the commands supported by halcmd. Commands and 
   most parameters are not case sensitive. The exceptions are passwords, 
@@ -108,6 +112,21 @@
   set the communications mode to the specified mode. The binary protocol 
   is TBD.
   
+  watch [<name 1> .. <name n>]
+  With set, adds the named pins, parameters or signals to the watch list
+  of the connection, or empties the list if no names are given. With get,
+  returns the values of everything on the list, all read at the same
+  time, as lines of the form WATCH <index> <value> .. <value>, where
+  <index> is the position in the list of the first value on the line.
+  Names that do not exist read as ?. This state is local to each
+  connection.
+
+  push on | off
+  With set on, the values on the watch list that changed are sent to the
+  connection every 100 ms, without a get, in the form WATCH <index> <value>.
+  With get, returns the current push state. This state is local to each
+  connection.
+
   comm_prot <version no>
   With get, returns the current protocol version used by the server,
   with set, sets the server to use the specified protocol version,
@@ -294,7 +313,6 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <sys/uio.h>
-#include <pthread.h>
 #include <fnmatch.h>
 #include <getopt.h>
 
@@ -302,6 +320,7 @@
 #include <rtapi_mutex.h>
 #include "hal.h"		/* HAL public API decls */
 #include "../hal_priv.h"	/* private HAL decls */
+#include "rmtserver.h"		/* client event loop */
 /* non-EMC related uses of halrmt may want to avoid libnml dependency */
 #ifndef NO_INI
 #include "inifile.h"		/* iniFind() from libnml */
@@ -368,16 +387,23 @@ typedef struct {
   int commProt;
   char inBuf[256];
   char outBuf[4096];
-  char progName[256];} connectionRecType;
+  char progName[256];
+  int watchCount;
+  char (*watchNames)[HAL_NAME_LEN + 1];
+  hal_watch_t watch;
+  int push;
+  double *watchSent;
+  hal_type_t *watchSentType;} connectionRecType;
+
+#define WATCH_PERIOD 100	/* ms between watch pushes */
 
 
 int port = 5006;
 char errorStr[256];
 
-int server_sockfd, client_sockfd;
-socklen_t server_len, client_len;
+int server_sockfd;
+socklen_t server_len;
 struct sockaddr_in server_address;
-struct sockaddr_in client_address;
 int useSockets = 1;
 int tokenIdx;
 const char *delims = " \n\r\0";
@@ -388,7 +414,7 @@ typedef enum {
   cmdHello, cmdSet, cmdGet, cmdQuit, cmdShutdown, cmdHelp, cmdUnknown} commandTokenType;
   
 typedef enum {
-  hcEcho, hcVerbose, hcEnable, hcConfig, hcCommMode, hcCommProt,
+  hcEcho, hcVerbose, hcEnable, hcConfig, hcCommMode, hcWatch, hcPush, hcCommProt,
   hcComps, hcPins, hcPinVals, hcSigs, hcSigVals, hcParams, hcParamVals, hcFuncts, hcThreads,
   hcComp, hcPin, hcPinVal, hcSig, hcSigVal, hcParam, hcParamVal, hcFunct, hcThread,
   hcLoadRt, hcUnload, hcLoadUsr, hcLinkps, hcLinksp, hcLinkpp, hcNet, hcUnlinkp,
@@ -411,7 +437,7 @@ struct option longopts[] = {
 
 const char *commands[] = {"HELLO", "SET", "GET", "QUIT", "SHUTDOWN", "HELP", ""};
 const char *halCommands[] = {
-  "ECHO", "VERBOSE", "ENABLE", "CONFIG", "COMM_MODE", "COMM_PROT",
+  "ECHO", "VERBOSE", "ENABLE", "CONFIG", "COMM_MODE", "WATCH", "PUSH", "COMM_PROT",
   "COMPS", "PINS", "PINVALS", "SIGNALS", "SIGVALS", "PARAMS", "PARAMVALS", "FUNCTS", "THREADS",
   "COMP", "PIN", "PINVAL", "SIGNAL", "SIGVAL", "PARAM", "PARAMVAL", "FUNCT", "THREAD",
   "LOADRT", "UNLOAD", "LOADUSR", "LINKPS", "LINKSP", "LINKPP", "NET", "UNLINKP",
@@ -469,7 +495,7 @@ static int initSockets()
 static int sockWrite(connectionRecType *context)
 {
    strcat(context->outBuf, "\r\n");
-   return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+   return rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
 }
 
 static void sockWriteError(const char *nakStr, connectionRecType *context)
@@ -507,6 +533,8 @@ pid_t hal_systemv_nowait(char *const argv[], connectionRecType *context) {
     }
     if ( pid == 0 ) {
 	/* child process */
+	/* the replies queued so far are the parent's to send */
+	rmtTruncate(context->cliSock, 0);
 	/* print debugging info if "very verbose" (-V) */
         for(n=0; argv[n] != NULL; n++) {
 	    rtapi_print_msg(RTAPI_MSG_DBG, "%s ", argv[n] );
@@ -514,6 +542,7 @@ pid_t hal_systemv_nowait(char *const argv[], connectionRecType *context) {
         if (n == 0) {
             snprintf(errorStr, sizeof(errorStr), "hal_systemv_nowait: empty argv array passed in\n");
             sockWriteError(nakStr, context);
+            rmtFlush(context->cliSock);
             exit(1);
         }
 	rtapi_print_msg(RTAPI_MSG_DBG, "\n" );
@@ -523,6 +552,7 @@ pid_t hal_systemv_nowait(char *const argv[], connectionRecType *context) {
 //	halcmd_error("execv(%s) failed\n", argv[0] );
         sprintf(errorStr, "execv(%s) failed", argv[0]);
         sockWriteError(nakStr, context);
+        rmtFlush(context->cliSock);
 	exit(1);
     }
     /* parent process */
@@ -2535,6 +2565,51 @@ static cmdResponseType getCommProt(char *s, connectionRecType *context)
   return rtNoError;
 }
 
+static void watchValue(connectionRecType *context, int i, char *value, size_t size)
+{
+  double v = context->watch.value[i];
+
+  switch (context->watch.type[i]) {
+    case HAL_BIT: snprintf(value, size, "%s", v != 0 ? "TRUE" : "FALSE"); break;
+    case HAL_FLOAT: snprintf(value, size, "%.7g", v); break;
+    case HAL_S32: snprintf(value, size, "%ld", (long) v); break;
+    case HAL_U32: snprintf(value, size, "%lu", (unsigned long) v); break;
+    default: snprintf(value, size, "?");
+    }
+}
+
+static cmdResponseType getWatch(char *s, connectionRecType *context)
+{
+  char value[32];
+  int i, len;
+
+  if (context->watchCount == 0) return rtStandardError;
+  hal_watch_read(&context->watch);
+  len = 0;
+  for (i = 0; i < context->watchCount; i++) {
+    watchValue(context, i, value, sizeof(value));
+    /* start a new line when this one is full */
+    if ((len > 0) && (len + strlen(value) + 4 > sizeof(context->outBuf))) {
+      sockWrite(context);
+      len = 0;
+      }
+    if (len == 0)
+      len = sprintf(context->outBuf, "WATCH %d", i);
+    len += sprintf(context->outBuf + len, " %s", value);
+    }
+  sockWrite(context);
+  return rtHandledNoError;
+}
+
+static cmdResponseType getPush(char *s, connectionRecType *context)
+{
+  const char *pPushStr = "PUSH %s";
+
+  if (context->push == 1) sprintf(context->outBuf, pPushStr, "ON");
+  else sprintf(context->outBuf, pPushStr, "OFF");
+  return rtNoError;
+}
+
 static cmdResponseType getComps(char *s, connectionRecType *context)
 {
   if (s == NULL) 
@@ -2690,7 +2765,7 @@ int commandGet(connectionRecType *context)
   
   pch = strtok(NULL, delims);
   if (pch == NULL) {
-    return write(context->cliSock, setNakStr, strlen(setNakStr));
+    return rmtWrite(context->cliSock, setNakStr, strlen(setNakStr));
     }
   strupr(pch);
   cmd = lookupHalCommand(pch);
@@ -2700,6 +2775,8 @@ int commandGet(connectionRecType *context)
     case hcEnable: ret = getEnable(pch, context); break;
     case hcConfig: ret = getConfig(pch, context); break;
     case hcCommMode: ret = getCommMode(pch, context); break;
+    case hcWatch: ret = getWatch(pch, context); break;
+    case hcPush: ret = getPush(pch, context); break;
     case hcCommProt: ret = getCommProt(pch, context); break;
     case hcComps: ret = getComps(strtok(NULL, delims), context); break;
     case hcPins: ret = getPins(strtok(NULL, delims), context); break;
@@ -2845,6 +2922,59 @@ static cmdResponseType setCommProt(char *s, connectionRecType *context)
   return rtNoError;
 }
 
+static cmdResponseType setWatch(char *s, connectionRecType *context)
+{
+  const char *names[context->watchCount + MAX_TOK + 1];
+  char (*list)[HAL_NAME_LEN + 1];
+  int i, count;
+
+  free(context->watchSent);
+  free(context->watchSentType);
+  context->watchSent = NULL;
+  context->watchSentType = NULL;
+  if (s == NULL) {
+    /* no names, empty the list */
+    hal_watch_free(&context->watch);
+    free(context->watchNames);
+    context->watchNames = NULL;
+    context->watchCount = 0;
+    return rtNoError;
+    }
+  count = context->watchCount;
+  for (i = 0; i < count; i++)
+    names[i] = context->watchNames[i];
+  while ((s != NULL) && (count < context->watchCount + MAX_TOK)) {
+    if (strlen(s) > HAL_NAME_LEN) return rtStandardError;
+    names[count++] = s;
+    s = strtok(NULL, delims);
+    }
+  if (s != NULL) return rtStandardError;
+  list = malloc(count * sizeof(*list));
+  if (list == NULL) return rtStandardError;
+  for (i = 0; i < count; i++)
+    snprintf(list[i], sizeof(list[i]), "%s", names[i]);
+  hal_watch_free(&context->watch);
+  free(context->watchNames);
+  context->watchNames = list;
+  context->watchCount = 0;
+  for (i = 0; i < count; i++)
+    names[i] = list[i];
+  if (hal_watch_new(&context->watch, count, names) < 0) return rtStandardError;
+  context->watchCount = count;
+  return rtNoError;
+}
+
+static cmdResponseType setPush(char *s, connectionRecType *context)
+{
+
+   switch (checkOnOff(s)) {
+     case -1: return rtStandardError;
+     case 0: context->push = 1; break;
+     case 1: context->push = 0;
+     }
+   return rtNoError;
+}
+
 static cmdResponseType setLoadRt(char *s, connectionRecType *context)
 {
   char *pch;
@@ -3059,17 +3189,18 @@ int commandSet(connectionRecType *context)
   
   pcmd = strtok(NULL, delims);
   if (pcmd == NULL) {
-    return write(context->cliSock, setNakStr, strlen(setNakStr));
+    return rmtWrite(context->cliSock, setNakStr, strlen(setNakStr));
     }
   strupr(pcmd);
   cmd = lookupHalCommand(pcmd);
   if ((cmd >= hcCommProt) && (context->cliSock != enabledConn)) {
     sprintf(context->outBuf, setCmdNakStr, pcmd);
-    return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+    return rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
     }
   pch = strtok(NULL, delims);
   i = 0;
-  while (pch != NULL) {
+  /* the watch list takes any number of names, it reads them itself */
+  while ((pch != NULL) && (cmd != hcWatch)) {
     tokens[i] = pch;
     i++;
     pch = strtok(NULL, delims);
@@ -3080,6 +3211,8 @@ int commandSet(connectionRecType *context)
     case hcEnable: ret = setEnable(tokens[0], context); break;
     case hcConfig: ret = setConfig(tokens[0], context); break;
     case hcCommMode: ret = setCommMode(tokens[0], context); break;
+    case hcWatch: ret = setWatch(pch, context); break;
+    case hcPush: ret = setPush(tokens[0], context); break;
     case hcCommProt: ret = setCommProt(tokens[0], context); break;
     case hcComps: break;
     case hcPins: break;
@@ -3124,17 +3257,17 @@ int commandSet(connectionRecType *context)
     case rtNoError:  
       if (context->verbose) {
         sprintf(context->outBuf, ackStr, pcmd);
-        retval = write(context->cliSock, context->outBuf, strlen(context->outBuf));
+        retval = rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
         }
       break;
     case rtHandledNoError: // Custom ok response already handled, take no action
       break; 
     case rtStandardError:
       sprintf(context->outBuf, setCmdNakStr, pcmd);
-      retval = write(context->cliSock, context->outBuf, strlen(context->outBuf));
+      retval = rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
       break;
     case rtCustomError: // Custom error response entered in buffer
-      retval = write(context->cliSock, context->outBuf, strlen(context->outBuf));
+      retval = rmtWrite(context->cliSock, context->outBuf, strlen(context->outBuf));
       break;
     case rtCustomHandledError: ;// Custom error respose handled, take no action
     }
@@ -3220,6 +3353,8 @@ static int helpGet(connectionRecType *context)
   strcat(context->outBuf, "    Thread <thread name>\n\r");
   strcat(context->outBuf, "    Threads\n\r");
   strcat(context->outBuf, "    Verbose\n\r");
+  strcat(context->outBuf, "    Push\n\r");
+  strcat(context->outBuf, "    Watch\n\r");
 //  strcat(outBuf, "CONFIG\n\r");
   sockWrite(context);
   return 0;
@@ -3235,7 +3370,9 @@ static int helpSet(connectionRecType *context)
   strcat(context->outBuf, "    Comm_prot <protocol>\n\r");
   strcat(context->outBuf, "    Echo <On | Off>\n\r");
   strcat(context->outBuf, "    Enable <Pwd | Off>\n\r");
-  strcat(context->outBuf, "    Verbose <On | Off>\n\r\n\r");
+  strcat(context->outBuf, "    Push <On | Off>\n\r");
+  strcat(context->outBuf, "    Verbose <On | Off>\n\r");
+  strcat(context->outBuf, "    Watch [<name 1> .. <name n>]\n\r\n\r");
   strcat(context->outBuf, "  The set commands requiring control enabled are:\n\r");
   strcat(context->outBuf, "    Addf <function name> <threadname> [<parameters>]\n\r");
   strcat(context->outBuf, "    Delf <function name>\n\r");
@@ -3338,16 +3475,16 @@ int parseCommand(connectionRecType *context)
     switch (lookupToken(pch)) {
       case cmdHello: 
         if (commandHello(context) == -1)
-          ret = write(context->cliSock, helloNakStr, strlen(helloNakStr));
+          ret = rmtWrite(context->cliSock, helloNakStr, strlen(helloNakStr));
         else 
-          ret = write(context->cliSock, s, strlen(s));
+          ret = rmtWrite(context->cliSock, s, strlen(s));
         break;
       case cmdGet: 
         ret = commandGet(context);
         break;
       case cmdSet:
         if (context->linked == 0)
-	  ret = write(context->cliSock, setNakStr, strlen(setNakStr));
+	  ret = rmtWrite(context->cliSock, setNakStr, strlen(setNakStr));
         else ret = commandSet(context);
         break;
       case cmdQuit: 
@@ -3365,19 +3502,13 @@ int parseCommand(connectionRecType *context)
   return ret;
 }  
 
-void *readClient(void *arg)
+static void *openClient(int fd, void *data)
 {
-  char str[1600];
-  char buf[1600];
-  unsigned int i, j;
-  int len;
-  int ret;
   connectionRecType *context;
-  
-  
-//  res = 1;
+
   context = (connectionRecType *) malloc(sizeof(connectionRecType));
-  context->cliSock = client_sockfd;
+  if (context == NULL) return NULL;
+  context->cliSock = fd;
   context->linked = 0;
   context->echo = 1;
   context->verbose = 0;
@@ -3386,46 +3517,71 @@ void *readClient(void *arg)
   connCount++;
   context->commMode = 0;
   context->commProt = 0;
+  context->watchCount = 0;
+  context->watchNames = NULL;
+  memset(&context->watch, 0, sizeof(context->watch));
+  context->push = 0;
+  context->watchSent = NULL;
+  context->watchSentType = NULL;
   context->inBuf[0] = 0;
-  buf[0] = 0;
-  
-  while (1) {
-    len = read(context->cliSock, &str, 1600);
-    if (len <= 0) goto finished;
-    str[len] = 0;
-    strcat(buf, str);
-    if (!memchr(str, 0x0d, strlen(str))) continue;
-    if ((context->echo == 1) && (context->linked == 1)) {
-      ret = write(context->cliSock, &buf, strlen(buf));
-      if (ret < 0) {
-        goto finished;
-      }
+  return context;
+}
+
+static int readClient(void *client, char *line, void *data)
+{
+  connectionRecType *context = (connectionRecType *) client;
+
+  if ((context->echo == 1) && (context->linked == 1)) {
+    rmtWrite(context->cliSock, line, strlen(line));
+    rmtWrite(context->cliSock, "\r\n", 2);
     }
-    i = 0;
-    j = 0;
-    while (i <= strlen(buf)) {
-      if ((buf[i] != '\n') && (buf[i] != '\r')) {
-        context->inBuf[j] = buf[i];
-	j++;
-	}
-      else
-        if (j > 0)
-          {
-  	    context->inBuf[j] = 0;
-            if (parseCommand(context) == -1) goto finished;
-	    j = 0;
-	}
-        i++;	
-      }
-    buf[0] = 0;
-    } 
+  snprintf(context->inBuf, sizeof(context->inBuf), "%s", line);
+  return parseCommand(context);
+}
+
+static void dropClient(void *client, void *data)
+{
+  connectionRecType *context = (connectionRecType *) client;
 
-finished:
-  close(context->cliSock);
+  /* the next client may get the same socket */
+  if (enabledConn == context->cliSock) enabledConn = -1;
+  hal_watch_free(&context->watch);
+  free(context->watchNames);
+  free(context->watchSent);
+  free(context->watchSentType);
   free(context);
-  pthread_exit((void *)0);
 }
-  
+
+/* send the watched values that changed since they were last sent */
+static void pushWatch(void *client, void *data)
+{
+  connectionRecType *context = (connectionRecType *) client;
+  char value[32];
+  int i, n;
+
+  if (!context->push || (context->watchCount == 0)) return;
+  n = context->watchCount;
+  if (context->watchSent == NULL) {
+    context->watchSent = malloc(n * sizeof(double));
+    context->watchSentType = malloc(n * sizeof(hal_type_t));
+    if ((context->watchSent == NULL) || (context->watchSentType == NULL)) return;
+    /* nothing sent yet, send everything */
+    for (i = 0; i < n; i++)
+      context->watchSentType[i] = (hal_type_t) -2;
+    }
+  hal_watch_read(&context->watch);
+  for (i = 0; i < n; i++) {
+    if ((context->watch.value[i] == context->watchSent[i]) &&
+        (context->watch.type[i] == context->watchSentType[i]))
+      continue;
+    context->watchSent[i] = context->watch.value[i];
+    context->watchSentType[i] = context->watch.type[i];
+    watchValue(context, i, value, sizeof(value));
+    sprintf(context->outBuf, "WATCH %d %s", i, value);
+    sockWrite(context);
+    }
+}
+
 /***********************************************************************
 *                            MAIN PROGRAM                              *
 ************************************************************************/ 
@@ -3439,20 +3595,16 @@ finished:
 
 int sockMain()
 {
-    pthread_t thrd;
-    int res;
-    
-    while (1) {
-      
-      client_len = sizeof(client_address);
-      client_sockfd = accept(server_sockfd,
-        (struct sockaddr *)&client_address, &client_len);
-      if (client_sockfd < 0) exit(0);
-      res = pthread_create(&thrd, NULL, readClient, (void *)NULL);
-      if (res != 0)
-        close(client_sockfd);
-     }
-    return 0;
+    rmt_server_t server;
+
+    memset(&server, 0, sizeof(server));
+    server.open = openClient;
+    server.line = readClient;
+    server.close = dropClient;
+    server.period = pushWatch;
+    server.period_ms = WATCH_PERIOD;
+    server.max_clients = maxSessions;
+    return rmtServe(server_sockfd, &server, &done);
 }
 
 int main(int argc, char **argv)
@@ -3601,8 +3753,8 @@ int main(int argc, char **argv)
     initSockets();
     /* HAL init is OK, let's process the command(s) */
     /* tell the signal handler we might have the mutex */
-    sockMain();
     hal_flag = 1;
+    sockMain();
     hal_exit(comp_id);
     if ( errorcount > 0 ) {
 	return 1;
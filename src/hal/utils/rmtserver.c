@@ -0,0 +1,381 @@
+/********************************************************************
+* Description: rmtserver.c
+*   Event loop for the line oriented remote control servers
+*   (halrmt and linuxcncrsh)
+*
+*   One thread waits on all client sockets with epoll, reads whatever
+*   arrived, hands the complete lines to the server and sends the
+*   queued replies, so that clients can pipeline commands and many
+*   clients cost no more than one.
+*
+* License: GPL Version 2
+* System: Linux
+********************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* accept4() */
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "rmtserver.h"
+
+#define RMT_EVENTS 64
+
+typedef struct {
+  int fd;
+  void *client;			/* what open() returned */
+  char *in;			/* received, not handled yet */
+  size_t inLen, inSize;
+  char *out;			/* queued, not sent yet */
+  size_t outLen, outSize;
+  unsigned events;		/* what epoll watches for */
+  int held;			/* lines are held back while busy */
+  int closing;			/* close once the output is sent */
+  int dead;			/* close now */
+} rmtClient;
+
+static rmtClient **clients = NULL;	/* indexed by file descriptor */
+static int clientsSize = 0;
+static int clientCount = 0;
+static int epfd = -1;
+
+static rmtClient *lookupClient(int fd)
+{
+  if ((fd < 0) || (fd >= clientsSize)) return NULL;
+  return clients[fd];
+}
+
+static int growBuf(char **buf, size_t *size, size_t need)
+{
+  size_t newSize;
+  char *p;
+
+  if (need <= *size) return 0;
+  newSize = *size ? *size : 256;
+  while (newSize < need) newSize *= 2;
+  p = realloc(*buf, newSize);
+  if (p == NULL) return -1;
+  *buf = p;
+  *size = newSize;
+  return 0;
+}
+
+static long long nowMs(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int rmtWrite(int fd, const void *buf, size_t len)
+{
+  rmtClient *c = lookupClient(fd);
+
+  if ((c == NULL) || c->dead) return -1;
+  if ((c->outLen + len > RMT_OUT_MAX) ||
+      (growBuf(&c->out, &c->outSize, c->outLen + len) < 0)) {
+    c->dead = 1;
+    return -1;
+    }
+  memcpy(c->out + c->outLen, buf, len);
+  c->outLen += len;
+  return len;
+}
+
+size_t rmtPending(int fd)
+{
+  rmtClient *c = lookupClient(fd);
+
+  return c ? c->outLen : 0;
+}
+
+const char *rmtQueued(int fd, size_t from)
+{
+  rmtClient *c = lookupClient(fd);
+
+  if ((c == NULL) || (from > c->outLen)) return NULL;
+  return c->out + from;
+}
+
+void rmtTruncate(int fd, size_t len)
+{
+  rmtClient *c = lookupClient(fd);
+
+  if ((c != NULL) && (len < c->outLen)) c->outLen = len;
+}
+
+/* send what the socket takes without blocking */
+static void sendSome(rmtClient *c)
+{
+  ssize_t n;
+
+  while ((c->outLen > 0) && !c->dead) {
+    n = send(c->fd, c->out, c->outLen, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n > 0) {
+      memmove(c->out, c->out + n, c->outLen - n);
+      c->outLen -= n;
+      }
+    else if ((n < 0) && (errno == EINTR))
+      continue;
+    else if ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+      break;
+    else {
+      c->dead = 1;
+      c->outLen = 0;
+      }
+    }
+}
+
+int rmtFlush(int fd)
+{
+  rmtClient *c = lookupClient(fd);
+  struct pollfd p;
+
+  if (c == NULL) return -1;
+  sendSome(c);
+  while ((c->outLen > 0) && !c->dead) {
+    p.fd = fd;
+    p.events = POLLOUT;
+    if (poll(&p, 1, 1000) <= 0) return -1;
+    sendSome(c);
+    }
+  return c->dead ? -1 : 0;
+}
+
+static void readSome(rmtClient *c)
+{
+  ssize_t n;
+
+  while (!c->dead && !c->closing) {
+    if ((c->inLen + 4096 > RMT_OUT_MAX) ||
+        (growBuf(&c->in, &c->inSize, c->inLen + 4096) < 0)) {
+      c->dead = 1;
+      return;
+      }
+    n = read(c->fd, c->in + c->inLen, c->inSize - c->inLen);
+    if (n > 0)
+      c->inLen += n;
+    else if (n == 0)
+      c->closing = 1;
+    else if (errno == EINTR)
+      continue;
+    else if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+      return;
+    else
+      c->dead = 1;
+    }
+}
+
+static int isBusy(rmt_server_t *server, rmtClient *c)
+{
+  return (server->busy != NULL) && server->busy(c->client, server->data);
+}
+
+static void handleLines(rmt_server_t *server, rmtClient *c)
+{
+  char line[RMT_LINE_MAX];
+  size_t start, from, i, len;
+
+  c->held = 0;
+  start = 0;
+  for (i = 0; i < c->inLen; i++) {
+    if ((c->in[i] != '\n') && (c->in[i] != '\r')) continue;
+    if ((i > start) && isBusy(server, c)) {
+      /* the rest waits until the client is no longer busy */
+      c->held = 1;
+      break;
+      }
+    from = start;
+    len = i - start;
+    start = i + 1;
+    if (len == 0) continue;
+    if (len >= sizeof(line)) len = sizeof(line) - 1;
+    memcpy(line, c->in + from, len);
+    line[len] = '\0';
+    if (server->line(c->client, line, server->data) == -1) {
+      /* forget the rest, the client is leaving */
+      c->closing = 1;
+      c->inLen = 0;
+      return;
+      }
+    if (c->dead) return;
+    }
+  memmove(c->in, c->in + start, c->inLen - start);
+  c->inLen -= start;
+}
+
+/* a closing client has nothing more to read; leaving EPOLLIN on would
+   report the end of file on every pass */
+static void watchEvents(rmtClient *c)
+{
+  struct epoll_event ev;
+  unsigned want;
+
+  want = c->closing ? 0 : EPOLLIN;
+  if (c->outLen > 0) want |= EPOLLOUT;
+  if (want == c->events) return;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = want;
+  ev.data.fd = c->fd;
+  epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+  c->events = want;
+}
+
+static void closeClient(rmt_server_t *server, rmtClient *c)
+{
+  epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+  server->close(c->client, server->data);
+  close(c->fd);
+  clients[c->fd] = NULL;
+  clientCount--;
+  free(c->in);
+  free(c->out);
+  free(c);
+}
+
+static void acceptClients(rmt_server_t *server, int listen_fd)
+{
+  struct epoll_event ev;
+  rmtClient *c;
+  rmtClient **p;
+  int fd, n;
+
+  while (1) {
+    fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      return;
+      }
+    if ((server->max_clients != -1) && (clientCount >= server->max_clients)) {
+      close(fd);
+      continue;
+      }
+    if (fd >= clientsSize) {
+      n = clientsSize ? clientsSize : 64;
+      while (n <= fd) n *= 2;
+      p = realloc(clients, n * sizeof(*clients));
+      if (p == NULL) {
+        close(fd);
+        continue;
+        }
+      memset(p + clientsSize, 0, (n - clientsSize) * sizeof(*clients));
+      clients = p;
+      clientsSize = n;
+      }
+    c = calloc(1, sizeof(*c));
+    if (c == NULL) {
+      close(fd);
+      continue;
+      }
+    c->fd = fd;
+    c->events = EPOLLIN;
+    clients[fd] = c;
+    clientCount++;
+    c->client = server->open(fd, server->data);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if ((c->client == NULL) || (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)) {
+      clients[fd] = NULL;
+      clientCount--;
+      if (c->client != NULL) server->close(c->client, server->data);
+      close(fd);
+      free(c);
+      }
+    }
+}
+
+int rmtServe(int listen_fd, rmt_server_t *server, volatile int *done)
+{
+  struct epoll_event ev, events[RMT_EVENTS];
+  rmtClient *c;
+  long long next, now;
+  int i, n, timeout, input, held;
+
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (epfd < 0) return -1;
+  fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = listen_fd;
+  if (epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) return -1;
+  next = nowMs() + server->period_ms;
+  held = 0;
+
+  while ((done == NULL) || !*done) {
+    timeout = -1;
+    if ((server->period != NULL) && (server->period_ms > 0)) {
+      now = nowMs();
+      timeout = next > now ? (int)(next - now) : 0;
+      }
+    if (held && ((timeout < 0) || (timeout > RMT_BUSY_MS)))
+      timeout = RMT_BUSY_MS;
+    n = epoll_wait(epfd, events, RMT_EVENTS, timeout);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+      }
+
+    // read everything that arrived
+    input = 0;
+    for (i = 0; i < n; i++) {
+      if (events[i].data.fd == listen_fd) {
+        acceptClients(server, listen_fd);
+        continue;
+        }
+      c = lookupClient(events[i].data.fd);
+      if (c == NULL) continue;
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        readSome(c);
+        if (c->inLen > 0) input = 1;
+        }
+      if (events[i].events & EPOLLOUT) sendSome(c);
+      }
+
+    // then handle the lines of all clients against one state; clients
+    // that are still busy keep theirs
+    if (input || held) {
+      if (server->tick != NULL) server->tick(server->data);
+      held = 0;
+      for (i = 0; i < clientsSize; i++) {
+        c = clients[i];
+        if ((c == NULL) || c->dead || (c->inLen == 0)) continue;
+        handleLines(server, c);
+        if (c->held) held = 1;
+        }
+      }
+
+    if ((server->period != NULL) && (server->period_ms > 0) &&
+        ((now = nowMs()) >= next)) {
+      if (server->tick != NULL) server->tick(server->data);
+      for (i = 0; i < clientsSize; i++) {
+        c = clients[i];
+        if ((c != NULL) && !c->dead && !c->closing)
+          server->period(c->client, server->data);
+        }
+      next += server->period_ms;
+      if (next <= now) next = now + server->period_ms;
+      }
+
+    // and send the replies
+    for (i = 0; i < clientsSize; i++) {
+      c = clients[i];
+      if (c == NULL) continue;
+      sendSome(c);
+      if (c->dead || (c->closing && !c->held && (c->outLen == 0)))
+        closeClient(server, c);
+      else
+        watchEvents(c);
+      }
+    }
+  return 0;
+}
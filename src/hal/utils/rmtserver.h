@@ -0,0 +1,72 @@
+/********************************************************************
+* Description: rmtserver.h
+*   Event loop for the line oriented remote control servers
+*   (halrmt and linuxcncrsh)
+*
+* License: GPL Version 2
+* System: Linux
+********************************************************************/
+
+#ifndef RMTSERVER_H
+#define RMTSERVER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RMT_LINE_MAX 1024		/* longer command lines are cut */
+#define RMT_OUT_MAX (1024 * 1024)	/* clients that fall further behind are dropped */
+#define RMT_BUSY_MS 10			/* how often busy clients are polled */
+
+/* One thread serves all clients.  Everything a client sent is read
+   first, then 'tick' is called once, then every complete line of every
+   client is handed to 'line', and then the replies are sent, so a
+   client may send many commands without waiting for each reply and
+   gets the replies of one pass in one write.  Replies are queued with
+   rmtWrite() by the file descriptor of the client.
+
+   A command that has to wait for something must not block the loop.
+   'busy' is asked before each line; while it returns nonzero the
+   client's lines are held back and it is asked again every pass, at
+   least every RMT_BUSY_MS.  Other clients are served meanwhile. */
+typedef struct {
+    /* a client connected, returns its state or NULL to refuse it */
+    void *(*open)(int fd, void *data);
+    /* one command line, without the line end; returns -1 to close */
+    int (*line)(void *client, char *line, void *data);
+    /* the client is gone, free its state */
+    void (*close)(void *client, void *data);
+    /* before the lines of a pass and before each period, may be NULL */
+    void (*tick)(void *data);
+    /* every 'period_ms' milliseconds for each client, may be NULL */
+    void (*period)(void *client, void *data);
+    /* nonzero to hold back the client's next line, may be NULL */
+    int (*busy)(void *client, void *data);
+    int period_ms;
+    int max_clients;			/* -1 for no limit */
+    void *data;
+} rmt_server_t;
+
+/* Serve clients that connect to 'listen_fd' until *done is set (it may
+   be NULL) or an error occurs.  Returns 0, or -1 with errno set. */
+extern int rmtServe(int listen_fd, rmt_server_t *server, volatile int *done);
+
+/* Queue output for a client.  Returns len, or -1 if fd is not a client
+   or the client is too far behind. */
+extern int rmtWrite(int fd, const void *buf, size_t len);
+/* Bytes queued for a client and not sent yet. */
+extern size_t rmtPending(int fd);
+/* The queued output of a client from byte 'from' on. */
+extern const char *rmtQueued(int fd, size_t from);
+/* Forget queued output past the first 'len' bytes. */
+extern void rmtTruncate(int fd, size_t len);
+/* Send queued output now, waiting if needed (e.g. before exiting). */
+extern int rmtFlush(int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,8 +26,12 @@
 #include <sys/time.h>		/* struct timeval, gettimeofday(), struct
 				   itimerval, setitimer(), ITIMER_REAL */
 #include <sched.h>
+#include <stdlib.h>		/* getenv() */
+#include <sys/ipc.h>		/* IPC_CREAT */
+#include <sys/shm.h>		/* shmget(), shmat() */
 
 #include "_timer.h"
+#include "rtapi_vclock.h"
 
 /* number of seconds in a system clock tick */
 double clk_tck()
@@ -43,8 +47,7 @@ double clk_tck()
 int etime_disabled = 0;
 double etime_disable_time = 0.0;
 
-/* number of seconds from some epoch, to clock tick resolution */
-double etime()
+static double wall_time(void)
 {
     struct timeval tp;
     double retval;
@@ -58,6 +61,74 @@ double etime()
     return retval;
 }
 
+/*
+ In a uspace simulation on a virtual clock (RTAPI_VIRTUAL_CLOCK, see
+ threads(9)) the time is that of the realtime threads, so that the
+ cycles and timeouts of task, iocontrol and the other programs follow
+ the simulated time.  The threads may be stopped: once the virtual clock
+ has stood still for VCLOCK_STALL seconds of wall time, the time follows
+ the wall clock until it moves again, so that timeouts still expire.
+ */
+#define VCLOCK_STALL 1.0
+
+static vclock_data_t *vclock_data = NULL;
+static int vclock_checked = 0;
+
+static vclock_data_t *vclock(void)
+{
+    void *mem;
+    int id;
+
+    if (vclock_checked) {
+	return vclock_data;
+    }
+    vclock_checked = 1;
+    if (getenv(VCLOCK_ENV) == NULL) {
+	return NULL;
+    }
+    /* created here if rtapi_app is not up yet, as rtapi does */
+    id = shmget((key_t) VCLOCK_KEY, sizeof(vclock_data_t), IPC_CREAT | 0600);
+    if (id == -1) {
+	rcs_print_error("etime: can't open the virtual clock: %s\n",
+	    strerror(errno));
+	return NULL;
+    }
+    mem = shmat(id, NULL, 0);
+    if (mem == (void *) -1) {
+	rcs_print_error("etime: can't map the virtual clock: %s\n",
+	    strerror(errno));
+	return NULL;
+    }
+    vclock_data = (vclock_data_t *) mem;
+    return vclock_data;
+}
+
+static double vclock_etime(void)
+{
+    static long long last = -1;
+    static double since = 0.0, stalled = 0.0;
+    long long now = vclock_data->now;
+    double wall = wall_time();
+
+    if (now != last) {
+	last = now;
+	since = wall;
+    } else if (wall - since > VCLOCK_STALL) {
+	stalled += wall - since - VCLOCK_STALL;
+	since = wall - VCLOCK_STALL;
+    }
+    return now * 1e-9 + stalled;
+}
+
+/* number of seconds from some epoch, to clock tick resolution */
+double etime()
+{
+    if (vclock()) {
+	return vclock_etime();
+    }
+    return wall_time();
+}
+
 int esleep_use_yield = 0;
 
 /* sleeps # of seconds */
@@ -70,6 +141,15 @@ void esleep(double seconds_to_sleep)
     double left = total;
     if (seconds_to_sleep <= 0.0)
 	return;
+    if (vclock()) {
+	/* poll until the simulated time has passed */
+	while (etime() < started + total) {
+	    tval.tv_sec = 0;
+	    tval.tv_usec = 100;
+	    select(0, NULL, NULL, NULL, &tval);
+	}
+	return;
+    }
     if (clk_tck_val <= 0) {
 	clk_tck_val = clk_tck();
     }
@@ -680,6 +680,7 @@ int rtapi_task_new(void (*taskcode) (void *), void *arg,
     }
     task->taskcode = taskcode;
     task->arg = arg;
+    task->cpu = rtapi_data->rt_cpu;
     /* call OS to initialize the task - use predetermined CPU */
     retval = rt_task_init_cpuid(ostask_array[task_id], wrapper, task_id,
 	 stacksize, prio, uses_fp, 0 /* signal */, rtapi_data->rt_cpu );
@@ -817,6 +818,50 @@ int rtapi_task_start(int task_id, unsigned long int period_nsec)
     return retval;
 }
 
+int rtapi_task_set_cpu(int task_id, int cpu)
+{
+    task_data *task;
+
+    /* validate task ID */
+    if ((task_id < 1) || (task_id > RTAPI_MAX_TASKS)) {
+	return -EINVAL;
+    }
+    task = &(task_array[task_id]);
+    if (task->state != PAUSED) {
+	return -EINVAL;
+    }
+    if (cpu < 0) {
+	cpu = rtapi_data->rt_cpu;
+    }
+    if (cpu >= NR_CPUS || !cpu_online(cpu)) {
+	return -EINVAL;
+    }
+    /* a 64 bit HAL value is written in two halves on a 32 bit kernel,
+       and a task on another processor could read half of it */
+    if (sizeof(long) < sizeof(double) && cpu != rtapi_data->rt_cpu) {
+	rtapi_print_msg(RTAPI_MSG_WARN,
+	    "RTAPI: task %02d: all tasks share cpu %d on a 32 bit system\n",
+	    task_id, rtapi_data->rt_cpu);
+	return -EINVAL;
+    }
+    rt_set_runnable_on_cpuid(ostask_array[task_id], cpu);
+    task->cpu = cpu;
+    rtapi_print_msg(RTAPI_MSG_DBG, "RTAPI: task %02d on cpu %d\n", task_id, cpu);
+    return 0;
+}
+
+int rtapi_task_get_cpu(int task_id)
+{
+    /* validate task ID */
+    if ((task_id < 1) || (task_id > RTAPI_MAX_TASKS)) {
+	return -EINVAL;
+    }
+    if (task_array[task_id].state == EMPTY) {
+	return -EINVAL;
+    }
+    return task_array[task_id].cpu;
+}
+
 void rtapi_wait(void)
 {
     int result = rt_task_wait_period();
@@ -854,6 +899,12 @@ void rtapi_wait(void)
     }
 }
 
+long rtapi_wait_lateness(void)
+{
+    /* RTAI keeps this to itself */
+    return 0;
+}
+
 int rtapi_task_resume(int task_id)
 {
     int retval;
@@ -1713,7 +1764,10 @@ EXPORT_SYMBOL(rtapi_prio_next_lower);
 EXPORT_SYMBOL(rtapi_task_new);
 EXPORT_SYMBOL(rtapi_task_delete);
 EXPORT_SYMBOL(rtapi_task_start);
+EXPORT_SYMBOL(rtapi_task_set_cpu);
+EXPORT_SYMBOL(rtapi_task_get_cpu);
 EXPORT_SYMBOL(rtapi_wait);
+EXPORT_SYMBOL(rtapi_wait_lateness);
 EXPORT_SYMBOL(rtapi_task_resume);
 EXPORT_SYMBOL(rtapi_task_pause);
 EXPORT_SYMBOL(rtapi_task_self);
@@ -384,6 +384,22 @@ RTAPI_BEGIN_DECLS
 */
     extern int rtapi_task_start(int task_id, unsigned long int period_nsec);
 
+/** 'rtapi_task_set_cpu()' asks for task 'task_id' to run on processor
+    'cpu' once it is started.  'cpu' -1 restores the default placement.
+    The task must be in the "paused" state.  Returns 0 on success,
+    -EINVAL for a bad task or processor, or -ENOSYS if the RTAPI cannot
+    place tasks.  Call only from within init/cleanup code, not from
+    realtime tasks.
+*/
+    extern int rtapi_task_set_cpu(int task_id, int cpu);
+
+/** 'rtapi_task_get_cpu()' returns the processor that task 'task_id'
+    runs on once started, or -1 if RTAPI does not decide that.  Returns
+    -EINVAL for a bad task.  Call only from within init/cleanup code,
+    not from realtime tasks.
+*/
+    extern int rtapi_task_get_cpu(int task_id);
+
 /** 'rtapi_wait()' suspends execution of the current task until the
     next period.  The task must be periodic, if not, the result is
     undefined.  The function will return at the beginning of the
@@ -391,6 +407,14 @@ RTAPI_BEGIN_DECLS
 */
     extern void rtapi_wait(void);
 
+/** 'rtapi_wait_lateness()' returns how late, in nanoseconds, the
+    current task was released at the start of its current period, or
+    0 where the RTAPI does not measure it.  Negative values mean it was
+    released early.  Call only from within a realtime task, after
+    rtapi_wait() has returned.
+*/
+    extern long rtapi_wait_lateness(void);
+
 /** 'rtapi_task_resume() starts a task in free-running mode. 'task_id'
     is a task ID from a call to rtapi_task_new().  The task must be in
     the "paused" state, or it will return -EINVAL.
@@ -410,7 +434,9 @@ RTAPI_BEGIN_DECLS
     or cleanup code, not just from the task that is to be paused.
     The task will resume execution when either rtapi_task_resume() or
     rtapi_task_start() is called.  May be called from init/cleanup code,
-    and from within realtime tasks.
+    and from within realtime tasks.  On uspace realtime a task can only
+    pause itself, and a resume that comes first makes the pause return
+    at once; other tasks get -ENOSYS.
 */
     extern int rtapi_task_pause(int task_id);
 
@@ -90,7 +90,7 @@
    against the code in the shared memory area.  If they don't match,
    the rtapi_init() call will faill.
 */
-static unsigned int rev_code = 1;  // increment this whenever you change the data structures
+static unsigned int rev_code = 2;  // increment this whenever you change the data structures
 
 /* These structs hold data associated with objects like tasks, etc. */
 
@@ -119,6 +119,7 @@ typedef struct {
     int owner;			/* owning module */
     void (*taskcode) (void *);	/* task code */
     void *arg;			/* task argument */
+    int cpu;			/* processor it runs on */
 } task_data;
 
 typedef struct {
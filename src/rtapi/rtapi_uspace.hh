@@ -37,6 +37,7 @@ struct rtapi_task {
   int uses_fp;
   size_t stacksize;
   int prio;
+  int cpu;			/* processor to run on, -1 for default */
   long period;
   struct timespec nextstart;
   unsigned ratio;
@@ -62,10 +63,13 @@ struct RtapiApp
     void unexpected_realtime_delay(rtapi_task *task, int nperiod=1);
     virtual int task_delete(int id) = 0;
     virtual int task_start(int task_id, unsigned long period_nsec) = 0;
+    int task_set_cpu(int task_id, int cpu);
+    int task_get_cpu(int task_id);
     virtual int task_pause(int task_id) = 0;
     virtual int task_resume(int task_id) = 0;
     virtual int task_self() = 0;
     virtual void wait() = 0;
+    virtual long wait_lateness() = 0;
     virtual unsigned char do_inb(unsigned int port) = 0;
     virtual void do_outb(unsigned char value, unsigned int port) = 0;
     virtual int run_threads(int fd, int (*callback)(int fd)) = 0;
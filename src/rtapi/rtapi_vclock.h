@@ -0,0 +1,31 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+#ifndef RTAPI_VCLOCK_H
+#define RTAPI_VCLOCK_H
+
+/* The virtual clock of uspace simulations, see threads(9).  With
+ * RTAPI_VIRTUAL_CLOCK in the environment, rtapi_app keeps the time of
+ * its tasks in this SysV shared memory segment.  rtapi_get_time() and
+ * rtapi_get_clocks() read it in realtime and ULAPI code, and etime() and
+ * esleep() of libnml read it in task, iocontrol and the other userspace
+ * programs, which do not use ULAPI.
+ */
+typedef struct {
+    volatile long long now;	/* virtual time, in nsec */
+} vclock_data_t;
+
+#define VCLOCK_KEY  0x48484c35 /* key for the virtual clock */
+#define VCLOCK_ENV  "RTAPI_VIRTUAL_CLOCK"
+
+#endif
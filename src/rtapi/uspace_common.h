@@ -16,6 +16,7 @@
 #include <sys/time.h>
 #include <time.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/utsname.h>
 #include <string.h>
 #include <unistd.h>
@@ -24,6 +25,7 @@
 
 #include <rtapi_errno.h>
 #include <rtapi_mutex.h>
+#include <rtapi_vclock.h>
 static int msg_level = RTAPI_MSG_ERR;	/* message printing level */
 
 #include <sys/ipc.h>		/* IPC_* */
@@ -255,6 +257,32 @@ int rtapi_get_msg_level() {
     return msg_level;
 }
 
+/* With RTAPI_VIRTUAL_CLOCK in the environment, rtapi_app steps its tasks
+ * by a virtual clock instead of the wall clock.  Every process sees that
+ * clock through rtapi_get_time() and rtapi_get_clocks(), which both count
+ * virtual nanoseconds.
+ */
+static vclock_data_t *vclock_data = 0;
+
+static int rtapi_is_virtual_clock(void) {
+    return getenv(VCLOCK_ENV) != NULL;
+}
+
+static void vclock_attach(void)
+{
+    void *mem;
+    int id;
+
+    if(vclock_data || !rtapi_is_virtual_clock()) return;
+    id = rtapi_shmem_new(VCLOCK_KEY, 0, sizeof(vclock_data_t));
+    if(id < 0 || rtapi_shmem_getptr(id, &mem) < 0) {
+        rtapi_print_msg(RTAPI_MSG_ERR,
+            "could not open shared memory for the virtual clock\n");
+        return;
+    }
+    vclock_data = (vclock_data_t *) mem;
+}
+
 #if defined(__i386) || defined(__amd64)
 #define rdtscll(val) ((val) = __builtin_ia32_rdtsc())
 #else
@@ -265,6 +293,7 @@ long long rtapi_get_clocks(void)
 {
     long long int retval;
 
+    if(vclock_data) return vclock_data->now;
     rdtscll(retval);
     return retval;
 }
@@ -286,6 +315,8 @@ int rtapi_init(const char *modname)
     int retval,id;
     void *uuid_mem;
 
+    vclock_attach();
+
     uuid_mem_id = rtapi_shmem_new(UUID_KEY,uuid_id,sizeof(uuid_data_t));
     if (uuid_mem_id < 0) {
         rtapi_print_msg(RTAPI_MSG_ERR,
@@ -325,6 +356,9 @@ static int detect_realtime() {
     int crit1, crit2 = 0, crit3 = 0;
     FILE *fd;
 
+    /* a virtual clock does not need, and is not helped by, realtime */
+    if (rtapi_is_virtual_clock()) return 0;
+
     uname(&u);
     crit1 = strcasestr (u.version, "PREEMPT RT") != 0;
 
@@ -521,7 +521,7 @@ struct rtapi_module {
 #define MODULE_OFFSET 32768
 
 rtapi_task::rtapi_task()
-    : magic{}, id{}, owner{}, stacksize{}, prio{},
+    : magic{}, id{}, owner{}, stacksize{}, prio{}, cpu{-1},
       period{}, nextstart{},
       ratio{}, arg{}, taskcode{}
 {}
@@ -530,18 +530,41 @@ namespace
 {
 struct PosixTask : rtapi_task
 {
-    PosixTask() : rtapi_task{}, thr{}
-    {}
+    PosixTask() : rtapi_task{}, thr{}, lock{}, spin_margin{}, wake_peak{},
+        lateness{}, vstate{}, vnext{}, started{}, woken{}
+    {
+        pthread_mutex_init(&wake_lock, 0);
+        pthread_cond_init(&wake_cond, 0);
+    }
+    ~PosixTask() {
+        pthread_cond_destroy(&wake_cond);
+        pthread_mutex_destroy(&wake_lock);
+    }
 
     pthread_t thr;                /* thread's context */
+    pthread_mutex_t *lock;        /* held while running, when not realtime */
+    long spin_margin;             /* ns spent spinning before each period */
+    long wake_peak;               /* decaying peak of sleep overshoot, ns */
+    long lateness;                /* ns late at the start of this period */
+    int vstate;                   /* VCLOCK_* state, 0 if not started */
+    long long vnext;              /* virtual time of the next period */
+    bool started;                 /* its thread has been created */
+    bool woken;                   /* resumed, and not paused since */
+    pthread_mutex_t wake_lock;    /* guards woken */
+    pthread_cond_t wake_cond;     /* signalled when woken is set */
 };
 
+#define VCLOCK_STARTING 1
+#define VCLOCK_RUNNING  2
+#define VCLOCK_WAITING  3
+
 struct Posix : RtapiApp
 {
-    Posix(int policy = SCHED_FIFO) : RtapiApp(policy), do_thread_lock(policy != SCHED_FIFO) {
+    Posix(int policy = SCHED_FIFO) : RtapiApp(policy), do_thread_lock(policy != SCHED_FIFO), next_cpu(0), spin_ns(0) {
         pthread_once(&key_once, init_key);
-        if(do_thread_lock)
-            pthread_mutex_init(&thread_lock, 0);
+        const char *env = getenv("RTAPI_SPIN_NS");
+        if(env && policy == SCHED_FIFO) spin_ns = std::max(0L, atol(env));
+        vclock_init();
     }
     int task_delete(int id);
     int task_start(int task_id, unsigned long period_nsec);
@@ -549,6 +572,7 @@ struct Posix : RtapiApp
     int task_resume(int task_id);
     int task_self();
     void wait();
+    long wait_lateness();
     struct rtapi_task *do_task_new() {
         return new PosixTask;
     }
@@ -557,7 +581,43 @@ struct Posix : RtapiApp
     int run_threads(int fd, int (*callback)(int fd));
     static void *wrapper(void *arg);
     bool do_thread_lock;
-    pthread_mutex_t thread_lock;
+    // Without realtime scheduling, tasks that share a processor take
+    // turns through that processor's lock so that a task runs its whole
+    // period undisturbed, as it would with SCHED_FIFO.
+    std::map<int, pthread_mutex_t> cpu_locks;
+    pthread_mutex_t *cpu_lock(int cpu);
+
+    std::vector<int> cpu_plan;
+    size_t next_cpu;
+    int default_cpu();
+    int other_task_cpu(rtapi_task *task);
+
+    // With RTAPI_SPIN_NS set, a task sleeps until shortly before its
+    // next period and spins on the clock for the rest.  That costs
+    // processor time but releases the task with far less jitter than
+    // the kernel's wakeup latency.  The value is the starting margin;
+    // each task then keeps its margin just above the sleep overshoot it
+    // observes.  Without realtime scheduling spinning only steals time
+    // from the other tasks, so it is left off.
+    long spin_ns;
+
+    // With RTAPI_VIRTUAL_CLOCK set, exactly one task runs at a time, and
+    // the scheduler releases whichever task is due first on the virtual
+    // clock (the higher priority, i.e. faster, one on a tie) as soon as
+    // every task has finished its period.  The virtual clock jumps to
+    // that task's period start.  The value of the variable limits how
+    // many times faster than the wall clock this may go; 0 or empty
+    // means as fast as possible.
+    bool vclock;
+    double vclock_speed;
+    long long vclock_wall0;
+    PosixTask *vclock_running;
+    pthread_mutex_t vclock_lock;
+    pthread_cond_t vclock_cond;
+    void vclock_init();
+    void vclock_schedule();
+    void vclock_wait(PosixTask *task);
+    void vclock_remove(PosixTask *task);
 
     static pthread_once_t key_once;
     static pthread_key_t key;
@@ -567,6 +627,7 @@ struct Posix : RtapiApp
 
     long long do_get_time(void) {
         struct timespec ts;
+        if(vclock) return vclock_data->now;
         clock_gettime(CLOCK_MONOTONIC, &ts);
         return ts.tv_sec * 1000000000LL + ts.tv_nsec;
     }
@@ -710,6 +771,11 @@ static int harden_rt()
 
 static RtapiApp *makeApp()
 {
+    if(rtapi_is_virtual_clock())
+    {
+        rtapi_print_msg(RTAPI_MSG_ERR, "Note: Using POSIX virtual clock\n");
+        return new Posix(SCHED_OTHER);
+    }
     if(harden_rt() < 0)
     {
         rtapi_print_msg(RTAPI_MSG_ERR, "Note: Using POSIX non-realtime\n");
@@ -797,6 +863,7 @@ int RtapiApp::task_new(void (*taskcode) (void*), void *arg,
   task->stacksize = stacksize;
   task->taskcode = taskcode;
   task->prio = prio;
+  task->cpu = -1;
   task->magic = TASK_MAGIC;
   task_array[n] = task;
 
@@ -815,6 +882,20 @@ rtapi_task *RtapiApp::get_task(int task_id) {
     return task;
 }
 
+int RtapiApp::task_set_cpu(int task_id, int cpu) {
+    rtapi_task *task = get_task(task_id);
+    if(!task) return -EINVAL;
+    if(cpu < -1 || cpu >= CPU_SETSIZE) return -EINVAL;
+    task->cpu = cpu;
+    return 0;
+}
+
+int RtapiApp::task_get_cpu(int task_id) {
+    rtapi_task *task = get_task(task_id);
+    if(!task) return -EINVAL;
+    return task->cpu;
+}
+
 void RtapiApp::unexpected_realtime_delay(rtapi_task *task, int nperiod) {
     static int printed = 0;
     if(!printed)
@@ -840,12 +921,99 @@ int Posix::task_delete(int id)
 
   pthread_cancel(task->thr);
   pthread_join(task->thr, 0);
+  if(vclock) vclock_remove(task);
   task->magic = 0;
   task_array[id] = 0;
   delete task;
   return 0;
 }
 
+// Parse a processor list in the format of /sys/devices/system/cpu/isolated,
+// e.g. "2-3,6", keeping the order it is written in.
+static void parse_cpu_list(const char *s, std::vector<int> &cpus)
+{
+    while(*s) {
+        char *end;
+        long first = strtol(s, &end, 10), last;
+        if(end == s) break;
+        last = first;
+        if(*end == '-') {
+            s = end + 1;
+            last = strtol(s, &end, 10);
+            if(end == s) break;
+        }
+        for(long cpu = first; cpu <= last; cpu++)
+            if(cpu >= 0 && cpu < CPU_SETSIZE) cpus.push_back(cpu);
+        s = end;
+        while(*s == ',' || *s == ' ' || *s == '\n') s++;
+    }
+}
+
+static std::vector<int> isolated_cpus()
+{
+    std::vector<int> cpus;
+    char buf[256];
+    FILE *f = fopen("/sys/devices/system/cpu/isolated", "r");
+    if(!f) return cpus;
+    if(fgets(buf, sizeof(buf), f)) parse_cpu_list(buf, cpus);
+    fclose(f);
+    return cpus;
+}
+
+// The processor for a task that did not ask for one.  RTAPI_CPUS lists
+// processors that are handed out in the order tasks are started, which is
+// fastest thread first; "isolated" stands for the isolated processors,
+// highest numbered first.  Once the list runs out, the remaining tasks
+// share its last entry.  Without RTAPI_CPUS every task shares the highest
+// isolated processor, or the highest online one if none are isolated.
+int Posix::default_cpu()
+{
+    if(cpu_plan.empty()) {
+        const char *env = getenv("RTAPI_CPUS");
+        if(env && !strcmp(env, "isolated")) {
+            cpu_plan = isolated_cpus();
+            std::reverse(cpu_plan.begin(), cpu_plan.end());
+        } else if(env) {
+            parse_cpu_list(env, cpu_plan);
+        }
+        if(cpu_plan.empty()) {
+            std::vector<int> isolated = isolated_cpus();
+            if(!isolated.empty())
+                cpu_plan.push_back(isolated.back());
+            else
+                cpu_plan.push_back(sysconf(_SC_NPROCESSORS_ONLN) - 1);
+        }
+    }
+    size_t i = std::min(next_cpu++, cpu_plan.size() - 1);
+    return cpu_plan[i];
+}
+
+// Where long is 32 bits a hal_float_t (and a 64 bit integer) is read and
+// written in two halves, so a task on another processor could see half
+// of an update.  There all tasks stay on the processor of the first one.
+static const bool split_cpus_ok = sizeof(long) >= sizeof(double);
+
+// The processor of a task that is already placed, or -1
+int Posix::other_task_cpu(rtapi_task *task)
+{
+    for(int n = 0; n < MAX_TASKS; n++) {
+        rtapi_task *t = task_array[n];
+        if(t && t != task && t->magic == TASK_MAGIC && t->period && t->cpu >= 0)
+            return t->cpu;
+    }
+    return -1;
+}
+
+pthread_mutex_t *Posix::cpu_lock(int cpu)
+{
+    auto it = cpu_locks.find(cpu);
+    if(it == cpu_locks.end()) {
+        it = cpu_locks.insert(std::make_pair(cpu, pthread_mutex_t())).first;
+        pthread_mutex_init(&it->second, 0);
+    }
+    return &it->second;
+}
+
 int Posix::task_start(int task_id, unsigned long int period_nsec)
 {
   auto task = ::get_task<PosixTask>(task_id);
@@ -859,10 +1027,23 @@ int Posix::task_start(int task_id, unsigned long int period_nsec)
   memset(&param, 0, sizeof(param));
   param.sched_priority = task->prio;
 
+  int nprocs = sysconf( _SC_NPROCESSORS_ONLN );
+  if(task->cpu < 0) task->cpu = default_cpu();
+  int shared = split_cpus_ok ? -1 : other_task_cpu(task);
+  if(shared >= 0 && task->cpu != shared) {
+      rtapi_print_msg(RTAPI_MSG_WARN,
+          "task %d: not on cpu %d, all tasks share cpu %d on a 32 bit system\n",
+          task->id, task->cpu, shared);
+      task->cpu = shared;
+  }
+  rtapi_print_msg(RTAPI_MSG_INFO, "task %d on cpu %d\n", task->id, task->cpu);
+
   cpu_set_t cpuset;
   CPU_ZERO(&cpuset);
-  int nprocs = sysconf( _SC_NPROCESSORS_ONLN );
-  CPU_SET(nprocs-1, &cpuset); // assumes processor numbers are contiguous
+  CPU_SET(task->cpu, &cpuset);
+
+  if(do_thread_lock)
+      task->lock = cpu_lock(task->cpu);
 
   pthread_attr_t attr;
   if(pthread_attr_init(&attr) < 0)
@@ -878,8 +1059,16 @@ int Posix::task_start(int task_id, unsigned long int period_nsec)
   if(nprocs > 1)
       if(pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset) < 0)
           return -errno;
+  if(vclock) {
+      pthread_mutex_lock(&vclock_lock);
+      task->vstate = VCLOCK_STARTING;
+      task->vnext = vclock_data->now;
+      pthread_mutex_unlock(&vclock_lock);
+  }
+
   if(pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task)) < 0)
       return -errno;
+  task->started = true;
 
   return 0;
 }
@@ -923,13 +1112,18 @@ void *Posix::wrapper(void *arg)
 
   pthread_setspecific(key, arg);
 
-  Posix &papp = reinterpret_cast<Posix&>(App());
-  if(papp.do_thread_lock)
-      pthread_mutex_lock(&papp.thread_lock);
-
-  struct timespec now;
-  clock_gettime(RTAPI_CLOCK, &now);
-  advance_clock(task->nextstart, now, task->period);
+  PosixTask *ptask = static_cast<PosixTask*>(task);
+  Posix &app = static_cast<Posix&>(App());
+  if(app.vclock) {
+      app.vclock_wait(ptask);
+  } else {
+      if(ptask->lock)
+          pthread_mutex_lock(ptask->lock);
+
+      struct timespec now;
+      clock_gettime(RTAPI_CLOCK, &now);
+      advance_clock(task->nextstart, now, task->period);
+  }
 
   /* call the task function with the task argument */
   (task->taskcode) (task->arg);
@@ -938,14 +1132,6 @@ void *Posix::wrapper(void *arg)
   return NULL;
 }
 
-int Posix::task_pause(int) {
-    return -ENOSYS;
-}
-
-int Posix::task_resume(int) {
-    return -ENOSYS;
-}
-
 int Posix::task_self() {
     struct rtapi_task *task = reinterpret_cast<rtapi_task*>(pthread_getspecific(key));
     if(!task) return -EINVAL;
@@ -958,11 +1144,32 @@ static bool ts_less(const struct timespec &ta, const struct timespec &tb) {
     return ta.tv_nsec < tb.tv_nsec;
 }
 
+static long ts_diff(const struct timespec &ta, const struct timespec &tb) {
+    return (ta.tv_sec - tb.tv_sec) * (long)ONE_SEC_IN_NS
+        + (ta.tv_nsec - tb.tv_nsec);
+}
+
+static inline void spin_pause() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// margin limits, in ns; the margin never takes more than half a period
+#define SPIN_MARGIN_MIN 2000
+#define SPIN_MARGIN_GUARD 1000
+
 void Posix::wait() {
-    if(do_thread_lock)
-        pthread_mutex_unlock(&thread_lock);
+    PosixTask *task = reinterpret_cast<PosixTask*>(pthread_getspecific(key));
+    if(task->lock)
+        pthread_mutex_unlock(task->lock);
     pthread_testcancel();
-    struct rtapi_task *task = reinterpret_cast<rtapi_task*>(pthread_getspecific(key));
+    if(vclock)
+    {
+        task->vnext += task->period;
+        vclock_wait(task);
+        return;
+    }
     advance_clock(task->nextstart, task->nextstart, task->period);
     struct timespec now;
     clock_gettime(RTAPI_CLOCK, &now);
@@ -971,13 +1178,167 @@ void Posix::wait() {
         if(policy == SCHED_FIFO)
             unexpected_realtime_delay(task);
     }
+    else if(spin_ns)
+    {
+        if(!task->spin_margin) {
+            task->wake_peak = spin_ns;
+            task->spin_margin = std::min(spin_ns, task->period / 2);
+        }
+        struct timespec target = task->nextstart;
+        target.tv_nsec -= task->spin_margin;
+        while(target.tv_nsec < 0) {
+            target.tv_nsec += ONE_SEC_IN_NS;
+            target.tv_sec--;
+        }
+        if(ts_less(now, target))
+        {
+            int res = rtapi_clock_nanosleep(RTAPI_CLOCK, TIMER_ABSTIME, &target, nullptr, &now);
+            if(res < 0) perror("clock_nanosleep");
+            clock_gettime(RTAPI_CLOCK, &now);
+
+            // follow the worst recent overshoot, letting it decay slowly
+            // so that one bad wakeup does not cost spinning forever
+            long over = ts_diff(now, target);
+            task->wake_peak -= task->wake_peak / 256;
+            if(over > task->wake_peak) task->wake_peak = over;
+            long margin = task->wake_peak + task->wake_peak / 4 + SPIN_MARGIN_GUARD;
+            margin = std::max(margin, (long)SPIN_MARGIN_MIN);
+            task->spin_margin = std::min(margin, task->period / 2);
+        }
+        while(ts_less(now, task->nextstart))
+        {
+            spin_pause();
+            clock_gettime(RTAPI_CLOCK, &now);
+        }
+    }
     else
     {
         int res = rtapi_clock_nanosleep(RTAPI_CLOCK, TIMER_ABSTIME, &task->nextstart, nullptr, &now);
         if(res < 0) perror("clock_nanosleep");
+        clock_gettime(RTAPI_CLOCK, &now);
+    }
+    task->lateness = ts_diff(now, task->nextstart);
+    if(task->lock)
+        pthread_mutex_lock(task->lock);
+}
+
+void Posix::vclock_init()
+{
+    vclock = false;
+    vclock_speed = 0;
+    vclock_wall0 = 0;
+    vclock_running = nullptr;
+    if(!rtapi_is_virtual_clock()) return;
+
+    vclock_attach();
+    if(!vclock_data) return;
+    vclock_data->now = 0;
+    vclock = true;
+    do_thread_lock = false;
+    vclock_speed = std::max(0., atof(getenv(VCLOCK_ENV)));
+    struct timespec ts;
+    clock_gettime(RTAPI_CLOCK, &ts);
+    vclock_wall0 = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    pthread_mutex_init(&vclock_lock, 0);
+    pthread_cond_init(&vclock_cond, 0);
+}
+
+// call with vclock_lock held
+void Posix::vclock_schedule()
+{
+    if(vclock_running) return;
+    PosixTask *next = nullptr;
+    for(int i = 0; i < MAX_TASKS; i++) {
+        auto task = ::get_task<PosixTask>(i);
+        if(!task || !task->vstate) continue;
+        // a task that is still starting up has not had its turn yet
+        if(task->vstate != VCLOCK_WAITING) return;
+        if(!next || task->vnext < next->vnext
+                || (task->vnext == next->vnext && task->prio > next->prio))
+            next = task;
     }
-    if(do_thread_lock)
-        pthread_mutex_lock(&thread_lock);
+    if(!next) return;
+    vclock_data->now = next->vnext;
+    vclock_running = next;
+    pthread_cond_broadcast(&vclock_cond);
+}
+
+static void unlock_mutex(void *arg)
+{
+    pthread_mutex_unlock(static_cast<pthread_mutex_t*>(arg));
+}
+
+void Posix::vclock_wait(PosixTask *task)
+{
+    pthread_mutex_lock(&vclock_lock);
+    pthread_cleanup_push(unlock_mutex, &vclock_lock);
+    task->vstate = VCLOCK_WAITING;
+    if(vclock_running == task) vclock_running = nullptr;
+    vclock_schedule();
+    while(vclock_running != task)
+        pthread_cond_wait(&vclock_cond, &vclock_lock);
+    task->vstate = VCLOCK_RUNNING;
+    pthread_cleanup_pop(1);
+
+    if(vclock_speed > 0) {
+        long long wall = vclock_wall0 + (long long)(task->vnext / vclock_speed);
+        struct timespec ts;
+        ts.tv_sec = wall / ONE_SEC_IN_NS;
+        ts.tv_nsec = wall % ONE_SEC_IN_NS;
+        rtapi_clock_nanosleep(RTAPI_CLOCK, TIMER_ABSTIME, &ts, nullptr, nullptr);
+    }
+}
+
+// call after the task's thread has exited, or from the task itself
+void Posix::vclock_remove(PosixTask *task)
+{
+    pthread_mutex_lock(&vclock_lock);
+    task->vstate = 0;
+    if(vclock_running == task) vclock_running = nullptr;
+    vclock_schedule();
+    pthread_mutex_unlock(&vclock_lock);
+}
+
+// Only a task can pause itself here; there is no way to stop another
+// thread at an arbitrary point.  A resume that comes before the pause is
+// not lost, the pause then returns at once.
+int Posix::task_pause(int task_id) {
+    auto task = ::get_task<PosixTask>(task_id);
+    if(!task) return -EINVAL;
+    if(task != pthread_getspecific(key)) return -ENOSYS;
+    if(task->lock)
+        pthread_mutex_unlock(task->lock);
+    // a paused task gives up its turns on the virtual clock; once it is
+    // resumed it runs alongside the task that woke it
+    if(vclock && task->vstate) vclock_remove(task);
+    pthread_mutex_lock(&task->wake_lock);
+    pthread_cleanup_push(unlock_mutex, &task->wake_lock);
+    while(!task->woken)
+        pthread_cond_wait(&task->wake_cond, &task->wake_lock);
+    task->woken = false;
+    pthread_cleanup_pop(1);
+    if(task->lock)
+        pthread_mutex_lock(task->lock);
+    return 0;
+}
+
+int Posix::task_resume(int task_id) {
+    auto task = ::get_task<PosixTask>(task_id);
+    if(!task) return -EINVAL;
+    // a task that never ran starts free running, at the base period as
+    // far as rtapi_wait() is concerned
+    if(!task->started) return task_start(task_id, period);
+    pthread_mutex_lock(&task->wake_lock);
+    task->woken = true;
+    pthread_cond_signal(&task->wake_cond);
+    pthread_mutex_unlock(&task->wake_lock);
+    return 0;
+}
+
+long Posix::wait_lateness() {
+    PosixTask *task = reinterpret_cast<PosixTask*>(pthread_getspecific(key));
+    if(!task) return 0;
+    return task->lateness;
 }
 
 unsigned char Posix::do_inb(unsigned int port)
@@ -1051,6 +1412,16 @@ int rtapi_task_start(int task_id, unsigned long period_nsec)
     return App().task_start(task_id, period_nsec);
 }
 
+int rtapi_task_set_cpu(int task_id, int cpu)
+{
+    return App().task_set_cpu(task_id, cpu);
+}
+
+int rtapi_task_get_cpu(int task_id)
+{
+    return App().task_get_cpu(task_id);
+}
+
 int rtapi_task_pause(int task_id)
 {
     return App().task_pause(task_id);
@@ -1071,6 +1442,11 @@ void rtapi_wait(void)
     App().wait();
 }
 
+long rtapi_wait_lateness(void)
+{
+    return App().wait_lateness();
+}
+
 void rtapi_outb(unsigned char byte, unsigned int port)
 {
     App().do_outb(byte, port);
@@ -0,0 +1,20 @@
+#!/bin/sh
+realtime start
+halcmd -f old.hal
+echo "# dry run"
+halcmd apply -n new.hal
+halcmd save netla
+echo "# failed apply"
+halcmd apply bad.hal || echo "apply failed"
+halcmd save netla
+halcmd save thread
+halcmd gets z
+halcmd getp scale.0.gain
+echo "# apply"
+halcmd apply new.hal
+halcmd save netla
+halcmd save thread
+halcmd getp scale.0.gain
+halcmd getp scale.1.gain
+halcmd unload all
+realtime stop
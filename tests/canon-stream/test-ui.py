@@ -0,0 +1,99 @@
+#!/usr/bin/env python
+
+import linuxcnc
+
+import time
+import sys
+import os
+import glob
+
+
+def wait_for_idle(timeout=10):
+    start = time.time()
+    while (time.time() - start) < timeout:
+        s.poll()
+        if s.interp_state == linuxcnc.INTERP_IDLE and s.queue == 0:
+            return
+        time.sleep(0.05)
+    print "timeout waiting for the interpreter to go idle"
+    sys.exit(1)
+
+
+def stream():
+    """inode of the recorded stream, a new one each time it is recorded"""
+    files = glob.glob("cache/*.ngcs")
+    if len(files) != 1:
+        print "ERROR: expected one stream in cache/, found %s" % files
+        sys.exit(1)
+    return os.stat(files[0]).st_ino
+
+
+def mdi(*commands):
+    c.mode(linuxcnc.MODE_MDI)
+    c.wait_complete()
+    for command in commands:
+        c.mdi(command)
+        c.wait_complete()
+    wait_for_idle()
+
+
+def run(x):
+    """set #<_x>, clear the G55 offset, go back to the start position
+    and run the program, which sets the G55 X offset to #<_x> and moves
+    to X#<_x>"""
+    mdi("#<_x>=%d" % x, "g10 l2 p2 x0", "g0 x0")
+
+    c.mode(linuxcnc.MODE_AUTO)
+    c.wait_complete()
+    c.program_open(os.path.abspath("move.ngc"))
+    c.wait_complete()
+    c.auto(linuxcnc.AUTO_RUN, 0)
+    c.wait_complete()
+    time.sleep(0.5)
+    wait_for_idle()
+
+    s.poll()
+    print "#<_x>=%d: program ended at X%.4f" % (x, s.position[0])
+    if abs(s.position[0] - x) > 1e-6:
+        print "ERROR: expected X%d" % x
+        sys.exit(1)
+
+    # the interpreter is left as the program left it
+    mdi("g55 g0 x0")
+    s.poll()
+    print "G55 X0 is at X%.4f" % s.position[0]
+    if abs(s.position[0] - x) > 1e-6:
+        print "ERROR: expected the G55 X offset to be %d" % x
+        sys.exit(1)
+    mdi("g54")
+
+
+c = linuxcnc.command()
+s = linuxcnc.stat()
+e = linuxcnc.error_channel()
+
+c.state(linuxcnc.STATE_ESTOP_RESET)
+c.state(linuxcnc.STATE_ON)
+c.wait_complete()
+
+# the first run is recorded
+run(1)
+first = stream()
+
+# a changed parameter must not replay the motion recorded for the old
+# value; the run is recorded again
+run(2)
+second = stream()
+if second == first:
+    print "ERROR: the stream was not recorded again after #<_x> changed"
+    sys.exit(1)
+
+# unchanged parameters replay that recording
+run(2)
+if stream() != second:
+    print "ERROR: the stream was recorded again although nothing changed"
+    sys.exit(1)
+print "unchanged parameters replayed the stream"
+
+# if we get here it all worked!
+sys.exit(0)
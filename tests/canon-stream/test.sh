@@ -0,0 +1,7 @@
+#!/bin/bash
+
+rm -rf cache
+mkdir cache
+
+linuxcnc -r canon-stream.ini
+exit $?
@@ -0,0 +1,77 @@
+#!/usr/bin/env python
+
+import linuxcnc
+
+import time
+import sys
+import os
+
+
+def wait_for_idle(timeout=20):
+    start = time.time()
+    while (time.time() - start) < timeout:
+        s.poll()
+        if s.interp_state == linuxcnc.INTERP_IDLE and s.queue == 0:
+            return
+        time.sleep(0.05)
+    print "timeout waiting for the interpreter to go idle"
+    sys.exit(1)
+
+
+def mdi(*commands):
+    c.mode(linuxcnc.MODE_MDI)
+    c.wait_complete()
+    for command in commands:
+        c.mdi(command)
+        c.wait_complete()
+    wait_for_idle()
+
+
+def run(line, g92, expected):
+    """go to machine X0 with a G92 offset of g92, run the program from
+    line and check that it ends at machine X expected"""
+    mdi("g92.1", "g0 x0")
+    if g92:
+        mdi("g92 x%d" % -g92)
+
+    c.mode(linuxcnc.MODE_AUTO)
+    c.wait_complete()
+    c.auto(linuxcnc.AUTO_RUN, line)
+    c.wait_complete()
+    time.sleep(0.5)
+    wait_for_idle()
+
+    s.poll()
+    print "from line %d with G92 X offset %d: ended at X%.4f" % \
+        (line, g92, s.position[0])
+    if abs(s.position[0] - expected) > 1e-6:
+        print "ERROR: expected X%d" % expected
+        sys.exit(1)
+
+
+c = linuxcnc.command()
+s = linuxcnc.stat()
+e = linuxcnc.error_channel()
+
+c.state(linuxcnc.STATE_ESTOP_RESET)
+c.state(linuxcnc.STATE_ON)
+c.wait_complete()
+
+c.mode(linuxcnc.MODE_AUTO)
+c.wait_complete()
+c.program_open(os.path.abspath("moves.ngc"))
+c.wait_complete()
+
+# the run from the top takes a checkpoint every other line, all with
+# the G92 offset active
+run(0, 1, 9)
+
+# the checkpoint it resumes at carries the same offset
+run(6, 1, 9)
+
+# with the offset cleared the checkpoints are stale; the run must not
+# bring the old offset back
+run(6, 0, 8)
+
+# if we get here it all worked!
+sys.exit(0)
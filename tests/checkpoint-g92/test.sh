@@ -0,0 +1,6 @@
+#!/bin/bash
+
+rm -f sim.var
+
+linuxcnc -r checkpoint-g92.ini
+exit $?
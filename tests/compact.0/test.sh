@@ -0,0 +1,23 @@
+#!/bin/sh
+used() {
+    halcmd status mem | sed -n 's/.*shared memory: *\([0-9]*\)\/.*/\1/p'
+}
+realtime start
+halcmd -f test.hal
+halcmd compact > /dev/null
+a=$(used)
+halcmd compact > /dev/null
+b=$(used)
+echo "second compact used $((b - a)) more bytes"
+halcmd delf scale.0 fast
+halcmd addf scale.0 fast
+halcmd compact > /dev/null
+c=$(used)
+echo "reordered compact used $((c - b)) more bytes"
+halcmd gets x
+halcmd start
+sleep 0.1
+halcmd stop
+halcmd getp scale.1.out
+halcmd unload all
+realtime stop
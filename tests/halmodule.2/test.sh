@@ -0,0 +1,56 @@
+#!/bin/sh
+realtime start
+python <<EOF
+import hal
+import os
+import struct
+h = hal.component("x")
+try:
+    h.newpin("f", hal.HAL_FLOAT, hal.HAL_OUT)
+    h.newpin("s", hal.HAL_S32, hal.HAL_OUT)
+    h.newpin("b", hal.HAL_BIT, hal.HAL_OUT)
+    h.newparam("u", hal.HAL_U32, hal.HAL_RW)
+    h.ready()
+    h["f"] = 1.5
+    h["s"] = -3
+    h["b"] = True
+    h["u"] = 7
+
+    w = hal.watch(["x.f", "x.s", "x.b", "x.u", "later"])
+    print "names", w.names
+    print "len", len(w)
+    print "read", w.read()
+    print "values", w.values
+    print "types", w.types == (hal.HAL_FLOAT, hal.HAL_S32, hal.HAL_BIT,
+                               hal.HAL_U32, -1)
+
+    # a signal created after the watch is found by the next read
+    os.system("halcmd newsig later u32 && halcmd sets later 9")
+    h["s"] = 4
+    print "read", w.read()
+    print "values", w.values
+    print "items", w[1], w[4]
+
+    # the buffer holds the values of the last read
+    print "buffer", struct.unpack("5d", str(buffer(w)))
+
+    # a pin linked to a signal is read from the signal
+    os.system("halcmd net fsig x.f")
+    h["f"] = 2.5
+    w.read()
+    print "values", w.values
+
+    try:
+        w.__init__(["x.f"])
+        print "reinit", "ok"
+    except RuntimeError:
+        print "reinit", "fail"
+    print "len", len(w)
+except:
+    import traceback
+    print "Exception:", traceback.format_exc()
+    raise
+finally:
+    h.exit()
+EOF
+realtime stop
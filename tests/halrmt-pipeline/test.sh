@@ -0,0 +1,52 @@
+#!/bin/bash
+realtime start
+
+for i in $(seq 0 199); do
+    echo "newsig sig$(printf %03d $i) s32"
+    echo "sets sig$(printf %03d $i) $((i * 3 - 100))"
+done | halcmd -f
+
+halrmt --port 5006 >/dev/null &
+HALRMT=$!
+
+python <<EOF
+import socket
+import time
+
+def connect():
+    for i in range(80):
+        try:
+            return socket.create_connection(("localhost", 5006))
+        except socket.error:
+            time.sleep(0.25)
+    raise SystemExit("connection to halrmt timed out")
+
+# a runs through the signals forwards, b backwards
+order = {"a": range(200), "b": range(199, -1, -1)}
+socks = {}
+for name in "ab":
+    socks[name] = connect()
+for name in "ab":
+    cmds = ["hello EMC %s 1.0" % name, "set echo off"]
+    cmds += ["get sigval sig%03d" % i for i in order[name]]
+    cmds += ["quit"]
+    socks[name].sendall("".join(c + "\r\n" for c in cmds))
+
+for name in "ab":
+    data = ""
+    while True:
+        chunk = socks[name].recv(65536)
+        if not chunk:
+            break
+        data += chunk
+    lines = [l.split() for l in data.split("\r\n") if l]
+    print name, " ".join(lines[0])
+    print name, " ".join(lines[1])
+    want = [["SIGNALVAL", "sig%03d" % i, str(i * 3 - 100)] for i in order[name]]
+    print name, "replies", len(lines) - 2, lines[2:] == want
+EOF
+
+kill $HALRMT
+wait $HALRMT
+halcmd unload all
+realtime stop
@@ -0,0 +1,65 @@
+#!/bin/bash
+
+rm -f gcode-output
+
+linuxcnc -r linuxcncrsh-test.ini &
+
+
+# let linuxcnc come up
+TOGO=80
+while [  $TOGO -gt 0 ]; do
+    echo trying to connect to linuxcncrsh TOGO=$TOGO
+    if nc -z localhost 5007; then
+        break
+    fi
+    sleep 0.25
+    TOGO=$(($TOGO - 1))
+done
+if [  $TOGO -eq 0 ]; then
+    echo connection to linuxcncrsh timed out
+    exit 1
+fi
+
+
+python <<EOF
+import socket
+
+def read_until(s, data, last):
+    while last not in data:
+        chunk = s.recv(65536)
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+a = socket.create_connection(("localhost", 5007))
+b = socket.create_connection(("localhost", 5007))
+
+# the whole session in one write; with set_wait done linuxcncrsh holds
+# each command until the one before it is done
+cmds = ["hello EMC a 1.0", "set enable EMCTOO", "set set_wait done",
+        "set mode manual", "set estop off", "set machine on", "set mode mdi"]
+cmds += ["set mdi m100 p%d q%d" % (i, -i) for i in range(1, 21)]
+cmds += ["get plat"]
+a.sendall("".join(c + "\r\n" for c in cmds))
+
+# b is answered while a is waiting on its mdi commands
+cmds = ["hello EMC b 1.0", "set echo off"]
+cmds += ["get plat"] * 200
+cmds += ["quit"]
+b.sendall("".join(c + "\r\n" for c in cmds))
+data = read_until(b, "", "\0")
+lines = [l for l in data.split("\r\n") if l]
+print "b", len(lines), lines.count("PLAT Linux")
+
+# the echo of the last get comes after every mdi command is done
+read_until(a, "", "get plat\r\n")
+a.sendall("shutdown\r\n")
+read_until(a, "", "\0")
+EOF
+
+
+# wait for linuxcnc to finish
+wait
+
+exit 0
@@ -0,0 +1,71 @@
+#!/bin/sh
+realtime start
+
+for count in 0 9; do
+    if halcmd loadrt servobench count=$count 2>/dev/null; then
+        echo "count=$count loaded"
+    else
+        echo "count=$count refused"
+    fi
+done
+
+halcmd -f <<EOF
+loadrt threads name1=fast period1=1000000
+loadrt servobench
+addf servobench.0.start fast 1
+addf servobench.0.sample fast
+net tt fast.time servobench.0.thread-time
+net f0 servobench.0.funct-00
+net f1 servobench.0.funct-01
+net f2 servobench.0.funct-02
+net f3 servobench.0.funct-03
+sets f0 5
+sets f1 16
+sets f2 100
+sets f3 1000
+start
+EOF
+sleep 1
+halcmd stop
+
+python <<EOF
+import hal
+import imp
+import os
+from distutils.spawn import find_executable
+
+sb = imp.load_source("servo_bench", find_executable("servo-bench"))
+values = [5, 16, 100, 1000, 0]
+h = hal.component("test")
+try:
+    data = sb.read_shm(h, 0)
+    periods = data["periods"]
+    print "periods", periods > 0
+    print "latency count", sum(data["hist"][0]) == periods
+    print "thread count", sum(data["hist"][1]) == periods - 1
+    bins = []
+    for i, v in enumerate(values):
+        hist = data["hist"][2 + i]
+        bins.append([b for b, n in enumerate(hist) if n])
+        if hist[bins[-1][0]] != periods:
+            print "funct-%02d" % i, "count", hist[bins[-1][0]]
+        # the bin servo-bench reports must hold the value
+        b = bins[-1][0]
+        if not (b == 0 or sb.bin_top(b - 1) < v) or sb.bin_top(b) < v:
+            print "funct-%02d" % i, "bin_top", b, sb.bin_top(b)
+    print "bins", bins
+    print "max", list(data["max"][2:7])
+    print "worst", list(data["worst"][2:7])
+    print "p50", [sb.percentile(data["hist"][2 + i], data["max"][2 + i], 50)
+                  for i in range(5)]
+
+    os.system("halcmd setp servobench.0.reset 1 && halcmd start "
+              "&& sleep 0.1 && halcmd stop")
+    data = sb.read_shm(h, 0)
+    print "after reset", data["periods"], sum(map(sum, data["hist"]))
+finally:
+    h.exit()
+EOF
+
+halcmd unload all
+realtime stop
@@ -0,0 +1,7 @@
+#!/bin/sh
+# give the uspace thread and its worker different processors
+export RTAPI_CPUS=0,1
+realtime start
+halcmd -f test.hal
+halcmd unload all
+realtime stop